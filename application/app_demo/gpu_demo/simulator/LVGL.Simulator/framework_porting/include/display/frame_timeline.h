@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2020 Actions Technology Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Display frame timeline
+ *
+ * Records the timestamps of every frame from the start of drawing to the
+ * completion of the panel transfer into a ring buffer, to measure the frame
+ * pacing and latency across surface and display composer. Only the frames of
+ * the display primary surface (SURFACE_FRAME_TIMELINE) are recorded, so that
+ * one draw sequence matches one post sequence.
+ */
+
+#ifndef ZEPHYR_FRAMEWORK_INCLUDE_DISPLAY_FRAME_TIMELINE_H_
+#define ZEPHYR_FRAMEWORK_INCLUDE_DISPLAY_FRAME_TIMELINE_H_
+
+/**
+ * @brief Display Frame Timeline Interface
+ * @defgroup frame_timeline_interface Display Frame Timeline Interface
+ * @ingroup display_libraries
+ * @{
+ */
+
+#include <stdint.h>
+#include <errno.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum frame_timeline_event
+ * @brief Enumeration with the frame timeline events
+ *
+ */
+enum frame_timeline_event {
+	/* surface_begin_frame() entered */
+	FRAME_TL_DRAW_START = 0,
+	/* back buffer available and swap copy done, drawing really starts */
+	FRAME_TL_SWAP_DONE,
+	/* last surface_end_draw() of the frame, the frame is posted */
+	FRAME_TL_DRAW_END,
+	/* composer starts transferring the first part of the frame */
+	FRAME_TL_POST_START,
+	/* panel completes transferring the last part of the frame */
+	FRAME_TL_PANEL_CPLT,
+
+	FRAME_TL_NUM_EVENTS,
+
+	/* TE/vsync signal, not stored per frame */
+	FRAME_TL_VSYNC = FRAME_TL_NUM_EVENTS,
+	/* the panel transfer of the frame crossed a vsync */
+	FRAME_TL_OVER_VSYNC,
+};
+
+/**
+ * @enum frame_timeline_stage
+ * @brief Enumeration with the frame stages measured
+ *
+ */
+enum frame_timeline_stage {
+	/* DRAW_START -> SWAP_DONE: wait back buffer and swap copy */
+	FRAME_TL_STAGE_SWAP_WAIT = 0,
+	/* SWAP_DONE -> DRAW_END: drawing */
+	FRAME_TL_STAGE_DRAW,
+	/* DRAW_END -> POST_START: wait for vsync and previous posts */
+	FRAME_TL_STAGE_POST_WAIT,
+	/* POST_START -> PANEL_CPLT: panel transfer */
+	FRAME_TL_STAGE_TRANSFER,
+	/* DRAW_START -> PANEL_CPLT: end-to-end latency */
+	FRAME_TL_STAGE_TOTAL,
+	/* POST_START -> POST_START of the next frame: frame interval */
+	FRAME_TL_STAGE_INTERVAL,
+
+	FRAME_TL_NUM_STAGES,
+};
+
+/* frames posted 1, 2, 3 and more than 3 vsyncs after the previous one */
+#define FRAME_TL_NUM_VSYNC_GAPS  4
+
+/**
+ * @struct frame_timeline_percentiles
+ * @brief Structure holding the percentiles of one stage in microseconds
+ *
+ */
+typedef struct frame_timeline_percentiles {
+	uint32_t p50;
+	uint32_t p90;
+	uint32_t p99;
+	uint32_t max;
+} frame_timeline_percentiles_t;
+
+/**
+ * @struct frame_timeline_stats
+ * @brief Structure holding the frame timeline statistics
+ *
+ */
+typedef struct frame_timeline_stats {
+	/* number of completed frames in the ring buffer the percentiles computed from */
+	uint16_t num_frames;
+	frame_timeline_percentiles_t stages[FRAME_TL_NUM_STAGES];
+
+	/* last measured vsync period in microseconds */
+	uint32_t vsync_period;
+	/* histogram of vsyncs passed between the posts of consecutive frames */
+	uint32_t vsync_gaps[FRAME_TL_NUM_VSYNC_GAPS];
+	/* vsyncs passed without a new frame posted while frames were drawn */
+	uint32_t missed_vsync_cnt;
+	/* frames whose panel transfer crossed a vsync */
+	uint32_t over_vsync_cnt;
+	/* frames drawn but never transferred */
+	uint32_t lost_cnt;
+} frame_timeline_stats_t;
+
+#ifdef CONFIG_DISPLAY_FRAME_TIMELINE
+
+/**
+ * @brief Record one frame timeline event
+ *
+ * Can be called in both thread and isr context.
+ *
+ * @param event event id, see enum frame_timeline_event
+ *
+ * @retval N/A
+ */
+void frame_timeline_mark(uint8_t event);
+
+/**
+ * @brief Compute the frame timeline statistics
+ *
+ * @param stats address to store the statistics
+ *
+ * @retval 0 on success else negative errno code.
+ */
+int frame_timeline_get_stats(frame_timeline_stats_t *stats);
+
+/**
+ * @brief Clear the recorded frames and statistics
+ *
+ * @retval N/A
+ */
+void frame_timeline_reset(void);
+
+#else
+
+static inline void frame_timeline_mark(uint8_t event) { }
+static inline int frame_timeline_get_stats(frame_timeline_stats_t *stats) { return -ENOSYS; }
+static inline void frame_timeline_reset(void) { }
+
+#endif /* CONFIG_DISPLAY_FRAME_TIMELINE */
+
+#ifdef __cplusplus
+}
+#endif
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_FRAMEWORK_INCLUDE_DISPLAY_FRAME_TIMELINE_H_ */
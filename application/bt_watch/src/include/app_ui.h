@@ -376,6 +376,7 @@ struct event_ui_map {
 				lvgl_freetype_font_set_emoji_font(font, emoji_path)
 #  define LVGL_FONT_SET_DEFAULT_CODE(font, code, emoji_code) \
 				lvgl_freetype_font_set_default_code(font, code, emoji_code)
+#  define LVGL_FONT_PREFETCH_TEXT(font, txt)
 #elif defined(CONFIG_LVGL_USE_BITMAP_FONT)
 #  define LVGL_FONT_OPEN_DEFAULT(font, size) lvgl_bitmap_font_open(font, DEF_FONT_FILE(size))
 #  define LVGL_FONT_OPEN(font, path, size)   lvgl_bitmap_font_open(font, path)
@@ -384,11 +385,14 @@ struct event_ui_map {
 				lvgl_bitmap_font_set_emoji_font(font, emoji_path)
 #  define LVGL_FONT_SET_DEFAULT_CODE(font, code, emoji_code) \
 				lvgl_bitmap_font_set_default_code(font, code, emoji_code)
+#  define LVGL_FONT_PREFETCH_TEXT(font, txt) \
+				lvgl_bitmap_font_prefetch_text(font, txt)
 #else
 #  define LVGL_FONT_OPEN_DEFAULT(font, size)                 (-ENOSYS)
 #  define LVGL_FONT_CLOSE(font)
 #  define LVGL_FONT_SET_EMOJI(font, emoji_path)              (-ENOSYS)
 #  define LVGL_FONT_SET_DEFAULT_CODE(font, code, emoji_code) (-ENOSYS)
+#  define LVGL_FONT_PREFETCH_TEXT(font, txt)
 #endif /* CONFIG_LVGL_USE_FREETYPE_FONT */
 
 static inline void lvgl_style_array_reset(lv_style_t * styles, int num)
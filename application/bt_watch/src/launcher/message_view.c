@@ -444,6 +444,7 @@ static int _show_message_content(view_data_t *view_data, const message_desc_t *m
 	lv_obj_t *obj_name = lv_label_create(data->box);
 	lv_obj_add_style(obj_name, &data->sty_box_name, LV_PART_MAIN);
 	lv_label_set_long_mode(obj_name, LV_LABEL_LONG_CLIP /* LV_LABEL_LONG_SCROLL_CIRCULAR */);
+	LVGL_FONT_PREFETCH_TEXT(&data->font, msg->name);
 	lv_label_set_text(obj_name, msg->name);
 
 	lv_obj_t *obj_text_box = lv_obj_create(data->box);
@@ -458,6 +459,8 @@ static int _show_message_content(view_data_t *view_data, const message_desc_t *m
 #ifdef CONFIG_BITMAP_FONT_SUPPORT_EMOJI
 	text_canvas_set_emoji_enable(obj_text, true);
 #endif
+	/* only the head of a long message, shown first, fits in the prefetch */
+	LVGL_FONT_PREFETCH_TEXT(&data->font_small, msg->text);
 	text_canvas_set_text_static(obj_text, msg->text);
 
 	/* refresh the visible content ASAP */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2016 Actions Semi Co., Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief audio mixer.
+ *
+ * Saturating mix of pcm in Q15/Q31. On cores with the DSP extension,
+ * two samples of 16 bits are mixed at a time by the SIMD32 instructions.
+*/
+
+#include <string.h>
+#include <audio_mixer.h>
+
+#if defined(__ARM_FEATURE_SIMD32) && __ARM_FEATURE_SIMD32
+#include <arm_acle.h>
+#define AUDIO_MIXER_SIMD32  1
+#endif
+
+static inline int32_t _sat16(int32_t val)
+{
+#ifdef AUDIO_MIXER_SIMD32
+	return __ssat(val, 16);
+#else
+	return (val > INT16_MAX) ? INT16_MAX : ((val < INT16_MIN) ? INT16_MIN : val);
+#endif
+}
+
+static inline int32_t _sat32(int64_t val)
+{
+	return (val > INT32_MAX) ? INT32_MAX : ((val < INT32_MIN) ? INT32_MIN : (int32_t)val);
+}
+
+static inline int32_t _gain16(int32_t sample, int32_t gain)
+{
+	return _sat16((sample * gain + (1 << 14)) >> 15);
+}
+
+static inline int32_t _add32(int32_t dst, int32_t sample, int32_t gain)
+{
+	/* Q15 * Q15 << 1 is Q31, does not overflow with gain not above AUDIO_MIXER_GAIN_MAX */
+#ifdef AUDIO_MIXER_SIMD32
+	return __qadd(dst, __qdbl(sample * gain));
+#else
+	return _sat32((int64_t)dst + _sat32((int64_t)sample * gain * 2));
+#endif
+}
+
+#ifdef AUDIO_MIXER_SIMD32
+/* the stream buffers are not guaranteed to be word aligned */
+static inline uint32_t _load32(const int16_t *ptr)
+{
+	uint32_t val;
+
+	memcpy(&val, ptr, 4);
+	return val;
+}
+
+static inline void _store32(int16_t *ptr, uint32_t val)
+{
+	memcpy(ptr, &val, 4);
+}
+
+static inline uint32_t _pack16(int32_t lo, int32_t hi)
+{
+	return __pkhbt(lo, hi, 16);
+}
+#endif
+
+void audio_mixer_add_s16(int16_t *dst, int dst_channels, int16_t *const src[2],
+		int samples, int32_t gain)
+{
+	const int16_t *src0 = src[0];
+	const int16_t *src1 = src[1];
+	int i = 0;
+
+	if (gain <= 0) {
+		return;
+	}
+
+	if (dst_channels > 1) {
+#ifdef AUDIO_MIXER_SIMD32
+		if (gain == AUDIO_MIXER_GAIN_UNITY) {
+			for (; i < samples; i++, dst += 2) {
+				_store32(dst, __qadd16(_load32(dst), _pack16(src0[i], src1[i])));
+			}
+		} else {
+			for (; i < samples; i++, dst += 2) {
+				_store32(dst, __qadd16(_load32(dst),
+						_pack16(_gain16(src0[i], gain), _gain16(src1[i], gain))));
+			}
+		}
+#else
+		for (; i < samples; i++, dst += 2) {
+			dst[0] = _sat16(dst[0] + _gain16(src0[i], gain));
+			dst[1] = _sat16(dst[1] + _gain16(src1[i], gain));
+		}
+#endif
+	} else {
+#ifdef AUDIO_MIXER_SIMD32
+		if (gain == AUDIO_MIXER_GAIN_UNITY) {
+			for (; i + 1 < samples; i += 2, dst += 2) {
+				_store32(dst, __qadd16(_load32(dst), _load32(&src0[i])));
+			}
+		} else {
+			for (; i + 1 < samples; i += 2, dst += 2) {
+				_store32(dst, __qadd16(_load32(dst),
+						_pack16(_gain16(src0[i], gain), _gain16(src0[i + 1], gain))));
+			}
+		}
+#endif
+		for (; i < samples; i++, dst++) {
+			*dst = _sat16(*dst + _gain16(src0[i], gain));
+		}
+	}
+}
+
+void audio_mixer_add_s32(int32_t *dst, int dst_channels, int16_t *const src[2],
+		int samples, int32_t gain)
+{
+	const int16_t *src0 = src[0];
+	const int16_t *src1 = src[1];
+	int i;
+
+	if (gain <= 0) {
+		return;
+	}
+
+	if (dst_channels > 1) {
+		for (i = 0; i < samples; i++, dst += 2) {
+			dst[0] = _add32(dst[0], src0[i], gain);
+			dst[1] = _add32(dst[1], src1[i], gain);
+		}
+	} else {
+		for (i = 0; i < samples; i++, dst++) {
+			*dst = _add32(*dst, src0[i], gain);
+		}
+	}
+}
+
+void audio_mixer_scale_s16(int16_t *buf, int count, int32_t gain)
+{
+	int i;
+
+	if (gain == AUDIO_MIXER_GAIN_UNITY) {
+		return;
+	}
+
+	if (gain <= 0) {
+		memset(buf, 0, count * sizeof(*buf));
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		buf[i] = _gain16(buf[i], gain);
+	}
+}
+
+void audio_mixer_scale_s32(int32_t *buf, int count, int32_t gain)
+{
+	int i;
+
+	if (gain == AUDIO_MIXER_GAIN_UNITY) {
+		return;
+	}
+
+	if (gain <= 0) {
+		memset(buf, 0, count * sizeof(*buf));
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		buf[i] = _sat32(((int64_t)buf[i] * gain + (1 << 14)) >> 15);
+	}
+}
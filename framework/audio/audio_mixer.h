@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016 Actions Semi Co., Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief audio mixer.
+*/
+
+#ifndef __AUDIO_MIXER_H__
+#define __AUDIO_MIXER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup audio_mixer_apis Auido Mixer APIs
+ * @ingroup media_system_apis
+ * @{
+ */
+
+/** Q15 gain of 0 dB */
+#define AUDIO_MIXER_GAIN_UNITY  (1 << 15)
+/** maximum Q15 gain, +6 dB */
+#define AUDIO_MIXER_GAIN_MAX    (2 * AUDIO_MIXER_GAIN_UNITY)
+
+/**
+ * @brief Mix one source into pcm of 16 bits
+ *
+ * This routine adds the source scaled by gain into the interleaved
+ * destination with saturation: dst = sat16(dst + src * gain).
+ *
+ * @param dst interleaved pcm of 16 bits to mix into
+ * @param dst_channels channels of dst, 1 or 2
+ * @param src planar pcm of 16 bits of the source, src[1] is only used
+ *            when dst_channels is 2, and can be src[0] for mono source.
+ * @param samples sample pairs to mix
+ * @param gain Q15 gain of the source, range [0, AUDIO_MIXER_GAIN_MAX]
+ *
+ * @return N/A
+ */
+void audio_mixer_add_s16(int16_t *dst, int dst_channels, int16_t *const src[2],
+		int samples, int32_t gain);
+
+/**
+ * @brief Mix one source into pcm of 32 bits
+ *
+ * The same as audio_mixer_add_s16, but the destination is Q31 pcm, and the
+ * source is added with saturation after left shifted by 16 bits.
+ *
+ * @param dst interleaved pcm of 32 bits to mix into
+ * @param dst_channels channels of dst, 1 or 2
+ * @param src planar pcm of 16 bits of the source
+ * @param samples sample pairs to mix
+ * @param gain Q15 gain of the source, range [0, AUDIO_MIXER_GAIN_MAX]
+ *
+ * @return N/A
+ */
+void audio_mixer_add_s32(int32_t *dst, int dst_channels, int16_t *const src[2],
+		int samples, int32_t gain);
+
+/**
+ * @brief Scale pcm of 16 bits in place with saturation
+ *
+ * @param buf pcm buffer
+ * @param count number of samples (not pairs)
+ * @param gain Q15 gain, range [0, AUDIO_MIXER_GAIN_MAX]
+ *
+ * @return N/A
+ */
+void audio_mixer_scale_s16(int16_t *buf, int count, int32_t gain);
+
+/**
+ * @brief Scale pcm of 32 bits in place with saturation
+ *
+ * @param buf pcm buffer
+ * @param count number of samples (not pairs)
+ * @param gain Q15 gain, range [0, AUDIO_MIXER_GAIN_MAX]
+ *
+ * @return N/A
+ */
+void audio_mixer_scale_s32(int32_t *buf, int count, int32_t gain);
+
+/**
+ * @} end defgroup audio_mixer_apis
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_MIXER_H__ */
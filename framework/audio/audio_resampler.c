@@ -0,0 +1,549 @@
+/*
+ * Copyright (c) 2016 Actions Semi Co., Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief audio resampler.
+ *
+ * Bandlimited interpolation with a Kaiser windowed sinc, tabulated in Q15
+ * for a number of phases per tap and linearly interpolated between them,
+ * so any rational ratio is supported with a small table. When downsampling
+ * the filter is stretched by the ratio to cut the alias off, so the taps
+ * per output sample grow by the same factor.
+*/
+
+#include <string.h>
+#include <errno.h>
+#include <mem_manager.h>
+#include <audio_resampler.h>
+
+/* input samples per process, in ms */
+#define RESAMPLER_BLOCK_MS  5
+
+struct resampler_filter {
+	/* half of the taps */
+	uint16_t half_taps;
+	/* log2 of the phases per tap */
+	uint16_t phase_bits;
+	/* h(k / phases) for k in [0, half_taps * phases], the last one is 0 */
+	const int16_t *table;
+};
+
+struct audio_resampler {
+	uint8_t channels;
+	uint8_t quality;
+
+	/* rate_out / rate_in = up / down, reduced */
+	uint32_t up;
+	uint32_t down;
+	/* input step per output sample: step_int + step_frac / up */
+	uint32_t step_int;
+	uint32_t step_frac;
+	/* phase of the current output sample: frac / up */
+	uint32_t frac;
+
+	const struct resampler_filter *filter;
+	/* Q16 table position per phase numerator */
+	uint32_t pos_per_frac;
+	/* Q16 table position per input sample */
+	uint32_t pos_step;
+	/* Q16 table end */
+	uint32_t pos_end;
+	/* Q15 gain of the stretched filter, 0 if not stretched */
+	int32_t gain;
+
+	/* input samples needed on each side of the output */
+	int half_span;
+	int in_samples;
+	int out_samples;
+
+	/* history and new input, pos is index of the sample left to the output */
+	int buf_len;
+	int pos;
+	int16_t *buf[2];
+};
+
+/*
+ * Generated with cutoff fc relative to the nyquist of the lower rate:
+ *   h(t) = fc * sinc(fc * t) * I0(beta * sqrt(1 - (t / half_taps)^2)) / I0(beta)
+ * 16 taps: fc 0.85, beta 6.0, 64 phases; 32 taps: fc 0.91, beta 8.0, 128 phases.
+ */
+static const int16_t filter_16tap[513] = {
+	27853, 27844, 27819, 27778, 27719, 27644, 27552, 27444, 27320, 27180, 27023, 26851,
+	26663, 26460, 26242, 26009, 25761, 25498, 25222, 24931, 24628, 24311, 23981, 23639,
+	23285, 22919, 22543, 22155, 21757, 21348, 20931, 20504, 20068, 19625, 19174, 18715,
+	18250, 17779, 17302, 16820, 16333, 15842, 15347, 14849, 14348, 13845, 13341, 12835,
+	12329, 11823, 11316, 10811, 10308, 9806, 9306, 8809, 8315, 7825, 7340, 6858,
+	6382, 5912, 5447, 4988, 4536, 4091, 3654, 3224, 2803, 2389, 1985, 1589,
+	1203, 826, 460, 103, -243, -579, -905, -1219, -1522, -1814, -2095, -2364,
+	-2622, -2868, -3102, -3325, -3536, -3735, -3922, -4098, -4261, -4413, -4553, -4682,
+	-4799, -4904, -4998, -5081, -5153, -5214, -5264, -5304, -5333, -5352, -5361, -5360,
+	-5350, -5330, -5301, -5263, -5217, -5162, -5100, -5029, -4952, -4867, -4775, -4676,
+	-4572, -4461, -4345, -4223, -4097, -3965, -3830, -3690, -3547, -3400, -3251, -3098,
+	-2943, -2787, -2628, -2468, -2306, -2144, -1981, -1818, -1655, -1493, -1331, -1169,
+	-1009, -851, -693, -538, -385, -234, -86, 60, 202, 342, 478, 610,
+	739, 864, 985, 1102, 1215, 1323, 1427, 1526, 1621, 1711, 1796, 1876,
+	1951, 2021, 2087, 2147, 2202, 2252, 2298, 2338, 2373, 2403, 2429, 2449,
+	2465, 2476, 2482, 2484, 2481, 2473, 2462, 2446, 2426, 2402, 2374, 2342,
+	2307, 2268, 2226, 2180, 2131, 2080, 2026, 1969, 1909, 1847, 1783, 1717,
+	1649, 1579, 1508, 1436, 1362, 1287, 1211, 1134, 1057, 979, 901, 823,
+	745, 667, 589, 512, 435, 358, 283, 209, 135, 63, -8, -78,
+	-146, -213, -278, -341, -402, -462, -519, -575, -628, -679, -728, -775,
+	-819, -861, -901, -938, -973, -1005, -1035, -1062, -1087, -1109, -1129, -1147,
+	-1162, -1174, -1184, -1192, -1198, -1201, -1202, -1200, -1197, -1191, -1183, -1174,
+	-1162, -1148, -1133, -1116, -1097, -1076, -1054, -1030, -1005, -979, -951, -922,
+	-892, -861, -829, -796, -762, -728, -693, -657, -621, -585, -548, -511,
+	-474, -436, -399, -362, -325, -288, -251, -214, -178, -143, -108, -73,
+	-39, -6, 27, 59, 90, 120, 149, 178, 205, 232, 257, 281,
+	305, 327, 348, 368, 387, 405, 421, 437, 451, 464, 476, 487,
+	496, 505, 512, 518, 523, 527, 530, 532, 533, 532, 531, 529,
+	525, 521, 516, 510, 504, 496, 488, 479, 469, 459, 448, 436,
+	424, 411, 398, 385, 371, 357, 342, 327, 312, 296, 281, 265,
+	249, 233, 217, 201, 185, 170, 154, 138, 122, 107, 92, 77,
+	62, 48, 34, 20, 6, -7, -20, -32, -44, -56, -67, -78,
+	-88, -98, -107, -116, -124, -132, -140, -147, -153, -159, -165, -170,
+	-174, -178, -182, -185, -187, -190, -191, -193, -194, -194, -194, -194,
+	-193, -192, -191, -189, -187, -184, -182, -178, -175, -172, -168, -164,
+	-160, -155, -151, -146, -141, -136, -131, -126, -120, -115, -110, -104,
+	-99, -93, -88, -82, -77, -71, -66, -60, -55, -50, -44, -39,
+	-34, -30, -25, -20, -16, -11, -7, -3, 1, 5, 8, 12,
+	15, 18, 21, 24, 27, 29, 31, 33, 35, 37, 39, 40,
+	42, 43, 44, 45, 45, 46, 46, 47, 47, 47, 47, 47,
+	46, 46, 45, 45, 44, 43, 43, 42, 41, 40, 39, 38,
+	36, 35, 34, 33, 32, 30, 29, 28, 26, 25, 24, 22,
+	21, 20, 18, 17, 16, 15, 14, 12, 0,
+};
+static const int16_t filter_32tap[2049] = {
+	29819, 29816, 29809, 29796, 29779, 29756, 29729, 29696, 29659, 29616, 29569, 29517,
+	29459, 29397, 29330, 29258, 29182, 29100, 29014, 28923, 28827, 28726, 28621, 28511,
+	28397, 28278, 28154, 28026, 27893, 27756, 27615, 27469, 27319, 27165, 27007, 26844,
+	26677, 26507, 26332, 26153, 25970, 25784, 25594, 25400, 25202, 25001, 24796, 24588,
+	24376, 24161, 23943, 23721, 23496, 23269, 23038, 22804, 22567, 22327, 22085, 21840,
+	21592, 21342, 21090, 20835, 20577, 20318, 20056, 19792, 19526, 19259, 18989, 18718,
+	18444, 18170, 17894, 17616, 17337, 17056, 16775, 16492, 16208, 15923, 15638, 15351,
+	15064, 14776, 14487, 14198, 13909, 13619, 13329, 13039, 12748, 12458, 12168, 11878,
+	11588, 11298, 11009, 10720, 10432, 10144, 9857, 9571, 9285, 9001, 8717, 8435,
+	8153, 7873, 7594, 7317, 7041, 6766, 6493, 6221, 5951, 5683, 5417, 5153,
+	4890, 4630, 4371, 4115, 3861, 3609, 3360, 3112, 2868, 2625, 2386, 2149,
+	1914, 1682, 1453, 1227, 1003, 782, 565, 350, 138, -71, -276, -479,
+	-678, -875, -1068, -1257, -1444, -1627, -1807, -1983, -2156, -2326, -2492, -2654,
+	-2813, -2969, -3121, -3270, -3414, -3556, -3693, -3828, -3958, -4085, -4208, -4327,
+	-4443, -4555, -4664, -4769, -4870, -4967, -5061, -5151, -5238, -5321, -5400, -5476,
+	-5547, -5616, -5680, -5741, -5799, -5853, -5903, -5950, -5993, -6033, -6070, -6103,
+	-6132, -6158, -6181, -6200, -6216, -6229, -6239, -6245, -6248, -6248, -6245, -6238,
+	-6229, -6216, -6201, -6183, -6161, -6137, -6110, -6081, -6048, -6013, -5975, -5934,
+	-5891, -5846, -5798, -5747, -5694, -5639, -5581, -5522, -5460, -5396, -5329, -5261,
+	-5191, -5119, -5045, -4969, -4891, -4812, -4731, -4648, -4564, -4478, -4391, -4303,
+	-4213, -4121, -4029, -3935, -3840, -3745, -3648, -3550, -3451, -3352, -3251, -3150,
+	-3048, -2946, -2843, -2739, -2635, -2531, -2426, -2321, -2215, -2110, -2004, -1898,
+	-1792, -1686, -1581, -1475, -1369, -1264, -1159, -1054, -949, -845, -741, -638,
+	-535, -433, -332, -231, -131, -32, 67, 165, 262, 358, 453, 547,
+	640, 732, 823, 912, 1001, 1088, 1174, 1259, 1343, 1425, 1506, 1586,
+	1664, 1740, 1816, 1889, 1961, 2032, 2101, 2169, 2235, 2299, 2361, 2422,
+	2482, 2539, 2595, 2649, 2702, 2753, 2802, 2849, 2894, 2938, 2979, 3019,
+	3058, 3094, 3129, 3161, 3192, 3221, 3248, 3274, 3297, 3319, 3339, 3357,
+	3373, 3388, 3401, 3411, 3421, 3428, 3433, 3437, 3439, 3439, 3438, 3435,
+	3430, 3423, 3415, 3405, 3393, 3380, 3365, 3349, 3331, 3311, 3290, 3268,
+	3244, 3218, 3191, 3163, 3133, 3102, 3069, 3036, 3000, 2964, 2926, 2887,
+	2847, 2806, 2764, 2720, 2676, 2630, 2584, 2536, 2487, 2438, 2387, 2336,
+	2284, 2231, 2177, 2123, 2068, 2012, 1956, 1899, 1841, 1783, 1724, 1665,
+	1605, 1545, 1484, 1424, 1362, 1301, 1239, 1177, 1115, 1053, 990, 928,
+	865, 803, 740, 677, 615, 552, 490, 428, 366, 304, 242, 181,
+	120, 59, -1, -61, -121, -180, -239, -297, -355, -412, -468, -524,
+	-580, -635, -689, -742, -795, -847, -898, -949, -998, -1047, -1095, -1142,
+	-1189, -1234, -1279, -1322, -1365, -1407, -1448, -1488, -1526, -1564, -1601, -1637,
+	-1672, -1705, -1738, -1770, -1800, -1830, -1858, -1885, -1911, -1936, -1960, -1983,
+	-2004, -2025, -2044, -2062, -2079, -2095, -2110, -2123, -2136, -2147, -2157, -2166,
+	-2174, -2181, -2186, -2191, -2194, -2196, -2197, -2197, -2196, -2193, -2190, -2186,
+	-2180, -2174, -2166, -2157, -2147, -2137, -2125, -2112, -2098, -2084, -2068, -2051,
+	-2034, -2015, -1996, -1975, -1954, -1932, -1909, -1886, -1861, -1836, -1810, -1783,
+	-1755, -1727, -1698, -1668, -1637, -1606, -1575, -1542, -1510, -1476, -1442, -1407,
+	-1372, -1337, -1301, -1264, -1227, -1190, -1152, -1114, -1076, -1037, -998, -959,
+	-919, -879, -839, -799, -759, -718, -677, -637, -596, -555, -514, -473,
+	-432, -391, -350, -309, -268, -227, -186, -146, -106, -65, -25, 14,
+	54, 93, 132, 171, 210, 248, 285, 323, 360, 397, 433, 469,
+	504, 539, 574, 608, 641, 674, 707, 738, 770, 801, 831, 861,
+	890, 918, 946, 973, 1000, 1026, 1051, 1075, 1099, 1123, 1145, 1167,
+	1188, 1208, 1228, 1247, 1265, 1283, 1299, 1315, 1331, 1345, 1359, 1372,
+	1384, 1395, 1406, 1416, 1425, 1433, 1441, 1448, 1454, 1459, 1463, 1467,
+	1470, 1472, 1474, 1474, 1474, 1474, 1472, 1470, 1467, 1463, 1459, 1454,
+	1448, 1441, 1434, 1426, 1417, 1408, 1398, 1388, 1377, 1365, 1352, 1339,
+	1325, 1311, 1296, 1281, 1265, 1248, 1231, 1214, 1195, 1177, 1158, 1138,
+	1118, 1098, 1077, 1055, 1033, 1011, 989, 966, 942, 919, 895, 870,
+	846, 821, 795, 770, 744, 718, 692, 666, 639, 612, 585, 558,
+	531, 504, 476, 449, 421, 394, 366, 338, 310, 283, 255, 227,
+	200, 172, 144, 117, 90, 62, 35, 8, -19, -46, -72, -99,
+	-125, -151, -177, -202, -227, -252, -277, -302, -326, -350, -373, -397,
+	-420, -442, -465, -486, -508, -529, -550, -570, -590, -610, -629, -648,
+	-666, -684, -702, -719, -735, -751, -767, -782, -797, -811, -824, -838,
+	-850, -862, -874, -885, -896, -906, -916, -925, -934, -942, -949, -956,
+	-963, -969, -974, -979, -984, -988, -991, -994, -996, -998, -999, -1000,
+	-1001, -1000, -1000, -998, -997, -995, -992, -989, -985, -981, -976, -971,
+	-966, -960, -953, -946, -939, -931, -923, -914, -905, -896, -886, -876,
+	-865, -854, -843, -831, -819, -806, -794, -781, -767, -753, -739, -725,
+	-710, -695, -680, -665, -649, -633, -617, -601, -584, -567, -550, -533,
+	-516, -498, -481, -463, -445, -427, -409, -390, -372, -353, -335, -316,
+	-298, -279, -260, -241, -223, -204, -185, -166, -147, -129, -110, -91,
+	-73, -54, -36, -17, 1, 19, 37, 55, 73, 90, 108, 125,
+	142, 159, 176, 193, 209, 226, 242, 258, 273, 289, 304, 319,
+	334, 348, 362, 376, 390, 403, 416, 429, 441, 454, 466, 477,
+	489, 500, 510, 521, 531, 540, 550, 559, 568, 576, 584, 592,
+	599, 606, 613, 619, 625, 631, 636, 641, 645, 649, 653, 657,
+	660, 663, 665, 667, 669, 670, 671, 672, 672, 672, 672, 671,
+	670, 669, 667, 665, 663, 660, 657, 654, 651, 647, 642, 638,
+	633, 628, 623, 617, 611, 605, 598, 591, 584, 577, 570, 562,
+	554, 546, 537, 528, 519, 510, 501, 491, 482, 472, 462, 451,
+	441, 430, 420, 409, 398, 386, 375, 364, 352, 340, 329, 317,
+	305, 293, 281, 268, 256, 244, 231, 219, 207, 194, 182, 169,
+	157, 144, 131, 119, 106, 94, 81, 69, 57, 44, 32, 20,
+	7, -5, -17, -29, -41, -52, -64, -76, -87, -98, -110, -121,
+	-132, -143, -153, -164, -174, -185, -195, -205, -215, -224, -234, -243,
+	-252, -261, -270, -278, -287, -295, -303, -310, -318, -325, -332, -339,
+	-346, -353, -359, -365, -371, -376, -382, -387, -392, -396, -401, -405,
+	-409, -413, -416, -420, -423, -426, -428, -431, -433, -435, -436, -438,
+	-439, -440, -441, -441, -441, -441, -441, -441, -440, -439, -438, -437,
+	-436, -434, -432, -430, -428, -425, -422, -419, -416, -413, -410, -406,
+	-402, -398, -394, -389, -385, -380, -375, -370, -365, -359, -354, -348,
+	-342, -337, -330, -324, -318, -311, -305, -298, -291, -285, -278, -270,
+	-263, -256, -249, -241, -234, -226, -218, -211, -203, -195, -187, -179,
+	-171, -163, -155, -147, -139, -131, -123, -115, -107, -98, -90, -82,
+	-74, -66, -58, -50, -42, -34, -26, -18, -10, -2, 6, 13,
+	21, 29, 36, 44, 51, 59, 66, 73, 80, 87, 94, 101,
+	108, 114, 121, 127, 133, 140, 146, 152, 158, 163, 169, 175,
+	180, 185, 190, 195, 200, 205, 209, 214, 218, 222, 226, 230,
+	234, 238, 241, 244, 248, 251, 253, 256, 259, 261, 263, 266,
+	268, 269, 271, 273, 274, 275, 276, 277, 278, 279, 279, 279,
+	280, 280, 280, 279, 279, 278, 278, 277, 276, 275, 274, 272,
+	271, 269, 268, 266, 264, 262, 260, 257, 255, 252, 250, 247,
+	244, 241, 238, 235, 231, 228, 225, 221, 217, 214, 210, 206,
+	202, 198, 194, 189, 185, 181, 176, 172, 167, 163, 158, 154,
+	149, 144, 139, 135, 130, 125, 120, 115, 110, 105, 100, 95,
+	90, 85, 80, 75, 70, 64, 59, 54, 49, 44, 39, 34,
+	29, 24, 19, 14, 9, 5, 0, -5, -10, -15, -19, -24,
+	-29, -33, -38, -42, -46, -51, -55, -59, -63, -68, -72, -76,
+	-79, -83, -87, -91, -94, -98, -101, -105, -108, -111, -114, -117,
+	-120, -123, -126, -129, -131, -134, -136, -139, -141, -143, -145, -147,
+	-149, -151, -153, -155, -156, -158, -159, -160, -162, -163, -164, -165,
+	-165, -166, -167, -167, -168, -168, -168, -169, -169, -169, -169, -169,
+	-168, -168, -168, -167, -167, -166, -165, -164, -163, -162, -161, -160,
+	-159, -158, -156, -155, -154, -152, -150, -149, -147, -145, -143, -141,
+	-139, -137, -135, -133, -131, -129, -126, -124, -122, -119, -117, -114,
+	-112, -109, -106, -104, -101, -98, -96, -93, -90, -87, -84, -81,
+	-79, -76, -73, -70, -67, -64, -61, -58, -55, -52, -49, -46,
+	-43, -40, -37, -34, -31, -28, -25, -22, -19, -16, -13, -10,
+	-7, -5, -2, 1, 4, 7, 9, 12, 15, 18, 20, 23,
+	25, 28, 30, 33, 35, 38, 40, 42, 44, 47, 49, 51,
+	53, 55, 57, 59, 61, 63, 65, 66, 68, 70, 71, 73,
+	75, 76, 77, 79, 80, 81, 83, 84, 85, 86, 87, 88,
+	89, 89, 90, 91, 92, 92, 93, 93, 94, 94, 95, 95,
+	95, 95, 95, 96, 96, 96, 95, 95, 95, 95, 95, 94,
+	94, 94, 93, 93, 92, 92, 91, 90, 90, 89, 88, 87,
+	87, 86, 85, 84, 83, 82, 81, 80, 79, 77, 76, 75,
+	74, 72, 71, 70, 68, 67, 66, 64, 63, 61, 60, 58,
+	57, 55, 54, 52, 51, 49, 47, 46, 44, 43, 41, 39,
+	38, 36, 34, 33, 31, 29, 28, 26, 24, 23, 21, 20,
+	18, 16, 15, 13, 11, 10, 8, 7, 5, 3, 2, 0,
+	-1, -3, -4, -6, -7, -9, -10, -11, -13, -14, -15, -17,
+	-18, -19, -21, -22, -23, -24, -25, -27, -28, -29, -30, -31,
+	-32, -33, -34, -35, -36, -37, -37, -38, -39, -40, -40, -41,
+	-42, -43, -43, -44, -44, -45, -45, -46, -46, -47, -47, -47,
+	-48, -48, -48, -49, -49, -49, -49, -49, -49, -50, -50, -50,
+	-50, -50, -50, -49, -49, -49, -49, -49, -49, -49, -48, -48,
+	-48, -47, -47, -47, -46, -46, -46, -45, -45, -44, -44, -43,
+	-43, -42, -41, -41, -40, -40, -39, -38, -38, -37, -36, -36,
+	-35, -34, -34, -33, -32, -31, -31, -30, -29, -28, -27, -27,
+	-26, -25, -24, -23, -23, -22, -21, -20, -19, -18, -18, -17,
+	-16, -15, -14, -13, -13, -12, -11, -10, -9, -9, -8, -7,
+	-6, -5, -5, -4, -3, -2, -1, -1, 0, 1, 2, 2,
+	3, 4, 4, 5, 6, 6, 7, 8, 8, 9, 9, 10,
+	11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 16, 16,
+	17, 17, 17, 18, 18, 19, 19, 19, 19, 20, 20, 20,
+	21, 21, 21, 21, 21, 22, 22, 22, 22, 22, 22, 22,
+	23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23,
+	23, 23, 22, 22, 22, 22, 22, 22, 22, 22, 21, 21,
+	21, 21, 21, 20, 20, 20, 20, 19, 19, 19, 19, 18,
+	18, 18, 17, 17, 17, 17, 16, 16, 16, 15, 15, 15,
+	14, 14, 14, 13, 13, 13, 12, 12, 11, 11, 11, 10,
+	10, 10, 9, 9, 8, 8, 8, 7, 7, 7, 6, 6,
+	6, 5, 5, 5, 4, 4, 3, 3, 3, 2, 2, 2,
+	1, 1, 1, 0, 0, 0, 0, -1, -1, -1, -2, -2,
+	-2, -2, -3, -3, -3, -3, -4, -4, -4, -4, -5, -5,
+	-5, -5, -5, -6, -6, -6, -6, -6, -6, -7, -7, -7,
+	-7, -7, -7, -7, -8, -8, -8, -8, -8, -8, -8, -8,
+	-8, -8, -8, -8, -8, -8, -8, -8, -9, -9, -9, -9,
+	-9, -9, -9, -9, -8, -8, -8, -8, -8, -8, -8, -8,
+	-8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -7, -7,
+	-7, -7, -7, -7, -7, -7, -7, -7, -6, -6, -6, -6,
+	-6, -6, -6, -6, -5, -5, -5, -5, -5, -5, -5, -5,
+	-4, -4, -4, -4, -4, -4, -4, -4, -3, -3, -3, -3,
+	-3, -3, -3, -2, -2, -2, -2, -2, -2, -2, -2, -2,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 0,
+};
+
+static const struct resampler_filter resampler_filters[] = {
+	[AUDIO_RESAMPLER_QUALITY_16TAP] = {
+		.half_taps = 8,
+		.phase_bits = 6,
+		.table = filter_16tap,
+	},
+	[AUDIO_RESAMPLER_QUALITY_32TAP] = {
+		.half_taps = 16,
+		.phase_bits = 7,
+		.table = filter_32tap,
+	},
+};
+
+static uint32_t _gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+static inline int32_t _sat16(int32_t val)
+{
+	return (val > INT16_MAX) ? INT16_MAX : ((val < INT16_MIN) ? INT16_MIN : val);
+}
+
+static inline int32_t _coef(const int16_t *table, uint32_t pos)
+{
+	const int16_t *h = &table[pos >> 16];
+	int32_t w = (pos & 0xffff) >> 1;
+
+	return h[0] + (((h[1] - h[0]) * w) >> 15);
+}
+
+static inline int32_t _round_q15(struct audio_resampler *res, int64_t acc)
+{
+	if (res->gain) {
+		acc = (acc >> 15) * res->gain;
+	}
+
+	return _sat16((int32_t)((acc + (1 << 14)) >> 15));
+}
+
+static void _filter_mono(struct audio_resampler *res, int16_t *out)
+{
+	const int16_t *table = res->filter->table;
+	const int16_t *xl = res->buf[0] + res->pos;
+	const int16_t *xr = xl + 1;
+	uint32_t left = res->frac * res->pos_per_frac;
+	uint32_t right = (res->up - res->frac) * res->pos_per_frac;
+	int64_t acc = 0;
+
+	for (; left < res->pos_end; left += res->pos_step) {
+		acc += *xl-- * _coef(table, left);
+	}
+
+	for (; right < res->pos_end; right += res->pos_step) {
+		acc += *xr++ * _coef(table, right);
+	}
+
+	*out = _round_q15(res, acc);
+}
+
+static void _filter_stereo(struct audio_resampler *res, int16_t *out0, int16_t *out1)
+{
+	const int16_t *table = res->filter->table;
+	const int16_t *xl0 = res->buf[0] + res->pos;
+	const int16_t *xl1 = res->buf[1] + res->pos;
+	const int16_t *xr0 = xl0 + 1;
+	const int16_t *xr1 = xl1 + 1;
+	uint32_t left = res->frac * res->pos_per_frac;
+	uint32_t right = (res->up - res->frac) * res->pos_per_frac;
+	int64_t acc0 = 0, acc1 = 0;
+	int32_t h;
+
+	for (; left < res->pos_end; left += res->pos_step) {
+		h = _coef(table, left);
+		acc0 += *xl0-- * h;
+		acc1 += *xl1-- * h;
+	}
+
+	for (; right < res->pos_end; right += res->pos_step) {
+		h = _coef(table, right);
+		acc0 += *xr0++ * h;
+		acc1 += *xr1++ * h;
+	}
+
+	*out0 = _round_q15(res, acc0);
+	*out1 = _round_q15(res, acc1);
+}
+
+static inline int16_t _linear(const int16_t *x, int32_t w)
+{
+	return x[0] + (((x[1] - x[0]) * w + (1 << 14)) >> 15);
+}
+
+void *audio_resampler_open(uint8_t channels, uint32_t rate_in, uint32_t rate_out,
+		uint8_t quality, int *samples_in, int *samples_out)
+{
+	struct audio_resampler *res;
+	const struct resampler_filter *filter = NULL;
+	uint32_t gcd;
+	int buf_size;
+
+	if (channels < 1 || channels > 2 || !rate_in || !rate_out
+		|| quality > AUDIO_RESAMPLER_QUALITY_32TAP) {
+		return NULL;
+	}
+
+	gcd = _gcd(rate_in, rate_out);
+
+	res = mem_malloc(sizeof(*res));
+	if (!res) {
+		return NULL;
+	}
+
+	memset(res, 0, sizeof(*res));
+	res->channels = channels;
+	res->quality = quality;
+	res->up = rate_out / gcd;
+	res->down = rate_in / gcd;
+	res->step_int = res->down / res->up;
+	res->step_frac = res->down % res->up;
+
+	if (quality == AUDIO_RESAMPLER_QUALITY_LINEAR) {
+		/* the sample on the right, and the samples skipped per output */
+		res->half_span = 1 + res->step_int;
+	} else {
+		filter = &resampler_filters[quality];
+		res->filter = filter;
+		res->pos_end = (uint32_t)filter->half_taps << (filter->phase_bits + 16);
+
+		if (res->up >= res->down) {
+			res->pos_step = 1u << (filter->phase_bits + 16);
+			res->pos_per_frac = res->pos_step / res->up;
+			res->half_span = filter->half_taps;
+		} else {
+			/* stretch the filter to the output nyquist */
+			res->pos_step = (uint32_t)(((uint64_t)res->up << (filter->phase_bits + 16)) / res->down);
+			res->pos_per_frac = (1u << (filter->phase_bits + 16)) / res->down;
+			res->gain = (int32_t)(((uint64_t)res->up << 15) / res->down);
+			res->half_span = (filter->half_taps * res->down + res->up - 1) / res->up;
+		}
+	}
+
+	res->in_samples = rate_in * RESAMPLER_BLOCK_MS / 1000;
+	if (res->in_samples < 16) {
+		res->in_samples = 16;
+	}
+
+	/* each process moves the output position by at most the new input */
+	res->out_samples = (int)(((uint64_t)res->in_samples * res->up + res->down - 1) / res->down) + 2;
+
+	buf_size = (2 * res->half_span + res->in_samples) * sizeof(int16_t);
+	res->buf[0] = mem_malloc(buf_size * channels);
+	if (!res->buf[0]) {
+		mem_free(res);
+		return NULL;
+	}
+
+	res->buf[1] = res->buf[0] + (2 * res->half_span + res->in_samples) * (channels - 1);
+
+	/* start with silence as history, the first output is at the first input */
+	memset(res->buf[0], 0, buf_size * channels);
+	res->pos = (quality == AUDIO_RESAMPLER_QUALITY_LINEAR) ? 0 : res->half_span;
+	res->buf_len = res->pos;
+
+	if (samples_in) {
+		*samples_in = res->in_samples;
+	}
+
+	if (samples_out) {
+		*samples_out = res->out_samples;
+	}
+
+	return res;
+}
+
+int audio_resampler_process(void *handle, int16_t *output_buf[2],
+		int16_t *const input_buf[2], int input_samples)
+{
+	struct audio_resampler *res = handle;
+	int16_t *out0 = output_buf[0];
+	int16_t *out1 = (res->channels > 1) ? output_buf[1] : NULL;
+	int right = (res->quality == AUDIO_RESAMPLER_QUALITY_LINEAR) ? 1 : res->half_span;
+	int out_num = 0;
+	int shift;
+
+	if (input_samples > res->in_samples) {
+		return -EINVAL;
+	}
+
+	memcpy(res->buf[0] + res->buf_len, input_buf[0], input_samples * sizeof(int16_t));
+	if (res->channels > 1) {
+		memcpy(res->buf[1] + res->buf_len, input_buf[1], input_samples * sizeof(int16_t));
+	}
+
+	res->buf_len += input_samples;
+
+	while (res->pos + right < res->buf_len) {
+		if (res->quality == AUDIO_RESAMPLER_QUALITY_LINEAR) {
+			int32_t w = (int32_t)(((uint64_t)res->frac << 15) / res->up);
+
+			out0[out_num] = _linear(res->buf[0] + res->pos, w);
+			if (out1) {
+				out1[out_num] = _linear(res->buf[1] + res->pos, w);
+			}
+		} else if (out1) {
+			_filter_stereo(res, &out0[out_num], &out1[out_num]);
+		} else {
+			_filter_mono(res, &out0[out_num]);
+		}
+
+		out_num++;
+
+		res->pos += res->step_int;
+		res->frac += res->step_frac;
+		if (res->frac >= res->up) {
+			res->frac -= res->up;
+			res->pos++;
+		}
+	}
+
+	/* keep the history needed by the next output */
+	shift = res->pos - ((res->quality == AUDIO_RESAMPLER_QUALITY_LINEAR) ? 0 : res->half_span);
+	if (shift > res->buf_len) {
+		shift = res->buf_len;
+	}
+
+	if (shift > 0) {
+		memmove(res->buf[0], res->buf[0] + shift, (res->buf_len - shift) * sizeof(int16_t));
+		if (res->channels > 1) {
+			memmove(res->buf[1], res->buf[1] + shift, (res->buf_len - shift) * sizeof(int16_t));
+		}
+
+		res->buf_len -= shift;
+		res->pos -= shift;
+	}
+
+	return out_num;
+}
+
+void audio_resampler_close(void *handle)
+{
+	struct audio_resampler *res = handle;
+
+	if (!res) {
+		return;
+	}
+
+	mem_free(res->buf[0]);
+	mem_free(res);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2016 Actions Semi Co., Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief audio resampler.
+*/
+
+#ifndef __AUDIO_RESAMPLER_H__
+#define __AUDIO_RESAMPLER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup audio_resampler_apis Auido Resampler APIs
+ * @ingroup media_system_apis
+ * @{
+ */
+
+/** quality tiers of the resampler, higher quality costs more cpu */
+enum audio_resampler_quality {
+	/** linear interpolation, for voice prompts and tones */
+	AUDIO_RESAMPLER_QUALITY_LINEAR = 0,
+	/** polyphase filter of 16 taps */
+	AUDIO_RESAMPLER_QUALITY_16TAP,
+	/** polyphase filter of 32 taps, for music */
+	AUDIO_RESAMPLER_QUALITY_32TAP,
+};
+
+/**
+ * @brief Open resampler
+ *
+ * This routine opens a resampler of 16 bits pcm converting between any two
+ * sample rates. The ratio is kept exactly, so there is no drift in long run.
+ *
+ * @param channels channels of pcm, 1 or 2
+ * @param rate_in input sample rate in Hz
+ * @param rate_out output sample rate in Hz
+ * @param quality quality tier, see enum audio_resampler_quality
+ * @param samples_in return the max input samples per process
+ * @param samples_out return the max output samples per process
+ *
+ * @return handle of resampler, NULL if failed
+ */
+void *audio_resampler_open(uint8_t channels, uint32_t rate_in, uint32_t rate_out,
+		uint8_t quality, int *samples_in, int *samples_out);
+
+/**
+ * @brief Resample pcm
+ *
+ * Any number of input samples up to samples_in is accepted, the history is
+ * kept inside, so short reads need no zero padding.
+ *
+ * @param handle handle of resampler
+ * @param output_buf planar output buffers, of samples_out samples each
+ * @param input_buf planar input buffers
+ * @param input_samples samples in input buffers
+ *
+ * @return samples output, or negative if failed
+ */
+int audio_resampler_process(void *handle, int16_t *output_buf[2],
+		int16_t *const input_buf[2], int input_samples);
+
+/**
+ * @brief Close resampler
+ *
+ * @param handle handle of resampler
+ *
+ * @return N/A
+ */
+void audio_resampler_close(void *handle);
+
+/**
+ * @} end defgroup audio_resampler_apis
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_RESAMPLER_H__ */
@@ -90,10 +90,36 @@ typedef enum {
 #define MAX_AUDIO_RECORD_NUM 2
 #define MAX_AUDIO_DEVICE_NUM 1
 
+#ifdef CONFIG_AUDIO_MIX_SOURCE_NUM
+#define MAX_AUDIO_MIX_SOURCE_NUM CONFIG_AUDIO_MIX_SOURCE_NUM
+#else
+#define MAX_AUDIO_MIX_SOURCE_NUM 1
+#endif
+
 #define MAX_VOLUME_VALUE 2
 #define MIN_VOLUME_VALUE 1
 #define DEFAULT_VOLUME   5
 
+struct audio_mix_source_t {
+	io_stream_t stream;
+	uint8_t stream_type;
+	uint8_t sample_rate;
+	uint8_t channels;
+	/* Q15 gain, AUDIO_MIXER_GAIN_UNITY for 0 dB */
+	int32_t gain;
+
+	/* resample */
+	void *res_handle;
+	int res_in_samples;
+	int res_out_samples;
+	int res_remain_samples;
+	int16_t *res_in_buf[2];
+	int16_t *res_out_buf[2];
+
+	/* samples not mixed since the stream has no data */
+	uint32_t underrun_samples;
+};
+
 struct audio_track_t {
 	uint8_t stream_type;
 	uint8_t audio_format;
@@ -119,9 +145,6 @@ struct audio_track_t {
 	uint8_t *pcm_frame_buff;
 
 	io_stream_t audio_stream;
-	io_stream_t mix_stream;
-	uint8_t mix_sample_rate;
-	uint8_t mix_channels;
 
 	/** audio hal handle*/
 	void *audio_handle;
@@ -133,19 +156,19 @@ struct audio_track_t {
 	int compensate_samples;
 	int fill_cnt;
 
-	/* resample */
-	void *res_handle;
-	int res_in_samples;
-	int res_out_samples;
-	int res_remain_samples;
-	int16_t *res_in_buf[2];
-	int16_t *res_out_buf[2];
-
 	/* fade in/out */
 	void *fade_handle;
 
 	/* mix */
-	void *mix_handle;
+	struct audio_mix_source_t mix_sources[MAX_AUDIO_MIX_SOURCE_NUM];
+	uint8_t mix_source_num;
+	/* Q15 gain of the track stream applied while mixing other sources */
+	int32_t mix_main_gain;
+
+	/* zero copy: ring buffer of audio_stream read by dma in place */
+	struct acts_ringbuf *pcm_ringbuf;
+	/* bytes claimed from pcm_ringbuf by the running dma */
+	uint32_t dma_claim_len;
 
     uint64_t total_samples_filled;
     int32_t sample_fix;
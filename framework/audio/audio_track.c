@@ -22,6 +22,7 @@
 #include <assert.h>
 #include <ringbuff_stream.h>
 #include <arithmetic.h>
+#include <audio_resampler.h>
 
 #define SYS_LOG_NO_NEWLINE
 #ifdef SYS_LOG_DOMAIN
@@ -43,140 +44,160 @@ extern int stream_read_pcm(asin_pcm_t *aspcm, io_stream_t stream, int max_sample
 extern uint32_t get_sample_rate_hz(uint8_t fs_khz);
 
 #ifdef CONFIG_MEDIA_EFFECT
-extern void *media_resample_open(uint8_t channels, uint8_t samplerate_in,
-		uint8_t samplerate_out, int *samples_in, int *samples_out, uint8_t stream_type);
-extern int media_resample_process(void *handle, uint8_t channels, void *output_buf[2],
-		void *input_buf[2], int input_samples);
-extern void media_resample_close(void *handle);
-
 extern void *media_fade_open(uint8_t sample_rate, uint8_t channels, uint8_t sample_bits, uint8_t is_interweaved);
 extern void media_fade_close(void *handle);
 extern int media_fade_process(void *handle, void **inout_buf, int samples);
 extern int media_fade_in_set(void *handle, int fade_time_ms);
 extern int media_fade_out_set(void *handle, int fade_time_ms);
 extern int media_fade_out_is_finished(void *handle);
-
-extern void *media_mix_open(uint8_t sample_rate, uint8_t channels, uint8_t is_interweaved);
-extern void media_mix_close(void *handle);
-extern int media_mix_process(void *handle, void **inout_buf, void *mix_buf,
-			     int samples);
 #endif /* CONFIG_MEDIA_EFFECT */
 
 #ifdef CONFIG_MEDIA_EFFECT
-static int _audio_track_data_mix(struct audio_track_t *handle, s16_t *src_buff, uint16_t samples, s16_t *dest_buff)
+/* samples per channel read at a time from a mix stream not resampled */
+#define AUDIO_MIX_FRAME_SAMPLES (256)
+
+static int _audio_track_mix_source(struct audio_track_t *handle, struct audio_mix_source_t *src,
+		s16_t *buf, int samples)
 {
 	int ret = 0;
-    int max_retry_cnt = 5;
-	uint16_t mix_num = 0;
+	int mix_num = 0;
 	asin_pcm_t mix_pcm = {
-		.channels = handle->mix_channels,
+		.channels = src->channels,
 		.sample_bits = 16,
-		.pcm = { handle->res_in_buf[0], handle->res_in_buf[1], },
+		.pcm = { src->res_in_buf[0], src->res_in_buf[1], },
 	};
 
-	if (stream_get_length(handle->mix_stream) <= 0 && handle->res_remain_samples <= 0)
-		return 0;
-
 	while (1) {
-		uint16_t mix_samples = MIN(samples, handle->res_remain_samples);
-		s16_t *mix_buff[2] = {
-			handle->res_out_buf[0] + handle->res_out_samples - handle->res_remain_samples,
-			handle->res_out_buf[1] + handle->res_out_samples - handle->res_remain_samples,
+		int mix_samples = MIN(samples, src->res_remain_samples);
+		int16_t *mix_buff[2] = {
+			src->res_out_buf[0] + src->res_out_samples - src->res_remain_samples,
+			src->res_out_buf[1] + src->res_out_samples - src->res_remain_samples,
 		};
 
 		/* 1) consume remain samples */
-		if (handle->mix_handle && dest_buff == src_buff) {
-#ifdef CONFIG_AUDIO_MIX
-			media_mix_process(handle->mix_handle, (void **)&dest_buff, mix_buff[0], mix_samples);
-			dest_buff += handle->channels * mix_samples;
-			src_buff += handle->channels * mix_samples;
-#endif //CONFIG_AUDIO_MIX
+		if (handle->audio_format == AUDIO_FORMAT_PCM_32_BIT) {
+			audio_mixer_add_s32((int32_t *)buf, handle->channels, mix_buff, mix_samples, src->gain);
+			buf += handle->channels * mix_samples * 2;
 		} else {
-            if(handle->audio_format == AUDIO_FORMAT_PCM_32_BIT) {
-                int32_t *pdst = (int32_t*)dest_buff;
-                int32_t *psrc = (int32_t*)src_buff;
-
-                if (handle->channels > 1) {
-    				for (int i = 0; i < mix_samples; i++) {
-    					*pdst++ = (*psrc++) / 2 + (((int32_t)mix_buff[0][i] / 2) << 16);
-    					*pdst++ = (*psrc++) / 2 + (((int32_t)mix_buff[1][i] / 2) << 16);
-    				}
-    			} else {
-    				for (int i = 0; i < mix_samples; i++) {
-    					*pdst++ = (*psrc++) / 2 + (((int32_t)mix_buff[0][i] / 2) << 16);
-    				}
-                }
-            }else{
-                if (handle->channels > 1) {
-    				for (int i = 0; i < mix_samples; i++) {
-    					*dest_buff++ = (*src_buff++) / 2 + mix_buff[0][i] / 2;
-    					*dest_buff++ = (*src_buff++) / 2 + mix_buff[1][i] / 2;
-    				}
-    			} else {
-    				for (int i = 0; i < mix_samples; i++) {
-    					*dest_buff++ = (*src_buff++) / 2 + mix_buff[0][i] / 2;
-    				}
-    			}
-            }
+			audio_mixer_add_s16(buf, handle->channels, mix_buff, mix_samples, src->gain);
+			buf += handle->channels * mix_samples;
 		}
 
-		handle->res_remain_samples -= mix_samples;
+		src->res_remain_samples -= mix_samples;
 		samples -= mix_samples;
 		mix_num += mix_samples;
 		if (samples <= 0)
 			break;
 
-		/* 2) read mix stream and do resample as required */
+		/* 2) read mix stream and do resample as required, never wait for
+		 * the stream in the writer context, the samples not ready are skipped.
+		 */
 		mix_pcm.samples = 0;
-		ret = stream_read_pcm(&mix_pcm, handle->mix_stream, handle->res_in_samples, INT32_MAX);
-        //printk("mix read: %d, need: %d, have: %d\n", ret, handle->res_in_samples, stream_get_length(handle->mix_stream));
-		if (ret <= 0)
-		{
-            if(stream_check_finished(handle->mix_stream))
-                break;
-
-            max_retry_cnt--;
-            if(max_retry_cnt <= 0)
-            {
-                SYS_LOG_ERR("wait tip tone timeout\n");
-    			break;
-            }
-
-            os_sleep(2);
-            continue;
+		ret = stream_read_pcm(&mix_pcm, src->stream, src->res_in_samples, INT32_MAX);
+		if (ret <= 0) {
+			src->underrun_samples += samples;
+			break;
 		}
 
-		if (handle->res_handle) {
-#ifdef CONFIG_RESAMPLE
-			uint8_t res_channels = MIN(handle->mix_channels, handle->channels);
-
-			if (ret < handle->res_in_samples) {
-				memset((uint16_t *)mix_pcm.pcm[0] + ret, 0, (handle->res_in_samples - ret) * 2);
-				if (res_channels > 1)
-					memset((uint16_t *)mix_pcm.pcm[1] + ret, 0, (handle->res_in_samples - ret) * 2);
-			}
-
-			/* do resample */
-			handle->res_out_samples = media_resample_process(handle->res_handle, res_channels,
-					(void **)handle->res_out_buf, (void **)mix_pcm.pcm, handle->res_in_samples);
-			handle->res_remain_samples = handle->res_out_samples;
-#endif //CONFIG_RESAMPLE
+		if (src->res_handle) {
+			/* do resample, short reads are kept as history by the resampler */
+			ret = audio_resampler_process(src->res_handle, src->res_out_buf,
+					(int16_t **)mix_pcm.pcm, ret);
+			src->res_out_samples = MAX(ret, 0);
+			src->res_remain_samples = src->res_out_samples;
 		} else {
-			handle->res_out_samples = ret;
-			handle->res_remain_samples = handle->res_out_samples;
+			src->res_out_samples = ret;
+			src->res_remain_samples = src->res_out_samples;
 		}
 	}
 
 	return mix_num;
 }
+
+static int _audio_track_data_mix(struct audio_track_t *handle, s16_t *buf, int samples)
+{
+	struct audio_mix_source_t *src;
+	int mix_num = 0;
+	int i;
+
+	/* duck the track stream as long as a source is attached, even between its chunks */
+	if (handle->audio_format == AUDIO_FORMAT_PCM_32_BIT) {
+		audio_mixer_scale_s32((int32_t *)buf, samples * handle->channels, handle->mix_main_gain);
+	} else {
+		audio_mixer_scale_s16(buf, samples * handle->channels, handle->mix_main_gain);
+	}
+
+	for (i = 0; i < MAX_AUDIO_MIX_SOURCE_NUM; i++) {
+		src = &handle->mix_sources[i];
+		if (src->stream)
+			mix_num = MAX(mix_num, _audio_track_mix_source(handle, src, buf, samples));
+	}
+
+	return mix_num;
+}
+
+static uint8_t _audio_track_resample_quality(uint8_t stream_type)
+{
+	/* prompts and tones are narrow band, save cpu for the music */
+	switch (stream_type) {
+	case AUDIO_STREAM_TTS:
+	case AUDIO_STREAM_TIP:
+	case AUDIO_STREAM_VOICE:
+		return AUDIO_RESAMPLER_QUALITY_16TAP;
+	default:
+		return AUDIO_RESAMPLER_QUALITY_32TAP;
+	}
+}
+
+static void _audio_track_close_mix_source(struct audio_mix_source_t *src)
+{
+	if (src->res_handle) {
+		audio_resampler_close(src->res_handle);
+	}
+
+	/* res_in_buf[0] is the start of the frame buffer */
+	if (src->res_in_buf[0]) {
+		mem_free(src->res_in_buf[0]);
+	}
+
+	memset(src, 0, sizeof(*src));
+}
+
+static struct audio_mix_source_t *_audio_track_find_mix_source(struct audio_track_t *handle,
+		uint8_t stream_type)
+{
+	int i;
+
+	for (i = 0; i < MAX_AUDIO_MIX_SOURCE_NUM; i++) {
+		if (handle->mix_sources[i].stream && handle->mix_sources[i].stream_type == stream_type)
+			return &handle->mix_sources[i];
+	}
+
+	return NULL;
+}
 #endif /* CONFIG_MEDIA_EFFECT */
 
+#ifdef CONFIG_AUDIO_TRACK_ZERO_COPY
+static void _audio_track_dma_release(struct audio_track_t *audio_track)
+{
+	if (audio_track->dma_claim_len) {
+		acts_ringbuf_get_finish(audio_track->pcm_ringbuf, audio_track->dma_claim_len);
+		audio_track->dma_claim_len = 0;
+
+		/* stream_read is bypassed, wake up the writer blocked on the space */
+		if (audio_track->audio_stream->sync_sem) {
+			os_sem_give(audio_track->audio_stream->sync_sem);
+		}
+	}
+}
+#endif
+
 static int _audio_track_request_more_data(void *handle, uint32_t reason)
 {
 	static uint8_t printk_cnt = 0;
 	struct audio_track_t *audio_track = (struct audio_track_t *)handle;
 	int read_len = audio_track->pcm_frame_size / 2;
-	int stream_length = stream_get_length(audio_track->audio_stream);
+	int stream_length;
 	int ret = 0;
 	bool reload_mode = ((audio_track->channel_mode & AUDIO_DMA_RELOAD_MODE) == AUDIO_DMA_RELOAD_MODE);
 	uint8_t *buf = NULL;
@@ -185,6 +206,13 @@ static int _audio_track_request_more_data(void *handle, uint32_t reason)
         return 0;
     }
 
+#ifdef CONFIG_AUDIO_TRACK_ZERO_COPY
+	/* the dma of the last request has finished, release its pcm */
+	_audio_track_dma_release(audio_track);
+#endif
+
+	stream_length = stream_get_length(audio_track->audio_stream);
+
 	if (reload_mode) {
 		if (reason == AOUT_DMA_IRQ_HF) {
 			buf = audio_track->pcm_frame_buff;
@@ -247,7 +275,22 @@ static int _audio_track_request_more_data(void *handle, uint32_t reason)
 	    printk_cnt = 0;
 	}
 
-	ret = stream_read(audio_track->audio_stream, buf, read_len);
+#ifdef CONFIG_AUDIO_TRACK_ZERO_COPY
+	if (audio_track->pcm_ringbuf) {
+		void *data = NULL;
+
+		/* let the dma read the pcm in place, up to the wrap point */
+		ret = acts_ringbuf_get_claim(audio_track->pcm_ringbuf, &data, read_len);
+		if (ret > 0) {
+			buf = data;
+			read_len = ret;
+			audio_track->dma_claim_len = ret;
+		}
+	} else
+#endif
+	{
+		ret = stream_read(audio_track->audio_stream, buf, read_len);
+	}
 	if (ret != read_len) {
 		if (!printk_cnt++) {
 			printk("F\n");
@@ -316,9 +359,11 @@ exit:
 #endif
 
 		/**last frame send more 2 samples */
-		if (audio_track->flushed && stream_get_length(audio_track->audio_stream) == 0) {
-			memset(buf, 0, audio_track->frame_size * 2);
-			hal_aout_channel_write_data(audio_track->audio_handle, buf, audio_track->frame_size * 2);
+		if (audio_track->flushed
+			&& stream_get_length(audio_track->audio_stream) == audio_track->dma_claim_len) {
+			memset(audio_track->pcm_frame_buff, 0, audio_track->frame_size * 2);
+			hal_aout_channel_write_data(audio_track->audio_handle,
+					audio_track->pcm_frame_buff, audio_track->frame_size * 2);
 		}
 	}
 
@@ -369,8 +414,11 @@ static void _audio_track_stream_observer_notify(void *observer, int readoff, int
 #ifdef CONFIG_MEDIA_EFFECT
     if(!os_is_in_isr()) {
     	audio_system_mutex_lock();
-    	if (handle->mix_stream && (type == STREAM_NOTIFY_PRE_WRITE)) {
-    		_audio_track_data_mix(handle, (s16_t *)buf, num / handle->frame_size, (s16_t *)buf);
+    	/* buf is NULL for pcm written in place, mixed by audio_track_write_finish */
+    	if (handle->mix_source_num && buf && (type == STREAM_NOTIFY_PRE_WRITE)) {
+    		int sample_size = (handle->audio_format == AUDIO_FORMAT_PCM_32_BIT) ? 4 : 2;
+
+    		_audio_track_data_mix(handle, (s16_t *)buf, num / (handle->channels * sample_size));
     	}
     	audio_system_mutex_unlock();
     }
@@ -433,6 +481,7 @@ struct audio_track_t *audio_track_create(uint8_t stream_type, int sample_rate,
 	audio_track->audio_format = format;
 	audio_track->sample_rate = sample_rate;
 	audio_track->compensate_samples = 0;
+	audio_track->mix_main_gain = AUDIO_MIXER_GAIN_UNITY;
 
 	audio_track->channel_type = audio_policy_get_out_channel_type(stream_type);
 	audio_track->channel_id = audio_policy_get_out_channel_id(stream_type);
@@ -514,6 +563,13 @@ struct audio_track_t *audio_track_create(uint8_t stream_type, int sample_rate,
         }
 	}
 
+#ifdef CONFIG_AUDIO_TRACK_ZERO_COPY
+	/* the internal pcm pool is in the dma section on no psram soc, see media_mem.c */
+	if (!outer_stream && (audio_track->channel_mode & AUDIO_DMA_RELOAD_MODE) != AUDIO_DMA_RELOAD_MODE) {
+		audio_track->pcm_ringbuf = stream_get_ringbuffer(audio_track->audio_stream);
+	}
+#endif
+
 	stream_set_observer(audio_track->audio_stream, audio_track,
 		_audio_track_stream_observer_notify, STREAM_NOTIFY_WRITE | STREAM_NOTIFY_PRE_WRITE);
 
@@ -582,6 +638,11 @@ int audio_track_destory(struct audio_track_t *handle)
 #ifdef CONFIG_MEDIA_EFFECT
 	if (handle->fade_handle)
 		media_fade_close(handle->fade_handle);
+
+	for (int i = 0; i < MAX_AUDIO_MIX_SOURCE_NUM; i++) {
+		if (handle->mix_sources[i].stream)
+			_audio_track_close_mix_source(&handle->mix_sources[i]);
+	}
 #endif
 
 	mem_free(handle);
@@ -641,6 +702,10 @@ int audio_track_stop(struct audio_track_t *handle)
 	if (handle->audio_handle)
 		hal_aout_channel_stop(handle->audio_handle);
 
+#ifdef CONFIG_AUDIO_TRACK_ZERO_COPY
+	_audio_track_dma_release(handle);
+#endif
+
 	SYS_LOG_INF("stop %p ok ", handle);
 	return 0;
 }
@@ -651,7 +716,16 @@ int audio_track_pause(struct audio_track_t *handle)
 
 	handle->muted = 1;
 
+#ifdef CONFIG_AUDIO_TRACK_ZERO_COPY
+	uint32_t flags = irq_lock();
+
+	/* the pcm claimed by dma is dropped too */
 	stream_flush(handle->audio_stream);
+	handle->dma_claim_len = 0;
+	irq_unlock(flags);
+#else
+	stream_flush(handle->audio_stream);
+#endif
 
 	return 0;
 }
@@ -695,6 +769,71 @@ int audio_track_write(struct audio_track_t *handle, unsigned char *buf, int num)
 	return ret;
 }
 
+static int _audio_track_sample_bytes(struct audio_track_t *handle)
+{
+	return handle->channels * ((handle->audio_format == AUDIO_FORMAT_PCM_32_BIT) ? 4 : 2);
+}
+
+int audio_track_write_claim(struct audio_track_t *handle, struct acts_ringbuf_vec vec[2], int num)
+{
+	struct acts_ringbuf *ringbuf;
+	int sample_bytes;
+
+	assert(handle && handle->audio_stream);
+
+	ringbuf = stream_get_ringbuffer(handle->audio_stream);
+	if (!ringbuf) {
+		return -ENOTSUP;
+	}
+
+	acts_ringbuf_put_claim_vec(ringbuf, vec, num);
+
+	/* each segment holds whole samples, so that they can be mixed in place */
+	sample_bytes = _audio_track_sample_bytes(handle);
+	if (vec[0].len % sample_bytes) {
+		vec[0].len -= vec[0].len % sample_bytes;
+		vec[1].len = 0;
+	} else {
+		vec[1].len -= vec[1].len % sample_bytes;
+	}
+
+	return vec[0].len + vec[1].len;
+}
+
+int audio_track_write_finish(struct audio_track_t *handle, struct acts_ringbuf_vec vec[2], int num)
+{
+	int ret = 0;
+
+	assert(handle && handle->audio_stream);
+
+	/* writing 0 bytes would mark the stream finished */
+	if (num <= 0) {
+		return 0;
+	}
+
+#ifdef CONFIG_MEDIA_EFFECT
+	if (handle->mix_source_num && !os_is_in_isr()) {
+		int sample_bytes = _audio_track_sample_bytes(handle);
+		int len = MIN(num, vec[0].len);
+
+		audio_system_mutex_lock();
+		_audio_track_data_mix(handle, vec[0].data, len / sample_bytes);
+		if (num > len) {
+			_audio_track_data_mix(handle, vec[1].data, (num - len) / sample_bytes);
+		}
+		audio_system_mutex_unlock();
+	}
+#endif
+
+	/* only move the write offset, the pcm is already in place */
+	ret = stream_write(handle->audio_stream, NULL, num);
+	if (ret != num) {
+		SYS_LOG_WRN(" %d %d\n", ret, num);
+	}
+
+	return ret;
+}
+
 int audio_track_flush(struct audio_track_t *handle)
 {
 	int try_cnt = 0;
@@ -743,7 +882,13 @@ int audio_track_flush(struct audio_track_t *handle)
 #endif
     }
 
-	audio_track_set_mix_stream(handle, NULL, 0, 1, AUDIO_STREAM_TTS);
+#ifdef CONFIG_MEDIA_EFFECT
+	for (int i = 0; i < MAX_AUDIO_MIX_SOURCE_NUM; i++) {
+		if (handle->mix_sources[i].stream) {
+			audio_track_set_mix_stream(handle, NULL, 0, 1, handle->mix_sources[i].stream_type);
+		}
+	}
+#endif
 
 	return 0;
 }
@@ -991,7 +1136,9 @@ int audio_track_set_mix_stream(struct audio_track_t *handle, io_stream_t mix_str
 		uint8_t sample_rate, uint8_t channels, uint8_t stream_type)
 {
 #ifdef CONFIG_MEDIA_EFFECT
+	struct audio_mix_source_t *src;
 	int res = 0;
+	int i;
 
 	assert(handle);
 
@@ -1001,79 +1148,132 @@ int audio_track_set_mix_stream(struct audio_track_t *handle, io_stream_t mix_str
 		goto exit;
 	}
 
+	/* one source per stream type, replace the old stream of the same type */
+	src = _audio_track_find_mix_source(handle, stream_type);
+	if (src) {
+		_audio_track_close_mix_source(src);
+		handle->mix_source_num--;
+	}
+
 	if (mix_stream) {
-		uint16_t *frame_buf = media_mem_get_cache_pool(RESAMPLE_FRAME_DATA, stream_type);
-		int frame_buf_size = media_mem_get_cache_pool_size(RESAMPLE_FRAME_DATA, stream_type);
+		int16_t *frame_buf;
 		uint8_t res_channels = MIN(channels, handle->channels);
 
+		for (i = 0; i < MAX_AUDIO_MIX_SOURCE_NUM; i++) {
+			if (!handle->mix_sources[i].stream)
+				break;
+		}
+
+		if (i >= MAX_AUDIO_MIX_SOURCE_NUM) {
+			SYS_LOG_ERR("mix source full");
+			res = -EBUSY;
+			goto exit;
+		}
+
+		src = &handle->mix_sources[i];
+
 		if (sample_rate != handle->sample_rate) {
 			int frame_size;
 
-			handle->res_handle = media_resample_open(
-					res_channels, sample_rate, handle->sample_rate,
-					&handle->res_in_samples, &handle->res_out_samples, stream_type);
-			if (!handle->res_handle) {
-				SYS_LOG_ERR("media_resample_open failed");
+			src->res_handle = audio_resampler_open(res_channels,
+					get_sample_rate_hz(sample_rate), get_sample_rate_hz(handle->sample_rate),
+					_audio_track_resample_quality(stream_type),
+					&src->res_in_samples, &src->res_out_samples);
+			if (!src->res_handle) {
+				SYS_LOG_ERR("audio_resampler_open failed");
 				res = -ENOMEM;
 				goto exit;
 			}
 
-			frame_size = channels * (ROUND_UP(handle->res_in_samples, 2) + ROUND_UP(handle->res_out_samples, 2));
+			frame_size = channels * (ROUND_UP(src->res_in_samples, 2) + ROUND_UP(src->res_out_samples, 2));
 
-			if (frame_buf_size / 2 < frame_size) {
+			/* allocated while attached only, nothing is reserved when no stream is mixed */
+			frame_buf = mem_malloc(frame_size * sizeof(int16_t));
+			if (!frame_buf) {
 				SYS_LOG_ERR("frame mem not enough");
-				media_resample_close(handle->res_handle);
-				handle->res_handle = NULL;
+				_audio_track_close_mix_source(src);
 				res = -ENOMEM;
 				goto exit;
 			}
 
-			handle->res_in_buf[0] = frame_buf;
-			handle->res_in_buf[1] = (channels > 1) ?
-					handle->res_in_buf[0] + ROUND_UP(handle->res_in_samples, 2) : handle->res_in_buf[0];
+			src->res_in_buf[0] = frame_buf;
+			src->res_in_buf[1] = (channels > 1) ?
+					src->res_in_buf[0] + ROUND_UP(src->res_in_samples, 2) : src->res_in_buf[0];
 
-			handle->res_out_buf[0] = handle->res_in_buf[1] + ROUND_UP(handle->res_in_samples, 2);
-			handle->res_out_buf[1] = (res_channels > 1) ?
-					handle->res_out_buf[0] + ROUND_UP(handle->res_out_samples, 2) : handle->res_out_buf[0];
+			src->res_out_buf[0] = src->res_in_buf[1] + ROUND_UP(src->res_in_samples, 2);
+			src->res_out_buf[1] = (res_channels > 1) ?
+					src->res_out_buf[0] + ROUND_UP(src->res_out_samples, 2) : src->res_out_buf[0];
 		} else {
-			handle->res_in_samples = frame_buf_size / 2 / channels;
-			handle->res_in_buf[0] = frame_buf;
-			handle->res_in_buf[1] = (channels > 1) ?
-					handle->res_in_buf[0] + handle->res_in_samples : handle->res_in_buf[0];
-
-			handle->res_out_buf[0] = handle->res_in_buf[0];
-			handle->res_out_buf[1] = handle->res_in_buf[1];
-		}
+			frame_buf = mem_malloc(AUDIO_MIX_FRAME_SAMPLES * channels * sizeof(int16_t));
+			if (!frame_buf) {
+				SYS_LOG_ERR("frame mem not enough");
+				res = -ENOMEM;
+				goto exit;
+			}
 
-		handle->res_out_samples = 0;
-		handle->res_remain_samples = 0;
+			src->res_in_samples = AUDIO_MIX_FRAME_SAMPLES;
+			src->res_in_buf[0] = frame_buf;
+			src->res_in_buf[1] = (channels > 1) ?
+					src->res_in_buf[0] + src->res_in_samples : src->res_in_buf[0];
 
-		/* open mix: only support 1 mix channels */
-		if (handle->mix_channels == 1) {
-			handle->mix_handle = media_mix_open(handle->sample_rate, handle->channels, 1);
+			src->res_out_buf[0] = src->res_in_buf[0];
+			src->res_out_buf[1] = src->res_in_buf[1];
 		}
+
+		src->res_out_samples = 0;
+		src->res_remain_samples = 0;
+		src->underrun_samples = 0;
+		src->stream_type = stream_type;
+		src->sample_rate = sample_rate;
+		src->channels = channels;
+		src->gain = AUDIO_MIXER_GAIN_UNITY;
+		src->stream = mix_stream;
+		handle->mix_source_num++;
 	}
 
-	handle->mix_stream = mix_stream;
-	handle->mix_sample_rate = sample_rate;
-	handle->mix_channels = channels;
+	SYS_LOG_INF("mix_stream %p type %d, sample_rate %d->%d, sources %d\n",
+			mix_stream, stream_type, sample_rate, handle->sample_rate, handle->mix_source_num);
 
-	if (!handle->mix_stream) {
-		if (handle->res_handle) {
-			media_resample_close(handle->res_handle);
-			handle->res_handle = NULL;
-		}
+exit:
+	audio_system_mutex_unlock();
+	return res;
+#else
+	return -ENOSYS;
+#endif /* CONFIG_MEDIA_EFFECT */
+}
 
-		if (handle->mix_handle) {
-			media_mix_close(handle->mix_handle);
-			handle->mix_handle = NULL;
-		}
+io_stream_t audio_track_get_mix_stream(struct audio_track_t *handle)
+{
+	int i;
+
+	assert(handle);
+
+	for (i = 0; i < MAX_AUDIO_MIX_SOURCE_NUM; i++) {
+		if (handle->mix_sources[i].stream)
+			return handle->mix_sources[i].stream;
 	}
 
-	SYS_LOG_INF("mix_stream %p, sample_rate %d->%d\n",
-			mix_stream, sample_rate, handle->sample_rate);
+	return NULL;
+}
+
+int audio_track_get_mix_underrun(struct audio_track_t *handle, uint8_t stream_type,
+		uint32_t *underrun_samples)
+{
+#ifdef CONFIG_MEDIA_EFFECT
+	struct audio_mix_source_t *src;
+	int res = 0;
+
+	assert(handle && underrun_samples);
+
+	audio_system_mutex_lock();
+
+	src = _audio_track_find_mix_source(handle, stream_type);
+	if (src) {
+		*underrun_samples = src->underrun_samples;
+	} else {
+		res = -ENOENT;
+	}
 
-exit:
 	audio_system_mutex_unlock();
 	return res;
 #else
@@ -1081,9 +1281,32 @@ exit:
 #endif /* CONFIG_MEDIA_EFFECT */
 }
 
-io_stream_t audio_track_get_mix_stream(struct audio_track_t *handle)
+int audio_track_set_mix_gain(struct audio_track_t *handle, uint8_t stream_type, int32_t gain)
 {
+#ifdef CONFIG_MEDIA_EFFECT
+	struct audio_mix_source_t *src;
+	int res = 0;
+
 	assert(handle);
 
-	return handle->mix_stream;
+	gain = MAX(0, MIN(gain, AUDIO_MIXER_GAIN_MAX));
+
+	audio_system_mutex_lock();
+
+	if (stream_type == handle->stream_type) {
+		handle->mix_main_gain = gain;
+	} else {
+		src = _audio_track_find_mix_source(handle, stream_type);
+		if (src) {
+			src->gain = gain;
+		} else {
+			res = -ENOENT;
+		}
+	}
+
+	audio_system_mutex_unlock();
+	return res;
+#else
+	return -ENOSYS;
+#endif /* CONFIG_MEDIA_EFFECT */
 }
@@ -14,6 +14,8 @@
 #include <audio_system.h>
 #include <audio_policy.h>
 #include <stream.h>
+#include <acts_ringbuf.h>
+#include <audio_mixer.h>
 /**
  * @defgroup audio_track_apis Auido Track APIs
  * @{
@@ -100,6 +102,36 @@ int audio_track_resume(struct audio_track_t *handle);
  * @return len of write datas
  */
 int audio_track_write(struct audio_track_t *handle, unsigned char *buf, int num);
+/**
+ * @brief Claim buffer in audio track to write data in place
+ *
+ * This routine claims free space of the track stream, so that decoder can
+ * write pcm directly into it instead of its own buffer plus a copy by
+ * audio_track_write. The space wrapping at the end of the ring buffer is
+ * returned in vec[1], and each segment holds whole samples.
+ *
+ * @param handle handle of track
+ * @param vec two segments of the claimed space
+ * @param num number of bytes want to write
+ *
+ * @return bytes claimed, smaller than num if not enough space, or
+ *         negative if the track stream is not a ring buffer stream
+ */
+int audio_track_write_claim(struct audio_track_t *handle, struct acts_ringbuf_vec vec[2], int num);
+/**
+ * @brief Finish writing data claimed by audio_track_write_claim
+ *
+ * This routine mixes the mix streams into the written data in place, then
+ * commits it to the track stream. The data is not copied to the streams
+ * attached to the track stream.
+ *
+ * @param handle handle of track
+ * @param vec segments returned by audio_track_write_claim
+ * @param num number of bytes written, not more than claimed
+ *
+ * @return len of write datas
+ */
+int audio_track_write_finish(struct audio_track_t *handle, struct acts_ringbuf_vec vec[2], int num);
 /**
  * @brief flush Audio Track data
  *
@@ -117,16 +149,68 @@ int audio_track_set_waitto_start(struct audio_track_t *handle, bool wait);
 int audio_track_is_waitto_start(struct audio_track_t *handle);
 int audio_track_get_fill_samples(struct audio_track_t *handle);
 int audio_track_compensate_samples(struct audio_track_t *handle, int samples_cnt);
-int audio_track_set_mix_stream(struct audio_track_t *handle, io_stream_t mix_stream,
-		uint8_t sample_rate, uint8_t channels, uint8_t stream_type);
 uint32_t audio_track_get_play_time(struct audio_track_t *handle);
-io_stream_t audio_track_get_mix_stream(struct audio_track_t *handle);
 int audio_track_set_mute(struct audio_track_t *handle, bool mute);
 int audio_track_set_fade_out(struct audio_track_t *handle, int fade_time);
 int audio_track_set_fade_in(struct audio_track_t *handle, int fade_time);
 /**
  * INTERNAL_HIDDEN @endcond
  */
+/**
+ * @brief Set Mix Stream Of Track
+ *
+ * This routine mixes a pcm stream into the track output. Streams of
+ * different stream types can be mixed at the same time, at most
+ * MAX_AUDIO_MIX_SOURCE_NUM. Setting a stream for a stream type already
+ * mixed replaces the old one, and setting NULL stops mixing the stream type.
+ * The mix never waits for the stream, the samples not ready are skipped.
+ *
+ * @param handle handle of track
+ * @param mix_stream pcm stream of 16 bits to mix, NULL to stop mixing
+ * @param sample_rate sample rate of mix_stream, resampled to the track
+ * @param channels channels of mix_stream
+ * @param stream_type stream type of mix_stream
+ *
+ * @return 0 excute successed , others failed
+ */
+int audio_track_set_mix_stream(struct audio_track_t *handle, io_stream_t mix_stream,
+		uint8_t sample_rate, uint8_t channels, uint8_t stream_type);
+/**
+ * @brief Get Mix Stream Of Track
+ *
+ * @param handle handle of track
+ *
+ * @return the first stream mixed, NULL if none
+ */
+io_stream_t audio_track_get_mix_stream(struct audio_track_t *handle);
+/**
+ * @brief Get Underrun Samples Of Mix Stream
+ *
+ * This routine gets the samples of the track not mixed with the stream
+ * since it had no data, counted from the time the stream is set.
+ *
+ * @param handle handle of track
+ * @param stream_type stream type of the mixed stream
+ * @param underrun_samples pointer to store the underrun samples
+ *
+ * @return 0 excute successed , others failed
+ */
+int audio_track_get_mix_underrun(struct audio_track_t *handle, uint8_t stream_type,
+		uint32_t *underrun_samples);
+/**
+ * @brief Set Mix Gain Of Track
+ *
+ * This routine sets the gain of a mixed stream. If stream_type is the
+ * stream type of the track, it sets the gain of the track stream applied
+ * only while mixing, which can be used to duck the music under tones.
+ *
+ * @param handle handle of track
+ * @param stream_type stream type of the mixed stream or the track
+ * @param gain Q15 gain, AUDIO_MIXER_GAIN_UNITY for 0 dB, at most AUDIO_MIXER_GAIN_MAX
+ *
+ * @return 0 excute successed , others failed
+ */
+int audio_track_set_mix_gain(struct audio_track_t *handle, uint8_t stream_type, int32_t gain);
 /**
  * @brief set track volume
  *
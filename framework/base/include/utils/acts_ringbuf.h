@@ -73,6 +73,30 @@ struct acts_ringbuf {
 	uint32_t tail_offset;
 };
 
+/*
+ * Concurrency
+ *
+ * A ring buffer with a single producer and a single consumer needs no lock:
+ * the put side (put, put_claim(_vec)/put_finish, write, fill, fill_none)
+ * only updates tail, and the get side (peek, get, get_claim(_vec)/get_finish,
+ * read, drop, drop_all) only updates head. Each side publishes its index
+ * after its data accesses complete (release) and reads the peer index before
+ * touching data (acquire). acts_ringbuf_copy() is the consumer of src_buf
+ * and the producer of dst_buf.
+ *
+ * Several producers or several consumers must still serialize among
+ * themselves. acts_ringbuf_reset() and acts_ringbuf_defrag() move both
+ * indexes and must not run concurrently with any other access.
+ */
+
+/* one contiguous segment of a ring buffer claim */
+struct acts_ringbuf_vec {
+	/* start address of the segment */
+	void *data;
+	/* segment size in elements */
+	uint32_t len;
+};
+
 /**
  * @brief Statically define and initialize a high performance ring buffer.
  *
@@ -247,6 +271,25 @@ uint32_t acts_ringbuf_get(struct acts_ringbuf *buf, void *data, uint32_t size);
  */
 uint32_t acts_ringbuf_get_claim(struct acts_ringbuf *buf, void **data, uint32_t size);
 
+/**
+ * @brief Get address of valid data in a ring buffer, wrap included.
+ *
+ * Same as @ref acts_ringbuf_get_claim, but data wrapping at the end of the
+ * internal buffer is returned as a second segment instead of being cut off,
+ * so no copy or @ref acts_ringbuf_defrag is required. vec[1].len is 0 when
+ * the data does not wrap. Once processed the data can be freed using
+ * @ref acts_ringbuf_get_finish with up to the returned size.
+ *
+ * @param[in]  buf Address of ring buffer.
+ * @param[out] vec Two segments, in order, covering the claimed data.
+ * @param[in]  size Requested size in elements.
+ *
+ * @return Number of valid elements in both segments, smaller than requested
+ *	   if there is not enough data.
+ */
+uint32_t acts_ringbuf_get_claim_vec(struct acts_ringbuf *buf,
+		struct acts_ringbuf_vec vec[2], uint32_t size);
+
 /**
  * @brief Indicate number of elements read from claimed buffer.
  *
@@ -288,6 +331,24 @@ uint32_t acts_ringbuf_put(struct acts_ringbuf *buf, const void *data, uint32_t s
  */
 uint32_t acts_ringbuf_put_claim(struct acts_ringbuf *buf, void **data, uint32_t size);
 
+/**
+ * @brief Allocate buffer for writing data to a ring buffer, wrap included.
+ *
+ * Same as @ref acts_ringbuf_put_claim, but free space wrapping at the end of
+ * the internal buffer is returned as a second segment. vec[1].len is 0 when
+ * the space does not wrap. Once written, the number of elements can be
+ * confirmed using @ref acts_ringbuf_put_finish with up to the returned size.
+ *
+ * @param[in]  buf Address of ring buffer.
+ * @param[out] vec Two segments, in order, covering the allocated space.
+ * @param[in]  size Requested allocation size in elements.
+ *
+ * @return Size of both segments, smaller than requested if there is not
+ *	   enough free space.
+ */
+uint32_t acts_ringbuf_put_claim_vec(struct acts_ringbuf *buf,
+		struct acts_ringbuf_vec vec[2], uint32_t size);
+
 /**
  * @brief Indicate number of elements written to allocated buffers.
  *
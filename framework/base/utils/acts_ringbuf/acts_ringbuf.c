@@ -14,6 +14,57 @@
 #include <soc_dsp.h>
 #endif
 
+/*
+ * Each side reads the peer index with acquire and publishes its own with
+ * release, see "Concurrency" in acts_ringbuf.h.
+ */
+static inline uint32_t _acts_ringbuf_readable(struct acts_ringbuf *buf)
+{
+	return __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE) - buf->head;
+}
+
+static inline uint32_t _acts_ringbuf_writable(struct acts_ringbuf *buf)
+{
+	return buf->size - (buf->tail - __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE));
+}
+
+static inline void _acts_ringbuf_advance_head(struct acts_ringbuf *buf, uint32_t size)
+{
+	uint32_t offset = buf->head_offset + size;
+
+	if (offset >= buf->size)
+		offset -= buf->size;
+
+	buf->head_offset = offset;
+	__atomic_store_n(&buf->head, buf->head + size, __ATOMIC_RELEASE);
+}
+
+static inline void _acts_ringbuf_advance_tail(struct acts_ringbuf *buf, uint32_t size)
+{
+	uint32_t offset = buf->tail_offset + size;
+
+	if (offset >= buf->size)
+		offset -= buf->size;
+
+	buf->tail_offset = offset;
+	__atomic_store_n(&buf->tail, buf->tail + size, __ATOMIC_RELEASE);
+}
+
+static uint32_t _acts_ringbuf_fill_vec(struct acts_ringbuf *buf, uint32_t offset,
+		uint32_t size, struct acts_ringbuf_vec vec[2])
+{
+	uint32_t len = buf->size - offset;
+
+	if (len > size)
+		len = size;
+
+	vec[0].data = (void *)(buf->cpu_ptr + ACTS_RINGBUF_SIZE8(offset));
+	vec[0].len = len;
+	vec[1].data = (void *)(buf->cpu_ptr);
+	vec[1].len = size - len;
+	return size;
+}
+
 int acts_ringbuf_init(struct acts_ringbuf *buf, void *data, uint32_t size)
 {
 	buf->head = 0;
@@ -86,7 +137,7 @@ uint32_t acts_ringbuf_peek(struct acts_ringbuf *buf, void *data, uint32_t size)
 {
 	uint32_t offset, len;
 
-	len = acts_ringbuf_length(buf);
+	len = _acts_ringbuf_readable(buf);
 	if (size > len)
 		return 0;
 
@@ -108,34 +159,37 @@ uint32_t acts_ringbuf_peek(struct acts_ringbuf *buf, void *data, uint32_t size)
 uint32_t acts_ringbuf_get(struct acts_ringbuf *buf, void *data, uint32_t size)
 {
 	size = acts_ringbuf_peek(buf, data, size);
-	buf->head += size;
-	buf->head_offset += size;
-	if (buf->head_offset >= buf->size)
-		buf->head_offset -= buf->size;
+	_acts_ringbuf_advance_head(buf, size);
 	return size;
 }
 
 uint32_t acts_ringbuf_get_claim(struct acts_ringbuf *buf, void **data, uint32_t size)
 {
 	uint32_t offset = buf->head_offset;
-	uint32_t max_size = min(buf->size - offset, acts_ringbuf_length(buf));
+	uint32_t max_size = min(buf->size - offset, _acts_ringbuf_readable(buf));
 
 	*data = (void *)(buf->cpu_ptr + ACTS_RINGBUF_SIZE8(offset));
 	return (size <= max_size) ? size : max_size;
 }
 
-int acts_ringbuf_get_finish(struct acts_ringbuf *buf, uint32_t size)
+uint32_t acts_ringbuf_get_claim_vec(struct acts_ringbuf *buf,
+		struct acts_ringbuf_vec vec[2], uint32_t size)
 {
-	uint32_t offset = buf->head_offset;
-	uint32_t max_size = min(buf->size - offset, acts_ringbuf_length(buf));
+	uint32_t len = _acts_ringbuf_readable(buf);
+
+	if (size > len)
+		size = len;
+
+	return _acts_ringbuf_fill_vec(buf, buf->head_offset, size, vec);
+}
 
-	if (size > max_size)
+int acts_ringbuf_get_finish(struct acts_ringbuf *buf, uint32_t size)
+{
+	/* may span the wrap point when claimed by acts_ringbuf_get_claim_vec */
+	if (size > _acts_ringbuf_readable(buf))
 		return -EINVAL;
 
-	buf->head += size;
-	buf->head_offset += size;
-	if (buf->head_offset >= buf->size)
-		buf->head_offset -= buf->size;
+	_acts_ringbuf_advance_head(buf, size);
 	return 0;
 }
 
@@ -143,7 +197,7 @@ uint32_t acts_ringbuf_put(struct acts_ringbuf *buf, const void *data, uint32_t s
 {
 	uint32_t offset, len;
 
-	len = acts_ringbuf_space(buf);
+	len = _acts_ringbuf_writable(buf);
 	if (size > len)
 		return 0;
 
@@ -159,41 +213,44 @@ uint32_t acts_ringbuf_put(struct acts_ringbuf *buf, const void *data, uint32_t s
 		}
 	}
 
-	buf->tail += size;
-	buf->tail_offset += size;
-	if (buf->tail_offset >= buf->size)
-		buf->tail_offset -= buf->size;
+	_acts_ringbuf_advance_tail(buf, size);
 	return size;
 }
 
 uint32_t acts_ringbuf_put_claim(struct acts_ringbuf *buf, void **data, uint32_t size)
 {
 	uint32_t offset = buf->tail_offset;
-	uint32_t max_size = min(buf->size - offset, acts_ringbuf_space(buf));
+	uint32_t max_size = min(buf->size - offset, _acts_ringbuf_writable(buf));
 
 	*data = (void *)(buf->cpu_ptr + ACTS_RINGBUF_SIZE8(offset));
 	return (size <= max_size) ? size : max_size;
 }
 
-int acts_ringbuf_put_finish(struct acts_ringbuf *buf, uint32_t size)
+uint32_t acts_ringbuf_put_claim_vec(struct acts_ringbuf *buf,
+		struct acts_ringbuf_vec vec[2], uint32_t size)
 {
-	uint32_t offset = buf->tail_offset;
-	uint32_t max_size = min(buf->size - offset, acts_ringbuf_space(buf));
+	uint32_t len = _acts_ringbuf_writable(buf);
+
+	if (size > len)
+		size = len;
+
+	return _acts_ringbuf_fill_vec(buf, buf->tail_offset, size, vec);
+}
 
-	if (size > max_size)
+int acts_ringbuf_put_finish(struct acts_ringbuf *buf, uint32_t size)
+{
+	/* may span the wrap point when claimed by acts_ringbuf_put_claim_vec */
+	if (size > _acts_ringbuf_writable(buf))
 		return -EINVAL;
 
-	buf->tail += size;
-	buf->tail_offset += size;
-	if (buf->tail_offset >= buf->size)
-		buf->tail_offset -= buf->size;
+	_acts_ringbuf_advance_tail(buf, size);
 	return 0;
 }
 
 uint32_t acts_ringbuf_copy(struct acts_ringbuf *dst_buf, struct acts_ringbuf *src_buf, uint32_t size)
 {
-	uint32_t src_length = acts_ringbuf_length(src_buf);
-	uint32_t dst_space = acts_ringbuf_space(dst_buf);
+	uint32_t src_length = _acts_ringbuf_readable(src_buf);
+	uint32_t dst_space = _acts_ringbuf_writable(dst_buf);
 	uint32_t src_offset, dst_offset;
 	uint32_t len, copy_len;
 
@@ -231,15 +288,9 @@ uint32_t acts_ringbuf_copy(struct acts_ringbuf *dst_buf, struct acts_ringbuf *sr
 			dst_offset = 0;
 	} while (1);
 
-	src_buf->head += copy_len;
-	src_buf->head_offset += copy_len;
-	if (src_buf->head_offset >= src_buf->size)
-		src_buf->head_offset -= src_buf->size;
+	_acts_ringbuf_advance_head(src_buf, copy_len);
 
-	dst_buf->tail += copy_len;
-	dst_buf->tail_offset += copy_len;
-	if (dst_buf->tail_offset >= dst_buf->size)
-		dst_buf->tail_offset -= dst_buf->size;
+	_acts_ringbuf_advance_tail(dst_buf, copy_len);
 
 	return copy_len;
 }
@@ -250,7 +301,7 @@ uint32_t acts_ringbuf_read(struct acts_ringbuf *buf,
 	uint32_t offset, len;
 	int stream_len = 0;
 
-	len = acts_ringbuf_length(buf);
+	len = _acts_ringbuf_readable(buf);
 	if (size > len)
 		return 0;
 
@@ -275,10 +326,7 @@ uint32_t acts_ringbuf_read(struct acts_ringbuf *buf,
 
 	if (stream_len > 0) {
 		stream_len = ACTS_RINGBUF_NELEM(stream_len);
-		buf->head += stream_len;
-		buf->head_offset += stream_len;
-		if (buf->head_offset >= buf->size)
-			buf->head_offset -= buf->size;
+		_acts_ringbuf_advance_head(buf, stream_len);
 		return stream_len;
 	}
 
@@ -291,7 +339,7 @@ uint32_t acts_ringbuf_write(struct acts_ringbuf *buf,
 	uint32_t offset, len;
 	int stream_len = 0;
 
-	len = acts_ringbuf_space(buf);
+	len = _acts_ringbuf_writable(buf);
 	if (size > len)
 		return 0;
 
@@ -316,10 +364,7 @@ uint32_t acts_ringbuf_write(struct acts_ringbuf *buf,
 
 	if (stream_len > 0) {
 		stream_len = ACTS_RINGBUF_NELEM(stream_len);
-		buf->tail += stream_len;
-		buf->tail_offset += stream_len;
-		if (buf->tail_offset >= buf->size)
-			buf->tail_offset -= buf->size;
+		_acts_ringbuf_advance_tail(buf, stream_len);
 		return stream_len;
 	}
 
@@ -328,26 +373,20 @@ uint32_t acts_ringbuf_write(struct acts_ringbuf *buf,
 
 uint32_t acts_ringbuf_drop(struct acts_ringbuf *buf, uint32_t size)
 {
-	uint32_t length = acts_ringbuf_length(buf);
+	uint32_t length = _acts_ringbuf_readable(buf);
 
 	if (size > length)
 		return 0;
 
-	buf->head += size;
-	buf->head_offset += size;
-	if (buf->head_offset >= buf->size)
-		buf->head_offset -= buf->size;
+	_acts_ringbuf_advance_head(buf, size);
 	return size;
 }
 
 uint32_t acts_ringbuf_drop_all(struct acts_ringbuf *buf)
 {
-	uint32_t length = acts_ringbuf_length(buf);
+	uint32_t length = _acts_ringbuf_readable(buf);
 
-	buf->head += length;
-	buf->head_offset += length;
-	if (buf->head_offset >= buf->size)
-		buf->head_offset -= buf->size;
+	_acts_ringbuf_advance_head(buf, length);
 	return length;
 }
 
@@ -355,7 +394,7 @@ uint32_t acts_ringbuf_fill(struct acts_ringbuf *buf, uint8_t c, uint32_t size)
 {
 	uint32_t offset, len;
 
-	len = acts_ringbuf_space(buf);
+	len = _acts_ringbuf_writable(buf);
 	if (size > len)
 		return 0;
 
@@ -369,24 +408,18 @@ uint32_t acts_ringbuf_fill(struct acts_ringbuf *buf, uint8_t c, uint32_t size)
 		memset((void *)(buf->cpu_ptr), c, ACTS_RINGBUF_SIZE8(size - len));
 	}
 
-	buf->tail += size;
-	buf->tail_offset += size;
-	if (buf->tail_offset >= buf->size)
-		buf->tail_offset -= buf->size;
+	_acts_ringbuf_advance_tail(buf, size);
 	return size;
 }
 
 uint32_t acts_ringbuf_fill_none(struct acts_ringbuf *buf, uint32_t size)
 {
-	uint32_t space = acts_ringbuf_space(buf);
+	uint32_t space = _acts_ringbuf_writable(buf);
 
 	if (size > space)
 		return 0;
 
-	buf->tail += size;
-	buf->tail_offset += size;
-	if (buf->tail_offset >= buf->size)
-		buf->tail_offset -= buf->size;
+	_acts_ringbuf_advance_tail(buf, size);
 	return size;
 }
 
@@ -395,7 +428,7 @@ void *acts_ringbuf_head_ptr(struct acts_ringbuf *buf, uint32_t *len)
 	void *data = NULL;
 	uint32_t size;
 
-	size = acts_ringbuf_get_claim(buf, &data, acts_ringbuf_length(buf));
+	size = acts_ringbuf_get_claim(buf, &data, _acts_ringbuf_readable(buf));
 	if (len)
 		*len = size;
 
@@ -407,7 +440,7 @@ void *acts_ringbuf_tail_ptr(struct acts_ringbuf *buf, uint32_t *len)
 	void *data = NULL;
 	uint32_t size;
 
-	size = acts_ringbuf_put_claim(buf, &data, acts_ringbuf_space(buf));
+	size = acts_ringbuf_put_claim(buf, &data, _acts_ringbuf_writable(buf));
 	if (len)
 		*len = size;
 
@@ -33,11 +33,21 @@
 #  define LZ4_FORCE_O3
 #endif
 
+#ifndef CONFIG_PIC_DECOMPRESS_ROWS_BUF_SIZE
+#  define CONFIG_PIC_DECOMPRESS_ROWS_BUF_SIZE 8192
+#endif
+
 #ifdef CONFIG_PIC_COMPRESS
 __aligned(4) __in_section_unique(decompress.bss.cache)
 static uint8_t tile_temp[TILE_MAX_H * TILE_MAX_W * PIC_BYTES_PER_PIXEL];
 #endif
 
+#ifdef CONFIG_PIC_DECOMPRESS_ROWS
+/* holds the leading rows of a block not required by the decompression */
+__aligned(4) __in_section_unique(decompress.bss.cache)
+static uint8_t rows_temp[CONFIG_PIC_DECOMPRESS_ROWS_BUF_SIZE];
+#endif
+
 #ifdef CONFIG_DMA2D_HAL
 static bool dma2d_inited = false;
 static hal_dma2d_handle_t dma2d;
@@ -150,6 +160,21 @@ int pic_compress(const char* picSrc, char* picDst, int srcWidth, int srcHight,
 		pic_head->magic = RLE_PIC_MAGIC;
 	} else if (compress_format == COMPRESSED_PIC_FORMAT_RAW) {
 		pic_head->magic = RAW_PIC_MAGIC;
+	} else if (compress_format == COMPRESSED_PIC_FORMAT_LZ4_ROWS) {
+		/* blocks of tileHight full rows, keep them small enough for rows_temp */
+		int max_rows = CONFIG_PIC_DECOMPRESS_ROWS_BUF_SIZE / (srcWidth * bytes_per_pixel);
+
+		if (max_rows <= 0) {
+			printf("row of %d pixels exceeds the decompress rows buffer\n", srcWidth);
+			return -1;
+		}
+
+		if (tileHight > max_rows) {
+			tileHight = max_rows;
+		}
+
+		pic_head->magic = LZ4_ROWS_PIC_MAGIC;
+		tileWidth = srcWidth;
 	}
 
 	pic_head->width = srcWidth;
@@ -188,13 +213,23 @@ int pic_compress(const char* picSrc, char* picDst, int srcWidth, int srcHight,
 			tile_start = picSrc + i * tileWidth * bytes_per_pixel
 							 + j * tileHight * srcWidth * bytes_per_pixel;
 
-			for(int k = 0; k < tile_height; k++) {
-				memcpy(&tile_temp[k * bytes_per_pixel * tile_width],
-					tile_start + k * bytes_per_pixel * srcWidth,
-					bytes_per_pixel * tile_width);
+			if (compress_format == COMPRESSED_PIC_FORMAT_LZ4_ROWS) {
+				/* full rows are contiguous in the source */
+				new_tile->tile_size = LZ4_compress_HC(tile_start,
+										new_tile->tile_addr + base_picDst,
+										tile_height * tile_width * bytes_per_pixel,
+										maxOutputSize, 12);
+			} else {
+				for(int k = 0; k < tile_height; k++) {
+					memcpy(&tile_temp[k * bytes_per_pixel * tile_width],
+						tile_start + k * bytes_per_pixel * srcWidth,
+						bytes_per_pixel * tile_width);
+				}
 			}
 
-			if (compress_format == COMPRESSED_PIC_FORMAT_LZ4) {
+			if (compress_format == COMPRESSED_PIC_FORMAT_LZ4_ROWS) {
+				/* already compressed */
+			} else if (compress_format == COMPRESSED_PIC_FORMAT_LZ4) {
 				new_tile->tile_size = LZ4_compress_HC(tile_temp,
 										new_tile->tile_addr + base_picDst,
 										tile_height * tile_width * bytes_per_pixel,
@@ -249,6 +284,73 @@ int pic_compress_format(const char* picSource)
 }
 #endif
 
+#ifdef CONFIG_PIC_DECOMPRESS_ROWS
+LZ4_FORCE_O3
+static int _pic_decompress_rows(const char* picSource, char* picDst,
+		int out_stride, int x, int y, int w, int h)
+{
+	const compress_pic_head_t* pic_head = (const compress_pic_head_t*)picSource;
+	const tile_head_t* block_head_info = (const tile_head_t*)(picSource + sizeof(compress_pic_head_t));
+	int bytes_per_pixel = pic_head->bytes_per_pixel;
+	int row_bytes = pic_head->width * bytes_per_pixel;
+	int block_rows = pic_head->tile_height;
+	int out_size = 0;
+
+	for (int j = y / block_rows; j <= (y + h - 1) / block_rows; j++) {
+		const char* block_src = picSource + block_head_info[j].tile_addr;
+		int block_y1 = j * block_rows;
+		int block_y2 = (block_y1 + block_rows < pic_head->height) ?
+				(block_y1 + block_rows) : pic_head->height;
+		int copy_y1 = (y > block_y1) ? y : block_y1;
+		int copy_y2 = (y + h < block_y2) ? (y + h) : block_y2;
+		int dec_size = (copy_y2 - block_y1) * row_bytes;
+		char* dest = picDst + (copy_y1 - y) * out_stride;
+		int res;
+
+		/* full rows from the block start, decode in place */
+		if (x == 0 && w == pic_head->width && out_stride == row_bytes && copy_y1 == block_y1) {
+#ifndef CONFIG_SIMULATOR
+			if (copy_y2 == block_y2) {
+				res = p_brom_misc_api->p_decompress(block_src, dest,
+						block_head_info[j].tile_size, dec_size);
+			} else
+#endif
+			{
+				res = LZ4_decompress_safe_partial(block_src, dest,
+						block_head_info[j].tile_size, dec_size, dec_size);
+			}
+
+			if (res != dec_size) {
+				return -EIO;
+			}
+
+			out_size += dec_size;
+			continue;
+		}
+
+		/* stop decoding at the last row required */
+		if (dec_size > sizeof(rows_temp)) {
+			return -ENOMEM;
+		}
+
+		res = LZ4_decompress_safe_partial(block_src, (char *)rows_temp,
+				block_head_info[j].tile_size, dec_size, sizeof(rows_temp));
+		if (res != dec_size) {
+			return -EIO;
+		}
+
+		out_size += hardware_copy(dest, out_stride,
+				(char *)rows_temp + (copy_y1 - block_y1) * row_bytes + x * bytes_per_pixel,
+				w, copy_y2 - copy_y1, row_bytes, bytes_per_pixel);
+
+		/* rows_temp reused by the next block */
+		hardware_wait_finish();
+	}
+
+	return out_size;
+}
+#endif /* CONFIG_PIC_DECOMPRESS_ROWS */
+
 LZ4_FORCE_O3
 __ramfunc int pic_decompress(const char* picSource, char* picDst, int compressedSize,
 		int maxDecompressedSize, int out_stride, int x, int y, int w, int h)
@@ -293,47 +395,32 @@ __ramfunc int pic_decompress(const char* picSource, char* picDst, int compressed
 		return out_size;
 	}
 
+	if (pic_head->magic == LZ4_ROWS_PIC_MAGIC) {
+#ifdef CONFIG_PIC_DECOMPRESS_ROWS
+		out_size = _pic_decompress_rows(picSource, picDst, out_stride, x, y, w, h);
+#else
+		out_size = -ENOEXEC;
+#endif
+
+		os_strace_end_call_u32(SYS_TRACE_ID_PIC_DECOMPRESS, y_end_tile - y_start_tile + 1);
+		return out_size;
+	}
+
 	if (y_start_tile < 0)
 		y_start_tile = 0;
 	if (x_start_tile < 0)
 		x_start_tile = 0;
 
+	/*
+	 * When the cache cannot hold one row of the tiles copied out, a tile is
+	 * evicted before the next strip of the picture reaches it, so RLE tiles
+	 * cut by the region are decoded only in the rows needed.
+	 */
+	bool rle_rows_only = tile_cache_get_capacity() < x_end_tile - x_start_tile + 1;
+
 	for (int j = y_start_tile; j <= y_end_tile; j++) {
 		for (int i = x_start_tile; i <= x_end_tile; i++) {
 			int tile_index = i + j * tile_x_num;
-			//uint32_t get_cache_start = k_cycle_get_32();
-			tile_cache_item_t * cache_item = tile_cache_get(picSource, tile_index);
-			//get_cache_time +=  (k_cycle_get_32() - get_cache_start);
-			//if (!tile_cache_is_valid(cache_item)) {
-				//dec = true;
-
-			if (pic_head->magic == LZ4_PIC_MAGIC) {
-#ifndef CONFIG_SIMULATOR
-				p_brom_misc_api->p_decompress(picSource + tile_head_info[tile_index].tile_addr,
-					cache_item->tile_data,
-					tile_head_info[tile_index].tile_size,
-					sizeof(cache_item->tile_data));
-#else
-
-				LZ4_decompress_safe(picSource + tile_head_info[tile_index].tile_addr,
-					cache_item->tile_data,
-					tile_head_info[tile_index].tile_size,
-					sizeof(cache_item->tile_data));
-
-#endif
-			} else if (pic_head->magic == RLE_PIC_MAGIC) {
-				rle_decompress(picSource + tile_head_info[tile_index].tile_addr,
-						 cache_item->tile_data,
-						 tile_head_info[tile_index].tile_size,
-						 sizeof(cache_item->tile_data), pic_head->bytes_per_pixel);
-			} else {
-				return -ENOEXEC;
-			}
-
-				//tile_cache_set_valid(cache_item, picSource, tile_index,
-									 //tile_head_info[tile_index].tile_size);
-			//}
-
 			ui_region_t tile_region = {
 				.x1 = i * pic_head->tile_width,
 				.y1 = j * pic_head->tile_height,
@@ -355,6 +442,51 @@ __ramfunc int pic_decompress(const char* picSource, char* picDst, int compressed
 
 			int src_stride = pic_head->bytes_per_pixel * ui_region_get_width(&tile_region);
 
+			tile_cache_item_t * cache_item = tile_cache_get(picSource, tile_index);
+			bool partial = false;
+
+			/* the owner invalidates freed pictures, tile_size is a cheap second check */
+			if (!tile_cache_is_valid(cache_item) ||
+				cache_item->tile_size != tile_head_info[tile_index].tile_size) {
+				if (pic_head->magic == LZ4_PIC_MAGIC) {
+#ifndef CONFIG_SIMULATOR
+					p_brom_misc_api->p_decompress(picSource + tile_head_info[tile_index].tile_addr,
+						cache_item->tile_data,
+						tile_head_info[tile_index].tile_size,
+						sizeof(cache_item->tile_data));
+#else
+
+					LZ4_decompress_safe(picSource + tile_head_info[tile_index].tile_addr,
+						cache_item->tile_data,
+						tile_head_info[tile_index].tile_size,
+						sizeof(cache_item->tile_data));
+
+#endif
+				} else if (pic_head->magic == RLE_PIC_MAGIC && rle_rows_only &&
+						ui_region_get_height(&copy_region) < ui_region_get_height(&tile_region)) {
+					/* decode only the rows copied out, the tile is left uncached */
+					rle_decompress_lines(picSource + tile_head_info[tile_index].tile_addr,
+							tile_head_info[tile_index].tile_size, NULL,
+							ui_region_get_width(&tile_region), copy_region.y1 - tile_region.y1,
+							ui_region_get_height(&copy_region),
+							cache_item->tile_data + (copy_region.y1 - tile_region.y1) * src_stride,
+							src_stride, pic_head->bytes_per_pixel);
+					partial = true;
+				} else if (pic_head->magic == RLE_PIC_MAGIC) {
+					rle_decompress(picSource + tile_head_info[tile_index].tile_addr,
+							 cache_item->tile_data,
+							 tile_head_info[tile_index].tile_size,
+							 sizeof(cache_item->tile_data), pic_head->bytes_per_pixel);
+				} else {
+					return -ENOEXEC;
+				}
+
+				if (!partial) {
+					tile_cache_set_valid(cache_item, picSource, tile_index,
+										 tile_head_info[tile_index].tile_size);
+				}
+			}
+
 			char* tile_dest_addr = picDst + (copy_region.x1 - x) * pic_head->bytes_per_pixel
 											 				+ (copy_region.y1 - y) * out_stride;
 
@@ -364,17 +496,15 @@ __ramfunc int pic_decompress(const char* picSource, char* picDst, int compressed
 			out_size += hardware_copy(tile_dest_addr, out_stride, tile_src_addr,
 					ui_region_get_width(&copy_region), ui_region_get_height(&copy_region),
 					src_stride, pic_head->bytes_per_pixel);
-#if CONFIG_TILE_CACHE_NUM == 1
-			hardware_wait_finish();
-#endif
+			if (tile_cache_get_capacity() == 1) {
+				hardware_wait_finish();
+			}
 
 			//copy_time += (k_cycle_get_32() - copy_start);
 		}
 	}
 
-#if CONFIG_TILE_CACHE_NUM > 1
 	hardware_wait_finish();
-#endif
 
 	os_strace_end_call_u32(SYS_TRACE_ID_PIC_DECOMPRESS, (x_end_tile - x_start_tile + 1) * (y_end_tile - y_start_tile + 1));
 
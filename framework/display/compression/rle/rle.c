@@ -1,6 +1,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include "rle.h"
 
 #if defined(__GNUC__) && !defined(__clang__)
 #  define RLE_FORCE_O3  __attribute__((optimize("O3")))
@@ -11,19 +12,31 @@
 #define ENC_REPEAT_COUNT 3
 #define MAX_SIZE 4
 
+/* load one element of at most MAX_SIZE bytes as an integer for comparison */
+static inline uint32_t load_element(const uint8_t * src, size_t size)
+{
+	switch (size) {
+	case 1:
+		return src[0];
+	case 2:
+		return src[0] | ((uint32_t)src[1] << 8);
+	case 3:
+		return src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16);
+	default:
+		return src[0] | ((uint32_t)src[1] << 8) |
+				((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+	}
+}
+
 static inline int get_repetition_count(const uint8_t * src, size_t count, size_t size, int line_length)
 {
-	uint8_t rep_val[MAX_SIZE];
-	memcpy(rep_val, src, size);
+	uint32_t rep_val = load_element(src, size);
 	src += size;
 	count--;
 
 	int length = 1;
 	while (count > 0 && length < line_length) {
-		uint8_t val[MAX_SIZE];
-		memcpy(val, src, size);
-
-		if (memcmp(val, rep_val, size) != 0)
+		if (load_element(src, size) != rep_val)
 			break;
 
 		src += size;
@@ -39,26 +52,22 @@ static int get_non_repetition_count(const uint8_t * src, size_t count, size_t si
 	if (count < 2)
 		return count;
 
-	uint8_t v1[MAX_SIZE];
-	uint8_t v2[MAX_SIZE];
-	memcpy(v1, src, size);
-	memcpy(v2, src + size, size);
+	uint32_t v2 = load_element(src + size, size);
 	src += size * 2;
 	count -= 2;
 
-	if (memcmp(v1, v2, size) == 0)
+	if (load_element(src - size * 2, size) == v2)
 		return 1;
 
 	int length = 1;
 
 	while (count > 0 && length < line_length) {
-		uint8_t v3[MAX_SIZE];
-		memcpy(v3, src, size);
+		uint32_t v3 = load_element(src, size);
 
-		if (memcmp(v2, v3, size) == 0)
+		if (v2 == v3)
 			break;
 
-		memcpy(v2, v3, size);
+		v2 = v3;
 		src += size;
 		count--;
 		length++;
@@ -119,50 +128,123 @@ int rle_compress(const uint8_t* in_buf, uint8_t * out_buf,  size_t in_count, siz
 }
 
 RLE_FORCE_O3
-static inline void fill_repetition(uint8_t * dest, const uint8_t * src, size_t count, size_t size)
+static inline void fill_repetition_16(uint8_t * dest, const uint8_t * src, size_t count)
 {
-	if (size == 1) {
-		memset(dest, src[0], count);
-	} else if (size == 2) {
-		if (((uintptr_t)dest & 0x1) == 0) {
-			uint16_t val = src[0] | ((uint16_t)src[1] << 8);
+	uint16_t val = src[0] | ((uint16_t)src[1] << 8);
 
-			for (int i = count; i > 0; i--) {
-				*(uint16_t *)dest = val;
-				dest += size;
-			}
-		} else {
-			for (int i = count; i > 0; i--) {
-				dest[0] = src[0];
-				dest[1] = src[1];
-				dest += size;
-			}
+	if ((uintptr_t)dest & 0x1) {
+		for (int i = count; i > 0; i--) {
+			dest[0] = src[0];
+			dest[1] = src[1];
+			dest += 2;
 		}
-	} else if (size == 4) {
-		if (((uintptr_t)dest & 0x3) == 0) {
-			uint32_t val = src[0] | ((uint32_t)src[1] << 8) |
-					((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+		return;
+	}
 
-			for (int i = count; i > 0; i--) {
-				*(uint32_t *)dest = val;
-				dest += size;
-			}
-		} else {
-			for (int i = count; i > 0; i--) {
-				dest[0] = src[0];
-				dest[1] = src[1];
-				dest[2] = src[2];
-				dest[3] = src[3];
-				dest += size;
-			}
+	if (((uintptr_t)dest & 0x2) && count > 0) {
+		*(uint16_t *)dest = val;
+		dest += 2;
+		count--;
+	}
+
+	uint32_t val32 = val | ((uint32_t)val << 16);
+	uint32_t *dest32 = (uint32_t *)dest;
+
+	for (; count >= 8; count -= 8) {
+		dest32[0] = val32;
+		dest32[1] = val32;
+		dest32[2] = val32;
+		dest32[3] = val32;
+		dest32 += 4;
+	}
+
+	for (; count >= 2; count -= 2) {
+		*dest32++ = val32;
+	}
+
+	if (count > 0)
+		*(uint16_t *)dest32 = val;
+}
+
+RLE_FORCE_O3
+static inline void fill_repetition_24(uint8_t * dest, const uint8_t * src, size_t count)
+{
+	/* reach a word boundary, at most 3 pixels since 3 and 4 are coprime */
+	while (((uintptr_t)dest & 0x3) && count > 0) {
+		dest[0] = src[0];
+		dest[1] = src[1];
+		dest[2] = src[2];
+		dest += 3;
+		count--;
+	}
+
+	if (count >= 4) {
+		/* 4 pixels are exactly 3 words */
+		uint32_t w0 = src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[0] << 24);
+		uint32_t w1 = src[1] | ((uint32_t)src[2] << 8) | ((uint32_t)src[0] << 16) | ((uint32_t)src[1] << 24);
+		uint32_t w2 = src[2] | ((uint32_t)src[0] << 8) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 24);
+		uint32_t *dest32 = (uint32_t *)dest;
+
+		for (; count >= 4; count -= 4) {
+			dest32[0] = w0;
+			dest32[1] = w1;
+			dest32[2] = w2;
+			dest32 += 3;
 		}
-	} else if (size == 3) {
+
+		dest = (uint8_t *)dest32;
+	}
+
+	for (; count > 0; count--) {
+		dest[0] = src[0];
+		dest[1] = src[1];
+		dest[2] = src[2];
+		dest += 3;
+	}
+}
+
+RLE_FORCE_O3
+static inline void fill_repetition_32(uint8_t * dest, const uint8_t * src, size_t count)
+{
+	if ((uintptr_t)dest & 0x3) {
 		for (int i = count; i > 0; i--) {
 			dest[0] = src[0];
 			dest[1] = src[1];
 			dest[2] = src[2];
-			dest += size;
+			dest[3] = src[3];
+			dest += 4;
 		}
+		return;
+	}
+
+	uint32_t val = src[0] | ((uint32_t)src[1] << 8) |
+			((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+	uint32_t *dest32 = (uint32_t *)dest;
+
+	for (; count >= 4; count -= 4) {
+		dest32[0] = val;
+		dest32[1] = val;
+		dest32[2] = val;
+		dest32[3] = val;
+		dest32 += 4;
+	}
+
+	for (; count > 0; count--) {
+		*dest32++ = val;
+	}
+}
+
+RLE_FORCE_O3
+static inline void fill_repetition(uint8_t * dest, const uint8_t * src, size_t count, size_t size)
+{
+	if (size == 1) {
+		memset(dest, src[0], count);
+	} else if (size == 2) {
+		fill_repetition_16(dest, src, count);
+	} else if (size == 4) {
+		fill_repetition_32(dest, src, count);
+	} else if (size == 3) {
+		fill_repetition_24(dest, src, count);
 	} else { /* common case */
 		for (int i = count; i > 0; i--) {
 			memcpy(dest, src, size);
@@ -222,3 +304,132 @@ int rle_decompress(const uint8_t * in_buf, uint8_t * out_buf, int in_size, int o
 
 	return dec_size;
 }
+
+/*
+ * Walk the packets from (*in, *skip) over count elements, storing them to
+ * out_buf if it is not NULL. Returns the number of elements actually passed.
+ */
+RLE_FORCE_O3
+static int rle_walk(const uint8_t ** in, const uint8_t * in_end, uint8_t * skip,
+		uint8_t * out_buf, int count, size_t size)
+{
+	const uint8_t *in_buf = *in;
+	int left = count;
+
+	while (left > 0 && in_buf < in_end) {
+		uint8_t sign = in_buf[0];
+		int pkt_count = (sign & 0x7F) - *skip;
+		int n = (pkt_count > left) ? left : pkt_count;
+		int pkt_size = (sign & 0x80) ? (1 + size) : (1 + size * (sign & 0x7F));
+
+		if (in_buf + pkt_size > in_end)
+			break;
+
+		if (out_buf != NULL) {
+			if (sign & 0x80) {
+				fill_repetition(out_buf, &in_buf[1], n, size);
+			} else {
+				memcpy(out_buf, &in_buf[1 + size * *skip], size * n);
+			}
+			out_buf += size * n;
+		}
+
+		left -= n;
+		if (n < pkt_count) {
+			*skip += n;
+		} else {
+			*skip = 0;
+			in_buf += pkt_size;
+		}
+	}
+
+	*in = in_buf;
+	return count - left;
+}
+
+/**
+ * @brief Build the line index of an RLE stream
+ *
+ * @param in_buf pointer to encoded input buffer
+ * @param in_size size of input buffer in bytes
+ * @param line_width number of elements of each line
+ * @param line_count number of lines
+ * @param size size of each element in bytes
+ * @param index array of line_count entries to store the position of each line
+ *
+ * @retval number of lines indexed, less than line_count if the stream is short
+ */
+int rle_build_line_index(const uint8_t * in_buf, int in_size, int line_width,
+		int line_count, size_t size, rle_line_index_t * index)
+{
+	const uint8_t *in = in_buf;
+	const uint8_t *in_end = in_buf + in_size;
+	uint8_t skip = 0;
+	int i;
+
+	for (i = 0; i < line_count; i++) {
+		if (in >= in_end)
+			break;
+
+		index[i].offset = in - in_buf;
+		index[i].skip = skip;
+
+		/* an incomplete line is not counted */
+		if (rle_walk(&in, in_end, &skip, NULL, line_width, size) < line_width)
+			break;
+	}
+
+	return i;
+}
+
+/**
+ * @brief RLE decode a range of lines
+ *
+ * @param in_buf pointer to encoded input buffer
+ * @param in_size size of input buffer in bytes
+ * @param index line index built by rle_build_line_index, or NULL to seek
+ *              by walking the packet headers from the start of the stream
+ * @param line_width number of elements of each line
+ * @param first_line first line to decode
+ * @param line_count number of lines to decode
+ * @param out_buf pointer to output buffer
+ * @param out_stride output buffer stride in bytes, 0 for line_width * size
+ * @param size size of each element in bytes
+ *
+ * @retval number of bytes actually decoded
+ */
+RLE_FORCE_O3
+int rle_decompress_lines(const uint8_t * in_buf, int in_size, const rle_line_index_t * index,
+		int line_width, int first_line, int line_count,
+		uint8_t * out_buf, int out_stride, size_t size)
+{
+	const uint8_t *in = in_buf;
+	const uint8_t *in_end = in_buf + in_size;
+	uint8_t skip = 0;
+	int dec_size = 0;
+
+	if (out_stride == 0)
+		out_stride = line_width * size;
+
+	if (index != NULL) {
+		in = in_buf + index[first_line].offset;
+		skip = index[first_line].skip;
+	} else if (first_line > 0) {
+		int seek = line_width * first_line;
+
+		if (rle_walk(&in, in_end, &skip, NULL, seek, size) < seek)
+			return 0;
+	}
+
+	for (int j = 0; j < line_count; j++) {
+		int n = rle_walk(&in, in_end, &skip, out_buf, line_width, size);
+
+		dec_size += size * n;
+		if (n < line_width)
+			break;
+
+		out_buf += out_stride;
+	}
+
+	return dec_size;
+}
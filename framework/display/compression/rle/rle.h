@@ -7,6 +7,7 @@
 #ifndef __COMPRESSION_RLE_H__
 #define __COMPRESSION_RLE_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -43,6 +44,58 @@ int rle_compress(const uint8_t* in_buf, uint8_t * out_buf,  size_t in_count, siz
 
 int rle_decompress(const uint8_t * in_buf, uint8_t * out_buf, int in_size, int out_count, size_t size);
 
+/**
+ * @struct rle_line_index
+ * @brief Position of the first element of a line in an RLE stream
+ *
+ * Packets may cross line boundaries, so a line starts at some element
+ * inside the packet at offset.
+ */
+typedef struct rle_line_index {
+	uint32_t offset; /* byte offset of the packet */
+	uint8_t skip;    /* elements of the packet belonging to previous lines */
+} rle_line_index_t;
+
+/**
+ * @brief Build the line index of an RLE stream
+ *
+ * @param in_buf pointer to encoded input buffer
+ * @param in_size size of input buffer in bytes
+ * @param line_width number of elements of each line
+ * @param line_count number of lines
+ * @param size size of each element in bytes
+ * @param index array of line_count entries to store the position of each line
+ *
+ * @retval number of lines indexed, less than line_count if the stream is short
+ */
+
+int rle_build_line_index(const uint8_t * in_buf, int in_size, int line_width,
+		int line_count, size_t size, rle_line_index_t * index);
+
+/**
+ * @brief RLE decode a range of lines
+ *
+ * Only the lines [first_line, first_line + line_count) are written, so a
+ * clipped image needs not be decoded as a whole.
+ *
+ * @param in_buf pointer to encoded input buffer
+ * @param in_size size of input buffer in bytes
+ * @param index line index built by rle_build_line_index, or NULL to seek
+ *              by walking the packet headers from the start of the stream
+ * @param line_width number of elements of each line
+ * @param first_line first line to decode
+ * @param line_count number of lines to decode
+ * @param out_buf pointer to output buffer
+ * @param out_stride output buffer stride in bytes, 0 for line_width * size
+ * @param size size of each element in bytes
+ *
+ * @retval number of bytes actually decoded
+ */
+
+int rle_decompress_lines(const uint8_t * in_buf, int in_size, const rle_line_index_t * index,
+		int line_width, int first_line, int line_count,
+		uint8_t * out_buf, int out_stride, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
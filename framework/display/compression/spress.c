@@ -244,3 +244,212 @@ size_t spr_decompress(const char* source, char* destination)
 	return shdr->decompress_sz;
 }
 
+
+static inline uint32_t spr_chunk_len(const chunk_header_t* hdr)
+{
+	uint32_t len = (hdr->data_sz & ~CHUNK_TYPE_MASK) << 1;
+
+	return len ? len : SPRESS_BLK_MAX * SPRESS_BLK_SIZE;
+}
+
+/* fill len bytes of the repeated word dat, starting at byte phase of it */
+static void spr_fill_bytes(char* dst, uint32_t dat, uint32_t phase, uint32_t len)
+{
+	while (len > 0 && (phase & 0x3)) {
+		*dst++ = (char)(dat >> (8 * phase));
+		phase = (phase + 1) & 0x3;
+		len--;
+	}
+
+	if (((uintptr_t)dst & 0x3) == 0) {
+		spr_fill_data((uint32_t*)dst, dat, len / SPRESS_BLK_SIZE);
+		dst += len & ~0x3;
+	} else {
+		for (uint32_t i = len / SPRESS_BLK_SIZE; i > 0; i--) {
+			memcpy(dst, &dat, SPRESS_BLK_SIZE);
+			dst += SPRESS_BLK_SIZE;
+		}
+	}
+
+	for (len &= 0x3, phase = 0; len > 0; len--, phase++) {
+		*dst++ = (char)(dat >> (8 * phase));
+	}
+}
+
+int spr_stream_init(spr_stream_t* st, const char* source)
+{
+	spress_header_t* shdr = (spress_header_t*)source;
+
+	if (shdr->magic != SPRESS_HEADER_MAGIC) {
+		return -1;
+	}
+
+	st->source = source;
+	st->hdr = (const chunk_header_t*)(source + sizeof(spress_header_t));
+	st->src = source + sizeof(spress_header_t) + shdr->chunk_sz;
+	st->out_pos = 0;
+	st->out_size = shdr->decompress_sz;
+	st->chunk_pos = 0;
+	return 0;
+}
+
+/* advance over len bytes of output, writing them to dst if not NULL */
+static size_t spr_stream_walk(spr_stream_t* st, char* dst, size_t len)
+{
+	size_t left;
+
+	if (len > st->out_size - st->out_pos) {
+		len = st->out_size - st->out_pos;
+	}
+
+	left = len;
+	while (left > 0) {
+		uint32_t raw = ((st->hdr->data_sz & CHUNK_TYPE_MASK) == CHUNK_TYPE_RAW);
+		uint32_t chunk_len = spr_chunk_len(st->hdr);
+		uint32_t n = chunk_len - st->chunk_pos;
+
+		if (n > left) {
+			n = left;
+		}
+
+		if (dst) {
+			if (raw) {
+				memcpy(dst, st->src + st->chunk_pos, n);
+			} else {
+				uint32_t dat;
+
+				memcpy(&dat, st->src, sizeof(dat));
+				spr_fill_bytes(dst, dat, st->chunk_pos & 0x3, n);
+			}
+			dst += n;
+		}
+
+		left -= n;
+		st->chunk_pos += n;
+		if (st->chunk_pos == chunk_len) {
+			st->src += raw ? chunk_len : SPRESS_BLK_SIZE;
+			st->hdr++;
+			st->chunk_pos = 0;
+		}
+	}
+
+	st->out_pos += len;
+	return len;
+}
+
+size_t spr_stream_read(spr_stream_t* st, char* destination, size_t len)
+{
+	return spr_stream_walk(st, destination, len);
+}
+
+size_t spr_stream_skip(spr_stream_t* st, size_t len)
+{
+	return spr_stream_walk(st, NULL, len);
+}
+
+size_t spr_build_index(const char* source, spr_index_entry_t* index, size_t max_num)
+{
+	spress_header_t* shdr = (spress_header_t*)source;
+	const chunk_header_t* hdr = (const chunk_header_t*)(source + sizeof(spress_header_t));
+	uint32_t data_off = sizeof(spress_header_t) + shdr->chunk_sz;
+	uint32_t src_off = data_off;
+	uint32_t out_pos = 0;
+	uint32_t chunk_num = 0;
+	uint32_t step;
+	size_t num = 0;
+
+	if (shdr->magic != SPRESS_HEADER_MAGIC || max_num == 0) {
+		return 0;
+	}
+
+	/* count the chunks, header padding is not part of them */
+	while (out_pos < shdr->decompress_sz) {
+		out_pos += spr_chunk_len(&hdr[chunk_num++]);
+	}
+
+	step = (chunk_num + max_num - 1) / max_num;
+	out_pos = 0;
+
+	for (uint32_t i = 0; i < chunk_num; i++) {
+		uint32_t len = spr_chunk_len(&hdr[i]);
+
+		if ((i % step) == 0) {
+			index[num].out_pos = out_pos;
+			index[num].src_off = src_off - data_off;
+			index[num].chunk = (uint16_t)i;
+			num++;
+		}
+
+		out_pos += len;
+		src_off += ((hdr[i].data_sz & CHUNK_TYPE_MASK) == CHUNK_TYPE_RAW) ? len : SPRESS_BLK_SIZE;
+	}
+
+	return num;
+}
+
+int spr_stream_seek(spr_stream_t* st, const spr_index_entry_t* index, size_t num, size_t pos)
+{
+	spress_header_t* shdr = (spress_header_t*)st->source;
+
+	if (pos > st->out_size) {
+		return -1;
+	}
+
+	if (pos < st->out_pos || index != NULL) {
+		spr_stream_init(st, st->source);
+	}
+
+	if (index != NULL && num > 0) {
+		size_t lo = 0, hi = num;
+
+		/* last entry at or before pos */
+		while (hi - lo > 1) {
+			size_t mid = (lo + hi) / 2;
+
+			if (index[mid].out_pos <= pos) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+
+		st->hdr = (const chunk_header_t*)(st->source + sizeof(spress_header_t)) + index[lo].chunk;
+		st->src = st->source + sizeof(spress_header_t) + shdr->chunk_sz + index[lo].src_off;
+		st->out_pos = index[lo].out_pos;
+	}
+
+	spr_stream_skip(st, pos - st->out_pos);
+	return 0;
+}
+
+size_t spr_decompress_region(const char* source, const spr_index_entry_t* index, size_t num,
+		uint32_t src_stride, uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+		char* destination, uint32_t dst_stride)
+{
+	spr_stream_t st;
+	size_t out_size = 0;
+
+	if (spr_stream_init(&st, source) || x + w > src_stride) {
+		return 0;
+	}
+
+	if (spr_stream_seek(&st, index, num, (size_t)y * src_stride + x)) {
+		return 0;
+	}
+
+	for (uint32_t j = 0; j < h; j++) {
+		size_t n = spr_stream_read(&st, destination, w);
+
+		out_size += n;
+		if (n < w) {
+			break;
+		}
+
+		destination += dst_stride;
+		if (j + 1 < h) {
+			spr_stream_skip(&st, src_stride - w);
+		}
+	}
+
+	return out_size;
+}
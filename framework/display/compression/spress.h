@@ -39,5 +39,40 @@ size_t spr_decompress(const char* source, char* destination);
 
 size_t spr_compress_index(const char* source, char* destination, size_t size);
 size_t spr_compress_data(const char* source, char* destination, size_t size);
+
+/* resumable decoder, the output is produced in any number of pieces */
+typedef struct spr_stream {
+    const char* source;
+    const chunk_header_t* hdr;	/* current chunk */
+    const char* src;	/* data of current chunk */
+    uint32_t out_pos;	/* decompressed bytes passed */
+    uint32_t out_size;
+    uint16_t chunk_pos;	/* bytes of current chunk passed */
+} spr_stream_t;
+
+/* seek point, one every few chunks */
+typedef struct spr_index_entry {
+    uint32_t out_pos;	/* decompressed offset of the chunk */
+    uint32_t src_off;	/* offset of the chunk data after the chunk headers */
+    uint16_t chunk;	/* chunk number */
+} spr_index_entry_t;
+
+int spr_stream_init(spr_stream_t* st, const char* source);
+/* decode the next len bytes (at most) into destination, return bytes decoded */
+size_t spr_stream_read(spr_stream_t* st, char* destination, size_t len);
+size_t spr_stream_skip(spr_stream_t* st, size_t len);
+/* move to decompressed offset pos, index may be NULL */
+int spr_stream_seek(spr_stream_t* st, const spr_index_entry_t* index, size_t num, size_t pos);
+
+/* build at most max_num evenly spaced seek points, return the number built */
+size_t spr_build_index(const char* source, spr_index_entry_t* index, size_t max_num);
+
+/*
+ * decode the w x h bytes rectangle at byte offset x of line y of an image
+ * with src_stride bytes per line, return bytes decoded
+ */
+size_t spr_decompress_region(const char* source, const spr_index_entry_t* index, size_t num,
+		uint32_t src_stride, uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+		char* destination, uint32_t dst_stride);
 #endif
 
@@ -11,30 +11,162 @@
 #include <string.h>
 #include <os_common_api.h>
 #include "tile_cache.h"
-#define CONFIG_TILE_CACHE_LOOP_MODE 1
+
+#define TILE_CACHE_INVALID_IDX 0xffff
+
+#if CONFIG_TILE_CACHE_NUM > 64
+#define TILE_CACHE_HASH_BITS 8
+#elif CONFIG_TILE_CACHE_NUM > 16
+#define TILE_CACHE_HASH_BITS 6
+#elif CONFIG_TILE_CACHE_NUM > 4
+#define TILE_CACHE_HASH_BITS 4
+#else
+#define TILE_CACHE_HASH_BITS 2
+#endif
+
+#define TILE_CACHE_HASH_SIZE (1 << TILE_CACHE_HASH_BITS)
 
 __aligned(32) __in_section_unique(tile.bss.cache)
 static tile_cache_item_t tile_cache[CONFIG_TILE_CACHE_NUM];
 
+static uint16_t hash_heads[TILE_CACHE_HASH_SIZE];
+
+/* lru_head is the most recently used item, lru_tail the next victim */
+static uint16_t lru_head;
+static uint16_t lru_tail;
+static uint16_t cache_capacity = CONFIG_TILE_CACHE_NUM;
+static uint16_t cache_used;
+
+/*
+ * Bumped on every invalidation, a tile decoded across an invalidation is not
+ * published, since its picture may have been freed meanwhile.
+ */
+static uint32_t cache_gen;
+
+static uint32_t hit_cnt;
+static uint32_t miss_cnt;
+static uint32_t evict_cnt;
+
 static bool cache_init = false;
 
-#ifdef CONFIG_TILE_CACHE_LOOP_MODE
-static uint16_t current_index = 0;
-#endif
+static inline uint32_t _tile_hash(const uint8_t *pic_src, uint16_t tile_index)
+{
+	uint32_t key = ((uint32_t)(uintptr_t)pic_src >> 2) ^ ((uint32_t)tile_index << 16) ^ tile_index;
 
-#ifdef CONFIG_CACHE_PROFILE
-static int total_cnt = 0;
-static int hit_cnt = 0;
-#endif
+	return (key * 2654435761u) >> (32 - TILE_CACHE_HASH_BITS);
+}
 
-int tile_cache_init(void)
+static void _hash_remove(uint16_t idx)
+{
+	tile_cache_item_t *item = &tile_cache[idx];
+	uint16_t *link = &hash_heads[_tile_hash(item->pic_addr, item->tile_index)];
+
+	while (*link != TILE_CACHE_INVALID_IDX) {
+		if (*link == idx) {
+			*link = item->hash_next;
+			break;
+		}
+		link = &tile_cache[*link].hash_next;
+	}
+
+	item->hash_next = TILE_CACHE_INVALID_IDX;
+}
+
+static void _lru_unlink(uint16_t idx)
+{
+	tile_cache_item_t *item = &tile_cache[idx];
+
+	if (item->lru_prev != TILE_CACHE_INVALID_IDX)
+		tile_cache[item->lru_prev].lru_next = item->lru_next;
+	else
+		lru_head = item->lru_next;
+
+	if (item->lru_next != TILE_CACHE_INVALID_IDX)
+		tile_cache[item->lru_next].lru_prev = item->lru_prev;
+	else
+		lru_tail = item->lru_prev;
+}
+
+static void _lru_push_head(uint16_t idx)
+{
+	tile_cache_item_t *item = &tile_cache[idx];
+
+	item->lru_prev = TILE_CACHE_INVALID_IDX;
+	item->lru_next = lru_head;
+
+	if (lru_head != TILE_CACHE_INVALID_IDX)
+		tile_cache[lru_head].lru_prev = idx;
+	else
+		lru_tail = idx;
+
+	lru_head = idx;
+}
+
+static void _lru_push_tail(uint16_t idx)
 {
+	tile_cache_item_t *item = &tile_cache[idx];
+
+	item->lru_prev = lru_tail;
+	item->lru_next = TILE_CACHE_INVALID_IDX;
+
+	if (lru_tail != TILE_CACHE_INVALID_IDX)
+		tile_cache[lru_tail].lru_next = idx;
+	else
+		lru_head = idx;
+
+	lru_tail = idx;
+}
+
+static inline void _lru_touch(uint16_t idx)
+{
+	if (lru_head != idx) {
+		_lru_unlink(idx);
+		_lru_push_head(idx);
+	}
+}
+
+static void _tile_cache_drop(uint16_t idx)
+{
+	tile_cache_item_t *item = &tile_cache[idx];
+
+	if (item->cache_valid) {
+		_hash_remove(idx);
+		item->cache_valid = 0;
+		cache_used--;
+	}
+}
+
+static void _tile_cache_reset(void)
+{
+	lru_head = TILE_CACHE_INVALID_IDX;
+	lru_tail = TILE_CACHE_INVALID_IDX;
+	cache_used = 0;
+
+	for (int i = 0; i < TILE_CACHE_HASH_SIZE; i++) {
+		hash_heads[i] = TILE_CACHE_INVALID_IDX;
+	}
+
 	for (int i = 0 ; i < CONFIG_TILE_CACHE_NUM; i++) {
 		tile_cache[i].cache_valid = 0;
 		tile_cache[i].pic_addr = 0;
-		tile_cache[i].cache_ref_cnt = 0;
+		tile_cache[i].hash_next = TILE_CACHE_INVALID_IDX;
+		tile_cache[i].lru_prev = TILE_CACHE_INVALID_IDX;
+		tile_cache[i].lru_next = TILE_CACHE_INVALID_IDX;
+	}
+
+	/* invalid items are chained in index order, so they are used first */
+	for (int i = cache_capacity - 1; i >= 0; i--) {
+		_lru_push_head(i);
 	}
-	current_index = 0;
+}
+
+int tile_cache_init(void)
+{
+	_tile_cache_reset();
+	hit_cnt = 0;
+	miss_cnt = 0;
+	evict_cnt = 0;
+	cache_init = true;
 	return 0;
 }
 
@@ -48,91 +180,214 @@ __ramfunc int tile_cache_is_valid(tile_cache_item_t * cache_item)
 
 __ramfunc int tile_cache_set_valid(tile_cache_item_t *cache_item, const uint8_t *pic_src, uint16_t tile_index, uint16_t tile_size)
 {
+	uint16_t idx;
+	uint16_t *head;
+	int key;
+
 	if (!cache_item)
 		return -EINVAL;
 
+	key = os_irq_lock();
+
+	idx = cache_item - tile_cache;
+	_tile_cache_drop(idx);
+
+	if (cache_item->fill_gen != cache_gen) {
+		os_irq_unlock(key);
+		return -ESTALE;
+	}
+
 	cache_item->pic_addr = pic_src;
 	cache_item->tile_index = tile_index;
 	cache_item->tile_size = tile_size;
 	cache_item->cache_valid = 1;
-	cache_item->cache_ref_cnt = 0;
+
+	head = &hash_heads[_tile_hash(pic_src, tile_index)];
+	cache_item->hash_next = *head;
+	*head = idx;
+	cache_used++;
+
+	os_irq_unlock(key);
 	return 0;
 }
 
-#ifdef CONFIG_TILE_CACHE_LOOP_MODE
 __ramfunc tile_cache_item_t *tile_cache_get(const uint8_t *pic_src, uint16_t tile_index)
 {
+	uint16_t idx;
+	int key;
+
 	if (!cache_init) {
 		tile_cache_init();
-		cache_init = true;
 	}
 
-	tile_cache_item_t *replace_cache_item = &tile_cache[current_index];
+	key = os_irq_lock();
 
+	idx = hash_heads[_tile_hash(pic_src, tile_index)];
+	while (idx != TILE_CACHE_INVALID_IDX) {
+		tile_cache_item_t *item = &tile_cache[idx];
 
-	if (++current_index >= CONFIG_TILE_CACHE_NUM) {
-		current_index = 0;
+		if (item->pic_addr == pic_src && item->tile_index == tile_index) {
+			_lru_touch(idx);
+			hit_cnt++;
+			os_irq_unlock(key);
+			return item;
+		}
+		idx = item->hash_next;
 	}
 
-	replace_cache_item->cache_valid = 0;
+	/*
+	 * Recycle the least recently used item. The item just returned for the
+	 * previous tiles sit at the head, so a tile still being copied out by
+	 * hardware_copy() is not overwritten before capacity - 1 other tiles.
+	 */
+	idx = lru_tail;
+	if (tile_cache[idx].cache_valid) {
+		_tile_cache_drop(idx);
+		evict_cnt++;
+	}
 
-	return replace_cache_item;
+	_lru_touch(idx);
+	tile_cache[idx].fill_gen = cache_gen;
+	miss_cnt++;
+	os_irq_unlock(key);
+	return &tile_cache[idx];
 }
-#else
-__ramfunc tile_cache_item_t *tile_cache_get(const uint8_t *pic_src, uint16_t tile_index)
+
+void tile_cache_invalidate_range(const void *addr, size_t size)
 {
-	if (!cache_init) {
-		tile_cache_init();
-		cache_init = true;
+	const uint8_t *start = addr;
+	const uint8_t *end = start + size;
+	int key;
+
+	if (!cache_init)
+		return;
+
+	key = os_irq_lock();
+
+	cache_gen++;
+
+	for (int i = 0 ; i < cache_capacity; i++) {
+		if (tile_cache[i].cache_valid && (addr == NULL ||
+			(tile_cache[i].pic_addr >= start && tile_cache[i].pic_addr < end))) {
+			/* freed items become the next victims */
+			_tile_cache_drop(i);
+			_lru_unlink(i);
+			_lru_push_tail(i);
+		}
 	}
 
-	tile_cache_item_t *new_cache_item = NULL;
-	tile_cache_item_t *replace_cache_item = &tile_cache[0];
-#ifdef CONFIG_CACHE_PROFILE
-	int replace_cache_index = 0;
-#endif
+	os_irq_unlock(key);
+}
 
-#ifdef CONFIG_CACHE_PROFILE
-	total_cnt ++;
-	printk("cache hit %d %% \n",hit_cnt * 100 / total_cnt);
-	printk("\n");
-	for (int i = 0 ; i < CONFIG_TILE_CACHE_NUM; i++) {
-		printk(" %d ",tile_cache[i].cache_ref_cnt);
+void tile_cache_invalidate(const uint8_t *pic_src)
+{
+	tile_cache_invalidate_range(pic_src, 1);
+}
+
+int tile_cache_set_capacity(uint16_t num)
+{
+	int key;
+
+	if (num < 1 || num > CONFIG_TILE_CACHE_NUM)
+		return -EINVAL;
+
+	cache_capacity = num;
+	if (!cache_init) {
+		return tile_cache_init();
 	}
-	printk("\n");
-#endif
 
-	for (int i = 0 ; i < CONFIG_TILE_CACHE_NUM; i++) {
-		if (tile_cache[i].cache_valid && tile_cache[i].pic_addr == pic_src
-				&& tile_cache[i].tile_index == tile_index) {
-			new_cache_item = &tile_cache[i];
-		#ifdef CONFIG_CACHE_PROFILE
-			hit_cnt++;
-		#endif
-		} else {
-			if (!tile_cache[i].cache_valid) {
-				new_cache_item = &tile_cache[i];
-				printk("new cache %d \n",i);
-			} else {
-				if (replace_cache_item->cache_ref_cnt < tile_cache[i].cache_ref_cnt) {
-					replace_cache_item = &tile_cache[i];
-#ifdef CONFIG_CACHE_PROFILE
-					replace_cache_index  = i;
-#endif
-				}
-				tile_cache[i].cache_ref_cnt += 1;
-			}
-		}
+	key = os_irq_lock();
+	_tile_cache_reset();
+	cache_gen++;
+	os_irq_unlock(key);
+	return 0;
+}
+
+uint16_t tile_cache_get_capacity(void)
+{
+	return cache_capacity;
+}
+
+void tile_cache_get_stats(tile_cache_stats_t *stats)
+{
+	stats->hit_cnt = hit_cnt;
+	stats->miss_cnt = miss_cnt;
+	stats->evict_cnt = evict_cnt;
+	stats->capacity = cache_capacity;
+	stats->used = cache_used;
+}
+
+void tile_cache_reset_stats(void)
+{
+	hit_cnt = 0;
+	miss_cnt = 0;
+	evict_cnt = 0;
+}
+
+#ifdef CONFIG_TILE_CACHE_SHELL
+#include <shell/shell.h>
+
+static int cmd_tile_cache_stats(const struct shell *shell,
+			size_t argc, char **argv)
+{
+	tile_cache_stats_t stats;
+	uint32_t total;
+
+	tile_cache_get_stats(&stats);
+	total = stats.hit_cnt + stats.miss_cnt;
+
+	shell_print(shell, "tile cache: %u/%u items, %u bytes each",
+			stats.used, stats.capacity, (uint32_t)sizeof(tile_cache[0].tile_data));
+	shell_print(shell, "hit %u miss %u evict %u, hit rate %u%%",
+			stats.hit_cnt, stats.miss_cnt, stats.evict_cnt,
+			total ? (uint32_t)((uint64_t)stats.hit_cnt * 100 / total) : 0);
+	return 0;
+}
+
+static int cmd_tile_cache_reset(const struct shell *shell,
+			size_t argc, char **argv)
+{
+	tile_cache_reset_stats();
+	shell_print(shell, "tile cache stats reset");
+	return 0;
+}
+
+static int cmd_tile_cache_size(const struct shell *shell,
+			size_t argc, char **argv)
+{
+	int ret;
+
+	if (argc < 2) {
+		shell_print(shell, "tile cache capacity %u (max %u)",
+				tile_cache_get_capacity(), CONFIG_TILE_CACHE_NUM);
+		return 0;
 	}
-	if (new_cache_item) {
-		return new_cache_item;
-	} else if (replace_cache_item) {
-		replace_cache_item->cache_valid = 0;
-#ifdef CONFIG_CACHE_PROFILE
-		printk("replace cache %d \n",replace_cache_index);
-#endif
-		return replace_cache_item;
+
+	ret = tile_cache_set_capacity(strtoul(argv[1], NULL, 0));
+	if (ret) {
+		shell_print(shell, "capacity must be 1 ~ %u", CONFIG_TILE_CACHE_NUM);
+		return ret;
 	}
-	return NULL;
+
+	shell_print(shell, "tile cache capacity %u", tile_cache_get_capacity());
+	return 0;
 }
-#endif
+
+static int cmd_tile_cache_flush(const struct shell *shell,
+			size_t argc, char **argv)
+{
+	tile_cache_invalidate(NULL);
+	shell_print(shell, "tile cache flushed");
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_tilecache,
+	SHELL_CMD(stats, NULL, "show hit/miss/evict statistics", cmd_tile_cache_stats),
+	SHELL_CMD(reset, NULL, "reset statistics", cmd_tile_cache_reset),
+	SHELL_CMD(size, NULL, "get or set capacity: size [num]", cmd_tile_cache_size),
+	SHELL_CMD(flush, NULL, "drop all cached tiles", cmd_tile_cache_flush),
+	SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_REGISTER(tilecache, &sub_tilecache, "Compressed picture tile cache commands", NULL);
+#endif /* CONFIG_TILE_CACHE_SHELL */
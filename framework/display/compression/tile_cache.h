@@ -11,24 +11,67 @@
 
 //#define CONFIG_TILE_CACHE_NUM 1
 
-//#define CONFIG_CACHE_PROFILE  1
-
 typedef struct tile_cache_item {
 	uint8_t tile_data[TILE_MAX_H * TILE_MAX_W * CONFIG_TILE_BYTES_PER_PIXELS];
 	const uint8_t *pic_addr;
 	uint16_t tile_index;
 	uint16_t tile_size;
 	uint16_t cache_valid;
-	uint16_t cache_ref_cnt;	
+	uint16_t hash_next;	/* next item in the same hash bucket */
+	uint16_t lru_prev;	/* towards most recently used */
+	uint16_t lru_next;	/* towards least recently used */
+	uint32_t fill_gen;	/* invalidation generation when handed out for decoding */
 } tile_cache_item_t;
 
+typedef struct tile_cache_stats {
+	uint32_t hit_cnt;
+	uint32_t miss_cnt;
+	uint32_t evict_cnt;
+	uint16_t capacity;
+	uint16_t used;
+} tile_cache_stats_t;
+
 int tile_cache_init(void);
 
 int tile_cache_is_valid(tile_cache_item_t * cache_item);
 
+/**
+ * Publish a decoded tile, must be called on the item returned by a missed
+ * tile_cache_get() once its tile_data is filled. Returns -ESTALE and keeps
+ * the item invalid if any invalidation happened since that tile_cache_get().
+ */
 int tile_cache_set_valid(tile_cache_item_t *cache_item, const uint8_t *pic_src, uint16_t tile_index, uint16_t tile_size);
 
+/**
+ * Look up the tile (pic_src, tile_index). On a hit the returned item is valid,
+ * on a miss the least recently used item is recycled and returned invalid.
+ */
 tile_cache_item_t * tile_cache_get(const uint8_t *pic_src, uint16_t tile_index);
 
+/**
+ * Drop all tiles of one picture, or every tile if pic_src is NULL. Must be
+ * called before the memory of a cached picture is reused.
+ */
+void tile_cache_invalidate(const uint8_t *pic_src);
+
+/**
+ * Drop the tiles of every picture located in [addr, addr + size), or every
+ * tile if addr is NULL. Must be called when a buffer holding pictures is
+ * freed or repurposed.
+ */
+void tile_cache_invalidate_range(const void *addr, size_t size);
+
+/**
+ * Change the number of items in use, between 1 and CONFIG_TILE_CACHE_NUM.
+ * All cached tiles are dropped.
+ */
+int tile_cache_set_capacity(uint16_t num);
+
+uint16_t tile_cache_get_capacity(void);
+
+void tile_cache_get_stats(tile_cache_stats_t *stats);
+
+void tile_cache_reset_stats(void);
+
 #endif
 
@@ -34,6 +34,28 @@
 
 #define MAX_HIGH_FREQ_NUM					3500
 
+#define CMAP_PAGE_BITS						8
+#define CMAP_PAGE_SIZE						(1 << CMAP_PAGE_BITS)
+#define CMAP_PAGE_MASK						(CMAP_PAGE_SIZE - 1)
+
+#ifdef CONFIG_BITMAP_FONT_CMAP_MAX_PAGES
+#define CMAP_MAX_PAGES						CONFIG_BITMAP_FONT_CMAP_MAX_PAGES
+#else
+#define CMAP_MAX_PAGES						16
+#endif
+
+#define PREFETCH_MAX_GLYPHS					32
+#define PREFETCH_BUF_SIZE					4096
+#define PREFETCH_LOCA_WINDOW				256
+/* bitmap may start inside the last metric byte and read a few bytes ahead */
+#define PREFETCH_SLACK						4
+/* unrelated bytes allowed between glyphs merged into one read */
+#define PREFETCH_GAP						256
+
+/* page lookup result when the sub table walk has to be used */
+#define CMAP_PAGE_FALLBACK					((uint16_t*)1)
+#define CMAP_SLOT_FREE						0xffffffff
+
 
 typedef struct
 {
@@ -73,6 +95,23 @@ typedef struct
 	uint16_t last_unicode_idx;
 }high_freq_cache_t;
 
+/* in memory glyph source, used when glyph data has been prefetched */
+typedef struct
+{
+	const uint8_t* buf;
+	uint32_t len;
+	uint32_t pos;
+	uint32_t file_off;
+}glyf_src_t;
+
+typedef struct
+{
+	uint32_t unicode;
+	uint32_t glyf_id;
+	uint32_t loca;
+	uint32_t end;
+}glyf_prefetch_item_t;
+
 typedef struct{
 	char magic[4];
 	int32_t count;
@@ -83,6 +122,7 @@ typedef struct{
 
 
 static uint8_t* cmap_sub_data;
+static const uint16_t cmap_empty_page[CMAP_PAGE_SIZE];
 static uint32_t metrics32[4];
 
 static bitmap_cache_t* bitmap_cache;
@@ -111,6 +151,9 @@ static uint8_t* decomp_tmp2 = NULL;
 
 void bitmap_font_load_high_freq_chars(const uint8_t* file_path);
 static int32_t _search_emoji_glyf_id(bitmap_emoji_font_t* font, uint32_t unicode, uint32_t* glyf_id);
+static int _bitmap_cache_reserve_tail(bitmap_cache_t* cache, uint32_t multi);
+static void _cmap_pages_init(bitmap_font_t* font, uint32_t cmap_size);
+static void _cmap_pages_deinit(bitmap_font_t* font);
 
 uint32_t _find_cache_size_for_font(const char* file_path, uint32_t file_size)
 {
@@ -150,10 +193,18 @@ uint32_t _find_cache_size_for_font(const char* file_path, uint32_t file_size)
     }
 }
 
+static uint32_t _bitmap_cache_slot_size(bitmap_cache_t* cache)
+{
+	/* data + glyph index + metrics + hash chain + ref bit + one hash head */
+	return cache->unit_size + sizeof(uint32_t) + sizeof(glyph_metrics_t) + 2*sizeof(uint16_t) + sizeof(uint8_t);
+}
+
 int _bitmap_cache_init(bitmap_cache_t* cache, const char* file_path, uint32_t file_size)
 {
 	uint8_t* cache_start;
 	uint32_t cache_size;
+	uint32_t slot_size;
+	uint32_t buckets;
 
 	if(cache == NULL)
 	{
@@ -167,10 +218,11 @@ int _bitmap_cache_init(bitmap_cache_t* cache, const char* file_path, uint32_t fi
 	}
 
 	cache_size = _find_cache_size_for_font(file_path, file_size);
+	slot_size = _bitmap_cache_slot_size(cache);
 
-	if(cache_size < 3*(cache->unit_size + sizeof(uint32_t) + sizeof(glyph_metrics_t)))
+	if(cache_size < 3*slot_size)
 	{
-		cache_size = 3*(cache->unit_size + sizeof(uint32_t) + sizeof(glyph_metrics_t));
+		cache_size = 3*slot_size;
 	}
 
 	cache_start = bitmap_font_cache_malloc(cache_size);
@@ -182,18 +234,42 @@ int _bitmap_cache_init(bitmap_cache_t* cache, const char* file_path, uint32_t fi
 	SYS_LOG_INF("cache_start %p\n", cache_start);
 
 	cache->cache_max_size = cache_size;
-	cache->cached_max = cache_size/(cache->unit_size + sizeof(uint32_t) + sizeof(glyph_metrics_t));
-	cache->glyph_index = (uint32_t*)cache_start;
+	cache->cached_max = cache_size/slot_size;
+	if(cache->cached_max > BITMAP_CACHE_MAX_SLOTS)
+	{
+		cache->cached_max = BITMAP_CACHE_MAX_SLOTS;
+	}
+
+	/* largest power of 2 not above slot count, so heads fit in the per slot budget */
+	cache->hash_bits = 0;
+	while((2U << cache->hash_bits) <= cache->cached_max)
+	{
+		cache->hash_bits++;
+	}
+	buckets = 1U << cache->hash_bits;
 
+	cache->glyph_index = (uint32_t*)cache_start;
 	memset(cache->glyph_index, 0, cache->cached_max*sizeof(uint32_t));
 	cache->metrics = (glyph_metrics_t*)(cache_start + cache->cached_max*sizeof(uint32_t));
 	cache->data = cache_start + cache->cached_max*sizeof(uint32_t) + cache->cached_max*sizeof(glyph_metrics_t);
+	cache->hash_heads = (uint16_t*)(cache->data + cache->cached_max*cache->unit_size);
+	cache->hash_next = cache->hash_heads + buckets;
+	cache->ref_bits = (uint8_t*)(cache->hash_next + cache->cached_max);
+	memset(cache->hash_heads, 0xff, buckets*sizeof(uint16_t));
+	memset(cache->ref_bits, 0, cache->cached_max);
+
+	cache->clock_hand = 0;
+	cache->cached_total = 0;
+	cache->last_glyph_idx = 0;
+	cache->hit_count = 0;
+	cache->miss_count = 0;
+	cache->evict_count = 0;
 
 	memset(&cache->default_metric, 0, sizeof(glyph_metrics_t));
 	cache->default_data = NULL;
 	cache->inited = 1;
 
-	SYS_LOG_INF("metrics_buf %p, data_buf %p\n", cache->metrics, cache->data);
+	SYS_LOG_INF("metrics_buf %p, data_buf %p, hash buckets %d\n", cache->metrics, cache->data, buckets);
 	return 0;
 }
 
@@ -613,6 +689,7 @@ bitmap_font_t* bitmap_font_open(const char* file_path)
 	fs_read(&bmp_font->font_fp, bmp_font->cmap_sub_headers, cmap_size-12);
 
 	cmap_sub_data = (uint8_t*)bmp_font->cmap_sub_headers + cmap_sub_count*16;
+	_cmap_pages_init(bmp_font, cmap_size);
 
 	//read loca offset, loca table too big for cache
 	fs_seek(&bmp_font->font_fp, bmp_font->loca_offset, FS_SEEK_SET);
@@ -690,6 +767,7 @@ bitmap_font_t* bitmap_font_open(const char* file_path)
 	return bmp_font;
 ERR_EXIT:
 	fs_close(&bmp_font->font_fp);
+	_cmap_pages_deinit(bmp_font);
 	if(bmp_font->cmap_sub_headers)
 	{
 	    bitmap_font_cache_free(bmp_font->cmap_sub_headers);
@@ -757,6 +835,7 @@ void bitmap_font_close(bitmap_font_t* bmp_font)
 			else
 			{
 				fs_close(&opend_font[i].font_fp);
+				_cmap_pages_deinit(&opend_font[i]);
 				if(opend_font[i].cmap_sub_headers)
 				{
 				    bitmap_font_cache_free(opend_font[i].cmap_sub_headers);
@@ -835,7 +914,11 @@ int bitmap_font_set_default_emoji_code(bitmap_emoji_font_t* font, uint32_t emoji
 			SYS_LOG_INF("default size %d, unit size %d, max %d\n", glyf_size, font->cache->unit_size, font->cache->cached_max);
 			//default code first read, malloc
 			multi = glyf_size/font->cache->unit_size + 1;
-			cache_index = font->cache->cached_max-multi;
+			cache_index = _bitmap_cache_reserve_tail(font->cache, multi);
+			if(cache_index < 0)
+			{
+				return -1;
+			}
 			font->cache->default_data = &(font->cache->data[cache_index*font->cache->unit_size]);
 			data = font->cache->default_data;
 
@@ -844,18 +927,18 @@ int bitmap_font_set_default_emoji_code(bitmap_emoji_font_t* font, uint32_t emoji
 			{
 				SYS_LOG_ERR("read font file error\n");
 				return -1;
-			}		
-
-			font->cache->cached_max -= multi;
+			}
 		}
 		else
 		{
-			cache_index = font->cache->cached_max-1;
+			cache_index = _bitmap_cache_reserve_tail(font->cache, 1);
+			if(cache_index < 0)
+			{
+				return -1;
+			}
 			font->cache->default_data = &(font->cache->data[cache_index*font->cache->unit_size]);
 			uint32_t* loca_data = (uint32_t*)font->cache->default_data;
 			*loca_data = glyf_loca;
-
-			font->cache->cached_max--;
 		}
 	}
 
@@ -933,13 +1016,16 @@ int bitmap_font_set_default_bitmap(bitmap_font_t* font, uint8_t* bitmap, uint32_
 
 			multi = bmp_size/font->cache->unit_size + 1;
 			
-			cache_index = font->cache->cached_max-multi;
+			cache_index = _bitmap_cache_reserve_tail(font->cache, multi);
+			if(cache_index < 0)
+			{
+				return -1;
+			}
 			font->cache->default_data = &(font->cache->data[cache_index*font->cache->unit_size]);
 			data = font->cache->default_data;
 			
 			memcpy(data, bitmap, bmp_size);	
 			
-			font->cache->cached_max -= multi;			
 		}
 		else
 		{
@@ -987,13 +1073,16 @@ int bitmap_font_set_default_bitmap(bitmap_font_t* font, uint8_t* bitmap, uint32_
 
 			multi = bmp_size/font->cache->unit_size + 1;
 			
-			cache_index = font->cache->cached_max-multi;
+			cache_index = _bitmap_cache_reserve_tail(font->cache, multi);
+			if(cache_index < 0)
+			{
+				return -1;
+			}
 			font->cache->default_data = &(font->cache->data[cache_index*font->cache->unit_size]);
 			data = font->cache->default_data;
 			
 			memset(data, 0, bmp_size);	
 			
-			font->cache->cached_max -= multi;
 		}
 	}
 
@@ -1154,224 +1243,681 @@ ok_exit:
 	return glyf_id;
 }
 
-uint32_t _get_glyf_loca(bitmap_font_t* font, uint32_t glyf_id)
+static void _cmap_pages_init(bitmap_font_t* font, uint32_t cmap_size)
 {
-	uint32_t loca_offset;
-	uint32_t glyf_offset;
-	uint16_t glyf_offset16;
+	cmap_sub_header_t* sub_header = (cmap_sub_header_t*)font->cmap_sub_headers;
+	uint32_t max_code = 0;
+	uint32_t budget;
+	uint32_t i;
 
-	if(font->loca_format == 0)
+	font->cmap_slots = NULL;
+	font->cmap_slot_count = 0;
+	font->cmap_last_slot = 0;
+	font->cmap_use_tick = 0;
+	font->cmap_page_count = 0;
+
+	for(i=0;i<font->cmap_sub_count;i++)
 	{
-		loca_offset = font->loca_offset+12+2*glyf_id;
+		if(sub_header[i].range_start + sub_header[i].range_length > max_code)
+		{
+			max_code = sub_header[i].range_start + sub_header[i].range_length;
+		}
 	}
-	else
+
+	if(max_code == 0)
 	{
-		loca_offset = font->loca_offset+12+4*glyf_id;
+		return;
 	}
+	font->cmap_page_count = (max_code + CMAP_PAGE_MASK) >> CMAP_PAGE_BITS;
 
-//	SYS_LOG_INF("loca_origin 0x%x, loca_offset 0x%x, font fp 0x%x\n", font->loca_offset, loca_offset, font->font_fp.filep);
-	fs_seek(&font->font_fp, loca_offset, FS_SEEK_SET);
-	if(font->loca_format == 0)
+	/* the sub tables take the cmap budget of the pool first, pages get the rest */
+	budget = bitmap_font_get_cmap_cache_size();
+	budget = (budget > cmap_size) ? (budget - cmap_size) : 0;
+	font->cmap_slot_count = budget/(CMAP_PAGE_SIZE*sizeof(uint16_t) + sizeof(cmap_page_slot_t));
+	if(font->cmap_slot_count > CMAP_MAX_PAGES)
 	{
-		fs_read(&font->font_fp, &glyf_offset16, 2);
-		glyf_offset = glyf_offset16;
+		font->cmap_slot_count = CMAP_MAX_PAGES;
 	}
-	else
+
+	SYS_LOG_INF("cmap %d pages, max code 0x%x, cached pages %d\n",
+				font->cmap_page_count, max_code, font->cmap_slot_count);
+	if(font->cmap_slot_count == 0)
 	{
-		fs_read(&font->font_fp, &glyf_offset, 4);
+		return;
+	}
+
+	font->cmap_slots = (cmap_page_slot_t*)bitmap_font_cache_malloc(font->cmap_slot_count*sizeof(cmap_page_slot_t));
+	if(font->cmap_slots == NULL)
+	{
+		SYS_LOG_ERR("cmap page slots malloc failed, %d slots\n", font->cmap_slot_count);
+		font->cmap_slot_count = 0;
+		return;
+	}
+
+	for(i=0;i<font->cmap_slot_count;i++)
+	{
+		font->cmap_slots[i].page_idx = CMAP_SLOT_FREE;
+		font->cmap_slots[i].last_use = 0;
+		font->cmap_slots[i].data = NULL;
 	}
-	return glyf_offset;
 }
 
-int _try_get_cached_index(bitmap_cache_t* cache, uint32_t glyf_id)
+static void _cmap_pages_deinit(bitmap_font_t* font)
 {
-	int32_t cindex;
+	uint32_t i;
 
-	if(cache == NULL)
+	if(font->cmap_slots == NULL)
 	{
-		SYS_LOG_ERR("null glyph cache\n");
-		return -1;
+		return;
 	}
 
-	if(cache->cached_total > 0)
+	for(i=0;i<font->cmap_slot_count;i++)
 	{
-		if (glyf_id == cache->glyph_index[cache->last_glyph_idx]) {
-			return cache->last_glyph_idx;
-		}
-
-		cindex = cache->last_glyph_idx + 1;
-		for (; cindex < cache->cached_total; cindex++) {
-			if (glyf_id == cache->glyph_index[cindex]) {
-				cache->last_glyph_idx = cindex;
-				return cindex;
-			}
-		}
-
-		cindex = cache->last_glyph_idx - 1;
-		for (; cindex >= 0; cindex--) {
-			if (glyf_id == cache->glyph_index[cindex]) {
-				cache->last_glyph_idx = cindex;
-				return cindex;
-			}
+		if(font->cmap_slots[i].data != NULL)
+		{
+			bitmap_font_cache_free(font->cmap_slots[i].data);
 		}
 	}
-
-	return -1;
+	bitmap_font_cache_free(font->cmap_slots);
+	font->cmap_slots = NULL;
+	font->cmap_slot_count = 0;
+	font->cmap_page_count = 0;
 }
 
-int _get_cache_index(bitmap_cache_t* cache, uint32_t glyf_id, uint32_t slot_num)
+static int _cmap_page_set(uint16_t* page, uint32_t code, uint32_t glyf_id)
 {
-	if(cache == NULL)
+	if(glyf_id > 0xffff)
 	{
-		SYS_LOG_ERR("null glyph cache\n");
 		return -1;
 	}
 
-	if(cache->cached_total+slot_num <= cache->cached_max)
+	/* first matching sub table wins, same as the linear lookup */
+	if(page[code & CMAP_PAGE_MASK] == 0)
+	{
+		page[code & CMAP_PAGE_MASK] = (uint16_t)glyf_id;
+	}
+	return 0;
+}
+
+static bool _cmap_page_is_empty(bitmap_font_t* font, uint32_t page_idx)
+{
+	cmap_sub_header_t* sub_header = (cmap_sub_header_t*)font->cmap_sub_headers;
+	uint32_t page_start = page_idx << CMAP_PAGE_BITS;
+	uint32_t i;
+
+	for(i=0;i<font->cmap_sub_count;i++, sub_header++)
 	{
-//		SYS_LOG_INF("current %d, current id %d\n", cache->current, cache->glyph_index[cache->current]);
-		if(cache->glyph_index[cache->current] == 0)
+		if(sub_header->range_start < page_start + CMAP_PAGE_SIZE &&
+			sub_header->range_start + sub_header->range_length > page_start)
 		{
-			cache->cached_total+=slot_num;
-			cache->glyph_index[cache->current] = glyf_id;
+			return false;
 		}
-		else
+	}
+
+	return true;
+}
+
+static int _cmap_page_fill(bitmap_font_t* font, uint16_t* page, uint32_t page_idx)
+{
+	cmap_sub_header_t* sub_header = (cmap_sub_header_t*)font->cmap_sub_headers;
+	uint32_t page_start = page_idx << CMAP_PAGE_BITS;
+	uint32_t lo, hi, code;
+	uint32_t i;
+
+	memset(page, 0, CMAP_PAGE_SIZE*sizeof(uint16_t));
+
+	for(i=0;i<font->cmap_sub_count;i++, sub_header++)
+	{
+		lo = sub_header->range_start > page_start ? sub_header->range_start : page_start;
+		hi = sub_header->range_start + sub_header->range_length;
+		if(hi > page_start + CMAP_PAGE_SIZE)
 		{
-			cache->cached_total+=slot_num;
- 			cache->current = cache->next;			
-			cache->glyph_index[cache->current] = glyf_id;
+			hi = page_start + CMAP_PAGE_SIZE;
 		}
-		cache->next = cache->current+slot_num;
-		if(slot_num > 1)
+		if(lo >= hi)
 		{
-		    int i;
-		    for(i=1;i<slot_num;i++)
-		    {
-		        cache->glyph_index[cache->current+i] = 0xffffffff;
-		    }
-		}		
-	}
-	else
-	{
-		cache->current = cache->next;
-        cache->next = cache->current+slot_num;
-		if(cache->next >= cache->cached_max)
+			continue;
+		}
+
+		if(sub_header->sub_format == 0)
 		{
-			cache->current = 0;
-			cache->next = slot_num;
+			uint8_t* value = font->cmap_sub_headers + sub_header->data_offset - 12;
+			for(code=lo;code<hi;code++)
+			{
+				uint8_t delta = (uint8_t)(code - sub_header->range_start);
+				if(_cmap_page_set(page, code, value[delta] + sub_header->glyf_id_offset) < 0)
+				{
+					return -1;
+				}
+			}
 		}
-		cache->glyph_index[cache->current] = glyf_id;
-		if(slot_num > 1)
+		else if(sub_header->sub_format == 2)
 		{
-		    int i;
-		    for(i=1;i<slot_num;i++)
-		    {
-		        cache->glyph_index[cache->current+i] = 0xffffffff;
-		    }
+			for(code=lo;code<hi;code++)
+			{
+				if(_cmap_page_set(page, code, sub_header->glyf_id_offset + (code - sub_header->range_start)) < 0)
+				{
+					return -1;
+				}
+			}
 		}
-		if(cache->cached_total < cache->cached_max)
+		else if(sub_header->sub_format == 3)
 		{
-		    cache->cached_total = cache->cached_max;
+			uint16_t* value = (uint16_t*)(font->cmap_sub_headers + sub_header->data_offset - 12);
+			uint32_t delta_lo = lo - sub_header->range_start;
+			uint32_t delta_hi = hi - sub_header->range_start;
+			int32_t low = 0;
+			int32_t high = sub_header->entry_count;
+
+			/* deltas are sorted, find the first one inside this page */
+			while(low < high)
+			{
+				int32_t mid = (low + high)/2;
+				if(value[mid] < delta_lo)
+				{
+					low = mid + 1;
+				}
+				else
+				{
+					high = mid;
+				}
+			}
+
+			for(;low < sub_header->entry_count && value[low] < delta_hi;low++)
+			{
+				if(_cmap_page_set(page, sub_header->range_start + value[low], sub_header->glyf_id_offset + low) < 0)
+				{
+					return -1;
+				}
+			}
 		}
 	}
 
-	cache->last_glyph_idx = cache->current;
-
-	return cache->current;
+	return 0;
 }
 
-uint8_t* _get_glyph_cache(bitmap_cache_t* cache, uint32_t glyf_id)
+/*
+ * returns the materialised page covering unicode, or CMAP_PAGE_FALLBACK when
+ * the page cannot be built and the sub table walk has to be used instead
+ */
+static uint16_t* _cmap_get_page(bitmap_font_t* font, uint32_t unicode)
 {
-	int32_t cache_index;
-	if(cache == NULL)
+	uint32_t page_idx = unicode >> CMAP_PAGE_BITS;
+	cmap_page_slot_t* slot = &font->cmap_slots[font->cmap_last_slot];
+	cmap_page_slot_t* victim;
+	uint32_t i;
+
+	font->cmap_use_tick++;
+
+	/* text runs mostly stay in one page */
+	if(slot->page_idx != page_idx)
 	{
-		SYS_LOG_ERR("null glyph cache\n");
-		return NULL;
+		victim = font->cmap_slots;
+		for(i=0;i<font->cmap_slot_count;i++)
+		{
+			slot = &font->cmap_slots[i];
+			if(slot->page_idx == page_idx)
+			{
+				break;
+			}
+			if(slot->last_use < victim->last_use)
+			{
+				victim = slot;
+			}
+		}
+
+		if(i == font->cmap_slot_count)
+		{
+			if(_cmap_page_is_empty(font, page_idx))
+			{
+				/* no sub table range touches it, not worth a slot */
+				return (uint16_t*)cmap_empty_page;
+			}
+
+			slot = victim;
+			if(slot->data == NULL)
+			{
+				slot->data = (uint16_t*)bitmap_font_cache_malloc(CMAP_PAGE_SIZE*sizeof(uint16_t));
+				if(slot->data == NULL)
+				{
+					SYS_LOG_INF("no memory for cmap page 0x%x\n", page_idx);
+					return CMAP_PAGE_FALLBACK;
+				}
+			}
+
+			slot->page_idx = page_idx;
+			if(_cmap_page_fill(font, slot->data, page_idx) < 0)
+			{
+				slot->page_idx = CMAP_SLOT_FREE;
+				slot->last_use = 0;
+				return CMAP_PAGE_FALLBACK;
+			}
+		}
+
+		font->cmap_last_slot = slot - font->cmap_slots;
 	}
 
-	cache_index = _try_get_cached_index(cache, glyf_id);
-	if(cache_index < 0)
+	slot->last_use = font->cmap_use_tick;
+	return slot->data;
+}
+
+uint32_t _get_glyf_id(bitmap_font_t* font, bitmap_cache_t* cache, uint32_t unicode)
+{
+	uint16_t* page;
+	uint32_t glyf_id;
+
+	if(font->cmap_slots != NULL)
 	{
-	    SYS_LOG_INF("cant find bitmap for glyf id %d\n", glyf_id);
-		return NULL;
+		if((unicode >> CMAP_PAGE_BITS) >= font->cmap_page_count)
+		{
+			/* beyond every sub table range */
+			glyf_id = 0;
+			goto page_exit;
+		}
+
+		page = _cmap_get_page(font, unicode);
+		if(page != CMAP_PAGE_FALLBACK)
+		{
+			glyf_id = page[unicode & CMAP_PAGE_MASK];
+			goto page_exit;
+		}
 	}
-	else
+
+	return _get_glyf_id_cached(cache, font->cmap_sub_headers, font->cmap_sub_count, unicode);
+
+page_exit:
+	if(glyf_id == 0 && bitmap_font_glyph_err_print_is_on())
 	{
-		return &(cache->data[cache_index*cache->unit_size]);
+		SYS_LOG_ERR("glyf id not found: 0x%x\n", unicode);
 	}
+	return glyf_id;
 }
 
-#ifdef CONFIG_BITMAP_FONT_USE_HIGH_FREQ_CACHE
-int32_t _check_high_freq_chars(uint16_t unicode)
+uint32_t _get_glyf_loca(bitmap_font_t* font, uint32_t glyf_id)
 {
-	uint16_t key = unicode;
+	uint32_t loca_offset;
+	uint32_t glyf_offset;
+	uint16_t glyf_offset16;
 
-	if(unicode == high_freq_cache.last_unicode_idx)
+	if(font->loca_format == 0)
 	{
-		return high_freq_cache.last_cache_idx;
+		loca_offset = font->loca_offset+12+2*glyf_id;
 	}
-	uint16_t *ptr16 = bsearch(&key, high_freq_codes, MAX_HIGH_FREQ_NUM, 2, unicode_to_glyph_compare);
-	if(ptr16)
+	else
 	{
-		int32_t cache_index = ptr16 - high_freq_codes;
-		high_freq_cache.last_unicode_idx = unicode;
-		high_freq_cache.last_cache_idx = cache_index;
-		return cache_index;
+		loca_offset = font->loca_offset+12+4*glyf_id;
+	}
+
+//	SYS_LOG_INF("loca_origin 0x%x, loca_offset 0x%x, font fp 0x%x\n", font->loca_offset, loca_offset, font->font_fp.filep);
+	fs_seek(&font->font_fp, loca_offset, FS_SEEK_SET);
+	if(font->loca_format == 0)
+	{
+		fs_read(&font->font_fp, &glyf_offset16, 2);
+		glyf_offset = glyf_offset16;
 	}
 	else
 	{
-		return -1;
+		fs_read(&font->font_fp, &glyf_offset, 4);
 	}
+	return glyf_offset;
 }
-#endif
 
-uint32_t bitmap_font_get_elapse_count(void)
+static inline uint32_t _cache_hash(bitmap_cache_t* cache, uint32_t glyf_id)
 {
-	return elapse_count;
+	/* fibonacci hashing, glyph ids and unicodes are mostly sequential */
+	if(cache->hash_bits == 0)
+	{
+		return 0;
+	}
+	return (glyf_id * 2654435761U) >> (32 - cache->hash_bits);
 }
 
-
-static int32_t _search_emoji_glyf_id(bitmap_emoji_font_t* font, uint32_t unicode, uint32_t* glyf_id)
+static int32_t _cache_hash_lookup(bitmap_cache_t* cache, uint32_t glyf_id)
 {
-	emoji_font_entry_t* entry = font->glyf_list;
-	int low, mid, high;
+	uint16_t slot;
 
-	low = 0;
-	high = font->glyf_count-1;
-	while(low <= high)
+	slot = cache->hash_heads[_cache_hash(cache, glyf_id)];
+	while(slot != BITMAP_CACHE_INVALID_IDX)
 	{
-		mid = (low+high)/2;
-		if(entry[mid].unicode > unicode)
-		{
-			high = mid - 1;
-		}
-		else if(entry[mid].unicode < unicode)
-		{
-			low = mid + 1;
-		}
-		else
+		if(cache->glyph_index[slot] == glyf_id)
 		{
-			//found
-			*glyf_id = mid;
-			return 0;
+			return slot;
 		}
+		slot = cache->hash_next[slot];
 	}
 
 	return -1;
 }
 
-uint8_t * bitmap_font_get_emoji_bitmap(bitmap_emoji_font_t* font, uint32_t unicode)
+static void _cache_hash_insert(bitmap_cache_t* cache, uint32_t glyf_id, uint32_t slot)
 {
-	uint8_t* data;
-	int ret;
-	int glyf_id = 0;
-	uint32_t* loca_data = NULL;
+	uint16_t* head = &cache->hash_heads[_cache_hash(cache, glyf_id)];
 
-	//SYS_LOG_INF("get 0x%x data, default code 0x%x\n", unicode, font->default_code);
-	if(unicode == font->default_code)
+	cache->hash_next[slot] = *head;
+	*head = (uint16_t)slot;
+}
+
+static void _cache_hash_remove(bitmap_cache_t* cache, uint32_t glyf_id, uint32_t slot)
+{
+	uint16_t* link = &cache->hash_heads[_cache_hash(cache, glyf_id)];
+
+	while(*link != BITMAP_CACHE_INVALID_IDX)
 	{
-		//SYS_LOG_INF("get default code data");
-		if(!emoji_font_use_mmap())
+		if(*link == slot)
+		{
+			*link = cache->hash_next[slot];
+			return;
+		}
+		link = &cache->hash_next[*link];
+	}
+}
+
+/* returns the first slot of the glyph occupying slot */
+static uint32_t _cache_slot_owner(bitmap_cache_t* cache, uint32_t slot)
+{
+	while(slot > 0 && cache->glyph_index[slot] == BITMAP_CACHE_CONT_SLOT)
+	{
+		slot--;
+	}
+	return slot;
+}
+
+/* returns the slot just behind the glyph starting at slot */
+static uint32_t _cache_slot_end(bitmap_cache_t* cache, uint32_t slot)
+{
+	slot++;
+	while(slot < cache->cached_max && cache->glyph_index[slot] == BITMAP_CACHE_CONT_SLOT)
+	{
+		slot++;
+	}
+	return slot;
+}
+
+static void _cache_evict_glyph(bitmap_cache_t* cache, uint32_t slot)
+{
+	uint32_t end;
+	uint32_t glyf_id = cache->glyph_index[slot];
+
+	if(glyf_id == BITMAP_CACHE_EMPTY_SLOT || glyf_id == BITMAP_CACHE_CONT_SLOT)
+	{
+		return;
+	}
+
+	end = _cache_slot_end(cache, slot);
+	_cache_hash_remove(cache, glyf_id, slot);
+	cache->cached_total -= end - slot;
+	cache->evict_count++;
+	for(; slot < end; slot++)
+	{
+		cache->glyph_index[slot] = BITMAP_CACHE_EMPTY_SLOT;
+		cache->ref_bits[slot] = 0;
+	}
+}
+
+static void _cache_evict_range(bitmap_cache_t* cache, uint32_t start, uint32_t end)
+{
+	uint32_t slot = start;
+
+	while(slot < end)
+	{
+		if(cache->glyph_index[slot] == BITMAP_CACHE_EMPTY_SLOT)
+		{
+			slot++;
+			continue;
+		}
+
+		slot = _cache_slot_owner(cache, slot);
+		_cache_evict_glyph(cache, slot);
+		slot++;
+	}
+}
+
+/*
+ * take multi slots from the cache tail for default data, glyphs cached there
+ * are dropped. returns the first reserved slot.
+ */
+static int _bitmap_cache_reserve_tail(bitmap_cache_t* cache, uint32_t multi)
+{
+	uint32_t new_max;
+
+	if(multi >= cache->cached_max)
+	{
+		SYS_LOG_ERR("no room for %d reserved slots, max %d\n", multi, cache->cached_max);
+		return -1;
+	}
+
+	new_max = cache->cached_max - multi;
+	_cache_evict_range(cache, new_max, cache->cached_max);
+	cache->cached_max = new_max;
+	if(cache->clock_hand >= new_max)
+	{
+		cache->clock_hand = 0;
+	}
+	if(cache->last_glyph_idx >= new_max)
+	{
+		cache->last_glyph_idx = 0;
+	}
+
+	return new_max;
+}
+
+int _try_get_cached_index(bitmap_cache_t* cache, uint32_t glyf_id)
+{
+	int32_t cindex;
+
+	if(cache == NULL)
+	{
+		SYS_LOG_ERR("null glyph cache\n");
+		return -1;
+	}
+
+	if(cache->cached_total > 0)
+	{
+		if (glyf_id == cache->glyph_index[cache->last_glyph_idx]) {
+			cindex = cache->last_glyph_idx;
+		} else {
+			cindex = _cache_hash_lookup(cache, glyf_id);
+		}
+
+		if(cindex >= 0)
+		{
+			cache->last_glyph_idx = cindex;
+			cache->ref_bits[cindex] = 1;
+			cache->hit_count++;
+			return cindex;
+		}
+	}
+
+	cache->miss_count++;
+	return -1;
+}
+
+/*
+ * CLOCK replacement over contiguous slot runs: a run is taken once none of
+ * the glyphs it overlaps has been referenced since the hand last passed.
+ */
+int _get_cache_index(bitmap_cache_t* cache, uint32_t glyf_id, uint32_t slot_num)
+{
+	uint32_t hand;
+	uint32_t slot;
+	uint32_t owner;
+	uint32_t steps = 0;
+
+	if(cache == NULL)
+	{
+		SYS_LOG_ERR("null glyph cache\n");
+		return -1;
+	}
+
+	if(slot_num == 0 || slot_num > cache->cached_max)
+	{
+		SYS_LOG_ERR("glyph %d needs %d slots, max %d\n", glyf_id, slot_num, cache->cached_max);
+		return -1;
+	}
+
+	hand = cache->clock_hand;
+	while(1)
+	{
+		if(hand + slot_num > cache->cached_max)
+		{
+			hand = 0;
+		}
+
+		/* every ref bit is cleared after two sweeps, take the run anyway */
+		if(steps > 2*cache->cached_max)
+		{
+			break;
+		}
+
+		for(slot = hand; slot < hand + slot_num; slot++)
+		{
+			if(cache->glyph_index[slot] == BITMAP_CACHE_EMPTY_SLOT)
+			{
+				continue;
+			}
+
+			owner = _cache_slot_owner(cache, slot);
+			if(cache->ref_bits[owner])
+			{
+				break;
+			}
+			slot = _cache_slot_end(cache, owner) - 1;
+		}
+
+		if(slot >= hand + slot_num)
+		{
+			break;
+		}
+
+		/* second chance for the referenced glyph, move past it */
+		cache->ref_bits[owner] = 0;
+		slot = _cache_slot_end(cache, owner);
+		steps += slot - hand;
+		hand = slot;
+	}
+
+	_cache_evict_range(cache, hand, hand + slot_num);
+
+	cache->glyph_index[hand] = glyf_id;
+	cache->ref_bits[hand] = 0;
+	for(slot = hand + 1; slot < hand + slot_num; slot++)
+	{
+		cache->glyph_index[slot] = BITMAP_CACHE_CONT_SLOT;
+	}
+	_cache_hash_insert(cache, glyf_id, hand);
+	cache->cached_total += slot_num;
+
+	cache->clock_hand = hand + slot_num;
+	if(cache->clock_hand >= cache->cached_max)
+	{
+		cache->clock_hand = 0;
+	}
+	cache->last_glyph_idx = hand;
+
+	return hand;
+}
+
+uint8_t* _get_glyph_cache(bitmap_cache_t* cache, uint32_t glyf_id)
+{
+	int32_t cache_index;
+	if(cache == NULL)
+	{
+		SYS_LOG_ERR("null glyph cache\n");
+		return NULL;
+	}
+
+	/* bitmap fetch follows glyph dsc, not counted as another reference */
+	if(glyf_id == cache->glyph_index[cache->last_glyph_idx])
+	{
+		cache_index = cache->last_glyph_idx;
+	}
+	else
+	{
+		cache_index = _cache_hash_lookup(cache, glyf_id);
+	}
+
+	if(cache_index < 0)
+	{
+	    SYS_LOG_INF("cant find bitmap for glyf id %d\n", glyf_id);
+		return NULL;
+	}
+	else
+	{
+		return &(cache->data[cache_index*cache->unit_size]);
+	}
+}
+
+#ifdef CONFIG_BITMAP_FONT_USE_HIGH_FREQ_CACHE
+int32_t _check_high_freq_chars(uint16_t unicode)
+{
+	uint16_t key = unicode;
+
+	if(unicode == high_freq_cache.last_unicode_idx)
+	{
+		return high_freq_cache.last_cache_idx;
+	}
+	uint16_t *ptr16 = bsearch(&key, high_freq_codes, MAX_HIGH_FREQ_NUM, 2, unicode_to_glyph_compare);
+	if(ptr16)
+	{
+		int32_t cache_index = ptr16 - high_freq_codes;
+		high_freq_cache.last_unicode_idx = unicode;
+		high_freq_cache.last_cache_idx = cache_index;
+		return cache_index;
+	}
+	else
+	{
+		return -1;
+	}
+}
+#endif
+
+uint32_t bitmap_font_get_elapse_count(void)
+{
+	return elapse_count;
+}
+
+
+static int32_t _search_emoji_glyf_id(bitmap_emoji_font_t* font, uint32_t unicode, uint32_t* glyf_id)
+{
+	emoji_font_entry_t* entry = font->glyf_list;
+	int low, mid, high;
+
+	low = 0;
+	high = font->glyf_count-1;
+	while(low <= high)
+	{
+		mid = (low+high)/2;
+		if(entry[mid].unicode > unicode)
+		{
+			high = mid - 1;
+		}
+		else if(entry[mid].unicode < unicode)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			//found
+			*glyf_id = mid;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+uint8_t * bitmap_font_get_emoji_bitmap(bitmap_emoji_font_t* font, uint32_t unicode)
+{
+	uint8_t* data;
+	int ret;
+	int glyf_id = 0;
+	uint32_t* loca_data = NULL;
+
+	//SYS_LOG_INF("get 0x%x data, default code 0x%x\n", unicode, font->default_code);
+	if(unicode == font->default_code)
+	{
+		//SYS_LOG_INF("get default code data");
+		if(!emoji_font_use_mmap())
 		{
 			return font->cache->default_data;
 		}
@@ -1577,11 +2123,11 @@ uint8_t * bitmap_font_get_bitmap(bitmap_font_t* font, bitmap_cache_t* cache, uin
 	}
 #endif
 
-	glyf_id = _get_glyf_id_cached(cache, font->cmap_sub_headers, font->cmap_sub_count, unicode);
+	glyf_id = _get_glyf_id(font, cache, unicode);
 	if(glyf_id == 0 && font->default_code > 0)
 	{
 		//glyf not found && default code set
-		glyf_id = _get_glyf_id_cached(cache, font->cmap_sub_headers, font->cmap_sub_count, font->default_code);
+		glyf_id = _get_glyf_id(font, cache, font->default_code);
 	}
 
 	if(glyf_id == 0)
@@ -1603,8 +2149,47 @@ uint8_t * bitmap_font_get_bitmap(bitmap_font_t* font, bitmap_cache_t* cache, uin
 	return data;
 }
 
+static int _glyf_src_read(bitmap_font_t* font, glyf_src_t* src, void* dst, uint32_t len)
+{
+	int ret;
+
+	if(src == NULL)
+	{
+		return fs_read(&font->font_fp, dst, len);
+	}
+
+	if(src->pos + len <= src->len)
+	{
+		memcpy(dst, src->buf + src->pos, len);
+		src->pos += len;
+		return len;
+	}
+
+	/* glyph runs past the prefetched window, read the rest from file */
+	fs_seek(&font->font_fp, src->file_off + src->pos, FS_SEEK_SET);
+	ret = fs_read(&font->font_fp, dst, len);
+	if(ret > 0)
+	{
+		src->pos += ret;
+	}
+	return ret;
+}
+
+static void _adjust_glyph_metrics(bitmap_font_t* font, uint32_t unicode, glyph_metrics_t* metric_item)
+{
+	//FIXME: no way to adjust vertical position of some letters automatically
+	if(unicode == 0x4e00  || unicode == 0x2014 || unicode == 0xbbd2)
+	{
+		int32_t diff = metric_item->bby - metric_item->bbh;
+		if(diff > font->font_size/2)
+		{
+			metric_item->bby -= font->font_size/3;
+		}
+	}
+}
+
 extern void decompress_glyf_bitmap(const uint8_t * in, uint8_t * out, int16_t w, int16_t h, uint8_t bpp, bool prefilter, uint8_t* linebuf1, uint8_t* linebuf2);
-glyph_metrics_t* _font_get_glyph_dsc(bitmap_font_t* font, bitmap_cache_t* cache, high_freq_cache_t* hcache,  uint32_t glyf_id, int32_t* pcache_index, uint32_t load_cache_type)
+glyph_metrics_t* _font_get_glyph_dsc(bitmap_font_t* font, bitmap_cache_t* cache, high_freq_cache_t* hcache,  uint32_t glyf_id, int32_t* pcache_index, uint32_t load_cache_type, glyf_src_t* src)
 {
 	uint32_t glyf_loca;
 	uint32_t metric_len;
@@ -1628,12 +2213,15 @@ glyph_metrics_t* _font_get_glyph_dsc(bitmap_font_t* font, bitmap_cache_t* cache,
 	}
 
 
-	glyf_loca = _get_glyf_loca(font, glyf_id);
-	ret = fs_seek(&font->font_fp, glyf_loca+font->glyf_offset, FS_SEEK_SET);
-	if(ret < 0)
+	if(src == NULL)
 	{
-		SYS_LOG_ERR("%d seek font file error\n", __LINE__);
-		return NULL;
+		glyf_loca = _get_glyf_loca(font, glyf_id);
+		ret = fs_seek(&font->font_fp, glyf_loca+font->glyf_offset, FS_SEEK_SET);
+		if(ret < 0)
+		{
+			SYS_LOG_ERR("%d seek font file error\n", __LINE__);
+			return NULL;
+		}
 	}
 
 
@@ -1641,7 +2229,7 @@ glyph_metrics_t* _font_get_glyph_dsc(bitmap_font_t* font, bitmap_cache_t* cache,
 	metric_len = (bits_total+7)/8;
 
 	metrics = (uint8_t*)metrics32;
-	ret = fs_read(&font->font_fp, metrics, metric_len);
+	ret = _glyf_src_read(font, src, metrics, metric_len);
 	if(ret < metric_len)
 	{
 		SYS_LOG_ERR("read font file error\n");
@@ -1981,7 +2569,7 @@ glyph_metrics_t* _font_get_glyph_dsc(bitmap_font_t* font, bitmap_cache_t* cache,
 
 	if(bits_off != 0)
 	{
-		fs_read(&font->font_fp, data+4, bmp_size);
+		_glyf_src_read(font, src, data+4, bmp_size);
 		data[off] =  (metrics[metric_off]<<bits_off)|(data[4]>>(8-bits_off));
 		off++;
 		while(off < bmp_size)
@@ -1992,7 +2580,7 @@ glyph_metrics_t* _font_get_glyph_dsc(bitmap_font_t* font, bitmap_cache_t* cache,
 	}
 	else
 	{
-		fs_read(&font->font_fp, data, bmp_size);
+		_glyf_src_read(font, src, data, bmp_size);
 	}
 
 	if(font->compress_alg == 1 && out_dest != NULL)
@@ -2038,11 +2626,11 @@ glyph_metrics_t* bitmap_font_get_glyph_dsc(bitmap_font_t* font, bitmap_cache_t *
 	}
 #endif
 
-	glyf_id = _get_glyf_id_cached(cache, font->cmap_sub_headers, font->cmap_sub_count, unicode);
+	glyf_id = _get_glyf_id(font, cache, unicode);
 	if(glyf_id == 0 && font->default_code > 0)
 	{
 		//glyf not found && default code set
-		glyf_id = _get_glyf_id_cached(cache, font->cmap_sub_headers, font->cmap_sub_count, font->default_code);
+		glyf_id = _get_glyf_id(font, cache, font->default_code);
 	}
 
 	if(glyf_id == 0)
@@ -2070,25 +2658,374 @@ glyph_metrics_t* bitmap_font_get_glyph_dsc(bitmap_font_t* font, bitmap_cache_t *
 		}
 //		cache_index = _get_cache_index(cache, glyf_id, 1);
 
-		metric_item = _font_get_glyph_dsc(font, cache, NULL, glyf_id, &cache_index, CACHE_TYPE_NORMAL);
+		metric_item = _font_get_glyph_dsc(font, cache, NULL, glyf_id, &cache_index, CACHE_TYPE_NORMAL, NULL);
 		if(metric_item == NULL)
 		{
 			return NULL;
 		}
 
 //		SYS_LOG_INF("metrics %d %d %d %d\n", metric_item->bbx, metric_item->bby, metric_item->bbw, metric_item->bbh);
-		//FIXME: no way to adjust vertical position of some letters automatically
-		if(unicode == 0x4e00  || unicode == 0x2014 || unicode == 0xbbd2)
+		_adjust_glyph_metrics(font, unicode, metric_item);
+		return metric_item;
+	}
+
+}
+
+static bool _bitmap_cache_contains(bitmap_cache_t* cache, uint32_t glyf_id)
+{
+	if(cache->cached_total == 0)
+	{
+		return false;
+	}
+
+	return (glyf_id == cache->glyph_index[cache->last_glyph_idx]) || (_cache_hash_lookup(cache, glyf_id) >= 0);
+}
+
+static uint32_t _utf8_next(const uint8_t* txt, uint32_t len, uint32_t* pos)
+{
+	uint32_t i = *pos;
+	uint32_t code = txt[i];
+	uint32_t extra;
+
+	if(code < 0x80)
+	{
+		extra = 0;
+	}
+	else if((code & 0xe0) == 0xc0)
+	{
+		code &= 0x1f;
+		extra = 1;
+	}
+	else if((code & 0xf0) == 0xe0)
+	{
+		code &= 0x0f;
+		extra = 2;
+	}
+	else if((code & 0xf8) == 0xf0)
+	{
+		code &= 0x07;
+		extra = 3;
+	}
+	else
+	{
+		/* stray continuation byte */
+		*pos = i + 1;
+		return 0;
+	}
+
+	i++;
+	while(extra > 0)
+	{
+		if(i >= len || (txt[i] & 0xc0) != 0x80)
 		{
-			int32_t diff = metric_item->bby - metric_item->bbh;
-			if(diff > font->font_size/2)
+			*pos = i;
+			return 0;
+		}
+		code = (code << 6) | (txt[i] & 0x3f);
+		i++;
+		extra--;
+	}
+
+	*pos = i;
+	return code;
+}
+
+static void _prefetch_sort_by_id(glyf_prefetch_item_t* items, uint32_t num)
+{
+	uint32_t i, j;
+	glyf_prefetch_item_t tmp;
+
+	for(i=1;i<num;i++)
+	{
+		tmp = items[i];
+		for(j=i;j>0 && items[j-1].glyf_id > tmp.glyf_id;j--)
+		{
+			items[j] = items[j-1];
+		}
+		items[j] = tmp;
+	}
+}
+
+static void _prefetch_sort_by_loca(glyf_prefetch_item_t* items, uint32_t num)
+{
+	uint32_t i, j;
+	glyf_prefetch_item_t tmp;
+
+	for(i=1;i<num;i++)
+	{
+		tmp = items[i];
+		for(j=i;j>0 && items[j-1].loca > tmp.loca;j--)
+		{
+			items[j] = items[j-1];
+		}
+		items[j] = tmp;
+	}
+}
+
+static uint32_t _prefetch_loca_entry(bitmap_font_t* font, const uint8_t* buf, uint32_t index)
+{
+	if(font->loca_format == 0)
+	{
+		return buf[2*index] | (buf[2*index+1] << 8);
+	}
+	else
+	{
+		return buf[4*index] | (buf[4*index+1] << 8) | (buf[4*index+2] << 16) | ((uint32_t)buf[4*index+3] << 24);
+	}
+}
+
+/* reads loca of every item and the next glyph, neighbouring ids share one read */
+static void _prefetch_read_loca(bitmap_font_t* font, glyf_prefetch_item_t* items, uint32_t num, uint8_t* buf)
+{
+	uint32_t entry_size = (font->loca_format == 0) ? 2 : 4;
+	uint32_t loca_count = (font->glyf_offset - font->loca_offset - 12)/entry_size;
+	uint32_t first, last;
+	uint32_t i, j, k;
+	int ret;
+
+	i = 0;
+	while(i < num)
+	{
+		first = items[i].glyf_id;
+		j = i;
+		while(j + 1 < num && (items[j+1].glyf_id + 2 - first)*entry_size <= PREFETCH_LOCA_WINDOW)
+		{
+			j++;
+		}
+
+		last = items[j].glyf_id + 1;
+		if(last >= loca_count)
+		{
+			last = loca_count - 1;
+		}
+
+		fs_seek(&font->font_fp, font->loca_offset + 12 + first*entry_size, FS_SEEK_SET);
+		ret = fs_read(&font->font_fp, buf, (last - first + 1)*entry_size);
+		if(ret < (int)((last - first + 1)*entry_size))
+		{
+			SYS_LOG_ERR("read loca failed %d\n", ret);
+			last = first - 1;
+		}
+
+		for(k=i;k<=j;k++)
+		{
+			if(items[k].glyf_id > last)
 			{
-				metric_item->bby -= font->font_size/3;
+				/* unknown, loaded from file glyph by glyph */
+				items[k].loca = _get_glyf_loca(font, items[k].glyf_id);
+				items[k].end = items[k].loca;
+				continue;
+			}
+
+			items[k].loca = _prefetch_loca_entry(font, buf, items[k].glyf_id - first);
+			if(items[k].glyf_id + 1 <= last)
+			{
+				items[k].end = _prefetch_loca_entry(font, buf, items[k].glyf_id + 1 - first);
+			}
+			else
+			{
+				items[k].end = items[k].loca;
 			}
 		}
-		return metric_item;
+
+		i = j + 1;
+	}
+}
+
+static inline uint32_t _prefetch_item_end(glyf_prefetch_item_t* item)
+{
+	return ((item->end > item->loca) ? item->end : item->loca) + PREFETCH_SLACK;
+}
+
+static int _prefetch_load_batch(bitmap_font_t* font, bitmap_cache_t* cache, glyf_prefetch_item_t* items, uint32_t num, uint8_t* buf)
+{
+	glyph_metrics_t* metric_item;
+	glyf_src_t src;
+	uint32_t run_start, run_end, item_end;
+	uint32_t i, j, k;
+	int32_t cache_index;
+	int loaded = 0;
+	int ret;
+
+	_prefetch_sort_by_id(items, num);
+	_prefetch_read_loca(font, items, num, buf);
+	_prefetch_sort_by_loca(items, num);
+
+	i = 0;
+	while(i < num)
+	{
+		run_start = items[i].loca;
+		run_end = _prefetch_item_end(&items[i]);
+		j = i;
+		while(j + 1 < num)
+		{
+			item_end = _prefetch_item_end(&items[j+1]);
+			if(items[j+1].loca > run_end + PREFETCH_GAP || item_end - run_start > PREFETCH_BUF_SIZE)
+			{
+				break;
+			}
+			if(item_end > run_end)
+			{
+				run_end = item_end;
+			}
+			j++;
+		}
+		if(run_end - run_start > PREFETCH_BUF_SIZE)
+		{
+			run_end = run_start + PREFETCH_BUF_SIZE;
+		}
+
+		fs_seek(&font->font_fp, font->glyf_offset + run_start, FS_SEEK_SET);
+		ret = fs_read(&font->font_fp, buf, run_end - run_start);
+		if(ret < 0)
+		{
+			ret = 0;
+		}
+
+		for(k=i;k<=j;k++)
+		{
+			src.buf = buf;
+			src.len = ret;
+			src.pos = items[k].loca - run_start;
+			src.file_off = font->glyf_offset + run_start;
+
+			metric_item = _font_get_glyph_dsc(font, cache, NULL, items[k].glyf_id, &cache_index, CACHE_TYPE_NORMAL, &src);
+			if(metric_item != NULL)
+			{
+				_adjust_glyph_metrics(font, items[k].unicode, metric_item);
+				loaded++;
+			}
+		}
+
+		i = j + 1;
 	}
 
+	return loaded;
+}
+
+int bitmap_font_prefetch_string(bitmap_font_t* font, bitmap_cache_t* cache, const char* txt, uint32_t len)
+{
+	glyf_prefetch_item_t items[PREFETCH_MAX_GLYPHS];
+	uint32_t batch_max;
+	uint32_t total_max;
+	uint32_t total = 0;
+	uint32_t num = 0;
+	uint32_t pos = 0;
+	uint32_t unicode;
+	uint32_t glyf_id;
+	uint32_t i;
+	uint8_t* buf;
+	int loaded = 0;
+
+	if((font == NULL) || (cache == NULL) || (txt == NULL))
+	{
+		SYS_LOG_ERR("null prefetch param, %p, %p, %p\n", font, cache, txt);
+		return -1;
+	}
+
+	/* keep the prefetch well inside the cache, or the tail of a long text
+	 * evicts the glyphs at its head, which are the ones displayed first */
+	total_max = cache->cached_max/2;
+	batch_max = total_max;
+	if(batch_max > PREFETCH_MAX_GLYPHS)
+	{
+		batch_max = PREFETCH_MAX_GLYPHS;
+	}
+	if(batch_max == 0)
+	{
+		return 0;
+	}
+
+	buf = bitmap_font_cache_malloc(PREFETCH_BUF_SIZE);
+	if(buf == NULL)
+	{
+		SYS_LOG_INF("no memory for glyph prefetch\n");
+		return -1;
+	}
+
+	while(pos < len && txt[pos] != 0 && total < total_max)
+	{
+		unicode = _utf8_next((const uint8_t*)txt, len, &pos);
+		if(unicode < 0x20)
+		{
+			continue;
+		}
+
+#ifdef CONFIG_BITMAP_FONT_USE_HIGH_FREQ_CACHE
+		if(bitmap_font_get_high_freq_enabled() && font->font_size == high_freq_cache.font_size)
+		{
+			if(_check_high_freq_chars((uint16_t)unicode) >= 0)
+			{
+				continue;
+			}
+		}
+#endif
+
+		glyf_id = _get_glyf_id(font, cache, unicode);
+		if(glyf_id == 0 && font->default_code > 0)
+		{
+			glyf_id = _get_glyf_id(font, cache, font->default_code);
+		}
+
+		if(glyf_id == 0)
+		{
+			if(font->cache->default_data != NULL)
+			{
+				continue;
+			}
+			glyf_id = 1;
+		}
+
+		if(_bitmap_cache_contains(cache, glyf_id))
+		{
+			continue;
+		}
+
+		for(i=0;i<num;i++)
+		{
+			if(items[i].glyf_id == glyf_id)
+			{
+				break;
+			}
+		}
+		if(i < num)
+		{
+			continue;
+		}
+
+		items[num].unicode = unicode;
+		items[num].glyf_id = glyf_id;
+		num++;
+		total++;
+		if(num >= batch_max)
+		{
+			loaded += _prefetch_load_batch(font, cache, items, num, buf);
+			num = 0;
+		}
+	}
+
+	if(num > 0)
+	{
+		loaded += _prefetch_load_batch(font, cache, items, num, buf);
+	}
+
+	bitmap_font_cache_free(buf);
+
+	if(bitmap_font_glyph_debug_is_on())
+	{
+		SYS_LOG_INF("prefetched %d glyphs\n", loaded);
+	}
+	return loaded;
+}
+
+static void _bitmap_cache_dump_stats(bitmap_cache_t* cache)
+{
+	uint32_t lookups = cache->hit_count + cache->miss_count;
+
+	os_printk("    hit %d, miss %d, evict %d, hit rate %d%%, buckets %d\n",
+				cache->hit_count, cache->miss_count, cache->evict_count,
+				lookups ? (uint32_t)((uint64_t)cache->hit_count*100/lookups) : 0,
+				1 << cache->hash_bits);
 }
 
 void bitmap_font_dump_info(void)
@@ -2101,13 +3038,20 @@ void bitmap_font_dump_info(void)
     {
         if(opend_font[i].font_fp.filep != NULL)
         {
-        	per_size = opend_font[i].cache->unit_size+sizeof(glyph_metrics_t)+sizeof(uint32_t);
+        	per_size = _bitmap_cache_slot_size(opend_font[i].cache);
         	cached_size = (opend_font[i].cache->cached_total+2)*per_size;
             os_printk("font %d, path %s, metric buf %p, data buf %p, cached total %d, cached max %d, cache size now %d, cache size max %d\n", 
 						i, opend_font[i].font_path, opend_font[i].cache->metrics, opend_font[i].cache->data, 
 						opend_font[i].cache->cached_total+2, opend_font[i].cache->cached_max, cached_size, opend_font[i].cache->cache_max_size);
+            _bitmap_cache_dump_stats(opend_font[i].cache);
         }
     }
+
+    if(opend_emoji_font.inited)
+    {
+        os_printk("emoji font, cached total %d, cached max %d\n", opend_emoji_font.cache->cached_total, opend_emoji_font.cache->cached_max);
+        _bitmap_cache_dump_stats(opend_emoji_font.cache);
+    }
     bitmap_font_cache_dump_info();
 }
 
@@ -2185,13 +3129,13 @@ void bitmap_font_load_high_freq_chars(const uint8_t* file_path)
 	SYS_LOG_INF("high freq fontsize %d, unitsize %d\n", high_freq_cache.font_size, high_freq_cache.unit_size);
 	for(i=0;i<MAX_HIGH_FREQ_NUM;i++)
 	{
-		glyf_id = _get_glyf_id_cached(font->cache, font->cmap_sub_headers, font->cmap_sub_count, (uint32_t)high_freq_codes[i]);
+		glyf_id = _get_glyf_id(font, font->cache, (uint32_t)high_freq_codes[i]);
 		if(glyf_id == 0)
 		{
 			SYS_LOG_INF("high freq glyf not found 0x%x\n", high_freq_codes[i]);
 			continue;
 		}
-		metric_item = _font_get_glyph_dsc(font, NULL, &high_freq_cache, glyf_id, &cache_index, CACHE_TYPE_HIGH_FREQ);
+		metric_item = _font_get_glyph_dsc(font, NULL, &high_freq_cache, glyf_id, &cache_index, CACHE_TYPE_HIGH_FREQ, NULL);
 		if(metric_item == NULL)
 		{
 			SYS_LOG_INF("high freq metric not found 0x%x\n", high_freq_codes[i]);
@@ -2,42 +2,54 @@
  *      INCLUDES
  *********************/
 #include <os_common_api.h>
+#include <string.h>
 
 /*********************
  *      DEFINES
  *********************/
+/* ones before a run switches to the 6 bit counter */
+#define RLE_MAX_ONES        11
 
 /**********************
  *      TYPEDEFS
  **********************/
-typedef enum {
-    RLE_STATE_SINGLE = 0,
-    RLE_STATE_REPEATE,
-    RLE_STATE_COUNTER,
-} rle_state_t;
+typedef struct {
+    const uint8_t * in;     /* next byte to load into acc */
+    uint32_t acc;           /* bit accumulator, next bit at MSB */
+    uint8_t acc_bits;       /* valid bits in acc */
+    uint8_t bpp;
+    uint8_t prev_v;
+    uint8_t first;
+    uint8_t lit_pending;    /* a literal follows the current run */
+    uint16_t rep_left;      /* repeated pixels not yet emitted */
+} rle_dec_t;
+
+typedef struct {
+    uint8_t * out;
+    uint32_t acc;
+    uint8_t bits;           /* pending bits in acc, always < 8 between pixels */
+    uint8_t wr_size;
+    const uint8_t * map;    /* value upscale for bpp 3 */
+} bits_pack_t;
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 void decompress_glyf_bitmap(const uint8_t * in, uint8_t * out, int16_t w, int16_t h, uint8_t bpp, bool prefilter, uint8_t* linebuf1, uint8_t* linebuf2);
-static inline void decompress_line(uint8_t * out, int16_t w);
-static inline uint8_t get_bits(const uint8_t * in, uint32_t bit_pos, uint8_t len);
-static inline void bits_write(uint8_t * out, uint32_t bit_pos, uint8_t val, uint8_t len);
-static inline void rle_init(const uint8_t * in,  uint8_t bpp);
-static inline uint8_t rle_next(void);
-
-
+static inline void rle_init(rle_dec_t * dec, const uint8_t * in, uint8_t bpp);
+static inline void rle_refill(rle_dec_t * dec);
+static inline uint8_t rle_read(rle_dec_t * dec, uint8_t len);
+static inline void rle_read_run(rle_dec_t * dec);
+static void decompress_line(rle_dec_t * dec, uint8_t * out, int16_t w);
+static void line_xor(uint8_t * dst, const uint8_t * src, int16_t w);
+static inline void pack_px(bits_pack_t * pk, uint8_t val);
+static void pack_line(bits_pack_t * pk, const uint8_t * line, int16_t w);
+static void pack_finish(bits_pack_t * pk);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
-static uint32_t rle_rdp;
-static const uint8_t * rle_in;
-static uint8_t rle_bpp;
-static uint8_t rle_prev_v;
-static uint8_t rle_cnt;
-static rle_state_t rle_state;
-
+static const uint8_t bpp3_to_bpp4[8] = {0, 2, 4, 6, 9, 11, 13, 15};
 
 /**********************
  *   GLOBAL FUNCTIONS
@@ -53,224 +65,265 @@ static rle_state_t rle_state;
  */
 void decompress_glyf_bitmap(const uint8_t * in, uint8_t * out, int16_t w, int16_t h, uint8_t bpp, bool prefilter, uint8_t* linebuf1, uint8_t* linebuf2)
 {
-    uint32_t wrp = 0;
-    uint8_t wr_size = bpp;
-    if(bpp == 3) wr_size = 4;
+    rle_dec_t dec;
+    bits_pack_t pk;
+    int16_t y;
 
-    rle_init(in, bpp);
+    rle_init(&dec, in, bpp);
 
-    //uint8_t * line_buf1 = bitmap_font_cache_malloc(w);
-    uint8_t* line_buf1 = linebuf1;
+    pk.out = out;
+    pk.acc = 0;
+    pk.bits = 0;
+    pk.wr_size = (bpp == 3) ? 4 : bpp;
+    pk.map = (bpp == 3) ? bpp3_to_bpp4 : NULL;
 
+    uint8_t* line_buf1 = linebuf1;
     uint8_t * line_buf2 = NULL;
 
-    if(prefilter) {		
-        //line_buf2 = bitmap_font_cache_malloc(w);
+    if(prefilter) {
         line_buf2 = linebuf2;
     }
 
-    decompress_line(line_buf1, w);
-
-    int16_t y;
-    int16_t x;
-
-    for(x = 0; x < w; x++) {
-        bits_write(out, wrp, line_buf1[x], bpp);
-        wrp += wr_size;
-    }
+    decompress_line(&dec, line_buf1, w);
+    pack_line(&pk, line_buf1, w);
 
     for(y = 1; y < h; y++) {
         if(prefilter) {
-            decompress_line(line_buf2, w);
-
-            for(x = 0; x < w; x++) {
-                line_buf1[x] = line_buf2[x] ^ line_buf1[x];
-                bits_write(out, wrp, line_buf1[x], bpp);
-                wrp += wr_size;
-            }
+            decompress_line(&dec, line_buf2, w);
+            line_xor(line_buf1, line_buf2, w);
         }
         else {
-            decompress_line(line_buf1, w);
-
-            for(x = 0; x < w; x++) {
-                bits_write(out, wrp, line_buf1[x], bpp);
-                wrp += wr_size;
-            }
+            decompress_line(&dec, line_buf1, w);
         }
+        pack_line(&pk, line_buf1, w);
     }
 
-    //bitmap_font_cache_free(line_buf1);
-    //bitmap_font_cache_free(line_buf2);
+    pack_finish(&pk);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static inline void rle_init(rle_dec_t * dec, const uint8_t * in, uint8_t bpp)
+{
+    dec->in = in;
+    dec->acc = 0;
+    dec->acc_bits = 0;
+    dec->bpp = bpp;
+    dec->prev_v = 0;
+    dec->first = 1;
+    dec->lit_pending = 0;
+    dec->rep_left = 0;
 }
 
 /**
- * Decompress one line. Store one pixel per byte
- * @param out output buffer
- * @param w width of the line in pixel count
+ * Top up the accumulator to at least 25 bits, enough for a whole run header.
+ * May load up to 3 bytes past the last bit actually used.
  */
-static inline void decompress_line(uint8_t * out, int16_t w)
+static inline void rle_refill(rle_dec_t * dec)
 {
-    int16_t i;
-    for(i = 0; i < w; i++) {
-        out[i] = rle_next();
+    while(dec->acc_bits <= 24) {
+        dec->acc |= (uint32_t)(*dec->in++) << (24 - dec->acc_bits);
+        dec->acc_bits += 8;
     }
 }
 
 /**
- * Read bits from an input buffer. The read can cross byte boundary.
- * @param in the input buffer to read from.
- * @param bit_pos index of the first bit to read.
+ * Read bits from the stream, MSB first.
  * @param len number of bits to read (must be <= 8).
  * @return the read bits
  */
-static inline uint8_t get_bits(const uint8_t * in, uint32_t bit_pos, uint8_t len)
+static inline uint8_t rle_read(rle_dec_t * dec, uint8_t len)
 {
-    uint8_t bit_mask;
-    switch(len) {
-        case 1:
-            bit_mask = 0x1;
-            break;
-        case 2:
-            bit_mask = 0x3;
-            break;
-        case 3:
-            bit_mask = 0x7;
-            break;
-        case 4:
-            bit_mask = 0xF;
-            break;
-        case 8:
-            bit_mask = 0xFF;
-            break;
-        default:
-            bit_mask = (uint16_t)((uint16_t) 1 << len) - 1;
+    uint8_t v;
+
+    if(dec->acc_bits < len) {
+        rle_refill(dec);
     }
 
-    uint32_t byte_pos = bit_pos >> 3;
-    bit_pos = bit_pos & 0x7;
+    v = (uint8_t)(dec->acc >> (32 - len));
+    dec->acc <<= len;
+    dec->acc_bits -= len;
+    return v;
+}
+
+/**
+ * Decode the header following two equal literals: up to 11 one bits, each
+ * one more repeat, then either a zero or a 6 bit extra count. A literal
+ * always follows the run.
+ */
+static inline void rle_read_run(rle_dec_t * dec)
+{
+    uint32_t ones;
 
-    if(bit_pos + len >= 8) {
-        uint16_t in16 = (in[byte_pos] << 8) + in[byte_pos + 1];
-        return (in16 >> (16 - bit_pos - len)) & bit_mask;
+    rle_refill(dec);
+
+    ones = (~dec->acc == 0) ? 32 : __builtin_clz(~dec->acc);
+    if(ones >= RLE_MAX_ONES) {
+        dec->acc <<= RLE_MAX_ONES;
+        dec->acc_bits -= RLE_MAX_ONES;
+        dec->rep_left = RLE_MAX_ONES - 1 + rle_read(dec, 6);
     }
     else {
-        return (in[byte_pos] >> (8 - bit_pos - len)) & bit_mask;
+        dec->acc <<= ones + 1;
+        dec->acc_bits -= ones + 1;
+        dec->rep_left = ones;
     }
+
+    dec->lit_pending = 1;
 }
 
 /**
- * Write `val` data to `bit_pos` position of `out`. The write can NOT cross byte boundary.
- * @param out buffer where to write
- * @param bit_pos bit index to write
- * @param val value to write
- * @param len length of bits to write from `val`. (Counted from the LSB).
- * @note `len == 3` will be converted to `len = 4` and `val` will be upscaled too
+ * Decompress one line. Store one pixel per byte, runs are filled at once
+ * @param out output buffer
+ * @param w width of the line in pixel count
  */
-static inline void bits_write(uint8_t * out, uint32_t bit_pos, uint8_t val, uint8_t len)
+static void decompress_line(rle_dec_t * dec, uint8_t * out, int16_t w)
 {
-    if(len == 3) {
-        len = 4;
-        switch(val) {
-            case 0:
-                val = 0;
-                break;
-            case 1:
-                val = 2;
-                break;
-            case 2:
-                val = 4;
-                break;
-            case 3:
-                val = 6;
-                break;
-            case 4:
-                val = 9;
-                break;
-            case 5:
-                val = 11;
-                break;
-            case 6:
-                val = 13;
-                break;
-            case 7:
-                val = 15;
+    int16_t x = 0;
+    int16_t n;
+    uint8_t v;
+    uint8_t bpp = dec->bpp;
+
+    while(x < w) {
+        if(dec->rep_left > 0) {
+            n = w - x;
+            if(n > dec->rep_left) {
+                n = dec->rep_left;
+            }
+            memset(out + x, dec->prev_v, n);
+            x += n;
+            dec->rep_left -= n;
+            continue;
+        }
+
+        if(dec->lit_pending || dec->first) {
+            /* literal closing a run, or the very first one: no repeat check */
+            v = rle_read(dec, bpp);
+            out[x++] = v;
+            dec->lit_pending = 0;
+            dec->first = 0;
+            dec->prev_v = v;
+            continue;
+        }
+
+        /* literal stretch, decoded from locals until two equal values meet */
+        uint32_t acc = dec->acc;
+        uint8_t acc_bits = dec->acc_bits;
+        uint8_t prev = dec->prev_v;
+        bool run = false;
+
+        while(x < w) {
+            if(acc_bits < bpp) {
+                dec->acc = acc;
+                dec->acc_bits = acc_bits;
+                rle_refill(dec);
+                acc = dec->acc;
+                acc_bits = dec->acc_bits;
+            }
+            v = (uint8_t)(acc >> (32 - bpp));
+            acc <<= bpp;
+            acc_bits -= bpp;
+            out[x++] = v;
+
+            if(v == prev) {
+                run = true;
                 break;
+            }
+            prev = v;
+        }
+
+        dec->acc = acc;
+        dec->acc_bits = acc_bits;
+        dec->prev_v = prev;
+        if(run) {
+            rle_read_run(dec);
         }
     }
+}
 
-    uint16_t byte_pos = bit_pos >> 3;
-    bit_pos = bit_pos & 0x7;
-    bit_pos = 8 - bit_pos - len;
+static void line_xor(uint8_t * dst, const uint8_t * src, int16_t w)
+{
+    int16_t x = 0;
 
-    uint8_t bit_mask = (uint16_t)((uint16_t) 1 << len) - 1;
-    out[byte_pos] &= ((~bit_mask) << bit_pos);
-    out[byte_pos] |= (val << bit_pos);
+    if((((uintptr_t)dst | (uintptr_t)src) & 0x3) == 0) {
+        uint32_t * dst32 = (uint32_t *)dst;
+        const uint32_t * src32 = (const uint32_t *)src;
+
+        for(; x + 4 <= w; x += 4) {
+            *dst32++ ^= *src32++;
+        }
+    }
+
+    for(; x < w; x++) {
+        dst[x] ^= src[x];
+    }
 }
 
-static inline void rle_init(const uint8_t * in,  uint8_t bpp)
+/**
+ * Append one pixel. Bits below the last pixel of a byte end up zero, the
+ * same as the former read-modify-write of each pixel.
+ */
+static inline void pack_px(bits_pack_t * pk, uint8_t val)
 {
-    rle_in = in;
-    rle_bpp = bpp;
-    rle_state = RLE_STATE_SINGLE;
-    rle_rdp = 0;
-    rle_prev_v = 0;
-    rle_cnt = 0;
+    if(pk->map) {
+        val = pk->map[val];
+    }
+
+    pk->acc = (pk->acc << pk->wr_size) | val;
+    pk->bits += pk->wr_size;
+    if(pk->bits >= 8) {
+        pk->bits -= 8;
+        *pk->out++ = (uint8_t)(pk->acc >> pk->bits);
+    }
 }
 
-static inline uint8_t rle_next(void)
+static void pack_line(bits_pack_t * pk, const uint8_t * line, int16_t w)
 {
-    uint8_t v = 0;
-    uint8_t ret = 0;
-
-    if(rle_state == RLE_STATE_SINGLE) {
-        ret = get_bits(rle_in, rle_rdp, rle_bpp);
-        if(rle_rdp != 0 && rle_prev_v == ret) {
-            rle_cnt = 0;
-            rle_state = RLE_STATE_REPEATE;
-        }
+    int16_t x = 0;
 
-        rle_prev_v = ret;
-        rle_rdp += rle_bpp;
+    /* realign to a byte boundary, lines are not byte aligned in output */
+    while(pk->bits != 0 && x < w) {
+        pack_px(pk, line[x++]);
     }
-    else if(rle_state == RLE_STATE_REPEATE) {
-        v = get_bits(rle_in, rle_rdp, 1);
-        rle_cnt++;
-        rle_rdp += 1;
-        if(v == 1) {
-            ret = rle_prev_v;
-            if(rle_cnt == 11) {
-                rle_cnt = get_bits(rle_in, rle_rdp, 6);
-                rle_rdp += 6;
-                if(rle_cnt != 0) {
-                    rle_state = RLE_STATE_COUNTER;
+
+    if(pk->map == NULL) {
+        switch(pk->wr_size) {
+            case 8:
+                memcpy(pk->out, line + x, w - x);
+                pk->out += w - x;
+                x = w;
+                break;
+            case 4:
+                for(; x + 2 <= w; x += 2) {
+                    *pk->out++ = (line[x] << 4) | line[x + 1];
                 }
-                else {
-                    ret = get_bits(rle_in, rle_rdp, rle_bpp);
-                    rle_prev_v = ret;
-                    rle_rdp += rle_bpp;
-                    rle_state = RLE_STATE_SINGLE;
+                break;
+            case 2:
+                for(; x + 4 <= w; x += 4) {
+                    *pk->out++ = (line[x] << 6) | (line[x + 1] << 4) | (line[x + 2] << 2) | line[x + 3];
                 }
-            }
-        }
-        else {
-            ret = get_bits(rle_in, rle_rdp, rle_bpp);
-            rle_prev_v = ret;
-            rle_rdp += rle_bpp;
-            rle_state = RLE_STATE_SINGLE;
-        }
-
-    }
-    else if(rle_state == RLE_STATE_COUNTER) {
-        ret = rle_prev_v;
-        rle_cnt--;
-        if(rle_cnt == 0) {
-            ret = get_bits(rle_in, rle_rdp, rle_bpp);
-            rle_prev_v = ret;
-            rle_rdp += rle_bpp;
-            rle_state = RLE_STATE_SINGLE;
+                break;
+            case 1:
+                for(; x + 8 <= w; x += 8) {
+                    *pk->out++ = (line[x] << 7) | (line[x + 1] << 6) | (line[x + 2] << 5) | (line[x + 3] << 4) |
+                                 (line[x + 4] << 3) | (line[x + 5] << 2) | (line[x + 6] << 1) | line[x + 7];
+                }
+                break;
+            default:
+                break;
         }
     }
 
-    return ret;
+    while(x < w) {
+        pack_px(pk, line[x++]);
+    }
 }
 
+static void pack_finish(bits_pack_t * pk)
+{
+    if(pk->bits > 0) {
+        *pk->out = (uint8_t)(pk->acc << (8 - pk->bits));
+    }
+}
@@ -26,6 +26,12 @@ extern "C" {
 
 #define USE_BSEARCH_IN_GLYPH_ID		1
 
+/* glyph cache slot index helpers */
+#define BITMAP_CACHE_EMPTY_SLOT		0
+#define BITMAP_CACHE_CONT_SLOT		0xffffffff
+#define BITMAP_CACHE_INVALID_IDX	0xffff
+#define BITMAP_CACHE_MAX_SLOTS		0xfffe
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -49,10 +55,18 @@ typedef struct
 
 typedef struct
 {
-	uint32_t current;
-	uint32_t next;
+	uint32_t clock_hand;
 	uint32_t cached_total;
 	uint32_t* glyph_index;
+	/* hashed glyph index, chained through hash_next */
+	uint16_t* hash_heads;
+	uint16_t* hash_next;
+	uint8_t* ref_bits;
+	uint32_t hash_bits;
+	/* statistics */
+	uint32_t hit_count;
+	uint32_t miss_count;
+	uint32_t evict_count;
 	glyph_metrics_t* metrics;
 	uint8_t* data;
 	glyph_metrics_t default_metric;
@@ -100,6 +114,14 @@ typedef struct
 	uint8_t* emoji_mmap_addr;
 }bitmap_emoji_font_t;
 
+typedef struct
+{
+	/* 256-code page held in this slot, CMAP_SLOT_FREE if none */
+	uint32_t page_idx;
+	uint32_t last_use;
+	uint16_t* data;
+}cmap_page_slot_t;
+
 typedef struct
 {
 	struct fs_file_t font_fp;
@@ -125,6 +147,13 @@ typedef struct
 	uint8_t* cmap_sub_headers;
 	uint32_t cmap_sub_count;
 	uint32_t default_code;
+	/* codepoint to glyph id pages built on use, least recently used reused */
+	cmap_page_slot_t* cmap_slots;
+	uint32_t cmap_slot_count;
+	uint32_t cmap_last_slot;
+	uint32_t cmap_use_tick;
+	/* pages above the highest code of every sub table */
+	uint32_t cmap_page_count;
 }bitmap_font_t;
 
 typedef struct
@@ -147,6 +176,7 @@ void bitmap_font_close(bitmap_font_t* font);
 
 uint8_t * bitmap_font_get_bitmap(bitmap_font_t* font, bitmap_cache_t* cache, uint32_t unicode);
 glyph_metrics_t* bitmap_font_get_glyph_dsc(bitmap_font_t* font, bitmap_cache_t *cache, uint32_t unicode);
+int bitmap_font_prefetch_string(bitmap_font_t* font, bitmap_cache_t* cache, const char* txt, uint32_t len);
 
 bitmap_cache_t* bitmap_font_get_cache(bitmap_font_t* font);
 
@@ -24,6 +24,20 @@ extern "C" {
 #define LZ4_PIC_MAGIC PIC_MAGIC_CODE('L', 'Z', '4', 'C')
 #define RLE_PIC_MAGIC PIC_MAGIC_CODE('R', 'L', 'E', 'C')
 #define RAW_PIC_MAGIC PIC_MAGIC_CODE('R', 'A', 'W', 'C')
+/* independent LZ4 blocks of full rows, tile_height rows per block */
+#define LZ4_ROWS_PIC_MAGIC PIC_MAGIC_CODE('L', 'Z', '4', 'R')
+
+/* whether the picture is in one of the compressed picture formats above */
+#ifdef CONFIG_PIC_DECOMPRESS_ROWS
+#define IS_COMPRESSED_PIC_MAGIC(magic) \
+	((magic) == LZ4_PIC_MAGIC || (magic) == RLE_PIC_MAGIC || \
+	 (magic) == RAW_PIC_MAGIC || (magic) == LZ4_ROWS_PIC_MAGIC)
+#else
+#define IS_COMPRESSED_PIC_MAGIC(magic) \
+	((magic) == LZ4_PIC_MAGIC || (magic) == RLE_PIC_MAGIC || \
+	 (magic) == RAW_PIC_MAGIC)
+#endif
+
 /**
  * @enum compressed_color_format
  * @brief compressed picture color format enumeration.
@@ -47,6 +61,7 @@ enum compressed_pic_forat {
 	COMPRESSED_PIC_FORMAT_RLE,
 	COMPRESSED_PIC_FORMAT_LZ4,
 	COMPRESSED_PIC_FORMAT_RAW,
+	COMPRESSED_PIC_FORMAT_LZ4_ROWS,
 };
 
 /**
@@ -47,6 +47,21 @@ int lvgl_bitmap_font_get_emoji_dsc(const lv_font_t* lv_font, uint32_t unicode, l
 */
 int lvgl_bitmap_font_set_default_code(lv_font_t* font, uint32_t word_code, uint32_t emoji_code);
 
+/**
+* @brief load the glyphs of a text run into font cache in advance
+*
+* Glyphs missing from the cache are deduplicated and read in file order,
+* so a new text page costs a few sequential reads instead of one read per
+* glyph during rendering. Only the glyphs of the text head fitting in half
+* of the font cache are loaded, the rest is left to rendering.
+*
+* @param font pointer to font data
+* @param txt UTF-8 text, zero terminated
+*
+* @return number of glyphs loaded, negative if failed.
+*/
+int lvgl_bitmap_font_prefetch_text(const lv_font_t* font, const char* txt);
+
 /**
 * @brief preset cache size for each font
 *
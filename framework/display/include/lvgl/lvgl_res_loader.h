@@ -507,6 +507,15 @@ int lvgl_res_preload_cancel(void);
 */
 int lvgl_res_preload_cancel_scene(uint32_t scene_id);
 
+/**
+* @brief resource preload statistics dumping funcion
+*
+* This routine prints preload latency of recently preloaded scenes, measured from
+* queueing a scene to its finish callback.
+*
+*/
+void lvgl_res_preload_dump_stats(void);
+
 /**
 * @brief scene resource release funcion
 *
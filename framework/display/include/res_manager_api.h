@@ -164,6 +164,16 @@ typedef struct _pic_search_param_s
 	uint32_t* compress_size;
 }pic_search_param_t;
 
+/* flat picture directory entry, indexed by (id - pic_dir_id_start) */
+typedef struct _pic_dir_entry_s
+{
+	uint32_t offset;
+	uint32_t compress_size : 24;
+	uint32_t volume : 8;	/* index of pic_search_param, PIC_DIR_VOLUME_NONE if absent */
+}pic_dir_entry_t;
+
+#define PIC_DIR_VOLUME_NONE		0xff
+
 typedef struct style_s
 {
 #ifdef CONFIG_SIMULATOR
@@ -184,6 +194,9 @@ typedef struct style_s
 	uint32_t reference;
 	pic_search_param_t* pic_search_param;
 	uint32_t pic_search_max_volume;
+	pic_dir_entry_t* pic_dir;
+	uint32_t pic_dir_id_start;
+	uint32_t pic_dir_count;
 #ifdef CONFIG_RES_MANAGER_USE_STYLE_MMAP
 	uint8_t* pic_res_mmap_addr;
 #endif
@@ -234,6 +247,15 @@ typedef struct _preload_param
 	void* param;
 	resource_info_t* res_info;
 	struct _preload_param* next;
+	/* next queued batch, only valid on the first item of a batch */
+	struct _preload_param* batch_next;
+	/* picture volume and offset, used to order reads */
+	uint32_t file_pos;
+	/* time the batch was queued, kept on the end callback item */
+	uint32_t queue_time;
+	/* view the batch is preloaded for, only valid on the first item */
+	uint16_t view_id;
+	uint8_t volume;
 }preload_param_t;
 
 
@@ -248,6 +270,9 @@ typedef struct
 	uint32_t inited;
 	pic_search_param_t* pic_search_param;
 	uint32_t pic_search_max_volume;
+	pic_dir_entry_t* pic_dir;
+	uint32_t pic_dir_id_start;
+	uint32_t pic_dir_count;
 #ifdef CONFIG_RES_MANAGER_USE_STYLE_MMAP
 	uint8_t* pic_res_mmap_addr;
 #endif	
@@ -325,6 +350,8 @@ uint32_t res_manager_get_bitmap_buf_block_unit_size(void);
 
 int32_t res_manager_preload_bitmap(resource_info_t* res_info, resource_bitmap_t* bitmap);
 int32_t res_manager_preload_bitmap_compact(uint32_t scene_id, resource_info_t* res_info, resource_bitmap_t* bitmap);
+//returns picture volume of bitmap and its offset in that volume, -1 if not found
+int32_t res_manager_get_bitmap_file_pos(resource_info_t* res_info, resource_bitmap_t* bitmap, uint32_t* pos);
 void* res_manager_preload_next_scene_child(resource_info_t* info, resource_scene_t* scene, uint32_t* count, uint32_t* offset);
 void* res_manager_preload_next_group_child(resource_info_t * info, resource_group_t* group, int* count, uint32_t* offset, uint32_t scene_id, uint32_t pargroup_id);
 
@@ -33,6 +33,11 @@ extern "C" {
 #  define CONFIG_SURFACE_MAX_BUFFER_COUNT (0)
 #endif
 
+/* maximum dirty regions tracked in one frame, the extra ones are merged */
+#ifndef CONFIG_SURFACE_MAX_DIRTY_REGIONS
+#  define CONFIG_SURFACE_MAX_DIRTY_REGIONS (4)
+#endif
+
 /**
  * @enum surface_event_id
  * @brief Enumeration with possible surface event
@@ -78,6 +83,9 @@ enum {
 
 	/* post flags */
 	SURFACE_POST_IN_SYNC_MODE = 0x40, /* surface post in sync mode. */
+
+	/* create flags */
+	SURFACE_FRAME_TIMELINE = 0x80, /* primary surface of the display, recorded in frame timeline */
 };
 
 /**
@@ -88,6 +96,9 @@ enum {
 typedef struct surface_post_data {
 	uint8_t flags;
 	const ui_region_t *area;
+	/* the non-overlapped dirty regions inside 'area' */
+	const ui_region_t *regions;
+	uint8_t num_regions;
 } surface_post_data_t;
 
 /**
@@ -119,6 +130,9 @@ typedef struct surface {
 
 #if CONFIG_SURFACE_MAX_BUFFER_COUNT > 0
 	ui_region_t dirty_area;
+	/* dirty regions of current frame, whose bounding box is dirty_area */
+	ui_region_t dirty_regions[CONFIG_SURFACE_MAX_DIRTY_REGIONS];
+	uint8_t dirty_num;
 
 	graphic_buffer_t *buffers[CONFIG_SURFACE_MAX_BUFFER_COUNT];
 	uint8_t buf_count;
@@ -128,6 +128,20 @@ uint16_t view_cache_get_focus_view(void);
  */
 uint16_t view_cache_get_focus_main_view(void);
 
+/**
+ * @brief Get views adjacent to the focused view
+ *
+ * The adjacent views are the ones a single drag can bring into focus: the
+ * previous and next main views and the cross views of a focused main view,
+ * or the main view behind a focused cross view.
+ *
+ * @param views array to store the view ids
+ * @param max_num max number of view ids to store
+ *
+ * @retval number of view ids stored.
+ */
+int view_cache_get_adjacent_views(uint16_t *views, int max_num);
+
 /**
  * @brief Set focus to view
  *
@@ -102,6 +102,26 @@ const uint8_t * bitmap_font_get_bitmap_cb(const lv_font_t * lv_font, uint32_t un
 	return data;
 }
 
+int lvgl_bitmap_font_prefetch_text(const lv_font_t* lv_font, const char* txt)
+{
+	lv_font_fmt_bitmap_dsc_t* font_dsc;
+
+	if((lv_font == NULL) || (txt == NULL))
+	{
+		SYS_LOG_ERR("null prefetch param, %p, %p\n", lv_font, txt);
+		return -1;
+	}
+
+	font_dsc = (lv_font_fmt_bitmap_dsc_t*)lv_font->user_data;
+	if(font_dsc == NULL)
+	{
+		SYS_LOG_ERR("null bitmap font for font %p\n", lv_font);
+		return -1;
+	}
+
+	return bitmap_font_prefetch_string(font_dsc->font, font_dsc->cache, txt, strlen(txt));
+}
+
 int lvgl_bitmap_font_init(const char *def_font_path)
 {
 	bitmap_font_init();
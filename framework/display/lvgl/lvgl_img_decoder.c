@@ -202,9 +202,7 @@ static bool _is_jpeg(const void *data)
 {
 	const compress_pic_head_t *pic_head = (compress_pic_head_t *)data;
 
-	if (pic_head->magic != LZ4_PIC_MAGIC &&
-		pic_head->magic != RLE_PIC_MAGIC &&
-		pic_head->magic != RAW_PIC_MAGIC) {
+	if (!IS_COMPRESSED_PIC_MAGIC(pic_head->magic)) {
 		return true;
 	}
 
@@ -256,7 +254,7 @@ static int _img_decoder_decode(void * buf, uint32_t buf_size,
 				lv_area_get_width(area), lv_area_get_height(area));
 	} else { /* JPEG */
 #ifdef CONFIG_JPEG_HAL
-		len = jpg_decode((void *)src->data, (int)src->data_size, buf,
+		len = jpg_decode_sw_fallback((void *)src->data, (int)src->data_size, buf,
 				(LV_COLOR_DEPTH == 16) ? 1 : 0, lv_area_get_width(area),
 				area->x1, area->y1, lv_area_get_width(area), lv_area_get_height(area));
 #else
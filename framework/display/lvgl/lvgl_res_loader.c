@@ -8,9 +8,27 @@
 #include <ui_manager.h>
 #endif
 #include "res_mempool.h"
+#ifdef CONFIG_UI_SERVICE
+#include <view_cache.h>
+#endif
 
 #define RES_PRELOAD_STACKSIZE	1536
 
+//batch not preloaded for any view
+#define PRELOAD_VIEW_NONE			0xffff
+#define PRELOAD_MAX_ADJACENT_VIEWS	4
+
+//preload priority bands, lower runs first
+#define PRELOAD_BAND_FOCUS		0
+#define PRELOAD_BAND_ADJACENT	1
+#define PRELOAD_BAND_OTHER		2
+
+//bits of picture id filter used to skip duplicated pictures in one batch
+#define PRELOAD_ID_FILTER_SHIFT	9
+#define PRELOAD_ID_FILTER_BITS	(1 << PRELOAD_ID_FILTER_SHIFT)
+
+#define PRELOAD_STAT_NUM		8
+
 typedef enum
 {
 	PRELOAD_TYPE_IMMEDIATE,
@@ -32,6 +50,23 @@ typedef struct _preload_default_t
 	struct _preload_default_t* next;
 }preload_default_t;
 
+typedef struct
+{
+	preload_param_t* head;
+	preload_param_t* tail;
+	//a set bit means a picture with the same hashed id may be in list already
+	uint32_t id_filter[PRELOAD_ID_FILTER_BITS/32];
+}preload_sublist_t;
+
+typedef struct
+{
+	uint32_t scene_id;
+	uint32_t count;
+	uint32_t last_ms;
+	uint32_t max_ms;
+	uint32_t total_ms;
+}preload_stat_t;
+
 #ifdef CONFIG_RES_MANAGER_ENABLE_MEM_LEAK_DEBUG
 #define MAX_BITMAP_CHECKABLE	160
 #define MAX_STRING_CHECKABLE	64
@@ -67,8 +102,14 @@ static void _bitmap_mem_debug_enable(bool enable);
 static os_sem preload_sem;
 static os_mutex preload_mutex;
 static uint32_t preload_running = 1;
+//queued batches linked by batch_next, items of each batch linked by next
 static preload_param_t* param_list = NULL;
+static preload_param_t* param_batch_tail = NULL;
 static preload_param_t* sync_param_list = NULL;
+//counts compact buffer splits, pictures of a split scene are kept in order
+static uint32_t compact_split_count = 0;
+static preload_stat_t preload_stats[PRELOAD_STAT_NUM];
+static uint32_t preload_stat_victim = 0;
 
 static lvgl_res_scene_t current_scene;
 static lvgl_res_group_t current_group;
@@ -1621,90 +1662,173 @@ int lvgl_res_load_picregion(uint32_t group_id, uint32_t subgroup_id, uint32_t pi
 
 }
 
-static preload_param_t* _check_item_in_list(preload_param_t* sublist, resource_bitmap_t* bitmap)
+static void _sublist_init(preload_sublist_t* sublist)
+{
+	memset(sublist, 0, sizeof(preload_sublist_t));
+}
+
+static bool _sublist_has_bitmap(preload_sublist_t* sublist, resource_bitmap_t* bitmap)
 {
 	preload_param_t* item;
+	uint32_t id = bitmap->sty_data->id;
+	uint32_t bit = (id * 2654435761u) >> (32 - PRELOAD_ID_FILTER_SHIFT);
 
-	if(sublist == NULL)
+	if((sublist->id_filter[bit >> 5] & (1u << (bit & 0x1f))) == 0)
 	{
-		SYS_LOG_ERR("shouldnt happen");
-		return NULL;
+		//never seen, no need to walk the list
+		sublist->id_filter[bit >> 5] |= (1u << (bit & 0x1f));
+		return false;
 	}
-	else
+
+	item = sublist->head;
+	while(item != NULL)
 	{
-		item = sublist;
-		if(item->bitmap && item->bitmap->sty_data->id == bitmap->sty_data->id)
-		{
-			return NULL;
-		}
-		
-		while(item->next != NULL)
+		if(item->bitmap && item->bitmap->sty_data->id == id)
 		{
-			if(item->bitmap && item->bitmap->sty_data->id == bitmap->sty_data->id)
-			{
-				return NULL;
-			}
-			item = item->next;
+			return true;
 		}
-		
-		if(item->bitmap && item->bitmap->sty_data->id == bitmap->sty_data->id)
-		{
-			return NULL;
-		}	
-		//found tail		
-		return item;
+		item = item->next;
 	}
+
+	return false;
 }
 
-static void _add_item_to_list(preload_param_t** sublist, preload_param_t* param)
+static void _sublist_append(preload_sublist_t* sublist, preload_param_t* param)
 {
-	preload_param_t* item;
+	int32_t volume;
 
-	os_strace_u32x4(SYS_TRACE_ID_RES_PRELOAD_ADD, (uint32_t)param->scene_id, (uint32_t)*sublist, (uint32_t)param, (uint32_t)param->next);
+	os_strace_u32x4(SYS_TRACE_ID_RES_PRELOAD_ADD, (uint32_t)param->scene_id, (uint32_t)sublist->head, (uint32_t)param, (uint32_t)param->next);
 
-	if(*sublist == NULL)
+	param->next = NULL;
+	param->batch_next = NULL;
+	param->view_id = PRELOAD_VIEW_NONE;
+	param->file_pos = 0;
+	param->volume = 0;
+	if(param->bitmap && param->res_info)
 	{
-		*sublist = param;
+		volume = res_manager_get_bitmap_file_pos(param->res_info, param->bitmap, &param->file_pos);
+		param->volume = (volume < 0) ? 0xff : (uint8_t)volume;
+	}
+
+	if(sublist->tail == NULL)
+	{
+		sublist->head = param;
 	}
 	else
 	{
-		item = *sublist;
-		while(1)
+		sublist->tail->next = param;
+	}
+	sublist->tail = param;
+
+	os_strace_end_call_u32(SYS_TRACE_ID_RES_PRELOAD_ADD, (uint32_t)sublist->head);
+}
+
+static inline bool _preload_item_before(preload_param_t* a, preload_param_t* b)
+{
+	if(a->volume != b->volume)
+	{
+		return a->volume < b->volume;
+	}
+	return a->file_pos <= b->file_pos;
+}
+
+//sort pictures after the first item by picture file position, so reads go forward through the file
+static void _sublist_sort_by_file_pos(preload_sublist_t* sublist)
+{
+	preload_param_t* list;
+	preload_param_t* p;
+	preload_param_t* q;
+	preload_param_t* e;
+	preload_param_t* tail;
+	uint32_t insize = 1;
+	uint32_t nmerges, psize, qsize, i;
+
+	if(sublist->head == NULL || sublist->head->next == NULL)
+	{
+		return;
+	}
+
+	//bottom-up merge sort, stable so pictures at the same position keep their order
+	list = sublist->head->next;
+	while(1)
+	{
+		p = list;
+		list = NULL;
+		tail = NULL;
+		nmerges = 0;
+
+		while(p)
 		{
-			if(item->next == NULL)
+			nmerges++;
+			q = p;
+			psize = 0;
+			for(i=0; i<insize && q; i++)
 			{
-				item->next = param;
-				break;
+				psize++;
+				q = q->next;
 			}
-			item = item->next;
+			qsize = insize;
+
+			while(psize > 0 || (qsize > 0 && q))
+			{
+				if(psize == 0)
+				{
+					e = q; q = q->next; qsize--;
+				}
+				else if(qsize == 0 || !q || _preload_item_before(p, q))
+				{
+					e = p; p = p->next; psize--;
+				}
+				else
+				{
+					e = q; q = q->next; qsize--;
+				}
+
+				if(tail)
+				{
+					tail->next = e;
+				}
+				else
+				{
+					list = e;
+				}
+				tail = e;
+			}
+			p = q;
+		}
+		tail->next = NULL;
+
+		if(nmerges <= 1)
+		{
+			break;
 		}
+		insize *= 2;
 	}
-	os_strace_end_call_u32(SYS_TRACE_ID_RES_PRELOAD_ADD, (uint32_t)param_list);
+
+	sublist->head->next = list;
+	sublist->tail = tail;
 }
 
-static void _add_item_to_preload_list(preload_param_t* param)
+static void _add_item_to_preload_list(preload_param_t* head, preload_param_t* tail, uint16_t view_id)
 {
-	preload_param_t* item;
 	os_mutex_lock(&preload_mutex, OS_FOREVER);
-	os_strace_u32x4(SYS_TRACE_ID_RES_PRELOAD_ADD, (uint32_t)param->scene_id, (uint32_t)param_list, (uint32_t)param, (uint32_t)param->next);
+	os_strace_u32x4(SYS_TRACE_ID_RES_PRELOAD_ADD, (uint32_t)head->scene_id, (uint32_t)param_list, (uint32_t)head, (uint32_t)head->next);
+
+	//each call queues one batch, the thread picks batches by priority
+	head->batch_next = NULL;
+	head->view_id = view_id;
+	tail->queue_time = os_uptime_get_32();
+
 	if(param_list == NULL)
 	{
-		param_list = param;
+		param_list = head;
 		os_sem_give(&preload_sem);
 	}
 	else
 	{
-		item = param_list;
-		while(1)
-		{
-			if(item->next == NULL)
-			{
-				item->next = param;
-				break;
-			}
-			item = item->next;
-		}
+		param_batch_tail->batch_next = head;
 	}
+	param_batch_tail = head;
 
 	os_strace_end_call_u32(SYS_TRACE_ID_RES_PRELOAD_ADD, (uint32_t)param_list);
 	os_mutex_unlock(&preload_mutex);
@@ -1733,86 +1857,100 @@ static void _add_item_to_loading_list(preload_param_t* param)
 	}
 }
 
+static void _free_preload_item(preload_param_t* item)
+{
+	if(item->preload_type == PRELOAD_TYPE_END_CALLBACK)
+	{
+		if(item->scene_id > 0)
+		{
+			res_manager_unload_scene(item->scene_id, NULL);
+		}
+		if (item->callback)
+			item->callback(LVGL_RES_PRELOAD_STATUS_CANCELED, item->param);
+	}
+	else
+	{
+		res_manager_free_resource_structure(item->bitmap);
+	}
+	memset(item, 0, sizeof(preload_param_t));
+	res_array_free(item);
+}
+
 void _clear_preload_list(uint32_t scene_id)
 {
+	preload_param_t* batch;
+	preload_param_t* next_batch;
+	preload_param_t* prev_batch;
 	preload_param_t* item;
-	preload_param_t* prev;
-	preload_param_t* found;
+	preload_param_t* next;
+	preload_param_t* head;
+	preload_param_t* tail;
+	uint16_t view_id;
+
 	os_mutex_lock(&preload_mutex, OS_FOREVER);
 	os_strace_u32x2(SYS_TRACE_ID_RES_PRELOAD_CANCEL, (uint32_t)scene_id, (uint32_t)param_list);
 
-	if(param_list == NULL)
+	batch = param_list;
+	prev_batch = NULL;
+	while(batch != NULL)
 	{
-		os_strace_end_call_u32(SYS_TRACE_ID_RES_PRELOAD_CANCEL, (uint32_t)param_list);
-		os_mutex_unlock(&preload_mutex);
-		return;
-	}
+		next_batch = batch->batch_next;
+		view_id = batch->view_id;
+		head = NULL;
+		tail = NULL;
 
-	item = param_list;
-	prev = NULL;
-	if(scene_id == 0)
-	{
+		item = batch;
 		while(item != NULL)
 		{
-			param_list = item->next;
-			if(item->preload_type == PRELOAD_TYPE_END_CALLBACK)
+			next = item->next;
+			if(scene_id == 0 || item->scene_id == scene_id)
 			{
-				if(item->scene_id > 0)
-				{
-					res_manager_unload_scene(item->scene_id, NULL);
-				}			
-				if (item->callback)
-					item->callback(LVGL_RES_PRELOAD_STATUS_CANCELED, item->param);
+				_free_preload_item(item);
 			}
 			else
 			{
-				res_manager_free_resource_structure(item->bitmap);
-			}
-			memset(item, 0, sizeof(preload_param_t));
-			res_array_free(item);
-			item = param_list;
-		}
-	}
-	else
-	{
-		while(item != NULL)
-		{
-			if(item->scene_id == scene_id)
-			{
-				if(item->preload_type == PRELOAD_TYPE_END_CALLBACK)
+				item->next = NULL;
+				if(tail)
 				{
-					if(item->scene_id > 0)
-					{
-						res_manager_unload_scene(item->scene_id, NULL);
-					}
-					if (item->callback)
-						item->callback(LVGL_RES_PRELOAD_STATUS_CANCELED, item->param);
+					tail->next = item;
 				}
 				else
 				{
-					res_manager_free_resource_structure(item->bitmap);
-				}				
-
-				if(param_list == item)
-				{
-					param_list = item->next;
-				}
-				if(prev != NULL)
-				{
-					prev->next = item->next;
+					head = item;
 				}
-				found = item;
-				item = item->next;
-				memset(found, 0, sizeof(preload_param_t));
-				res_array_free(found);
+				tail = item;
+			}
+			item = next;
+		}
+
+		if(head != NULL)
+		{
+			//relink what is left of this batch
+			head->batch_next = next_batch;
+			head->view_id = view_id;
+			if(prev_batch)
+			{
+				prev_batch->batch_next = head;
 			}
 			else
 			{
-				prev = item;
-				item = item->next;
+				param_list = head;
 			}
+			prev_batch = head;
 		}
+		batch = next_batch;
 	}
+
+	if(prev_batch == NULL)
+	{
+		param_list = NULL;
+	}
+	else
+	{
+		prev_batch->batch_next = NULL;
+	}
+	param_batch_tail = prev_batch;
+
 	os_strace_end_call_u32(SYS_TRACE_ID_RES_PRELOAD_CANCEL, (uint32_t)param_list);
 	os_mutex_unlock(&preload_mutex);
 }
@@ -1871,7 +2009,7 @@ int lvgl_res_preload_pictures_from_scene(uint32_t scene_id, lvgl_res_scene_t* sc
 		param->next = NULL;
 		param->res_info = scene->res_info;
 
-		_add_item_to_preload_list(param);
+		_add_item_to_preload_list(param, param, PRELOAD_VIEW_NONE);
 	}
 
 	os_strace_end_call_u32(SYS_TRACE_ID_RES_PICS_PRELOAD, (uint32_t)scene->scene_data);
@@ -1923,7 +2061,7 @@ int lvgl_res_preload_pictures_from_group(uint32_t scene_id, lvgl_res_group_t* gr
 		param->next = NULL;
 		param->res_info = group->res_info;
 
-		_add_item_to_preload_list(param);
+		_add_item_to_preload_list(param, param, PRELOAD_VIEW_NONE);
 	}
 	os_strace_end_call_u32(SYS_TRACE_ID_RES_PICS_PRELOAD, (uint32_t)group->group_data);
 
@@ -1977,7 +2115,7 @@ int lvgl_res_preload_pictures_from_picregion(uint32_t scene_id, lvgl_res_picregi
 		param->next = NULL;
 		param->res_info = picreg->res_info;
 
-		_add_item_to_preload_list(param);
+		_add_item_to_preload_list(param, param, PRELOAD_VIEW_NONE);
 	}
 
 	os_strace_end_call_u32(SYS_TRACE_ID_RES_PICS_PRELOAD, (uint32_t)picreg->picreg_data);
@@ -1986,30 +2124,156 @@ int lvgl_res_preload_pictures_from_picregion(uint32_t scene_id, lvgl_res_picregi
 }
 
 #ifndef CONFIG_RES_MANAGER_SKIP_PRELOAD
+static uint32_t _preload_batch_band(preload_param_t* batch, uint16_t focus_view, const uint16_t* adj_views, int adj_num)
+{
+	int i;
+
+	if(batch->view_id == PRELOAD_VIEW_NONE)
+	{
+		return PRELOAD_BAND_OTHER;
+	}
+
+	if(batch->view_id == focus_view)
+	{
+		return PRELOAD_BAND_FOCUS;
+	}
+
+	for(i=0; i<adj_num; i++)
+	{
+		if(batch->view_id == adj_views[i])
+		{
+			return PRELOAD_BAND_ADJACENT;
+		}
+	}
+
+	return PRELOAD_BAND_OTHER;
+}
+
+//pop the first item of the most urgent batch, batches of the same band run in queue order
+static preload_param_t* _pop_preload_item(uint16_t focus_view, const uint16_t* adj_views, int adj_num)
+{
+	preload_param_t* batch;
+	preload_param_t* prev;
+	preload_param_t* best = NULL;
+	preload_param_t* best_prev = NULL;
+	preload_param_t* next;
+	uint32_t best_band = PRELOAD_BAND_OTHER + 1;
+	uint32_t band;
+
+	prev = NULL;
+	batch = param_list;
+	while(batch != NULL)
+	{
+		band = _preload_batch_band(batch, focus_view, adj_views, adj_num);
+		if(band < best_band)
+		{
+			best = batch;
+			best_prev = prev;
+			best_band = band;
+			if(band == PRELOAD_BAND_FOCUS)
+			{
+				break;
+			}
+		}
+		prev = batch;
+		batch = batch->batch_next;
+	}
+
+	if(best == NULL)
+	{
+		return NULL;
+	}
+
+	next = best->next;
+	if(next != NULL)
+	{
+		//the rest of the batch keeps its place in queue
+		next->batch_next = best->batch_next;
+		next->view_id = best->view_id;
+	}
+	else
+	{
+		next = best->batch_next;
+	}
+
+	if(best_prev)
+	{
+		best_prev->batch_next = next;
+	}
+	else
+	{
+		param_list = next;
+	}
+
+	if(param_batch_tail == best)
+	{
+		param_batch_tail = (best->next != NULL) ? best->next : best_prev;
+	}
+
+	best->next = NULL;
+	best->batch_next = NULL;
+	return best;
+}
+
+static void _preload_stat_update(uint32_t scene_id, uint32_t elapsed)
+{
+	preload_stat_t* stat = NULL;
+	int i;
+
+	for(i=0; i<PRELOAD_STAT_NUM; i++)
+	{
+		if(preload_stats[i].scene_id == scene_id)
+		{
+			stat = &preload_stats[i];
+			break;
+		}
+	}
+
+	if(stat == NULL)
+	{
+		stat = &preload_stats[preload_stat_victim];
+		preload_stat_victim = (preload_stat_victim + 1) % PRELOAD_STAT_NUM;
+		memset(stat, 0, sizeof(preload_stat_t));
+		stat->scene_id = scene_id;
+	}
+
+	stat->count++;
+	stat->last_ms = elapsed;
+	stat->total_ms += elapsed;
+	if(elapsed > stat->max_ms)
+	{
+		stat->max_ms = elapsed;
+	}
+}
+
 static void _res_preload_thread(void *parama1, void *parama2, void *parama3)
 {
 	preload_param_t* param_item;
 	int32_t ret = 0;
+	uint16_t focus_view = PRELOAD_VIEW_NONE;
+	uint16_t adj_views[PRELOAD_MAX_ADJACENT_VIEWS];
+	int adj_num = 0;
 
 	while(preload_running)
 	{
+#ifdef CONFIG_UI_SERVICE
+		//snapshot view focus before taking preload_mutex, view cache may preload while holding its own lock
+		focus_view = view_cache_get_focus_view();
+		adj_num = view_cache_get_adjacent_views(adj_views, PRELOAD_MAX_ADJACENT_VIEWS);
+#endif
+
 		os_mutex_lock(&preload_mutex, OS_FOREVER);
 		
 		if(param_list == NULL)
 		{
 			os_mutex_unlock(&preload_mutex);
 			os_sem_take(&preload_sem, OS_FOREVER);
-			os_mutex_lock(&preload_mutex, OS_FOREVER);
-		}
-
-		if(param_list == NULL)
-		{
-			os_mutex_unlock(&preload_mutex);
+			//focus may have moved while waiting
 			continue;
 		}
+
 		os_strace_u32x2(SYS_TRACE_ID_RES_SCENE_PRELOAD_0, (uint32_t)param_list, (uint32_t)param_list->next);
-		param_item = param_list;
-		param_list = param_item->next;
+		param_item = _pop_preload_item(focus_view, adj_views, adj_num);
 		
 
 		if(preload_running == 2)
@@ -2039,6 +2303,7 @@ static void _res_preload_thread(void *parama1, void *parama2, void *parama3)
 		{
 			//user callback ,add at the end of preloaded pics to inform user about preload finish
 			//res_manager_preload_finish_check(param_item->scene_id);
+			_preload_stat_update(param_item->scene_id, os_uptime_get_32() - param_item->queue_time);
 
 			if (param_item->callback)
 				param_item->callback(LVGL_RES_PRELOAD_STATUS_FINISHED, param_item->param);
@@ -2061,13 +2326,42 @@ static void _res_preload_thread(void *parama1, void *parama2, void *parama3)
 
 void _dump_preload_list(void)
 {
-	preload_param_t* item = param_list;
+	preload_param_t* batch = param_list;
+	preload_param_t* item;
 
-	while(item)
+	while(batch)
+	{
+		printf("preload batch view %d\n", batch->view_id);
+		item = batch;
+		while(item)
+		{
+			printf("preload item scene 0x%x, type %d\n", item->scene_id, item->preload_type);
+			item=item->next;
+		}
+		batch = batch->batch_next;
+	}
+}
+
+void lvgl_res_preload_dump_stats(void)
+{
+#ifndef CONFIG_RES_MANAGER_SKIP_PRELOAD
+	int i;
+
+	os_mutex_lock(&preload_mutex, OS_FOREVER);
+	for(i=0; i<PRELOAD_STAT_NUM; i++)
 	{
-		printf("preload item scene 0x%x, type %d\n", item->scene_id, item->preload_type);
-		item=item->next;
+		preload_stat_t* stat = &preload_stats[i];
+
+		if(stat->count == 0)
+		{
+			continue;
+		}
+
+		printf("preload scene 0x%x: count %u, last %u ms, max %u ms, avg %u ms\n", stat->scene_id,
+			stat->count, stat->last_ms, stat->max_ms, stat->total_ms / stat->count);
 	}
+	os_mutex_unlock(&preload_mutex);
+#endif
 }
 
 int lvgl_res_preload_cancel(void)
@@ -2089,11 +2383,10 @@ int lvgl_res_preload_cancel_scene(uint32_t scene_id)
 	return 0;
 }
 
-int _res_preload_pictures_from_picregion(uint32_t scene_id, lvgl_res_picregion_t* picreg, uint32_t start, uint32_t end, preload_param_t** sublist)
+int _res_preload_pictures_from_picregion(uint32_t scene_id, lvgl_res_picregion_t* picreg, uint32_t start, uint32_t end, preload_sublist_t* sublist)
 {
 	int32_t i;
 	preload_param_t* param;
-	preload_param_t* tail;
 	resource_bitmap_t* bitmap;
 	int preload_count = 0;
 
@@ -2112,10 +2405,9 @@ int _res_preload_pictures_from_picregion(uint32_t scene_id, lvgl_res_picregion_t
 			SYS_LOG_ERR("preload %d bitmap error", i);
 			continue;
 		}
-		tail = _check_item_in_list(*sublist, bitmap);
-		if(tail == NULL)
+		if(_sublist_has_bitmap(sublist, bitmap))
 		{
-			//already in sublist, FIXME:only checked sublist for performance
+			//already in sublist
 			res_manager_release_resource(bitmap);
 			continue;
 		}
@@ -2140,7 +2432,7 @@ int _res_preload_pictures_from_picregion(uint32_t scene_id, lvgl_res_picregion_t
 		param->next = NULL;
 		param->res_info = picreg->res_info;
 
-		tail->next = param;	
+		_sublist_append(sublist, param);
 		preload_count++;
 	}
 
@@ -2166,6 +2458,7 @@ void _add_preload_total_size(uint32_t scene_id, uint32_t* ptotal_size, uint32_t
 	{
 		//split block
 		SYS_LOG_INF("\n ###  scene 0x%x, split total_size %d\n", scene_id, total_size);
+		compact_split_count++;
 		if(total_size > 0)
 		{
 			res_manager_init_compact_buffer(scene_id, total_size);
@@ -2193,10 +2486,9 @@ void _add_preload_total_size(uint32_t scene_id, uint32_t* ptotal_size, uint32_t
 }
 
 
-int _res_preload_group_compact(resource_info_t* info, uint32_t scene_id, uint32_t pargroup_id, resource_group_t* group, uint32_t* ptotal_size, uint32_t preload, preload_param_t** sublist)
+int _res_preload_group_compact(resource_info_t* info, uint32_t scene_id, uint32_t pargroup_id, resource_group_t* group, uint32_t* ptotal_size, uint32_t preload, preload_sublist_t* sublist)
 {
 	preload_param_t* param;
-	preload_param_t* tail;
 	resource_group_t* res_group;
 	resource_bitmap_t* bitmap;
 	lvgl_res_picregion_t picreg;
@@ -2269,10 +2561,9 @@ int _res_preload_group_compact(resource_info_t* info, uint32_t scene_id, uint32_
 			break;
 		case RESOURCE_TYPE_PICTURE:
 			bitmap = (resource_bitmap_t*)resource;
-			tail = _check_item_in_list(*sublist, bitmap);
-			if(tail == NULL)
+			if(_sublist_has_bitmap(sublist, bitmap))
 			{
-				//already in sublist, FIXME:only checked sublist for performance
+				//already in sublist
 				res_manager_release_resource(resource);
 				continue;
 			}
@@ -2314,7 +2605,7 @@ int _res_preload_group_compact(resource_info_t* info, uint32_t scene_id, uint32_
 				param->next = NULL;
 				param->res_info = info;
 
-				_add_item_to_list(sublist, param);
+				_sublist_append(sublist, param);
 			}
 			break;
 		default:
@@ -2332,8 +2623,7 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 {
 	resource_info_t* info;
 	preload_param_t* param;
-	preload_param_t* sublist;
-	preload_param_t* tail;
+	preload_sublist_t sublist;
 	resource_bitmap_t* bitmap;
 	resource_scene_t* res_scene;
 	resource_group_t* res_group;
@@ -2345,6 +2635,13 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 	uint32_t inc_size = 0;
 	uint32_t buf_block_struct_size = res_manager_get_bitmap_buf_block_unit_size();
 	int picreg_count = 0;
+	uint32_t split_mark = compact_split_count;
+	uint16_t view_id = PRELOAD_VIEW_NONE;
+
+	if(callback == lvgl_res_scene_preload_default_cb_for_view)
+	{
+		view_id = (uint16_t)(uint32_t)user_data;
+	}
 
 	info = _res_file_open(style_path, picture_path, text_path, 0, 1);
 	if(info == NULL)
@@ -2361,7 +2658,7 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 	}
 	os_strace_end_call_u32(SYS_TRACE_ID_RES_SCENE_PRELOAD_1, (uint32_t)scene_id);
 	os_strace_u32(SYS_TRACE_ID_RES_SCENE_PRELOAD_3, (uint32_t)scene_id);	
-	sublist = NULL;
+	_sublist_init(&sublist);
 	param = (preload_param_t*)res_array_alloc(RES_MEM_SIMPLE_PRELOAD, sizeof(preload_param_t));
 	if(param == NULL)
 	{
@@ -2375,7 +2672,7 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 	param->preload_type = PRELOAD_TYPE_BEGIN_CALLBACK;
 	param->next = NULL;
 	param->res_info = NULL;
-	_add_item_to_list(&sublist, param);
+	_sublist_append(&sublist, param);
 
 	//preload group, be sure that scene compact buffer is inited already
 	if(resource_id != NULL)
@@ -2416,10 +2713,9 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 				break;
 			case RESOURCE_TYPE_PICTURE:
 				bitmap = (resource_bitmap_t*)resource;
-				tail = _check_item_in_list(sublist, bitmap);
-				if(tail == NULL)
+				if(_sublist_has_bitmap(&sublist, bitmap))
 				{
-					//already in sublist, FIXME:only checked sublist for performance
+					//already in sublist
 					res_manager_release_resource(resource);
 					continue;
 				}				
@@ -2451,7 +2747,7 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 				param->next = NULL;
 				param->res_info = info;
 
-				tail->next = param;
+				_sublist_append(&sublist, param);
 				break;
 			default:
 				break;
@@ -2471,7 +2767,13 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 		param->preload_type = PRELOAD_TYPE_END_CALLBACK;
 		param->next = NULL;
 
-		_add_item_to_list(&sublist, param);
+		if(compact_split_count == split_mark)
+		{
+			//all pictures share one compact block, so any read order fits
+			_sublist_sort_by_file_pos(&sublist);
+		}
+
+		_sublist_append(&sublist, param);
 
 		if(total_size > 0)
 		{
@@ -2485,11 +2787,11 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 		
 		if(async_preload)
 		{
-			_add_item_to_preload_list(sublist);		
+			_add_item_to_preload_list(sublist.head, sublist.tail, view_id);
 		}
 		else
 		{
-			_add_item_to_loading_list(sublist);
+			_add_item_to_loading_list(sublist.head);
 		}
 		
 //		_dump_sram_usage();
@@ -2545,10 +2847,9 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 			break;
 		case RESOURCE_TYPE_PICTURE:
 			bitmap = (resource_bitmap_t*)resource;
-			tail = _check_item_in_list(sublist, bitmap);
-			if(tail == NULL)
+			if(_sublist_has_bitmap(&sublist, bitmap))
 			{
-				//already in sublist, FIXME:only checked sublist for performance
+				//already in sublist
 				res_manager_release_resource(resource);
 				continue;
 			}			
@@ -2581,7 +2882,7 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 			param->next = NULL;
 			param->res_info = info;
 
-			tail->next = param;
+			_sublist_append(&sublist, param);
 			break;
 		default:
 			//ignore text resource
@@ -2602,7 +2903,12 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 	param->scene_id = scene_id;
 	param->preload_type = PRELOAD_TYPE_END_CALLBACK;
 	param->next = NULL;
-	_add_item_to_list(&sublist, param);
+
+	if(compact_split_count == split_mark)
+	{
+		_sublist_sort_by_file_pos(&sublist);
+	}
+	_sublist_append(&sublist, param);
 
 	if(total_size > 0)
 	{
@@ -2616,11 +2922,11 @@ int _res_preload_scene_compact(uint32_t scene_id, const uint32_t* resource_id, u
 	
 	if(async_preload)
 	{
-		_add_item_to_preload_list(sublist); 	
+		_add_item_to_preload_list(sublist.head, sublist.tail, view_id);
 	}
 	else
 	{
-		_add_item_to_loading_list(sublist);
+		_add_item_to_loading_list(sublist.head);
 	}
 //	_dump_sram_usage();
 	os_strace_end_call_u32(SYS_TRACE_ID_RES_SCENE_PRELOAD_3, (uint32_t)scene_id);
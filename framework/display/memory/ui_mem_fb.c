@@ -14,6 +14,7 @@
 #include <os_common_api.h>
 #include <ui_mem.h>
 #include <ui_math.h>
+#include <string.h>
 #ifdef CONFIG_UI_MEMORY_DEBUG
 #  include <mem_guard.h>
 #endif
@@ -45,10 +46,47 @@ LOG_MODULE_DECLARE(ui_mem, LOG_LEVEL_INF);
 #endif
 
 #define UI_MEM_SIZE         (CONFIG_UI_MEM_NUMBER_BLOCKS * UI_MEM_BLOCK_SIZE)
+#define UI_MEM_INVALID_BLK  0xFF
+
+/* free extents are indexed by their length in blocks (1 ~ 255) */
+#define UI_MEM_FREE_MAP_WORDS  ((CONFIG_UI_MEM_NUMBER_BLOCKS + 32) / 32)
+
+/* buckets of the free extent histogram: 1, 2~3, 4~7, ..., 128~255 blocks */
+#define UI_MEM_FREE_HIST_NUM  8
+
+#ifndef CONFIG_UI_MEM_FB_ALLOC_TIMEOUT
+#  define CONFIG_UI_MEM_FB_ALLOC_TIMEOUT 60
+#endif
+
+struct ui_mem_fb_waiter {
+	struct ui_mem_fb_waiter *next;
+	os_sem sem;
+	uint8_t nbr_blks;
+};
 
 static uint8_t __aligned(UI_MEM_BLOCK_ALIGN) ui_mem_base[UI_MEM_SIZE] __in_section_unique(UI_PSRAM_REGION);
 /* store the allocated continuous block counts (max 255) from the index */
 static uint8_t alloc_count[CONFIG_UI_MEM_NUMBER_BLOCKS];
+/* store the free continuous block counts at the first block of a free extent */
+static uint8_t free_count[CONFIG_UI_MEM_NUMBER_BLOCKS];
+/* store the first block index at the last block of a free extent */
+static uint8_t free_first[CONFIG_UI_MEM_NUMBER_BLOCKS];
+/* link the free extents of the same length */
+static uint8_t free_next[CONFIG_UI_MEM_NUMBER_BLOCKS];
+static uint8_t free_prev[CONFIG_UI_MEM_NUMBER_BLOCKS];
+/* first free extent of each length, and the bitmap of non-empty lengths */
+static uint8_t free_head[CONFIG_UI_MEM_NUMBER_BLOCKS + 1];
+static uint32_t free_map[UI_MEM_FREE_MAP_WORDS];
+static bool free_index_inited;
+
+/* allocators blocked until enough blocks are freed */
+static struct ui_mem_fb_waiter *wait_list;
+
+static uint8_t free_blks_total;
+static uint8_t min_free_blks;
+static uint32_t wait_cnt;
+static uint32_t max_wait_time;
+static uint32_t fail_cnt;
 
 #ifndef CONFIG_SIMULATOR
 static struct k_spinlock alloc_spinlock;
@@ -56,11 +94,210 @@ static struct k_spinlock alloc_spinlock;
 static OS_MUTEX_DEFINE(alloc_mutex);
 #endif
 
-static void *ui_mem_fb_alloc_internal(size_t size)
+static inline uint8_t _find_lsb(uint32_t bits)
+{
+	uint8_t n = 0;
+
+	while ((bits & 0x1) == 0) {
+		bits >>= 1;
+		n++;
+	}
+
+	return n;
+}
+
+static inline uint8_t _find_msb(uint32_t bits)
+{
+	uint8_t n = 31;
+
+	while ((bits & 0x80000000) == 0) {
+		bits <<= 1;
+		n--;
+	}
+
+	return n;
+}
+
+static void _free_extent_insert(uint8_t first, uint8_t len)
+{
+	uint8_t head = free_head[len];
+
+	free_count[first] = len;
+	free_first[first + len - 1] = first;
+	free_prev[first] = UI_MEM_INVALID_BLK;
+	free_next[first] = head;
+
+	if (head != UI_MEM_INVALID_BLK) {
+		free_prev[head] = first;
+	} else {
+		free_map[len / 32] |= BIT(len % 32);
+	}
+
+	free_head[len] = first;
+}
+
+static void _free_extent_remove(uint8_t first)
+{
+	uint8_t len = free_count[first];
+	uint8_t prev = free_prev[first];
+	uint8_t next = free_next[first];
+
+	if (prev != UI_MEM_INVALID_BLK) {
+		free_next[prev] = next;
+	} else {
+		free_head[len] = next;
+		if (next == UI_MEM_INVALID_BLK) {
+			free_map[len / 32] &= ~BIT(len % 32);
+		}
+	}
+
+	if (next != UI_MEM_INVALID_BLK) {
+		free_prev[next] = prev;
+	}
+
+	free_count[first] = 0;
+}
+
+/* return the length of the smallest free extent that has at least nbr_blks blocks */
+static uint8_t _free_extent_best_fit(uint8_t nbr_blks)
+{
+	int i = nbr_blks / 32;
+	uint32_t bits = free_map[i] & ~(BIT(nbr_blks % 32) - 1);
+
+	while (bits == 0) {
+		if (++i >= UI_MEM_FREE_MAP_WORDS) {
+			return 0;
+		}
+
+		bits = free_map[i];
+	}
+
+	return i * 32 + _find_lsb(bits);
+}
+
+static uint8_t _free_extent_largest(void)
+{
+	for (int i = UI_MEM_FREE_MAP_WORDS - 1; i >= 0; i--) {
+		if (free_map[i]) {
+			return i * 32 + _find_msb(free_map[i]);
+		}
+	}
+
+	return 0;
+}
+
+static void _free_index_init(void)
+{
+	memset(free_head, UI_MEM_INVALID_BLK, sizeof(free_head));
+
+	_free_extent_insert(0, CONFIG_UI_MEM_NUMBER_BLOCKS);
+	free_blks_total = CONFIG_UI_MEM_NUMBER_BLOCKS;
+	min_free_blks = CONFIG_UI_MEM_NUMBER_BLOCKS;
+	free_index_inited = true;
+}
+
+static void *_fb_alloc_blocks(uint8_t nbr_blks)
+{
+	uint8_t len;
+	uint8_t first;
+
+	if (!free_index_inited) {
+		_free_index_init();
+	}
+
+	len = _free_extent_best_fit(nbr_blks);
+	if (len == 0) {
+		return NULL;
+	}
+
+	/* take the front of the extent, and put back the remaining blocks */
+	first = free_head[len];
+	_free_extent_remove(first);
+	if (len > nbr_blks) {
+		_free_extent_insert(first + nbr_blks, len - nbr_blks);
+	}
+
+	alloc_count[first] = nbr_blks;
+
+	free_blks_total -= nbr_blks;
+	if (min_free_blks > free_blks_total) {
+		min_free_blks = free_blks_total;
+	}
+
+	return ui_mem_base + first * UI_MEM_BLOCK_SIZE;
+}
+
+static void _fb_free_blocks(uint8_t first)
+{
+	uint8_t len = alloc_count[first];
+	uint8_t last = first + len - 1;
+	uint8_t largest;
+	struct ui_mem_fb_waiter **link;
+
+	alloc_count[first] = 0;
+	free_blks_total += len;
+
+	/* merge with the neighbouring free extents */
+	if (last + 1 < CONFIG_UI_MEM_NUMBER_BLOCKS && free_count[last + 1] > 0) {
+		len += free_count[last + 1];
+		_free_extent_remove(last + 1);
+	}
+
+	if (first > 0) {
+		uint8_t prev_first = free_first[first - 1];
+
+		if (free_count[prev_first] > 0 &&
+			prev_first + free_count[prev_first] == first) {
+			len += free_count[prev_first];
+			_free_extent_remove(prev_first);
+			first = prev_first;
+		}
+	}
+
+	_free_extent_insert(first, len);
+
+	if (wait_list == NULL) {
+		return;
+	}
+
+	/* wake up the waiters that can be satisfied now */
+	largest = _free_extent_largest();
+	link = &wait_list;
+
+	while (*link) {
+		struct ui_mem_fb_waiter *waiter = *link;
+
+		if (waiter->nbr_blks <= largest) {
+			*link = waiter->next;
+			os_sem_give(&waiter->sem);
+		} else {
+			link = &waiter->next;
+		}
+	}
+}
+
+static void _fb_waiter_remove(struct ui_mem_fb_waiter *waiter)
 {
+	struct ui_mem_fb_waiter **link = &wait_list;
+
+	while (*link) {
+		if (*link == waiter) {
+			*link = waiter->next;
+			break;
+		}
+
+		link = &(*link)->next;
+	}
+}
+
+void *ui_mem_fb_alloc(size_t size)
+{
+	struct ui_mem_fb_waiter waiter;
+	uint32_t start_time = 0;
+	bool waited = false;
+	int32_t timeout = CONFIG_UI_MEM_FB_ALLOC_TIMEOUT;
 	uint8_t nbr_blks = 1;
-	uint8_t free_blks = 0;
-	uint8_t first_blk = 0;
+	void *ptr = NULL;
 
 #ifndef CONFIG_SIMULATOR
 	k_spinlock_key_t key;
@@ -71,64 +308,66 @@ static void *ui_mem_fb_alloc_internal(size_t size)
 	}
 
 	if (size > UI_MEM_BLOCK_SIZE) {
-		nbr_blks = (size + UI_MEM_BLOCK_SIZE - 1) / UI_MEM_BLOCK_SIZE;
-		if (nbr_blks > CONFIG_UI_MEM_NUMBER_BLOCKS) {
+		if ((size + UI_MEM_BLOCK_SIZE - 1) / UI_MEM_BLOCK_SIZE > CONFIG_UI_MEM_NUMBER_BLOCKS) {
 			return NULL;
 		}
+
+		nbr_blks = (size + UI_MEM_BLOCK_SIZE - 1) / UI_MEM_BLOCK_SIZE;
 	}
 
+	waiter.nbr_blks = nbr_blks;
+
+	do {
 #ifndef CONFIG_SIMULATOR
-	key = k_spin_lock(&alloc_spinlock);
+		key = k_spin_lock(&alloc_spinlock);
 #else
-	os_mutex_lock(&alloc_mutex, OS_FOREVER);
+		os_mutex_lock(&alloc_mutex, OS_FOREVER);
 #endif
 
-	for (int i = 0; i < CONFIG_UI_MEM_NUMBER_BLOCKS;) {
-		if (alloc_count[i] == 0) {
-			if (free_blks == 0) {
-				first_blk = i;
+		if (waited) {
+			/* not woken up by the free which removes it from the list */
+			_fb_waiter_remove(&waiter);
+		}
+
+		ptr = _fb_alloc_blocks(nbr_blks);
+		if (ptr == NULL && timeout > 0) {
+			if (!waited) {
+				start_time = os_uptime_get_32();
+				waited = true;
+				wait_cnt++;
 			}
 
-			if (++free_blks == nbr_blks) {
-				alloc_count[first_blk] = nbr_blks;
-				break;
+			os_sem_init(&waiter.sem, 0, 1);
+			waiter.next = wait_list;
+			wait_list = &waiter;
+		} else if (waited || ptr == NULL) {
+			/* the last round, update the statistics under the lock */
+			uint32_t wait_time = waited ? os_uptime_get_32() - start_time : 0;
+
+			if (max_wait_time < wait_time) {
+				max_wait_time = wait_time;
 			}
 
-			i++;
-		} else {
-			free_blks = 0;
-			i += alloc_count[i];
-			if (i + nbr_blks > CONFIG_UI_MEM_NUMBER_BLOCKS) {
-				break;
+			if (ptr == NULL) {
+				fail_cnt++;
 			}
 		}
-	}
 
 #ifndef CONFIG_SIMULATOR
-	k_spin_unlock(&alloc_spinlock, key);
+		k_spin_unlock(&alloc_spinlock, key);
 #else
-	os_mutex_unlock(&alloc_mutex);
+		os_mutex_unlock(&alloc_mutex);
 #endif
 
-	if (free_blks == nbr_blks) {
-		return ui_mem_base + first_blk * UI_MEM_BLOCK_SIZE;
-	}
-
-	return NULL;
-}
-
-void *ui_mem_fb_alloc(size_t size)
-{
-	void *ptr = NULL;
-	int try = 30;
-
-	do {
-		ptr = ui_mem_fb_alloc_internal(size);
-		if (ptr)
+		if (ptr || timeout <= 0) {
 			break;
+		}
+
+		/* block until a free makes a large enough extent, instead of polling */
+		os_sem_take(&waiter.sem, timeout);
 
-		os_sleep(2);
-	} while (--try > 0);
+		timeout = CONFIG_UI_MEM_FB_ALLOC_TIMEOUT - (int32_t)(os_uptime_get_32() - start_time);
+	} while (1);
 
 	return ptr;
 }
@@ -161,7 +400,9 @@ void ui_mem_fb_free(void *ptr)
 	os_mutex_lock(&alloc_mutex, OS_FOREVER);
 #endif
 
-	alloc_count[blkidx] = 0;
+	if (alloc_count[blkidx] > 0) {
+		_fb_free_blocks(blkidx);
+	}
 
 #ifndef CONFIG_SIMULATOR
 	k_spin_unlock(&alloc_spinlock, key);
@@ -177,6 +418,15 @@ size_t ui_mem_fb_get_size(void)
 
 void ui_mem_fb_dump(void)
 {
+	uint16_t hist[UI_MEM_FREE_HIST_NUM] = { 0 };
+	uint16_t extent_cnt = 0;
+	uint8_t largest;
+	uint8_t free_blks;
+
+#ifndef CONFIG_SIMULATOR
+	k_spinlock_key_t key;
+#endif
+
 	os_printk("FB heap at %p, block size %lu, count %u\n", ui_mem_base,
 			UI_MEM_BLOCK_SIZE, CONFIG_UI_MEM_NUMBER_BLOCKS);
 
@@ -191,6 +441,48 @@ void ui_mem_fb_dump(void)
 			i += 1;
 		}
 	}
+
+#ifndef CONFIG_SIMULATOR
+	key = k_spin_lock(&alloc_spinlock);
+#else
+	os_mutex_lock(&alloc_mutex, OS_FOREVER);
+#endif
+
+	if (!free_index_inited) {
+		_free_index_init();
+	}
+
+	for (int len = 1; len <= CONFIG_UI_MEM_NUMBER_BLOCKS; len++) {
+		for (uint8_t i = free_head[len]; i != UI_MEM_INVALID_BLK; i = free_next[i]) {
+			hist[_find_msb(len)]++;
+			extent_cnt++;
+		}
+	}
+
+	largest = _free_extent_largest();
+	free_blks = free_blks_total;
+
+#ifndef CONFIG_SIMULATOR
+	k_spin_unlock(&alloc_spinlock, key);
+#else
+	os_mutex_unlock(&alloc_mutex);
+#endif
+
+	/* fragmentation: free blocks not in the largest extent */
+	os_printk("free %u blocks in %u extents, largest %u blocks, frag %u%%, min free %u blocks\n",
+			free_blks, extent_cnt, largest,
+			free_blks ? (free_blks - largest) * 100 / free_blks : 0, min_free_blks);
+
+	os_printk("free extents:");
+	for (int i = 0; i < UI_MEM_FREE_HIST_NUM; i++) {
+		if (hist[i] > 0) {
+			os_printk(" [%u-%u] %u", 1u << i, (2u << i) - 1, hist[i]);
+		}
+	}
+	os_printk("\n");
+
+	os_printk("alloc waits %u, max wait %u ms, failures %u\n",
+			wait_cnt, max_wait_time, fail_cnt);
 }
 
 bool ui_mem_is_fb(const void * ptr)
@@ -6,6 +6,7 @@
 #include <memory/mem_cache.h>
 #include "res_manager_api.h"
 #include "res_mempool.h"
+#include "tile_cache.h"
 #ifdef CONFIG_JPEG_HAL
 #include <jpeg_hal.h>
 #endif
@@ -41,6 +42,16 @@
 #define COMPACT_BUFFER_MAX_PAD_SIZE		4*1024
 #define COMPACT_BUFFER_MARGIN_SIZE		64
 
+#ifndef CONFIG_RES_MANAGER_DECODER_CACHE_SIZE
+#define CONFIG_RES_MANAGER_DECODER_CACHE_SIZE	0
+#endif
+
+#if defined(CONFIG_RES_MANAGER_IMG_DECODER) && CONFIG_RES_MANAGER_DECODER_CACHE_SIZE > 0
+#define DECODER_CACHE_ENABLED	1
+#else
+#define DECODER_CACHE_ENABLED	0
+#endif
+
 #define PACK __attribute__ ((packed))
 
 //以下宏定义资源图片的类型
@@ -132,6 +143,32 @@ typedef struct
 	buf_block_t* head;
 }resource_buffer_t;
 
+#if DECODER_CACHE_ENABLED
+//decoded bitmap kept after closed by the image decoder
+typedef struct _decoder_cache_item_s
+{
+	res_bin_info_t* res_info;
+	uint32_t id;
+	uint32_t format;
+	uint32_t size;
+	uint32_t ref;
+	uint8_t* addr;
+	struct _decoder_cache_item_s* prev;
+	struct _decoder_cache_item_s* next;
+}decoder_cache_item_t;
+
+typedef struct
+{
+	//most recently used first
+	decoder_cache_item_t* head;
+	decoder_cache_item_t* tail;
+	uint32_t total_size;
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+}decoder_cache_t;
+#endif
+
 typedef struct _regular_info_s
 {
 	uint32_t scene_id;
@@ -155,6 +192,13 @@ static size_t res_mem_align = 4;
 os_mutex bitmap_cache_mutex;
 os_mutex bitmap_read_mutex;
 
+#if DECODER_CACHE_ENABLED
+static decoder_cache_t decoder_cache;
+static os_mutex decoder_cache_mutex;
+
+static uint32_t _decoder_cache_evict(uint32_t max_size);
+#endif
+
 //#define MAX_RES_VERSIONS 1
 //static const char* part_path[6] = {"/NAND:A/","/NAND:B","/NAND:C/","/NAND:D", "/NAND:E/","/NAND:F"};
 //static char latest_partition;
@@ -176,6 +220,9 @@ void _resource_buffer_deinit(uint32_t force_clear)
 
 	if(force_clear)
 	{
+		//all pictures are freed below
+		tile_cache_invalidate(NULL);
+
 		listp = text_buffer.head;
 		while(listp != NULL)
 		{
@@ -969,6 +1016,9 @@ void _free_resource_bitmap_buffer(void *p)
 	buf_block_t* prev = NULL;
 	uint32_t is_compact = 0;
 
+	/* compressed tiles are cached by picture address */
+	tile_cache_invalidate(p);
+
 #if RES_MEM_DEBUG
 	if(res_mem_check()<0)
 	{
@@ -1049,6 +1099,7 @@ void _free_resource_bitmap_buffer(void *p)
 			else
 			{
 				SYS_LOG_DBG("%d ui mem free %d\n", __LINE__, item->id);
+				tile_cache_invalidate_range(item->addr, screen_bitmap_size);
 				res_mem_free_block(item->addr);
 				ui_mem_total--;
 				res_mem_free(RES_MEM_POOL_BMP, (void*)item);
@@ -1061,6 +1112,7 @@ void _free_resource_bitmap_buffer(void *p)
 			if(item->size == sizeof(buf_block_t))
 			{
 				SYS_LOG_DBG("%d ui mem free %d\n", __LINE__, item->id);
+				tile_cache_invalidate_range(item->addr, screen_bitmap_size);
 				res_mem_free_block(item->addr);
 				ui_mem_total--;
 				item->addr = NULL; 
@@ -1088,6 +1140,7 @@ void _free_resource_bitmap_buffer(void *p)
 				}
 
 				SYS_LOG_DBG("compact early release %p\n", buffer->addr);
+				tile_cache_invalidate_range(buffer->addr, buffer->free_size + buffer->offset);
 				if(buffer->free_size + buffer->offset == screen_bitmap_size)
 				{
 					res_mem_free_block(buffer->addr);
@@ -1131,6 +1184,81 @@ static void _init_pic_mmap_addr(void* data, const char* picres_path)
 }
 
 
+//flatten the per partition offset tables into one table indexed by id
+static void _build_pic_dir(void* data)
+{
+#ifndef CONFIG_RES_MANAGER_IMG_DECODER
+	resource_info_t* info = (resource_info_t*)data;
+#else
+	res_bin_info_t* info = (res_bin_info_t*)data;
+#endif
+	pic_search_param_t* param;
+	uint32_t id_start = UINT32_MAX;
+	uint32_t id_end = 0;
+	uint32_t count;
+	int i;
+	uint32_t k;
+
+	for(i=0;i<=MAX_PARTITION_ID;i++)
+	{
+		param = &info->pic_search_param[i];
+		if(param->pic_offsets == NULL)
+		{
+			continue;
+		}
+		if(param->id_start < id_start)
+		{
+			id_start = param->id_start;
+		}
+		if(param->id_end > id_end)
+		{
+			id_end = param->id_end;
+		}
+	}
+
+	if(id_start > id_end)
+	{
+		return;
+	}
+
+	count = id_end - id_start + 1;
+	info->pic_dir = res_mem_alloc(RES_MEM_POOL_BMP, count*sizeof(pic_dir_entry_t));
+	if(info->pic_dir == NULL)
+	{
+		//keep the partition tables, searched by id range instead
+		SYS_LOG_INF("no memory for pic dir of %d ids\n", count);
+		return;
+	}
+	memset(info->pic_dir, 0xff, count*sizeof(pic_dir_entry_t));
+	info->pic_dir_id_start = id_start;
+	info->pic_dir_count = count;
+
+	for(i=0;i<=MAX_PARTITION_ID;i++)
+	{
+		param = &info->pic_search_param[i];
+		if(param->pic_offsets == NULL)
+		{
+			continue;
+		}
+
+		for(k=0;k<=param->id_end-param->id_start;k++)
+		{
+			pic_dir_entry_t* dir = &info->pic_dir[param->id_start - id_start + k];
+
+			dir->offset = param->pic_offsets[k];
+			dir->compress_size = param->compress_size[k];
+			dir->volume = i;
+		}
+
+		res_mem_free(RES_MEM_POOL_BMP, param->pic_offsets);
+		res_mem_free(RES_MEM_POOL_BMP, param->compress_size);
+		param->pic_offsets = NULL;
+		param->compress_size = NULL;
+	}
+
+	SYS_LOG_INF("pic dir: id %d ~ %d\n", id_start, id_end);
+}
+
 static int _init_pic_search_param(void* data, const char* picres_path)
 {
 	int i,k;
@@ -1352,6 +1480,7 @@ static int _init_pic_search_param(void* data, const char* picres_path)
 	}
 	mem_free(res_path);
 
+	_build_pic_dir(info);
 	_init_pic_mmap_addr(info, picres_path);
 	
 	return 0;
@@ -1446,6 +1575,9 @@ void res_manager_init(void)
 
 		os_mutex_init(&bitmap_cache_mutex);
 		os_mutex_init(&bitmap_read_mutex);
+#if DECODER_CACHE_ENABLED
+		os_mutex_init(&decoder_cache_mutex);
+#endif
 		res_manager_inited = 1;
 	}
 }
@@ -1464,6 +1596,14 @@ void res_manager_set_screen_size(uint32_t screen_w, uint32_t screen_h)
 void res_manager_clear_cache(uint32_t force_clear)
 {
 	_resource_buffer_deinit(force_clear);
+
+#if DECODER_CACHE_ENABLED
+	//decoded bitmaps survive the view cache shrinking, only dropped on force clear
+	if(force_clear)
+	{
+		_decoder_cache_evict(0);
+	}
+#endif
 }
 
 int32_t res_manager_set_str_file(resource_info_t* info, const char* text_path)
@@ -1797,6 +1937,11 @@ ERR_EXIT:
 		mem_free(info->str_path);
 		info->str_path = NULL;
 	}
+	if(info->pic_dir)
+	{
+		res_mem_free(RES_MEM_POOL_BMP, info->pic_dir);
+		info->pic_dir = NULL;
+	}
 	mem_free(info);
 	return NULL;
 }
@@ -1872,6 +2017,12 @@ void res_manager_close_resources( resource_info_t* info )
 		res_mem_free(RES_MEM_POOL_BMP, info->pic_search_param);
 		info->pic_search_param = NULL;
 	}
+
+	if(info->pic_dir != NULL)
+	{
+		res_mem_free(RES_MEM_POOL_BMP, info->pic_dir);
+		info->pic_dir = NULL;
+	}
 	mem_free(info);
 }
 
@@ -2095,6 +2246,7 @@ void _unload_scene_bitmaps(uint32_t scene_id)
 						if(item->size == sizeof(buf_block_t) && item->addr != NULL)
 						{
 							SYS_LOG_DBG("%d ui mem free %d\n", __LINE__, item->id);
+							tile_cache_invalidate_range(item->addr, screen_bitmap_size);
 							res_mem_free_block(item->addr);
 							ui_mem_total--;
 						}
@@ -2128,6 +2280,7 @@ void _unload_scene_bitmaps(uint32_t scene_id)
 
 			found = buffer;
 			buffer = found->next;
+			tile_cache_invalidate_range(found->addr, found->free_size + found->offset);
 			if(found->free_size + found->offset == screen_bitmap_size)
 			{
 				res_mem_free_block(found->addr);
@@ -2223,6 +2376,27 @@ static int _search_res_id_in_files(void* data, void* bitmap_data, uint32_t* bmp_
 		return -1;
 	}
 
+	if(info->pic_dir != NULL)
+	{
+		pic_dir_entry_t* dir;
+
+		id -= info->pic_dir_id_start;
+		if(id >= info->pic_dir_count)
+		{
+			return -1;
+		}
+
+		dir = &info->pic_dir[id];
+		if(dir->volume == PIC_DIR_VOLUME_NONE)
+		{
+			return -1;
+		}
+
+		*bmp_pos = dir->offset;
+		*compress_size = dir->compress_size;
+		return dir->volume;
+	}
+
 	low = 0;
 	high = info->pic_search_max_volume-1;
 	mid = (info->pic_search_max_volume-1)/2;
@@ -2873,6 +3047,27 @@ int32_t res_manager_preload_bitmap_compact(uint32_t scene_id, resource_info_t* r
 
 }
 
+int32_t res_manager_get_bitmap_file_pos(resource_info_t* res_info, resource_bitmap_t* bitmap, uint32_t* pos)
+{
+	uint32_t bmp_pos = 0;
+	uint32_t compress_size = 0;
+	int ret;
+
+	if(res_info == NULL || bitmap == NULL || pos == NULL)
+	{
+		return -1;
+	}
+
+	ret = _search_res_id_in_files(res_info, bitmap, &bmp_pos, &compress_size);
+	if(ret < 0)
+	{
+		return -1;
+	}
+
+	*pos = bmp_pos;
+	return ret;
+}
+
 
 int32_t res_manager_load_bitmap(resource_info_t* res_info, resource_bitmap_t* bitmap)
 {
@@ -3336,6 +3531,208 @@ uint32_t res_manager_scene_is_loaded(uint32_t scene_id)
 }
 
 #ifdef CONFIG_RES_MANAGER_IMG_DECODER
+#if DECODER_CACHE_ENABLED
+static void _decoder_cache_unlink(decoder_cache_item_t* item)
+{
+	if(item->prev)
+	{
+		item->prev->next = item->next;
+	}
+	else
+	{
+		decoder_cache.head = item->next;
+	}
+
+	if(item->next)
+	{
+		item->next->prev = item->prev;
+	}
+	else
+	{
+		decoder_cache.tail = item->prev;
+	}
+}
+
+static void _decoder_cache_push_front(decoder_cache_item_t* item)
+{
+	item->prev = NULL;
+	item->next = decoder_cache.head;
+	if(decoder_cache.head)
+	{
+		decoder_cache.head->prev = item;
+	}
+	else
+	{
+		decoder_cache.tail = item;
+	}
+	decoder_cache.head = item;
+}
+
+static void _decoder_cache_free_item(decoder_cache_item_t* item)
+{
+	_decoder_cache_unlink(item);
+	decoder_cache.total_size -= item->size;
+	decoder_cache.evictions++;
+
+	tile_cache_invalidate_range(item->addr, item->size);
+	res_mem_free(RES_MEM_POOL_BMP, item->addr);
+	res_mem_free(RES_MEM_POOL_BMP, item);
+}
+
+static decoder_cache_item_t* _decoder_cache_find(res_bin_info_t* res_info, uint32_t id, uint32_t format)
+{
+	decoder_cache_item_t* item = decoder_cache.head;
+
+	while(item != NULL)
+	{
+		if(item->id == id && item->res_info == res_info && item->format == format)
+		{
+			return item;
+		}
+		item = item->next;
+	}
+
+	return NULL;
+}
+
+//free unreferenced bitmaps from the least recently used until total size not exceeds max_size
+static uint32_t _decoder_cache_evict(uint32_t max_size)
+{
+	decoder_cache_item_t* item;
+	decoder_cache_item_t* prev;
+	uint32_t freed = 0;
+
+	os_mutex_lock(&decoder_cache_mutex, OS_FOREVER);
+
+	item = decoder_cache.tail;
+	while(item != NULL && decoder_cache.total_size > max_size)
+	{
+		prev = item->prev;
+		if(item->ref == 0)
+		{
+			freed += item->size;
+			_decoder_cache_free_item(item);
+		}
+		item = prev;
+	}
+
+	os_mutex_unlock(&decoder_cache_mutex);
+
+	return freed;
+}
+
+static int _decoder_cache_get(style_bitmap_t* bitmap)
+{
+	decoder_cache_item_t* item;
+
+	os_mutex_lock(&decoder_cache_mutex, OS_FOREVER);
+
+	item = _decoder_cache_find(bitmap->res_info, bitmap->id, bitmap->format);
+	if(item == NULL)
+	{
+		decoder_cache.misses++;
+		os_mutex_unlock(&decoder_cache_mutex);
+		return -1;
+	}
+
+	item->ref++;
+	_decoder_cache_unlink(item);
+	_decoder_cache_push_front(item);
+	decoder_cache.hits++;
+	bitmap->buffer = item->addr;
+
+	os_mutex_unlock(&decoder_cache_mutex);
+	return 0;
+}
+
+static void _decoder_cache_put(style_bitmap_t* bitmap, uint32_t size)
+{
+	decoder_cache_item_t* item;
+
+	if(size > CONFIG_RES_MANAGER_DECODER_CACHE_SIZE)
+	{
+		return;
+	}
+
+	_decoder_cache_evict(CONFIG_RES_MANAGER_DECODER_CACHE_SIZE - size);
+
+	os_mutex_lock(&decoder_cache_mutex, OS_FOREVER);
+
+	//budget taken by bitmaps still in use, or decoded by another thread meanwhile
+	if(decoder_cache.total_size + size > CONFIG_RES_MANAGER_DECODER_CACHE_SIZE ||
+		_decoder_cache_find(bitmap->res_info, bitmap->id, bitmap->format) != NULL)
+	{
+		os_mutex_unlock(&decoder_cache_mutex);
+		return;
+	}
+
+	item = (decoder_cache_item_t*)res_mem_alloc(RES_MEM_POOL_BMP, sizeof(decoder_cache_item_t));
+	if(item != NULL)
+	{
+		item->res_info = bitmap->res_info;
+		item->id = bitmap->id;
+		item->format = bitmap->format;
+		item->size = size;
+		item->ref = 1;
+		item->addr = bitmap->buffer;
+		_decoder_cache_push_front(item);
+		decoder_cache.total_size += size;
+	}
+
+	os_mutex_unlock(&decoder_cache_mutex);
+}
+
+static int _decoder_cache_release(void* ptr)
+{
+	decoder_cache_item_t* item;
+
+	os_mutex_lock(&decoder_cache_mutex, OS_FOREVER);
+
+	item = decoder_cache.head;
+	while(item != NULL)
+	{
+		if(item->addr == ptr)
+		{
+			if(item->ref > 0)
+			{
+				item->ref--;
+			}
+			break;
+		}
+		item = item->next;
+	}
+
+	os_mutex_unlock(&decoder_cache_mutex);
+
+	return (item != NULL) ? 0 : -1;
+}
+#endif /* DECODER_CACHE_ENABLED */
+
+static void* _alloc_bitmap_for_decoder(uint32_t size)
+{
+	void* buffer;
+
+#ifdef CONFIG_RES_MANAGER_ALIGN
+	buffer = res_mem_aligned_alloc(RES_MEM_POOL_BMP, res_mem_align, size);
+#else
+	buffer = res_mem_alloc(RES_MEM_POOL_BMP, size);
+#endif
+
+#if DECODER_CACHE_ENABLED
+	//give back the cached bitmaps not in use and retry
+	if(buffer == NULL && _decoder_cache_evict(0) > 0)
+	{
+#ifdef CONFIG_RES_MANAGER_ALIGN
+		buffer = res_mem_aligned_alloc(RES_MEM_POOL_BMP, res_mem_align, size);
+#else
+		buffer = res_mem_alloc(RES_MEM_POOL_BMP, size);
+#endif
+	}
+#endif
+
+	return buffer;
+}
+
 static int32_t _load_bitmap_for_decoder(style_bitmap_t* bitmap)
 {
 	int32_t ret;
@@ -3358,14 +3755,17 @@ static int32_t _load_bitmap_for_decoder(style_bitmap_t* bitmap)
 		return 0;
 	}
 
+#if DECODER_CACHE_ENABLED
+	if(_decoder_cache_get(bitmap) == 0)
+	{
+		return 0;
+	}
+#endif
+
 	SYS_LOG_INF("decode bitmap id %d, w %d, height %d, bpp %d\n", bitmap->id, bitmap->width, bitmap->height, bitmap->bytes_per_pixel);
 
 	bmp_size = bitmap->width * bitmap->height * bitmap->bytes_per_pixel;
-#ifdef CONFIG_RES_MANAGER_ALIGN
-	bitmap->buffer = res_mem_aligned_alloc(RES_MEM_POOL_BMP, res_mem_align, bmp_size);
-#else
-	bitmap->buffer = res_mem_alloc(RES_MEM_POOL_BMP, bmp_size);
-#endif
+	bitmap->buffer = _alloc_bitmap_for_decoder(bmp_size);
 	if(bitmap->buffer == NULL)
 	{
 		SYS_LOG_INF("error: no buffer to load bitmap \n");
@@ -3453,6 +3853,13 @@ static int32_t _load_bitmap_for_decoder(style_bitmap_t* bitmap)
 	}	
 	
 	mem_dcache_clean(bitmap->buffer, bmp_size);	
+
+#if DECODER_CACHE_ENABLED
+	if(ret >= bmp_size)
+	{
+		_decoder_cache_put(bitmap, bmp_size);
+	}
+#endif
 	
 	return 0;
 }
@@ -3486,6 +3893,14 @@ int res_manager_load_bitmap_for_decoder(style_bitmap_t* bitmap)
 
 void res_manager_free_bitmap_for_decoder(void* ptr)
 {
+#if DECODER_CACHE_ENABLED
+	if(_decoder_cache_release(ptr) == 0)
+	{
+		//keep it cached for the next open
+		return;
+	}
+#endif
+
 	res_mem_free(RES_MEM_POOL_BMP, ptr);
 }
 
@@ -3593,6 +4008,20 @@ void res_manager_dump_info(void)
 	//ui mem info
 	SYS_LOG_INF("full screen bitmap total %d\n", ui_mem_total);
 
+#if DECODER_CACHE_ENABLED
+	//decoded bitmap cache dump
+	SYS_LOG_INF("decoder cache size %d/%d, hits %d, misses %d, evictions %d\n", decoder_cache.total_size,
+				CONFIG_RES_MANAGER_DECODER_CACHE_SIZE, decoder_cache.hits, decoder_cache.misses, decoder_cache.evictions);
+	{
+		decoder_cache_item_t* ditem = decoder_cache.head;
+		while(ditem != NULL)
+		{
+			SYS_LOG_INF("decoder cache id %d, format %d, addr %p, size %d, ref %d \n", ditem->id, ditem->format, ditem->addr, ditem->size, ditem->ref);
+			ditem = ditem->next;
+		}
+	}
+#endif
+
 	//compact buffer dump();
 	citem = bitmap_buffer.compact_buffer_list;
 	while(citem != NULL)
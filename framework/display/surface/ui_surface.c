@@ -15,7 +15,9 @@
 #include <string.h>
 #include <mem_manager.h>
 #include <memory/mem_cache.h>
+#include <display/frame_timeline.h>
 #include <display/sw_draw.h>
+#include <display/sw_rotate.h>
 #include <display/ui_memsetcpy.h>
 #include <ui_mem.h>
 #include <ui_surface.h>
@@ -92,8 +94,13 @@ static int _surface_begin_draw_internal(surface_t *surface, uint8_t flags, graph
 static int _surface_end_draw_internal(surface_t *surface, const ui_region_t *area,
 		const void *buf, uint16_t stride, uint32_t pixel_format);
 
+#if CONFIG_SURFACE_MAX_BUFFER_COUNT > 0
+static void _surface_add_dirty_region(surface_t *surface, const ui_region_t *area);
+#endif
+
 static void _surface_invoke_draw_ready(surface_t *surface);
-static void _surface_invoke_post_start(surface_t *surface, const ui_region_t *area, uint8_t flags);
+static void _surface_invoke_post_start(surface_t *surface, const ui_region_t *area,
+		const ui_region_t *regions, uint8_t num_regions, uint8_t flags);
 
 /**********************
  *  STATIC VARIABLES
@@ -303,6 +310,8 @@ int surface_set_min_buffer_count(surface_t *surface, uint8_t min_count)
 
 		/* invalidate the new dirty area */
 		ui_region_set(&surface->dirty_area, 0, 0, surface->width - 1, surface->height - 1);
+		ui_region_copy(&surface->dirty_regions[0], &surface->dirty_area);
+		surface->dirty_num = 1;
 
 		SYS_LOG_DBG("buf count %d", surface->buf_count);
 	}
@@ -386,6 +395,9 @@ int surface_begin_frame(surface_t *surface)
 		return -ENOBUFS;
 	}
 
+	if (surface->create_flags & SURFACE_FRAME_TIMELINE)
+		frame_timeline_mark(FRAME_TL_DRAW_START);
+
 #if CONFIG_SURFACE_MAX_BUFFER_COUNT > 1
 	if (surface->buf_count == 2) {
 		surface_cover_check_data_t cover_check_data = {
@@ -422,7 +434,10 @@ int surface_begin_frame(surface_t *surface)
 	}
 
 	ui_region_set(&surface->dirty_area, surface->width, surface->height, 0, 0);
+	surface->dirty_num = 0;
 
+	if (surface->create_flags & SURFACE_FRAME_TIMELINE)
+		frame_timeline_mark(FRAME_TL_SWAP_DONE);
 #else
 	/* surface_update() may called in another thread, so synchronization is required */
 	_surface_frame_wait_end(surface);
@@ -627,10 +642,14 @@ static int _surface_end_draw_internal(surface_t *surface, const ui_region_t *are
 
 	/* post based on frame */
 	ui_region_merge(&surface->dirty_area, &surface->dirty_area, area);
+	_surface_add_dirty_region(surface, area);
 
 	_surface_invoke_draw_ready(surface);
 
 	if (surface->draw_flags & SURFACE_LAST_DRAW) {
+		if (surface->create_flags & SURFACE_FRAME_TIMELINE)
+			frame_timeline_mark(FRAME_TL_DRAW_END);
+
 		/* make sure the swap buffer not interrupted by posting */
 		os_sched_lock();
 
@@ -641,7 +660,8 @@ static int _surface_end_draw_internal(surface_t *surface, const ui_region_t *are
 		}
 #endif /* CONFIG_SURFACE_MAX_BUFFER_COUNT > 1 */
 
-		_surface_invoke_post_start(surface, &surface->dirty_area, SURFACE_FIRST_DRAW | SURFACE_LAST_DRAW);
+		_surface_invoke_post_start(surface, &surface->dirty_area, surface->dirty_regions,
+				surface->dirty_num, SURFACE_FIRST_DRAW | SURFACE_LAST_DRAW);
 		os_sched_unlock();
 	}
 
@@ -658,7 +678,7 @@ static int _surface_end_draw_internal(surface_t *surface, const ui_region_t *are
 			ui_region_get_width(area), ui_region_get_height(area), pixel_format,
 			GRAPHIC_BUFFER_HW_COMPOSER, stride, (void *)buf);
 
-	_surface_invoke_post_start(surface, area, surface->draw_flags);
+	_surface_invoke_post_start(surface, area, area, 1, surface->draw_flags);
 #endif /* CONFIG_SURFACE_MAX_BUFFER_COUNT > 0 */
 
 	return 0;
@@ -672,9 +692,15 @@ static void _surface_invoke_draw_ready(surface_t *surface)
 	}
 }
 
-static void _surface_invoke_post_start(surface_t *surface, const ui_region_t *area, uint8_t flags)
+static void _surface_invoke_post_start(surface_t *surface, const ui_region_t *area,
+		const ui_region_t *regions, uint8_t num_regions, uint8_t flags)
 {
-	surface_post_data_t data = { .flags = flags, .area = area, };
+	surface_post_data_t data = {
+		.flags = flags,
+		.area = area,
+		.regions = regions,
+		.num_regions = num_regions,
+	};
 
 	atomic_inc(&surface->refcount);
 	atomic_inc(&surface->post_cnt);
@@ -686,6 +712,68 @@ static void _surface_invoke_post_start(surface_t *surface, const ui_region_t *ar
 	}
 }
 
+#if CONFIG_SURFACE_MAX_BUFFER_COUNT > 0
+/*
+ * Keep the dirty regions apart as long as merging them would cost extra pixels
+ * to post, so that far apart updates (like the hands of a watchface) are not
+ * posted as one large bounding box. Regions merge when that costs no extra
+ * pixels (overlapped ones, or adjacent stripes of the same width) or the list
+ * is full, and never overlap each other.
+ */
+static void _surface_add_dirty_region(surface_t *surface, const ui_region_t *area)
+{
+	ui_region_t *regions = surface->dirty_regions;
+	ui_region_t merged;
+	int32_t best_cost = INT32_MAX;
+	bool overlapped = false;
+	int best = -1;
+	int i;
+
+	if (ui_region_is_empty(area)) {
+		return;
+	}
+
+	for (i = 0; i < surface->dirty_num; i++) {
+		int32_t cost;
+
+		ui_region_merge(&merged, &regions[i], area);
+		cost = ui_region_get_size(&merged) - ui_region_get_size(&regions[i]) -
+				ui_region_get_size(area);
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = i;
+		}
+
+		if (ui_region_is_on(&regions[i], area)) {
+			overlapped = true;
+		}
+	}
+
+	if (best < 0 || (best_cost > 0 && !overlapped &&
+			surface->dirty_num < CONFIG_SURFACE_MAX_DIRTY_REGIONS)) {
+		ui_region_copy(&regions[surface->dirty_num++], area);
+		return;
+	}
+
+	ui_region_merge(&regions[best], &regions[best], area);
+
+	/* the grown region may overlap the others now */
+	for (i = 0; i < surface->dirty_num;) {
+		if (i != best && ui_region_is_on(&regions[i], &regions[best])) {
+			ui_region_merge(&regions[best], &regions[best], &regions[i]);
+			ui_region_copy(&regions[i], &regions[--surface->dirty_num]);
+			if (best == surface->dirty_num) {
+				best = i;
+			}
+
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+}
+#endif /* CONFIG_SURFACE_MAX_BUFFER_COUNT > 0 */
+
 static void _surface_frame_wait_end(surface_t *surface)
 {
 	while (surface->in_frame) {
@@ -758,6 +846,71 @@ static void _surface_dma2d_init(void)
 }
 #endif /* CONFIG_DMA2D_HAL */
 
+/* pixels of a dst line rotated at a time when pixel format conversion required */
+#define SW_ROTATE_SEG_SIZE 64
+
+static int _surface_buffer_sw_rotate(uint8_t *dst, uint32_t dst_pixel_format,
+		uint16_t dst_pitch, uint16_t dst_w, uint16_t dst_h, const uint8_t *src,
+		uint32_t src_pixel_format, uint16_t src_pitch, uint8_t flags)
+{
+	static const uint8_t sw_modes[] = { 0, SW_ROT_90, SW_ROT_180, SW_ROT_270 };
+	uint8_t mode = sw_modes[flags & SURFACE_ROTATED_MASK];
+	uint8_t src_px_size = hal_pixel_format_get_bits_per_pixel(src_pixel_format) / 8;
+	uint8_t dst_px_size = hal_pixel_format_get_bits_per_pixel(dst_pixel_format) / 8;
+	uint16_t src_w = (flags & SURFACE_ROTATED_90) ? dst_h : dst_w;
+	uint16_t src_h = (flags & SURFACE_ROTATED_90) ? dst_w : dst_h;
+	uint32_t seg_buf[SW_ROTATE_SEG_SIZE];
+
+	mem_dcache_flush(src, src_pitch * src_h);
+
+	if (src_pixel_format == dst_pixel_format) {
+		return sw_rotate_copy(dst, src, dst_pitch, src_pitch,
+				src_w, src_h, src_px_size, mode);
+	}
+
+	/* rotate a segment of dst line into seg_buf, then convert to dst */
+	for (int y = 0; y < dst_h; y++) {
+		for (int x = 0; x < dst_w; x += SW_ROTATE_SEG_SIZE) {
+			uint16_t n = dst_w - x;
+			int16_t seg_x, seg_y;
+			uint16_t seg_w, seg_h;
+			int res;
+
+			if (n > SW_ROTATE_SEG_SIZE)
+				n = SW_ROTATE_SEG_SIZE;
+
+			if (mode == SW_ROT_90) {
+				seg_x = y;
+				seg_y = src_h - x - n;
+				seg_w = 1;
+				seg_h = n;
+			} else if (mode == SW_ROT_180) {
+				seg_x = src_w - x - n;
+				seg_y = src_h - 1 - y;
+				seg_w = n;
+				seg_h = 1;
+			} else {
+				seg_x = src_w - 1 - y;
+				seg_y = x;
+				seg_w = 1;
+				seg_h = n;
+			}
+
+			res = sw_rotate_copy(seg_buf, src + seg_y * src_pitch + seg_x * src_px_size,
+					n * src_px_size, src_pitch, seg_w, seg_h, src_px_size, mode);
+			if (res == 0) {
+				res = sw_convert_color_buffer(dst + y * dst_pitch + x * dst_px_size,
+						dst_pixel_format, seg_buf, src_pixel_format, n);
+			}
+
+			if (res < 0)
+				return res;
+		}
+	}
+
+	return 0;
+}
+
 static int _surface_buffer_copy(graphic_buffer_t *dstbuf,
 		const ui_region_t *dst_region, const uint8_t *src,
 		uint32_t src_pixel_format, uint16_t src_stride, uint8_t flags)
@@ -816,13 +969,19 @@ static int _surface_buffer_copy(graphic_buffer_t *dstbuf,
 	}
 #endif /* CONFIG_DMA2D_HAL */
 
-	/**
-	 * TODO: add pixel format software convertion
-	 */
+	/* fallback to CPU copy, rotation and pixel format conversion */
 	if (res < 0) {
 		if (flags & SURFACE_ROTATED_MASK) {
-			SYS_LOG_ERR("no sw rotation");
-			return -ENOSYS;
+			dst = mem_addr_to_uncache(dst);
+
+			if (_surface_buffer_sw_rotate(dst, graphic_buffer_get_pixel_format(dstbuf),
+					dst_pitch, dst_w, dst_h, src, src_pixel_format, src_pitch, flags)) {
+				SYS_LOG_ERR("sw rotation failed: %x -> %x", src_pixel_format,
+						graphic_buffer_get_pixel_format(dstbuf));
+			}
+
+			mem_writebuf_clean_all();
+			return res;
 		}
 
 		uint16_t copy_bytes = dst_w * src_px_size;
@@ -681,6 +681,51 @@ uint16_t view_cache_get_focus_main_view(void)
 	return view_id;
 }
 
+int view_cache_get_adjacent_views(uint16_t *views, int max_num)
+{
+	int num = 0;
+
+	os_mutex_lock(&view_cache_mutex, OS_FOREVER);
+
+	if (view_cache_ctx.dsc && max_num > 0) {
+		const view_cache_dsc_t *dsc = view_cache_ctx.dsc;
+		int8_t main_idx = (view_cache_ctx.main_idx >= 0) ?
+				view_cache_ctx.main_idx : view_cache_ctx.init_main_idx;
+		int8_t focus_idx = (view_cache_ctx.focus_idx >= 0) ?
+				view_cache_ctx.focus_idx : view_cache_ctx.init_focus_idx;
+		int8_t idx_list[4];
+		int idx_num = 0;
+
+		if (focus_idx >= dsc->num) {
+			/* cross view focused: only the main view behind it is adjacent */
+			idx_list[idx_num++] = main_idx;
+		} else {
+			if (view_cache_ctx.rotate) {
+				idx_list[idx_num++] = _view_cache_rotate_main_idx(main_idx - 1);
+				idx_list[idx_num++] = _view_cache_rotate_main_idx(main_idx + 1);
+			} else {
+				if (main_idx > 0)
+					idx_list[idx_num++] = main_idx - 1;
+				if (main_idx < dsc->num - 1)
+					idx_list[idx_num++] = main_idx + 1;
+			}
+
+			idx_list[idx_num++] = dsc->num;
+			idx_list[idx_num++] = dsc->num + 1;
+		}
+
+		for (int i = 0; i < idx_num && num < max_num; i++) {
+			uint16_t view_id = _view_cache_get_view_id(idx_list[i]);
+
+			if (view_id != VIEW_INVALID_ID && idx_list[i] != focus_idx)
+				views[num++] = view_id;
+		}
+	}
+
+	os_mutex_unlock(&view_cache_mutex);
+	return num;
+}
+
 int view_cache_set_focus_view(uint16_t view_id)
 {
 	const view_cache_dsc_t *dsc;
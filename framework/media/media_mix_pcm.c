@@ -30,6 +30,10 @@
 #include <buffer_stream.h>
 
 
+/* Q15 gains of the track playing and of the pcm mixed into it */
+#define MIX_PCM_MAIN_GAIN	(16423)	//-6 dB
+#define MIX_PCM_GAIN		(29205)	//-1 dB
+#define MIX_PCM_POLL_MS		(20)
 
 struct mix_pcm_manager_t {
 	io_stream_t mix_pcm_stream;
@@ -39,8 +43,8 @@ struct mix_pcm_manager_t {
 	io_stream_t mix_track_stream;
 	os_delayed_work mix_track_work;
     char mix_pcm_name[20];
-    media_player_t *play_handle;
-    mix_service_param_t param;
+	/* track playing which the pcm is mixed into */
+	struct audio_track_t *mix_track;
 };
 
 static struct mix_pcm_manager_t mix_pcm_context = {0};
@@ -50,22 +54,6 @@ static void _mix_pcm_track_callback(uint8_t event, void *user_data)
 
 }
 
-static void _media_service_mix_callback(io_stream_t mix_stream, int result, void *reply)
-{
-    struct mix_pcm_manager_t *ctx = &mix_pcm_context;
-    if (mix_stream != ctx->mix_pcm_stream) {
-        SYS_LOG_ERR("mix_stream %p %p err \n", mix_stream, ctx->mix_pcm_stream);
-        return;
-    }
-
-    stream_close(ctx->mix_pcm_stream);
-    stream_destroy(ctx->mix_pcm_stream);
-    ctx->mix_pcm_stream = NULL;
-
-    ctx->mix_pcm_cnt--;
-	SYS_LOG_INF("%s %d close\n", __FUNCTION__, __LINE__);
-}
-
 static void mix_instream_read_notify(void *observer, int readoff, int writeoff,
 			int total_size, unsigned char *buf, int num, stream_notify_type type)
 {
@@ -135,6 +123,20 @@ static void _media_mix_pcm_put_data_work(os_work *work)
 
 }
 
+//the track reads the pcm, close it when played out or the track is gone
+static void _media_mix_pcm_track_mix_work(os_work *work)
+{
+	struct mix_pcm_manager_t *ctx = &mix_pcm_context;
+
+	if (!ctx->mix_track_finish && audio_system_get_track() == ctx->mix_track) {
+		os_delayed_work_submit(&ctx->mix_track_work, MIX_PCM_POLL_MS);
+		return;
+	}
+
+	SYS_LOG_INF("%s %d close\n", __FUNCTION__, __LINE__);
+	media_mix_pcm_stream_close();
+}
+
 int media_mix_pcm_stream_open(const char *url, int inrate, int outrate)
 {
 	struct mix_pcm_manager_t *ctx = &mix_pcm_context;
@@ -155,30 +157,26 @@ int media_mix_pcm_stream_open(const char *url, int inrate, int outrate)
         goto err_exit;
     }
 
-    media_player_t *player = media_player_get_current_dumpable_player();
-    if (player) {
-        mix_service_param_t param;
-        memset(&param, 0, sizeof(mix_service_param_t));
-
-    	param.in_rate = inrate;
-    	param.out_rate = outrate;
-    	param.master_db = -6;
-    	param.mix_db = -1;
-    	param.channels = 1;
-    	param.format = PCM_TYPE;
-    	param.input_stream = ctx->mix_pcm_stream;
-    	param.callback = _media_service_mix_callback;
-
-    	ret = media_player_set_mix_stream(player, &param);
-    	if (ret) {
-    		SYS_LOG_ERR("set mix stream err:%d\n", ret);
-    		goto err_exit;
-    	}
+    audio_system_mutex_lock();
+    struct audio_track_t *track = audio_system_get_track();
+    if (track && track->stream_type != AUDIO_STREAM_TTS) {
+		/* mixed by the track, resampled from inrate to the track rate */
+		ret = audio_track_set_mix_stream(track, ctx->mix_pcm_stream, inrate, 1, AUDIO_STREAM_TTS);
+		if (ret) {
+			SYS_LOG_ERR("set mix stream err:%d\n", ret);
+			audio_system_mutex_unlock();
+			goto err_exit;
+		}
 
-        ctx->play_handle = player;
-    } else {
-        audio_system_mutex_lock();
+		audio_track_set_mix_gain(track, track->stream_type, MIX_PCM_MAIN_GAIN);
+		audio_track_set_mix_gain(track, AUDIO_STREAM_TTS, MIX_PCM_GAIN);
+		ctx->mix_track = track;
 
+		stream_set_observer(ctx->mix_pcm_stream, ctx, mix_instream_read_notify, STREAM_NOTIFY_READ);
+		os_delayed_work_init(&ctx->mix_track_work, _media_mix_pcm_track_mix_work);
+		os_delayed_work_submit(&ctx->mix_track_work, MIX_PCM_POLL_MS);
+		audio_system_mutex_unlock();
+    } else {
 		struct audio_track_t * mix_pcm_track = audio_track_create(AUDIO_STREAM_TTS, inrate,
 									 AUDIO_FORMAT_PCM_16_BIT, AUDIO_MODE_MONO,
 									 NULL,
@@ -242,19 +240,24 @@ int media_mix_pcm_stream_close(void)
     	stream_close(ctx->mix_pcm_stream);
         stream_destroy(ctx->mix_pcm_stream);
         audio_system_mutex_unlock();
-	} else {
-	    media_player_t *player = media_player_get_current_dumpable_player();
-	    if (player != ctx->play_handle) {
-            SYS_LOG_ERR("mix_stream %p %p err \n", player, ctx->play_handle);
-            return -1;
-	    }
-
-	    int ret = media_player_set_mix_stream(ctx->play_handle, NULL);
-    	if (ret) {
-    		SYS_LOG_ERR("set mix stream err:%d\n", ret);
-            return 0;
-        }
-    }
+	} else if (ctx->mix_track) {
+		os_delayed_work_cancel(&ctx->mix_track_work);
+
+		audio_system_mutex_lock();
+		/* a track stopped already detached its sources */
+		if (audio_system_get_track() == ctx->mix_track) {
+			audio_track_set_mix_stream(ctx->mix_track, NULL, 0, 1, AUDIO_STREAM_TTS);
+			audio_track_set_mix_gain(ctx->mix_track, ctx->mix_track->stream_type, AUDIO_MIXER_GAIN_UNITY);
+		}
+		ctx->mix_track = NULL;
+		ctx->mix_track_finish = 0;
+
+		ctx->mix_pcm_cnt--;
+		stream_close(ctx->mix_pcm_stream);
+		stream_destroy(ctx->mix_pcm_stream);
+		ctx->mix_pcm_stream = NULL;
+		audio_system_mutex_unlock();
+	}
 
     return 0;
 
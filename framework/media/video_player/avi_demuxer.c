@@ -3,6 +3,7 @@
 #include <string.h>
 #include "avi_demuxer.h"
 #include <stream.h>
+#include <video_mem.h>
 
 unsigned int Samples_per_sec;
 
@@ -455,3 +456,242 @@ SACN_END:
 	
 }
 
+/* idx1 entries read at a time */
+#define INDEX_READ_ENTRIES 32
+
+void avi_seek_table_add(void *avict, DWORD frame, DWORD pos)
+{
+	avi_contex_t *ac = (avi_contex_t *)avict;
+	avi_seek_entry_t *last;
+	int i;
+
+	if (ac->seek_table == NULL)
+		return;
+
+	if (ac->seek_num > 0)
+	{
+		last = &ac->seek_table[ac->seek_num - 1];
+		if (frame < last->frame + ac->seek_stride)
+			return;
+	}
+
+	if (ac->seek_num >= AVI_SEEK_TABLE_SIZE)
+	{
+		//drop every other entry, so the table covers the whole file in fixed memory
+		for (i = 0; i < AVI_SEEK_TABLE_SIZE / 2; i++)
+		{
+			ac->seek_table[i] = ac->seek_table[i * 2];
+		}
+		ac->seek_num = AVI_SEEK_TABLE_SIZE / 2;
+		ac->seek_stride *= 2;
+
+		last = &ac->seek_table[ac->seek_num - 1];
+		if (frame < last->frame + ac->seek_stride)
+			return;
+	}
+
+	ac->seek_table[ac->seek_num].frame = frame;
+	ac->seek_table[ac->seek_num].pos = pos;
+	ac->seek_num++;
+}
+
+static int load_index(avi_contex_t *ac)
+{
+	void *stream = ac->stream;
+	unsigned int *entry;
+	unsigned int *buf;
+	DWORD base = 0;
+	DWORD frame = 0;
+	int entries;
+	int first = 1;
+	int num;
+	int i;
+
+	file_seek_set(stream, ac->index_offset);
+	if (read4bytes(stream) != ckidAVINEWINDEX)
+		return UNKNOWNCON;
+
+	entries = read4bytes(stream) / 16;
+	if (entries <= 0)
+		return UNKNOWNCON;
+
+	buf = video_mem_malloc(INDEX_READ_ENTRIES * 16);
+	if (buf == NULL)
+		return MEMERROR;
+
+	while (entries > 0)
+	{
+		num = (entries > INDEX_READ_ENTRIES) ? INDEX_READ_ENTRIES : entries;
+		if (read_data(stream, buf, num * 16) != num * 16)
+			break;
+
+		for (i = 0; i < num; i++)
+		{
+			//ckid, flags, offset, size
+			entry = &buf[i * 4];
+			if ((((entry[0] >> 16) & DATA_MASK) != cktypeDIBcompressed)
+				&& (((entry[0] >> 16) & DATA_MASK) != cktypeDIBbits))
+				continue;
+
+			//offsets are relative to the movi tag, except some muxers write file offsets
+			if (first)
+			{
+				base = (entry[2] >= ac->movitagpos) ? 0 : ac->movitagpos - 4;
+				first = 0;
+			}
+
+			if (entry[1] & AVIIF_KEYFRAME)
+				avi_seek_table_add(ac, frame, entry[2] + base);
+			frame++;
+		}
+		entries -= num;
+	}
+
+	video_mem_free(buf);
+
+	printf("%s: %lu frames, %lu entries, stride %lu\n", __FUNCTION__, frame, ac->seek_num, ac->seek_stride);
+	return (ac->seek_num > 0) ? NORMAL : UNKNOWNCON;
+}
+
+/**
+**	load the seek table from idx1, or start an empty one to be built while playing
+**/
+int avi_seek_table_init(void *avict)
+{
+	avi_contex_t *ac;
+	int pos;
+
+	if (avict == NULL)
+		return MEMERROR;
+
+	ac = (avi_contex_t *)avict;
+
+	ac->seek_table = video_mem_malloc(sizeof(avi_seek_entry_t) * AVI_SEEK_TABLE_SIZE);
+	if (ac->seek_table == NULL)
+		return MEMERROR;
+
+	ac->seek_num = 0;
+	ac->seek_stride = 1;
+	ac->seek_indexed = 0;
+
+	if ((ac->amvformat == 0) && (ac->index_flag & AVIF_HASINDEX))
+	{
+		pos = file_tell(ac->stream);
+		if (load_index(ac) == NORMAL)
+		{
+			ac->seek_indexed = 1;
+		}
+		else
+		{
+			ac->seek_num = 0;
+			ac->seek_stride = 1;
+		}
+		file_seek_set(ac->stream, pos);
+	}
+
+	return NORMAL;
+}
+
+void avi_seek_table_deinit(void *avict)
+{
+	avi_contex_t *ac = (avi_contex_t *)avict;
+
+	if (ac && ac->seek_table)
+	{
+		video_mem_free(ac->seek_table);
+		ac->seek_table = NULL;
+		ac->seek_num = 0;
+	}
+}
+
+/**
+**	walk the chunk headers forward until the chunk of video frame
+**/
+static int walk_to_frame(avi_contex_t *ac, DWORD frame)
+{
+	void *stream = ac->stream;
+	avi_packet_t packet;
+	DWORD pos;
+
+	while (1)
+	{
+		pos = file_tell(stream);
+		if (get_es_chunk(ac, &packet) != NORMAL)
+			return STREAMEND;
+
+		if ((packet.es_type == ckidAVINEWINDEX)||(packet.es_type == ckidAMVEND))
+			return STREAMEND;
+
+		if (packet.es_type == LISTTAG)
+		{
+			//rec list, step into it
+			read_skip(stream, 4);
+			continue;
+		}
+
+		if (packet.es_type == streamtypeVIDEO)
+		{
+			if (!ac->seek_indexed)
+				avi_seek_table_add(ac, ac->framecounter, pos);
+
+			if (ac->framecounter >= frame)
+			{
+				file_seek_set(stream, pos);
+				return NORMAL;
+			}
+			ac->framecounter++;
+		}
+
+		read_skip(stream, packet.data_len + CHUNKPADD(packet.data_len, ac->amvformat));
+	}
+}
+
+/**
+**	seek to the chunk of video frame, binary search the table then walk forward
+**/
+int avi_seek_frame(void *avict, DWORD frame)
+{
+	avi_contex_t *ac;
+	DWORD start_frame = 0;
+	DWORD start_pos;
+	int low, high, mid;
+
+	if (avict == NULL)
+		return MEMERROR;
+
+	ac = (avi_contex_t *)avict;
+	start_pos = ac->movitagpos;
+
+	if ((ac->TotalFrames > 0) && (frame >= ac->TotalFrames))
+		return STREAMEND;
+
+	//last entry not after frame
+	low = 0;
+	high = ac->seek_num;
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		if (ac->seek_table[mid].frame <= frame)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low > 0)
+	{
+		start_frame = ac->seek_table[low - 1].frame;
+		start_pos = ac->seek_table[low - 1].pos;
+	}
+
+	//the current position is a chunk header, walk from it when it is nearer
+	if ((frame >= ac->framecounter) && (ac->framecounter > start_frame))
+	{
+		start_frame = ac->framecounter;
+		start_pos = file_tell(ac->stream);
+	}
+
+	file_seek_set(ac->stream, start_pos);
+	ac->framecounter = start_frame;
+
+	return walk_to_frame(ac, frame);
+}
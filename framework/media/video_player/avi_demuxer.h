@@ -174,6 +174,13 @@ typedef enum{
 
 #define DATA_MASK 0x0000ffff
 
+/* flags of avih and idx1 */
+#define AVIF_HASINDEX       0x00000010
+#define AVIIF_KEYFRAME      0x00000010
+
+/* max entries of the seek table, the table is decimated when full */
+#define AVI_SEEK_TABLE_SIZE 256
+
 //#define CHUNKPADD(len, amv) ((len)&(!(amv)))
 #define CHUNKPADD(len, amv) ((amv)?0:((4 - ((len)&(0x3)))&0x3))
 
@@ -185,6 +192,12 @@ typedef struct
 	unsigned int data_len;	
 }avi_packet_t;
 
+typedef struct
+{
+	DWORD  frame;	// video frame number
+	DWORD  pos;	// file offset of the chunk header
+}avi_seek_entry_t;
+
 typedef struct 
 {
 ///////////header info//////////////
@@ -207,6 +220,11 @@ typedef struct
 	BITMAPINFOHEADER bmpheader;
 	WAVEFORMATEX     waveheader;
 	AMVAudioStreamFormat  amvwaveheader;
+///////////seek table//////////////
+	avi_seek_entry_t *seek_table;
+	DWORD  seek_num;
+	DWORD  seek_stride;   //min frames between entries
+	DWORD  seek_indexed;  //table is loaded from idx1, else built while playing
 ////////////	
 }avi_contex_t;
 
@@ -217,6 +235,11 @@ int get_es_chunk(void *avict, avi_packet_t *raw_packet);
 int read4bytes(void *io);
 int search_es_chunk(void *avict, avi_packet_t *raw_packet);
 
+int avi_seek_table_init(void *avict);
+void avi_seek_table_deinit(void *avict);
+void avi_seek_table_add(void *avict, DWORD frame, DWORD pos);
+int avi_seek_frame(void *avict, DWORD frame);
+
 
 int read_data(void *io, void *buf, unsigned int len);
 int read_skip(void *io, int len);
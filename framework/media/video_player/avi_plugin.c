@@ -108,6 +108,12 @@ static void *open(io_stream_t stream, ve_media_info_t *file_info)
 	}
 	
 	set_app_info(avi_handle, ve_m_info);
+
+	if (avi_seek_table_init(avi_handle) != NORMAL)
+	{
+		video_mem_free(avi_handle);
+		return NULL;
+	}
 	
 //default to amv
 	//avi_handle->amvformat = 1;
@@ -172,6 +178,10 @@ static int getframe(void *fhandle, demuxer_packet_t *de_pac)
 	if (packet->es_type == streamtypeVIDEO)
 	{
 		de_pac->packet_type = VIDEO_ES;
+		if (!avi_handle->seek_indexed)
+		{
+			avi_seek_table_add(avi_handle, avi_handle->framecounter, file_tell(avi_handle->stream) - 8);
+		}
 		avi_handle->framecounter++;
 	}
 	
@@ -252,6 +262,7 @@ static int dispose(void *fhandle)
 {
 	if (fhandle)
 	{
+		avi_seek_table_deinit(fhandle);
 		video_mem_free(fhandle);
 	}
 
@@ -261,12 +272,7 @@ static int dispose(void *fhandle)
 static int dem_seek(void *fhandle, seek_info_t *seek_info)
 {
 	avi_contex_t *avi_handle;
-	avi_packet_t packet;
 	int rtval;
-	int padding;
-	int curr_index_offset;
-	int relation_offset;
-	int data_offset;
 	unsigned int frame_num;
 	
 	if ((fhandle == NULL)||(seek_info == NULL))
@@ -294,100 +300,44 @@ static int dem_seek(void *fhandle, seek_info_t *seek_info)
 			break;
 			
 		case FAST_FORWORD:
-			if(avi_handle->index_flag ||(avi_handle->amvformat == 0))
-			{
-				if((seek_info->curframes+avi_handle->framecounter) >=  avi_handle->TotalFrames)
-				{
-					return EN_FILEISEND;					
-//					seek_info->curframes = avi_handle->TotalFrames - avi_handle->framecounter;
-				}
-				curr_index_offset = avi_handle->index_offset +8+((seek_info->curframes+avi_handle->framecounter)<<5);
-				file_seek_set(avi_handle->stream, (curr_index_offset+8));
-				relation_offset = read4bytes(avi_handle->stream);
-				data_offset = relation_offset + avi_handle->movitagpos;
-				file_seek_set(avi_handle->stream, data_offset-4);			
-				avi_handle->framecounter += seek_info->curframes;
-				packet.pts  = ((avi_handle->framecounter * TIMESCALE * 10) / avi_handle->framerate)/10;
-			}
-			else
+			frame_num = avi_handle->framecounter + (seek_info->curframes ? seek_info->curframes : 1);
+			rtval = avi_seek_frame(avi_handle, frame_num);
+			if (rtval != NORMAL)
 			{
-				packet.data_len = 0;
-				packet.es_type  = -1;
-				for(;;)
-				{
-					rtval = get_es_chunk(avi_handle, &packet);
-					if (rtval == STREAMEND)
-					{
-						return EN_FILEISEND;
-					}
-				
-					padding = CHUNKPADD(packet.data_len, avi_handle->amvformat);
-					read_skip(avi_handle->stream, packet.data_len + padding);
-				
-					if (packet.es_type  == streamtypeVIDEO)
-						break;
-				}
-				
-				avi_handle->framecounter++;
-				
-				//skip audio chunck			
-				rtval = get_es_chunk(avi_handle, &packet);
-				if (rtval == STREAMEND)
-				{
-					return EN_FILEISEND;
-				}
-				
-				padding = CHUNKPADD(packet.data_len, avi_handle->amvformat);
-				read_skip(avi_handle->stream, packet.data_len + padding);
-				//printf("f ts: %d\n", packet.pts);
+				return EN_FILEISEND;
 			}
+			//printf("f ts: %lu\n", avi_handle->framecounter);
 			break;
 			
 		case FAST_BACK:
-			if(avi_handle->index_flag ||(avi_handle->amvformat == 0))
+			if(avi_handle->framecounter <= seek_info->curframes)
 			{
-				if(avi_handle->framecounter <= seek_info->curframes)
-				{
-					return EN_FILESTARTPOS;
-				}
-				curr_index_offset = avi_handle->index_offset +8+((avi_handle->framecounter - seek_info->curframes )<<5);
-				file_seek_set(avi_handle->stream, (curr_index_offset+8));
-				relation_offset = read4bytes(avi_handle->stream);
-				data_offset = relation_offset + avi_handle->movitagpos;
-				file_seek_set(avi_handle->stream, data_offset-4);			
-				avi_handle->framecounter -= seek_info->curframes;
-				packet.pts  = ((avi_handle->framecounter * TIMESCALE * 10) / avi_handle->framerate)/10;
+				return EN_FILESTARTPOS;
 			}
-			else
+			frame_num = avi_handle->framecounter - (seek_info->curframes ? seek_info->curframes : 1);
+			rtval = avi_seek_frame(avi_handle, frame_num);
+			if (rtval != NORMAL)
 			{
-				packet.data = seek_info->searchbuf;
-				rtval = search_es_chunk(avi_handle, &packet);
-				if (rtval == STREAMSTART)
-				{
-					return EN_FILESTARTPOS;
-				}
+				return EN_FILEISEND;
 			}
-			//printf("b ts: %d\n", packet.pts);
-		
+			//printf("b ts: %lu\n", avi_handle->framecounter);
 			break;
 
 		case SEEK_TIME:
 			frame_num = (seek_info->curtime *avi_handle->framerate*10/TIMESCALE)/10;
 			printf("frame_num: %d, counter: %lu\n", frame_num, avi_handle->TotalFrames);
-			if(frame_num > avi_handle->TotalFrames)
+			if((avi_handle->TotalFrames > 0) && (frame_num >= avi_handle->TotalFrames))
+			{
+				frame_num = avi_handle->TotalFrames - 1;
+			}
+			rtval = avi_seek_frame(avi_handle, frame_num);
+			printf("seek: %lu, tell: %d\n", avi_handle->framecounter, file_tell(avi_handle->stream));
+			if (rtval != NORMAL)
 			{
-				frame_num = avi_handle->TotalFrames;
+				return EN_FILEISEND;
 			}
-			curr_index_offset = avi_handle->index_offset +8+(frame_num<<5);
-			file_seek_set(avi_handle->stream, (curr_index_offset+8));
-			relation_offset = read4bytes(avi_handle->stream);
-			data_offset = relation_offset + avi_handle->movitagpos;
-			file_seek_set(avi_handle->stream, data_offset-4);			
-			avi_handle->framecounter = frame_num;
-			printf("seek: %d, tell: %d\n", data_offset-4, file_tell(avi_handle->stream));
 			break;
 			
-		//search_es_chunk
 		default:
 			break;	
 	}
@@ -43,39 +43,183 @@ static char __aligned(4) audio_track_buf[AUDIO_TRACK_BUG_SIZE] __in_section_uniq
 video_player_data_t *video_player_data = NULL;
 extern unsigned int Samples_per_sec;
 
-static uint32_t t_begin = 0;
-static int frame_num = 0;
 static int video_dec_stop(video_player_data_t * data, bool mem_release);
-static void calculate_fps_check(void);
+
+/*
+ * The playback is a pipeline of three stages:
+ * demux: video_dec_workq reads chunks ahead into frame_ringbuf,
+ * decode: the service thread decodes into the back decode buffer, or drops
+ *         the frame when it is late to the clock,
+ * display: the callback hands the decoded buffer to ui, which draws it
+ *          while the next frame is decoded into the other buffer.
+ */
+#define VIDEO_DEMUX_WAIT_MS			(20)
+#define VIDEO_PRELOAD_WAIT_MS		(1000)
+#define VIDEO_MAX_WAIT_MS			(100)
+#define VIDEO_MAX_CONTINUOUS_DROP	(3)
+
+struct video_stage_stat {
+	uint32_t begin;
+	uint32_t demux_us;		//demux stage working
+	uint32_t queue_us;		//decode stage waiting for the demux stage
+	uint32_t decode_us;
+	uint32_t sync_us;		//waiting for the clock
+	uint32_t display_us;
+	uint16_t frames;
+	uint16_t dropped;
+	uint16_t starved;
+};
+
+static struct video_stage_stat stage_stat;
 
 #define VIDEO_DEC_WORKQ_STACKSIZE	(1024*2)
 struct k_work_q video_dec_workq;
 static uint8_t video_dec_workq_stack[VIDEO_DEC_WORKQ_STACKSIZE] __aligned(4);
 static OS_SEM_DEFINE(video_sem, 0, 1);
-static char video_frame_buf[sizeof(frame_info_t) * 2];
+#ifdef CONFIG_VIDEO_PLAYER_PREFETCH_NUM
+#define VIDEO_PREFETCH_NUM		CONFIG_VIDEO_PLAYER_PREFETCH_NUM
+#else
+#define VIDEO_PREFETCH_NUM		2
+#endif
+static char video_frame_buf[sizeof(frame_info_t) * VIDEO_PREFETCH_NUM];
 static void video_dec_work_handle(struct k_work *work);
 static K_WORK_DEFINE(video_dec_work, video_dec_work_handle);
+static struct k_work_sync video_dec_work_sync;
 static int video_dec_parse_frame(frame_info_t *frame_info);
-//load next frame when decoding
+
+static inline uint32_t video_stage_us(uint32_t begin)
+{
+	return k_cyc_to_us_floor32(k_cycle_get_32() - begin);
+}
+
+//demux stage, read chunks until the frame queue is full
 static void video_dec_work_handle(struct k_work *work)
 {
 	video_player_data_t *data = video_player_data;
 	frame_info_t *frame_info;
-	uint32_t size;
-	packet_type_t packet_type;
+	uint32_t begin;
+	int ret;
+
+	if (data == NULL || data->frame_ringbuf == NULL)
+		return;
 
 	while (acts_ringbuf_space(data->frame_ringbuf) >= sizeof(frame_info_t)) {
 		frame_info = video_mem_malloc(sizeof(frame_info_t));
-		video_dec_parse_frame(frame_info);
-		packet_type = frame_info->packet_type;
-		size = acts_ringbuf_put(data->frame_ringbuf, frame_info, sizeof(frame_info_t));
+		if (frame_info == NULL)
+			break;
+
+		begin = k_cycle_get_32();
+		ret = video_dec_parse_frame(frame_info);
+		stage_stat.demux_us += video_stage_us(begin);
+
+		acts_ringbuf_put(data->frame_ringbuf, frame_info, sizeof(frame_info_t));
 		video_mem_free(frame_info);
-		if (packet_type == VIDEO_ES)
+		os_sem_give(&video_sem);
+		if (ret != EN_NORMAL)
 			break;
 	}
+
+	//wake the decode stage even if nothing is put
 	os_sem_give(&video_sem);
 }
 
+//stop the demux stage, must be done before touching the demuxer or the queue
+static void video_dec_demux_sync(void)
+{
+	k_work_cancel_sync(&video_dec_work, &video_dec_work_sync);
+	k_sem_reset(&video_sem);
+}
+
+//drop the prefetched frames, the demux stage is stopped first so none is put back
+static void video_dec_flush_frames(video_player_data_t *data)
+{
+	frame_info_t frame_info;
+
+	video_dec_demux_sync();
+
+	while (acts_ringbuf_length(data->frame_ringbuf) >= sizeof(frame_info_t)) {
+		acts_ringbuf_get(data->frame_ringbuf, &frame_info, sizeof(frame_info_t));
+		if (frame_info.av_dec_buf.data) {
+			data->init_param.free(frame_info.av_dec_buf.data);
+		}
+	}
+}
+
+//get a frame from the queue, wait the demux stage a while if empty
+static int video_dec_get_frame(video_player_data_t *data, frame_info_t *frame_info, int timeout)
+{
+	uint32_t begin = k_cycle_get_32();
+	int ret = 0;
+
+	while (acts_ringbuf_get(data->frame_ringbuf, frame_info, sizeof(frame_info_t)) == 0) {
+		os_work_submit_to_queue(&video_dec_workq, &video_dec_work);
+		if (os_sem_take(&video_sem, timeout)) {
+			stage_stat.starved++;
+			ret = -EAGAIN;
+			break;
+		}
+	}
+
+	//refill the slot just freed
+	os_work_submit_to_queue(&video_dec_workq, &video_dec_work);
+	stage_stat.queue_us += video_stage_us(begin);
+	return ret;
+}
+
+/*
+ * The clock of playback in ms, from the pcm played when there is audio,
+ * else from the system uptime.
+ */
+static uint32_t video_dec_get_clock(video_player_data_t *data)
+{
+	uint32_t played;
+	uint32_t buffered;
+
+	if (!data->mute && data->aud_track && data->audio_clock_valid && Samples_per_sec) {
+		played = (uint32_t)(data->audio_samples * 1000 / Samples_per_sec);
+		buffered = stream_get_length(data->audio_stream) * 1000 / 2 / Samples_per_sec;
+		return data->audio_base_pts + ((played > buffered) ? played - buffered : 0);
+	}
+
+	return os_uptime_get_32() - data->start_time;
+}
+
+static void video_dec_alloc_buf(video_player_data_t *data)
+{
+	int i;
+
+	if (data->decode_buf_num > 0)
+		return;
+
+	data->decode_buf_size = data->video_info.height * data->video_info.width * 2;
+	for (i = 0; i < VIDEO_DECODE_BUF_NUM; i++) {
+		data->decode_bufs[i] = data->init_param.alloc(data->decode_buf_size);
+		if (data->decode_bufs[i] == NULL)
+			break;
+		data->decode_buf_num++;
+	}
+
+	if (data->decode_buf_num < VIDEO_DECODE_BUF_NUM)
+		SYS_LOG_WRN("decode buf %d/%d", data->decode_buf_num, VIDEO_DECODE_BUF_NUM);
+
+	data->decode_idx = 0;
+	data->decode_buf = data->decode_bufs[0];
+}
+
+static void video_dec_free_buf(video_player_data_t *data)
+{
+	int i;
+
+	for (i = 0; i < data->decode_buf_num; i++) {
+		data->init_param.free(data->decode_bufs[i]);
+		data->decode_bufs[i] = NULL;
+	}
+
+	data->decode_buf_num = 0;
+	data->decode_buf = NULL;
+	data->decode_buf_size = 0;
+}
+
 static int video_dec_parse_frame(frame_info_t *frame_info)
 {
 	video_player_data_t *data = video_player_data;
@@ -158,23 +302,27 @@ static int video_dec_parse_frame(frame_info_t *frame_info)
 	return EN_NORMAL;
 }
 
-static void calculate_fps_begin(void)
+static void video_stage_stat_begin(void)
 {
-	if(frame_num == 0)
-		t_begin = k_cycle_get_32();
+	if (stage_stat.begin == 0)
+		stage_stat.begin = k_cycle_get_32();
 }
 
-static void calculate_fps_check(void)
+static void video_stage_stat_check(void)
 {
-	uint32_t total_time = 0;
+	uint32_t total_time;
+	int frames;
 
-	frame_num ++;
-	total_time = k_cyc_to_us_floor32(k_cycle_get_32() - t_begin);
-	if(total_time >= 1000000)
+	total_time = video_stage_us(stage_stat.begin);
+	if (total_time >= 1000000)
 	{
-		SYS_LOG_INF("time: %dus, frame: %d", total_time, frame_num);
-		frame_num = 0;
-		t_begin = 0;
+		frames = stage_stat.frames ? stage_stat.frames : 1;
+		SYS_LOG_INF("time: %dus, frame: %d, drop: %d, starve: %d",
+			total_time, stage_stat.frames, stage_stat.dropped, stage_stat.starved);
+		SYS_LOG_INF("per frame demux: %dus, queue: %dus, decode: %dus, sync: %dus, display: %dus",
+			stage_stat.demux_us / frames, stage_stat.queue_us / frames, stage_stat.decode_us / frames,
+			stage_stat.sync_us / frames, stage_stat.display_us / frames);
+		memset(&stage_stat, 0, sizeof(stage_stat));
 	}
 }
 
@@ -210,6 +358,7 @@ static int video_audio_open(video_player_data_t *data)
 	SYS_LOG_INF("### data->mute %d", data->mute);
 	audio_track_mute(data->aud_track, data->mute);
 	audio_track_set_fade_in(data->aud_track, 10);
+	data->audio_clock_valid = false;
     //bt_transmit_catpure_start(audio_track_get_stream(data->aud_track),
     //   Samples_per_sec/1000, 1, AUDIO_STREAM_VIDEO);
     return 0;
@@ -307,11 +456,7 @@ static void video_dec_deinit(video_player_data_t *data)
 
 	video_dec_stop(data, true);
 
-	if(data->decode_buf) {
-		data->init_param.free(data->decode_buf);
-		data->decode_buf = NULL;
-		data->decode_buf_size = 0;
-	}
+	video_dec_free_buf(data);
 
 	if (data->file_stream) {
 		stream_close(data->file_stream);
@@ -469,10 +614,7 @@ static int video_dec_play(video_player_data_t *data)
 			return -1;
 	}
 
-	if(data->decode_buf == NULL) {
-		data->decode_buf_size = data->video_info.height * data->video_info.width * 2;
-		data->decode_buf = data->init_param.alloc(data->decode_buf_size);
-	}
+	video_dec_alloc_buf(data);
 
 	data->start_time = os_uptime_get_32();
 	data->status = VP_STATUS_PLAYING;
@@ -485,6 +627,8 @@ static int video_dec_stop(video_player_data_t *data, bool mem_release)
 	if(data->status == VP_STATUS_STOPED)
 		return 0;
 
+	video_dec_demux_sync();
+
 	if (!data->mute) {
 		video_audio_close(data);
 	}
@@ -509,23 +653,14 @@ static int video_dec_stop(video_player_data_t *data, bool mem_release)
 	}
 
 	if(mem_release) {
-		if(data->decode_buf) {
-			data->init_param.free(data->decode_buf);
-			data->decode_buf = NULL;
-			data->decode_buf_size = 0;
-		}
+		video_dec_free_buf(data);
 	}
 
 	if (data->frame_ringbuf)
 	{
-		while (acts_ringbuf_length(data->frame_ringbuf) >= sizeof(frame_info_t)) {
-			frame_info_t frame_info;
-			acts_ringbuf_get(data->frame_ringbuf, &frame_info, sizeof(frame_info_t));
-			if (frame_info.av_dec_buf.data) {
-				data->init_param.free(frame_info.av_dec_buf.data);
-			}
-		}
+		video_dec_flush_frames(data);
 		acts_ringbuf_destroy_ext(data->frame_ringbuf);
+		data->frame_ringbuf = NULL;
 	}
 
 	data->start_time = 0;
@@ -551,10 +686,8 @@ static int video_dec_pause(video_player_data_t *data, bool mem_release)
 	}
 
 	data->init_param.cb(VP_STATUS_PAUSED, data->init_param.cb_data, NULL);
-	if(mem_release && data->decode_buf) {
-		data->init_param.free(data->decode_buf);
-		data->decode_buf = NULL;
-		data->decode_buf_size = 0;
+	if(mem_release) {
+		video_dec_free_buf(data);
 	}
 
 	if(data->freq_boot) {
@@ -573,10 +706,7 @@ static int video_dec_resume(video_player_data_t *data)
 			return -1;
 	}
 
-	if(data->decode_buf == NULL) {
-		data->decode_buf_size = data->video_info.height * data->video_info.width * 2;
-		data->decode_buf = data->init_param.alloc(data->decode_buf_size);
-	}
+	video_dec_alloc_buf(data);
 
 	data->start_time = os_uptime_get_32() - data->cur_pts;
 	data->status = VP_STATUS_PLAYING;
@@ -591,20 +721,102 @@ static int video_dec_seek(video_player_data_t *data, uint32_t pos_ms)
 	//bt_transmit_on_seek();
 	seek_info.seek_cmd = SEEK_TIME;
 	seek_info.curtime = pos_ms;
+
+	//prefetched frames are from the old position, and the demux stage
+	//must not be parsing while the demuxer seeks
+	if (data->frame_ringbuf) {
+		video_dec_flush_frames(data);
+	}
 	data->dem_plugin->seek(data->dem_handle, &seek_info);
 
+	data->start_time = os_uptime_get_32() - pos_ms;
+	data->audio_clock_valid = false;
+	data->drop_count = 0;
+
 	return 0;
 }
 
+static int video_present_frame(video_player_data_t *data, frame_info_t *frame_info)
+{
+	av_buf_t *av_dec_buf = &frame_info->av_dec_buf;
+	video_data_t video_data;
+	uint32_t clock = 0;
+	uint32_t period;
+	uint32_t begin;
+	int ret = EN_NORMAL;
+
+	period = data->video_info.frame_rate ? 1000 / data->video_info.frame_rate : 0;
+
+	//drop the late frame, but still show one of a few to keep the picture moving
+	if (data->start_time) {
+		clock = video_dec_get_clock(data);
+		if ((int32_t)(clock - frame_info->pts) > (int32_t)period
+			&& data->drop_count < VIDEO_MAX_CONTINUOUS_DROP) {
+			SYS_LOG_DBG("drop pts: %u, clock: %u", frame_info->pts, clock);
+			data->drop_count++;
+			stage_stat.dropped++;
+			return EN_NORMAL;
+		}
+	}
+	data->drop_count = 0;
+
+	if (data->decode_buf_num == 0) {
+		SYS_LOG_ERR("no decode buf!");
+		return EN_MEMERR;
+	}
+
+	//decode into the buffer not on display
+	av_dec_buf->outbuf = data->decode_bufs[data->decode_idx];
+
+	begin = k_cycle_get_32();
+	if(data->init_param.need_decode) {
+		ret = data->dec_plugin->decode(data->dec_handle, av_dec_buf);
+		video_data.decode_buf_size = data->decode_buf_size;
+	} else {
+		memcpy(av_dec_buf->outbuf, av_dec_buf->data, av_dec_buf->data_len);
+		video_data.decode_buf_size = av_dec_buf->data_len;
+	}
+	stage_stat.decode_us += video_stage_us(begin);
+
+	video_data.decode_buf = (char *)av_dec_buf->outbuf;
+	video_data.width = data->video_info.width;
+	video_data.height = data->video_info.height;
+	video_data.format = 0;
+	if(ret != EN_NORMAL)
+	{
+		SYS_LOG_ERR("dec_plugin.decode failed!");
+		data->init_param.cb(VP_STATUS_ERROR, data->init_param.cb_data, &video_data);
+		return ret;
+	}
+
+	if (data->start_time) {
+		clock = video_dec_get_clock(data);
+		SYS_LOG_DBG("cur_pts: %u, clock: %u", frame_info->pts, clock);
+		if ((int32_t)(frame_info->pts - clock) > 0) {
+			begin = k_cycle_get_32();
+			os_sleep(MIN(frame_info->pts - clock, VIDEO_MAX_WAIT_MS));
+			stage_stat.sync_us += video_stage_us(begin);
+		}
+	}
+
+	begin = k_cycle_get_32();
+	data->decode_buf = av_dec_buf->outbuf;
+	data->decode_idx = (data->decode_idx + 1) % data->decode_buf_num;
+	data->init_param.cb(VP_STATUS_PLAYING, data->init_param.cb_data, &video_data);
+	stage_stat.display_us += video_stage_us(begin);
+	stage_stat.frames++;
+
+	return EN_NORMAL;
+}
+
 static int video_playing_handle(video_player_data_t *data)
 {
 	frame_info_t frame_info;
 	av_buf_t *av_dec_buf;
 	int ret = EN_NORMAL;
 	int audio_len;
-	video_data_t video_data;
 
-	calculate_fps_begin();
+	video_stage_stat_begin();
 
 	if(!data->freq_boot) {
 		data->freq_boot = 1;
@@ -613,9 +825,10 @@ static int video_playing_handle(video_player_data_t *data)
 #endif
 	}
 
-	uint32_t size = acts_ringbuf_get(data->frame_ringbuf, &frame_info, sizeof(frame_info_t));
-	if (size == 0) {
-		video_dec_parse_frame(&frame_info);
+	//demux stage is behind, back to process messages
+	if (video_dec_get_frame(data, &frame_info, (data->status == VP_STATUS_PLAYING) ?
+			VIDEO_DEMUX_WAIT_MS : VIDEO_PRELOAD_WAIT_MS)) {
+		return EN_NORMAL;
 	}
 
 	data->cur_pts = frame_info.pts;
@@ -637,66 +850,55 @@ static int video_playing_handle(video_player_data_t *data)
 	// video
 	if(frame_info.packet_type == VIDEO_ES)
 	{
-		av_dec_buf->outbuf = data->decode_buf;
-		if(data->init_param.need_decode) {
-			os_work_submit_to_queue(&video_dec_workq, &video_dec_work);
-			ret = data->dec_plugin->decode(data->dec_handle, av_dec_buf);
-			os_sem_take(&video_sem, OS_FOREVER);
-			video_data.decode_buf_size = data->decode_buf_size;
-		} else {
-			memcpy(av_dec_buf->outbuf, av_dec_buf->data, av_dec_buf->data_len);
-			video_data.decode_buf_size = av_dec_buf->data_len;
-		}
-
-		video_data.decode_buf = (char *)av_dec_buf->outbuf;
-		video_data.width = data->video_info.width;
-		video_data.height = data->video_info.height;
-		video_data.format = 0;
-		if(ret != EN_NORMAL)
-		{
-			SYS_LOG_ERR("dec_plugin.decode failed!");
-			data->init_param.cb(VP_STATUS_ERROR, data->init_param.cb_data, &video_data);
-		}
-		else
-		{
-			if (data->mute && data->start_time) {
-				uint32_t actual_pts = os_uptime_get_32() - data->start_time;
-				SYS_LOG_DBG("cur_pts: %u, actual_pts: %u", data->cur_pts, actual_pts);
-				if (data->cur_pts > actual_pts) {
-					SYS_LOG_DBG("wait time: %u", data->cur_pts - actual_pts);
-					os_sleep(data->cur_pts - actual_pts);
-				}
-			}
-			data->init_param.cb(VP_STATUS_PLAYING, data->init_param.cb_data, &video_data);
-		}
-
-		calculate_fps_check();
+		ret = video_present_frame(data, &frame_info);
+		video_stage_stat_check();
 	}
 	// audio
 	else if(frame_info.packet_type == AUDIO_ES)
 	{
 		if (!data->mute && data->aud_track) {
+			struct acts_ringbuf_vec vec[2];
+			bool in_place;
+			int pcm_max;
 			int len;
-	        av_dec_buf->outbuf = data->adpcm_outbuf;
+
+			audio_len = stream_get_length(data->audio_stream);
+			SYS_LOG_DBG("audio_len : %d", audio_len);
+			if (audio_len >= AUDIO_WR_THRESHOLD)
+			{
+				int wait_time = (audio_len -AUDIO_WR_THRESHOLD)*1000/2/Samples_per_sec;
+				if (wait_time>0 && wait_time<100) {
+					SYS_LOG_DBG("wait_time : %d", wait_time);
+					os_sleep(wait_time);
+				} else {
+					if (wait_time)
+						SYS_LOG_WRN("### wait time: %d ms !!!", wait_time);
+				}
+			}
+
+			//adpcm expands at most 4 times, decode straight into the track
+			//when the whole frame fits before the wrap point
+			pcm_max = MIN(av_dec_buf->data_len * 4, sizeof(data->adpcm_outbuf));
+			in_place = (audio_track_write_claim(data->aud_track, vec, pcm_max) > 0
+					&& vec[0].len >= pcm_max);
+	        av_dec_buf->outbuf = in_place ? (short *)vec[0].data : data->adpcm_outbuf;
 			len = data->wav_plugin->decode(data->wav_handle, av_dec_buf);
 			if (len < EN_NORMAL) {
 				SYS_LOG_ERR("wav_plugin->decode failed!");
 			} else {
-				audio_len = stream_get_length(data->audio_stream);
-				SYS_LOG_DBG("audio_len : %d", audio_len);
-				if (audio_len >= AUDIO_WR_THRESHOLD)
-				{
-					int wait_time = (audio_len -AUDIO_WR_THRESHOLD)*1000/2/Samples_per_sec;
-					if (wait_time>0 && wait_time<100) {
-						SYS_LOG_DBG("wait_time : %d", wait_time);
-						os_sleep(wait_time);
-					} else {
-						if (wait_time)
-							SYS_LOG_WRN("### wait time: %d ms !!!", wait_time);
-					}
+				if (in_place) {
+					audio_track_write_finish(data->aud_track, vec, len);
+				} else {
+					audio_track_write(data->aud_track, (unsigned char *)data->adpcm_outbuf, len);
 				}
 
-	            audio_track_write(data->aud_track, (unsigned char *)data->adpcm_outbuf, len);
+				//audio clock starts from the first pcm written after open or seek
+				if (!data->audio_clock_valid) {
+					data->audio_base_pts = frame_info.pts;
+					data->audio_samples = 0;
+					data->audio_clock_valid = true;
+				}
+				data->audio_samples += len / 2;
 			}
 		}
 	}
@@ -754,10 +956,7 @@ static void video_cmd_handle(video_player_data_t *data, struct app_msg *msg)
 				if (ret)
 					break;
 
-				if (data->decode_buf == NULL) {
-					data->decode_buf_size = data->video_info.height * data->video_info.width * 2;
-					data->decode_buf = data->init_param.alloc(data->decode_buf_size);
-				}
+				video_dec_alloc_buf(data);
 				video_playing_handle(data);
 				data->status = VP_STATUS_PRELOAD;
 			}
@@ -31,6 +31,9 @@
 
 #define ADPCM_MAX_FRAME_SIZE  (3200)
 
+/* decode into one buffer while the other is on display */
+#define VIDEO_DECODE_BUF_NUM	2
+
 enum video_player_msg {
 	MSG_VIDEO_PLAYER = MSG_SRV_MESSAGE_START,
 };
@@ -52,8 +55,12 @@ typedef struct {
 	video_init_param_t init_param;
 	vp_status_e status;
 	vp_playmode_e play_mode;
-	void *decode_buf;
+	void *decode_buf;	//buffer of the frame on display
 	int decode_buf_size;
+	void *decode_bufs[VIDEO_DECODE_BUF_NUM];
+	uint8_t decode_buf_num;
+	uint8_t decode_idx;
+	uint8_t drop_count;
 	io_stream_t file_stream;
 	demuxer_plugin_t *dem_plugin;
 	dec_plugin_t *dec_plugin;
@@ -78,6 +85,9 @@ typedef struct {
 	bool user_stop;
 	uint32_t start_time;
 	struct acts_ringbuf *frame_ringbuf;
+	bool audio_clock_valid;
+	uint32_t audio_base_pts;
+	uint64_t audio_samples;
 } video_player_data_t;
 
 int char_to_short(char *in, int len, char *out, int size);
@@ -102,9 +102,7 @@ lv_res_t lv_gpu_acts_decompress_draw_img_dsc(
 static bool _is_decompress(const uint8_t * raw_data, size_t len)
 {
     compress_pic_head_t *pic_head = (compress_pic_head_t *)raw_data;
-    if ((pic_head->magic != LZ4_PIC_MAGIC &&
-        pic_head->magic != RLE_PIC_MAGIC &&
-        pic_head->magic != RAW_PIC_MAGIC)
+    if (!IS_COMPRESSED_PIC_MAGIC(pic_head->magic)
 		|| pic_head->bytes_per_pixel != 2) {
         return false;
     }
@@ -138,9 +138,7 @@ static bool _is_jpg(const uint8_t * raw_data, size_t len)
 {
 #ifdef CONFIG_LVGL_USE_IMG_DECODER_ACTS
     compress_pic_head_t *pic_head = (compress_pic_head_t *)raw_data;
-    if (pic_head->magic != LZ4_PIC_MAGIC &&
-        pic_head->magic != RLE_PIC_MAGIC &&
-        pic_head->magic != RAW_PIC_MAGIC) {
+    if (!IS_COMPRESSED_PIC_MAGIC(pic_head->magic)) {
         return true;
     }
 
@@ -125,7 +125,13 @@ static void _surface_post_handler(uint32_t event, void *data, void *user_data)
 	display_composer_round(&layer.crop);
 	memcpy(&layer.frame, &layer.crop, sizeof(layer.crop));
 
-	display_composer_post(&layer, 1, POST_FULL_FRAME);
+	if (post_data->num_regions > 1) {
+		/* only transfer the changed regions to the panel */
+		display_composer_post_regions(&layer, post_data->regions,
+				post_data->num_regions, POST_FULL_FRAME | POST_FRAME_TIMELINE);
+	} else {
+		display_composer_post(&layer, 1, POST_FULL_FRAME | POST_FRAME_TIMELINE);
+	}
 }
 
 static int _init_overlay_layer(ui_layer_t *layer, graphic_buffer_t *gbuf,
@@ -197,7 +203,8 @@ int lvgl_port_disp_init(void)
 	k_sem_init(&s_disp_data.ready_sem, 0, 1);
 	s_disp_data.pm_state = LV_PORT_PM_STATE_ACTIVE;
 
-	surface_t *surface = surface_create(hor_res, ver_res, SURFACE_PIXEL_FORMAT, 2, flags);
+	surface_t *surface = surface_create(hor_res, ver_res, SURFACE_PIXEL_FORMAT, 2,
+			flags | SURFACE_FRAME_TIMELINE);
 	if (surface == NULL) {
 		LV_LOG_ERROR("surface_create failed");
 		return LV_RES_INV;
@@ -20,6 +20,7 @@
 #endif
 
 #include <display/display_composer.h>
+#include <display/frame_timeline.h>
 #include <board_cfg.h>
 
 #include <logging/log.h>
@@ -71,6 +72,9 @@ static ui_region_t g_screen_areas[NUM_SCREEN_AREAS];
 #  define NUM_POST_ENTRIES  (NUM_SCREEN_AREAS * 3)
 #endif
 
+/* maximum parts of one frame posted by display_composer_post_regions() */
+#define MAX_POST_REGIONS  (8)
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -132,6 +136,10 @@ typedef struct display_composer {
 	uint16_t frame_cnt;
 #endif
 
+	/* bytes posted in current frame */
+	uint32_t frame_bytes;
+	display_composer_stats_t stats;
+
 #ifdef CONFIG_DISPLAY_COMPOSER_DEBUG_VSYNC
 	uint32_t vsync_timestamp; /* measure in cycles */
 	uint32_t vsync_print_timestamp; /* measure in cycles */
@@ -155,6 +163,8 @@ static post_entry_t *_composer_find_free_entry(display_composer_t *composer);
 static int _composer_post_top_entry(display_composer_t *composer, bool require_not_first);
 static void _composer_cleanup_entry(display_composer_t *composer, post_entry_t *entry);
 static void _composer_dump_entry(post_entry_t *entry);
+static void _composer_end_frame_stats(display_composer_t *composer);
+static int _composer_post(const ui_layer_t *layers, int num_layers, uint32_t post_flags);
 
 static int _composer_post_entry_noram(display_composer_t *composer);
 static void _composer_de_complete_handler(int status, uint16_t cmd_seq, void *user_data);
@@ -312,6 +322,15 @@ uint16_t display_composer_get_orientation(void)
 	return (uint16_t)composer->disp_cap.current_orientation * 90;
 }
 
+void display_composer_get_stats(display_composer_stats_t *stats)
+{
+	display_composer_t *composer = _composer_get();
+
+	unsigned int key = os_irq_lock();
+	memcpy(stats, &composer->stats, sizeof(*stats));
+	os_irq_unlock(key);
+}
+
 uint8_t display_composer_get_num_layers(void)
 {
 	display_composer_t *composer = _composer_get();
@@ -446,6 +465,8 @@ static void _composer_display_vsync_handler(const struct display_callback *callb
 	if (++composer->post_frame_cnt >= composer->post_frame_period) {
 		composer->post_frame_cnt = 0;
 
+		frame_timeline_mark(FRAME_TL_VSYNC);
+
 		if (_composer_has_gram(composer) && composer->post_cnt > 0 && !composer->post_inprog) {
 			_composer_post_top_entry(composer, false);
 		}
@@ -485,11 +506,18 @@ static void _composer_display_complete_handler(const struct display_callback *ca
 	composer->post_inprog = 0;
 
 	if (entry->flags & LAST_POST_IN_FRAME) {
+		if (entry->flags & POST_FRAME_TIMELINE) {
+			frame_timeline_mark(FRAME_TL_PANEL_CPLT);
+		}
+
 		if (composer->vsync_counter != composer->frame_start_vsync_cnt) {
 			uint32_t frame_cycles = k_cycle_get_32() - composer->frame_start_cycle;
 			SYS_LOG_WRN("frame refresh over vsync: %u us\n", k_cyc_to_us_floor32(frame_cycles));
 
 			sys_trace_void(SYS_TRACE_ID_COMPOSER_OVERVSYNC);
+			if (entry->flags & POST_FRAME_TIMELINE) {
+				frame_timeline_mark(FRAME_TL_OVER_VSYNC);
+			}
 		}
 	}
 
@@ -514,6 +542,11 @@ static void _composer_de_complete_handler(int status, uint16_t cmd_seq, void *us
 	/* TODO: recovery the display */
 	assert(status == 0);
 
+	if ((composer->post_entries[composer->cplt_idx].flags & (LAST_POST_IN_FRAME | POST_FRAME_TIMELINE)) ==
+			(LAST_POST_IN_FRAME | POST_FRAME_TIMELINE)) {
+		frame_timeline_mark(FRAME_TL_PANEL_CPLT);
+	}
+
 	_composer_complete_one_entry(composer);
 
 	if (composer->post_cnt == 0 && composer->user_cb && composer->user_cb->complete) {
@@ -618,6 +651,9 @@ static int _composer_post_top_entry(display_composer_t *composer, bool require_n
 	if (entry->flags & FIRST_POST_IN_FRAME) {
 		composer->frame_start_vsync_cnt = composer->vsync_counter;
 		composer->frame_start_cycle = k_cycle_get_32();
+		if (entry->flags & POST_FRAME_TIMELINE) {
+			frame_timeline_mark(FRAME_TL_POST_START);
+		}
 	}
 
 	if (entry->flags & POST_PATH_BY_DE) {
@@ -648,6 +684,11 @@ static int _composer_post_entry_noram(display_composer_t *composer)
 	uint8_t num_layers = ovls[1].buffer ? 2 : 1;
 	int res;
 
+	if ((entry->flags & (FIRST_POST_IN_FRAME | POST_FRAME_TIMELINE)) ==
+			(FIRST_POST_IN_FRAME | POST_FRAME_TIMELINE)) {
+		frame_timeline_mark(FRAME_TL_POST_START);
+	}
+
 	res = display_engine_compose(composer->de_dev, composer->de_inst,
 			NULL, ovls, num_layers);
 
@@ -693,6 +734,48 @@ static void _composer_dump_entry(post_entry_t *entry)
 	}
 }
 
+static void _composer_end_frame_stats(display_composer_t *composer)
+{
+	composer->stats.frame_cnt++;
+	composer->stats.last_frame_bytes = composer->frame_bytes;
+	composer->stats.total_bytes += composer->frame_bytes;
+	if (composer->stats.max_frame_bytes < composer->frame_bytes) {
+		composer->stats.max_frame_bytes = composer->frame_bytes;
+	}
+
+	composer->frame_bytes = 0;
+}
+
+/* the last part of the frame failed to post, end the frame at the newest entry queued */
+static void _composer_end_frame_early(display_composer_t *composer)
+{
+	k_spinlock_key_t key = k_spin_lock(&composer->post_lock);
+
+	if (composer->post_cnt > 0) {
+		uint8_t idx = (composer->free_idx > 0) ? composer->free_idx - 1 : NUM_POST_ENTRIES - 1;
+
+		composer->post_entries[idx].flags |= LAST_POST_IN_FRAME;
+	}
+
+	_composer_end_frame_stats(composer);
+	k_spin_unlock(&composer->post_lock, key);
+}
+
+#ifdef CONFIG_DISPLAY_COMPOSER_DEBUG_FPS
+static void _composer_count_fps(display_composer_t *composer)
+{
+	uint32_t timestamp = k_cycle_get_32();
+
+	++composer->frame_cnt;
+	if ((timestamp - composer->frame_timestamp) >= sys_clock_hw_cycles_per_sec()) {
+		LOG_INF("post fps %u, %u bytes/frame\n", composer->frame_cnt,
+				composer->stats.last_frame_bytes);
+		composer->frame_cnt = 0;
+		composer->frame_timestamp = timestamp;
+	}
+}
+#endif
+
 static int _composer_post_inner(const ui_layer_t *layers, int num_layers, uint32_t post_flags)
 {
 	display_composer_t *composer = _composer_get();
@@ -753,6 +836,12 @@ static int _composer_post_inner(const ui_layer_t *layers, int num_layers, uint32
 	k_spinlock_key_t key = k_spin_lock(&composer->post_lock);
 	composer->post_cnt++;
 
+	composer->frame_bytes += (uint32_t)entry->ovls[0].frame.w * entry->ovls[0].frame.h *
+			display_format_get_bits_per_pixel(composer->disp_cap.current_pixel_format) / 8;
+	if (post_flags & LAST_POST_IN_FRAME) {
+		_composer_end_frame_stats(composer);
+	}
+
 	if (!_composer_has_gram(composer)) {
 		_composer_post_entry_noram(composer);
 	} else if (!composer->post_inprog) {
@@ -846,23 +935,21 @@ static int _composer_post_areas(const ui_layer_t *layers, int num_layers, uint32
 
 int display_composer_post(const ui_layer_t *layers, int num_layers, uint32_t post_flags)
 {
-	display_composer_t *composer = _composer_get();
-	uint8_t num_free_entries;
-	int res = 0, i;
-
 #ifdef CONFIG_DISPLAY_COMPOSER_DEBUG_FPS
 	if (post_flags & LAST_POST_IN_FRAME) {
-		uint32_t timestamp = k_cycle_get_32();
-
-		++composer->frame_cnt;
-		if ((timestamp - composer->frame_timestamp) >= sys_clock_hw_cycles_per_sec()) {
-			LOG_INF("post fps %u\n", composer->frame_cnt);
-			composer->frame_cnt = 0;
-			composer->frame_timestamp = timestamp;
-		}
+		_composer_count_fps(_composer_get());
 	}
 #endif
 
+	return _composer_post(layers, num_layers, post_flags);
+}
+
+static int _composer_post(const ui_layer_t *layers, int num_layers, uint32_t post_flags)
+{
+	display_composer_t *composer = _composer_get();
+	uint8_t num_free_entries;
+	int res = 0, i;
+
 	if (composer->disp_dev == NULL) {
 		SYS_LOG_ERR("composer not initialized");
 		goto fail_cleanup_cb;
@@ -924,6 +1011,122 @@ fail_cleanup_cb:
 	return -EINVAL;
 }
 
+static int32_t _region_merge_cost(const ui_region_t *region1, const ui_region_t *region2)
+{
+	ui_region_t merged;
+
+	ui_region_merge(&merged, region1, region2);
+
+	return ui_region_get_size(&merged) - ui_region_get_size(region1) -
+			ui_region_get_size(region2);
+}
+
+/* merge the pair of regions which costs the least extra pixels */
+static void _merge_nearest_regions(ui_region_t regions[], int num)
+{
+	int32_t min_cost = INT32_MAX;
+	int min_i = 0, min_j = 1;
+
+	for (int i = 0; i < num - 1; i++) {
+		for (int j = i + 1; j < num; j++) {
+			int32_t cost = _region_merge_cost(&regions[i], &regions[j]);
+
+			if (cost < min_cost) {
+				min_cost = cost;
+				min_i = i;
+				min_j = j;
+			}
+		}
+	}
+
+	ui_region_merge(&regions[min_i], &regions[min_i], &regions[min_j]);
+	regions[min_j] = regions[num - 1];
+}
+
+int display_composer_post_regions(const ui_layer_t *layer, const ui_region_t *regions,
+		int num_regions, uint32_t post_flags)
+{
+	display_composer_t *composer = _composer_get();
+	const uint32_t last_post_flag = post_flags & LAST_POST_IN_FRAME;
+	ui_region_t areas[MAX_POST_REGIONS + 1];
+	ui_layer_t tmp_layer;
+	int max_areas = 1;
+	int num = 0;
+	int res = 0;
+	int i;
+
+	/* partial posts rely on the panel GRAM keeping the unchanged content */
+	if (_composer_has_gram(composer) && !composer->first_frame) {
+		max_areas = _composer_num_free_entries_get(composer) / NUM_SCREEN_AREAS;
+		max_areas = MAX(MIN(max_areas, MAX_POST_REGIONS), 1);
+	}
+
+	for (i = 0; i < num_regions; i++) {
+		ui_region_t area = regions[i];
+
+		display_composer_round(&area);
+		if (!ui_region_intersect(&areas[num], &area, &layer->frame)) {
+			continue;
+		}
+
+		if (++num > max_areas) {
+			_merge_nearest_regions(areas, num--);
+		}
+	}
+
+	if (num == 0) {
+		if (layer->cleanup_cb)
+			layer->cleanup_cb(layer->cleanup_data);
+		return -EINVAL;
+	}
+
+#ifdef CONFIG_DISPLAY_COMPOSER_DEBUG_FPS
+	/* one frame however many regions it is posted in */
+	if (last_post_flag) {
+		_composer_count_fps(composer);
+	}
+#endif
+
+	memcpy(&tmp_layer, layer, sizeof(tmp_layer));
+	post_flags &= ~LAST_POST_IN_FRAME;
+
+	for (i = 0; i < num; i++) {
+		tmp_layer.frame = areas[i];
+		tmp_layer.crop.x1 = layer->crop.x1 + areas[i].x1 - layer->frame.x1;
+		tmp_layer.crop.y1 = layer->crop.y1 + areas[i].y1 - layer->frame.y1;
+		tmp_layer.crop.x2 = tmp_layer.crop.x1 + ui_region_get_width(&areas[i]) - 1;
+		tmp_layer.crop.y2 = tmp_layer.crop.y1 + ui_region_get_height(&areas[i]) - 1;
+
+		if (i == num - 1) {
+			post_flags |= last_post_flag;
+			tmp_layer.cleanup_cb = layer->cleanup_cb;
+		} else {
+			tmp_layer.cleanup_cb = NULL;
+		}
+
+		res = _composer_post(&tmp_layer, 1, post_flags);
+		if (res < 0) {
+			break;
+		}
+
+		post_flags &= ~FIRST_POST_IN_FRAME;
+	}
+
+	if (res < 0) {
+		/* the cleanup not called by _composer_post() yet */
+		if (i < num - 1 && layer->cleanup_cb) {
+			layer->cleanup_cb(layer->cleanup_data);
+		}
+
+		/* the regions accepted must still end the frame */
+		if (i > 0 && last_post_flag) {
+			_composer_end_frame_early(composer);
+		}
+	}
+
+	return res;
+}
+
 int display_composer_flush(unsigned int timeout)
 {
 	display_composer_t *composer = _composer_get();
@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2020 Actions Technology Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr.h>
+#include <display/frame_timeline.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#ifndef CONFIG_DISPLAY_FRAME_TIMELINE_SIZE
+#  define CONFIG_DISPLAY_FRAME_TIMELINE_SIZE  64
+#endif
+
+#define NUM_FRAME_RECORDS  CONFIG_DISPLAY_FRAME_TIMELINE_SIZE
+
+/* frames drawn but not transferred more than this, the oldest one is lost */
+#define MAX_PENDING_FRAMES  4
+
+#define FRAME_EVENT_BIT(event)  (1u << (event))
+#define FRAME_EVENTS_ALL  (FRAME_EVENT_BIT(FRAME_TL_NUM_EVENTS) - 1)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct frame_record {
+	/* timestamps in cycles */
+	uint32_t timestamps[FRAME_TL_NUM_EVENTS];
+	/* vsync counter at post start */
+	uint32_t vsync_cnt;
+	/* bitmask of recorded events */
+	uint8_t events;
+} frame_record_t;
+
+typedef struct frame_timeline {
+	frame_record_t frames[NUM_FRAME_RECORDS];
+	/* sequence of the next frame to draw */
+	uint32_t draw_seq;
+	/* sequence of the next frame to transfer */
+	uint32_t disp_seq;
+
+	uint32_t vsync_cnt;
+	uint32_t vsync_timestamp;
+	uint32_t vsync_period; /* in cycles */
+
+	/* the last frame posted */
+	uint32_t post_vsync_cnt;
+	uint32_t post_timestamp;
+	uint8_t has_posted;
+
+	uint32_t vsync_gaps[FRAME_TL_NUM_VSYNC_GAPS];
+	uint32_t missed_vsync_cnt;
+	uint32_t over_vsync_cnt;
+	uint32_t lost_cnt;
+} frame_timeline_t;
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static frame_timeline_t frame_timeline;
+
+/**********************
+ *  STATIC FUNCTIONS
+ **********************/
+
+static inline frame_record_t *_frame_get(frame_timeline_t *tl, uint32_t seq)
+{
+	return &tl->frames[seq % NUM_FRAME_RECORDS];
+}
+
+static inline void _frame_stamp(frame_record_t *frame, uint8_t event, uint32_t timestamp)
+{
+	frame->timestamps[event] = timestamp;
+	frame->events |= FRAME_EVENT_BIT(event);
+}
+
+static void _frame_post_start(frame_timeline_t *tl, uint32_t timestamp)
+{
+	/* find the oldest frame finished drawing but not posted */
+	for (uint32_t seq = tl->disp_seq; seq != tl->draw_seq; seq++) {
+		frame_record_t *frame = _frame_get(tl, seq);
+		uint32_t gap;
+
+		if ((frame->events & FRAME_EVENT_BIT(FRAME_TL_DRAW_END)) == 0 ||
+			(frame->events & FRAME_EVENT_BIT(FRAME_TL_POST_START))) {
+			continue;
+		}
+
+		_frame_stamp(frame, FRAME_TL_POST_START, timestamp);
+		frame->vsync_cnt = tl->vsync_cnt;
+
+		if (tl->has_posted) {
+			gap = tl->vsync_cnt - tl->post_vsync_cnt;
+			tl->vsync_gaps[MIN(MAX(gap, 1), FRAME_TL_NUM_VSYNC_GAPS) - 1]++;
+
+			/* continuous animation: drawing started before the last post (+1 vsync) */
+			if (gap > 1 && (int32_t)(frame->timestamps[FRAME_TL_DRAW_START] -
+					tl->post_timestamp) < (int32_t)tl->vsync_period) {
+				tl->missed_vsync_cnt += gap - 1;
+			}
+		}
+
+		tl->post_vsync_cnt = tl->vsync_cnt;
+		tl->post_timestamp = timestamp;
+		tl->has_posted = 1;
+		break;
+	}
+}
+
+static void _frame_panel_complete(frame_timeline_t *tl, uint32_t timestamp)
+{
+	frame_record_t *frame;
+
+	if (tl->disp_seq == tl->draw_seq) {
+		return;
+	}
+
+	frame = _frame_get(tl, tl->disp_seq);
+	if (frame->events & FRAME_EVENT_BIT(FRAME_TL_POST_START)) {
+		_frame_stamp(frame, FRAME_TL_PANEL_CPLT, timestamp);
+		tl->disp_seq++;
+	}
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void frame_timeline_mark(uint8_t event)
+{
+	frame_timeline_t *tl = &frame_timeline;
+	uint32_t timestamp = k_cycle_get_32();
+	unsigned int key = irq_lock();
+
+	switch (event) {
+	case FRAME_TL_DRAW_START:
+		if (tl->draw_seq - tl->disp_seq >= MAX_PENDING_FRAMES) {
+			tl->disp_seq++;
+			tl->lost_cnt++;
+		}
+
+		memset(_frame_get(tl, tl->draw_seq), 0, sizeof(frame_record_t));
+		_frame_stamp(_frame_get(tl, tl->draw_seq), event, timestamp);
+		tl->draw_seq++;
+		break;
+
+	case FRAME_TL_SWAP_DONE:
+	case FRAME_TL_DRAW_END:
+		if (tl->draw_seq != tl->disp_seq) {
+			_frame_stamp(_frame_get(tl, tl->draw_seq - 1), event, timestamp);
+		}
+		break;
+
+	case FRAME_TL_POST_START:
+		_frame_post_start(tl, timestamp);
+		break;
+
+	case FRAME_TL_PANEL_CPLT:
+		_frame_panel_complete(tl, timestamp);
+		break;
+
+	case FRAME_TL_VSYNC:
+		if (tl->vsync_cnt > 0) {
+			tl->vsync_period = timestamp - tl->vsync_timestamp;
+		}
+
+		tl->vsync_timestamp = timestamp;
+		tl->vsync_cnt++;
+		break;
+
+	case FRAME_TL_OVER_VSYNC:
+		tl->over_vsync_cnt++;
+		break;
+
+	default:
+		break;
+	}
+
+	irq_unlock(key);
+}
+
+static void _sort_values(uint32_t *values, int num)
+{
+	for (int i = 1; i < num; i++) {
+		uint32_t value = values[i];
+		int j = i - 1;
+
+		for (; j >= 0 && values[j] > value; j--) {
+			values[j + 1] = values[j];
+		}
+
+		values[j + 1] = value;
+	}
+}
+
+static uint32_t _stage_duration(const frame_record_t *frame, const frame_record_t *prev, uint8_t stage)
+{
+	const uint32_t *ts = frame->timestamps;
+
+	switch (stage) {
+	case FRAME_TL_STAGE_SWAP_WAIT:
+		return ts[FRAME_TL_SWAP_DONE] - ts[FRAME_TL_DRAW_START];
+	case FRAME_TL_STAGE_DRAW:
+		return ts[FRAME_TL_DRAW_END] - ts[FRAME_TL_SWAP_DONE];
+	case FRAME_TL_STAGE_POST_WAIT:
+		return ts[FRAME_TL_POST_START] - ts[FRAME_TL_DRAW_END];
+	case FRAME_TL_STAGE_TRANSFER:
+		return ts[FRAME_TL_PANEL_CPLT] - ts[FRAME_TL_POST_START];
+	case FRAME_TL_STAGE_TOTAL:
+		return ts[FRAME_TL_PANEL_CPLT] - ts[FRAME_TL_DRAW_START];
+	case FRAME_TL_STAGE_INTERVAL:
+	default:
+		return ts[FRAME_TL_POST_START] - prev->timestamps[FRAME_TL_POST_START];
+	}
+}
+
+int frame_timeline_get_stats(frame_timeline_stats_t *stats)
+{
+	frame_timeline_t *tl = &frame_timeline;
+	uint32_t values[NUM_FRAME_RECORDS];
+	uint32_t first_seq, end_seq;
+	unsigned int key;
+
+	memset(stats, 0, sizeof(*stats));
+
+	for (int stage = 0; stage < FRAME_TL_NUM_STAGES; stage++) {
+		frame_timeline_percentiles_t *pct = &stats->stages[stage];
+		const frame_record_t *prev = NULL;
+		int num = 0;
+
+		key = irq_lock();
+
+		end_seq = tl->disp_seq;
+		first_seq = (tl->draw_seq > NUM_FRAME_RECORDS) ? (tl->draw_seq - NUM_FRAME_RECORDS) : 0;
+
+		for (uint32_t seq = first_seq; seq != end_seq; seq++) {
+			const frame_record_t *frame = _frame_get(tl, seq);
+
+			if (frame->events != FRAME_EVENTS_ALL) {
+				prev = NULL;
+				continue;
+			}
+
+			if (stage != FRAME_TL_STAGE_INTERVAL || prev != NULL) {
+				values[num++] = _stage_duration(frame, prev, stage);
+			}
+
+			prev = frame;
+		}
+
+		if (stage == 0) {
+			stats->vsync_period = k_cyc_to_us_floor32(tl->vsync_period);
+			memcpy(stats->vsync_gaps, tl->vsync_gaps, sizeof(stats->vsync_gaps));
+			stats->missed_vsync_cnt = tl->missed_vsync_cnt;
+			stats->over_vsync_cnt = tl->over_vsync_cnt;
+			stats->lost_cnt = tl->lost_cnt;
+			stats->num_frames = num;
+		}
+
+		irq_unlock(key);
+
+		if (num == 0) {
+			continue;
+		}
+
+		_sort_values(values, num);
+
+		pct->p50 = k_cyc_to_us_floor32(values[(num - 1) * 50 / 100]);
+		pct->p90 = k_cyc_to_us_floor32(values[(num - 1) * 90 / 100]);
+		pct->p99 = k_cyc_to_us_floor32(values[(num - 1) * 99 / 100]);
+		pct->max = k_cyc_to_us_floor32(values[num - 1]);
+	}
+
+	return 0;
+}
+
+void frame_timeline_reset(void)
+{
+	frame_timeline_t *tl = &frame_timeline;
+	unsigned int key = irq_lock();
+
+	/* keep the vsync state and the frames still in progress */
+	for (uint32_t seq = tl->disp_seq - MIN(tl->disp_seq, NUM_FRAME_RECORDS); seq != tl->disp_seq; seq++) {
+		_frame_get(tl, seq)->events = 0;
+	}
+
+	tl->has_posted = 0;
+	memset(tl->vsync_gaps, 0, sizeof(tl->vsync_gaps));
+	tl->missed_vsync_cnt = 0;
+	tl->over_vsync_cnt = 0;
+	tl->lost_cnt = 0;
+
+	irq_unlock(key);
+}
+
+#ifdef CONFIG_DISPLAY_FRAME_TIMELINE_SHELL
+#include <shell/shell.h>
+
+static const char * const stage_names[FRAME_TL_NUM_STAGES] = {
+	"swap wait", "draw", "post wait", "transfer", "total", "interval",
+};
+
+static int cmd_frame_timeline_show(const struct shell *shell,
+			size_t argc, char **argv)
+{
+	frame_timeline_stats_t stats;
+
+	frame_timeline_get_stats(&stats);
+
+	shell_print(shell, "frames %u, vsync period %u us", stats.num_frames, stats.vsync_period);
+	shell_print(shell, "%-10s %8s %8s %8s %8s (us)", "stage", "p50", "p90", "p99", "max");
+
+	for (int i = 0; i < FRAME_TL_NUM_STAGES; i++) {
+		shell_print(shell, "%-10s %8u %8u %8u %8u", stage_names[i],
+				stats.stages[i].p50, stats.stages[i].p90,
+				stats.stages[i].p99, stats.stages[i].max);
+	}
+
+	shell_print(shell, "vsync gaps: 1:%u 2:%u 3:%u 4+:%u", stats.vsync_gaps[0],
+			stats.vsync_gaps[1], stats.vsync_gaps[2], stats.vsync_gaps[3]);
+	shell_print(shell, "missed vsync %u, over vsync %u, lost frames %u",
+			stats.missed_vsync_cnt, stats.over_vsync_cnt, stats.lost_cnt);
+	return 0;
+}
+
+static int cmd_frame_timeline_reset(const struct shell *shell,
+			size_t argc, char **argv)
+{
+	frame_timeline_reset();
+	shell_print(shell, "frame timeline reset");
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_frametl,
+	SHELL_CMD(show, NULL, "show per-stage latency percentiles and vsync statistics", cmd_frame_timeline_show),
+	SHELL_CMD(reset, NULL, "reset statistics", cmd_frame_timeline_reset),
+	SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_REGISTER(frametl, &sub_frametl, "Display frame timeline commands", NULL);
+#endif /* CONFIG_DISPLAY_FRAME_TIMELINE_SHELL */
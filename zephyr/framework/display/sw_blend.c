@@ -24,6 +24,66 @@ static const uint8_t g_bpp4_opa_table[16] = {
 	136, 153, 170, 187, 204, 221, 238, 255
 };
 
+/*
+ * The alpha mask paths below look at the opacities of 4 pixels at a time
+ * (loaded as one little endian word from A8, or from 2 bytes of A4), skip
+ * the fully transparent ones and fill the fully opaque ones. Aligned RGB565
+ * pixel pairs are loaded and stored a word at a time. The per-pixel math is
+ * the same as blend_argb8888_over_rgb565(), so are the results.
+ */
+#define OPA4_TRANSP 0x00000000
+#define OPA4_COVER  0xffffffff
+
+/*
+ * blend a solid color over 4 rgb565 pixels
+ *
+ * @param dst address of the 4 dst pixels
+ * @param src_color src color with alpha cleared
+ * @param opa4 opacities, the first pixel at the lowest byte
+ */
+static inline void blend_color_x4_over_rgb565(uint16_t *dst, uint32_t src_color, uint32_t opa4)
+{
+	if (((uintptr_t)dst & 0x3) == 0) {
+		uint32_t *dst32 = (uint32_t *)dst;
+
+		for (int k = 2; k > 0; k--, dst32++, opa4 >>= 16) {
+			uint32_t c2 = *dst32;
+
+			if ((opa4 & 0xffff) == 0)
+				continue;
+
+			c2 = blend_argb8888_over_rgb565(c2 & 0xffff, src_color | (opa4 << 24)) |
+				((uint32_t)blend_argb8888_over_rgb565(c2 >> 16, src_color | ((opa4 & 0xff00) << 16)) << 16);
+			*dst32 = c2;
+		}
+	} else {
+		for (int k = 4; k > 0; k--, dst++, opa4 >>= 8)
+			*dst = blend_argb8888_over_rgb565(*dst, src_color | (opa4 << 24));
+	}
+}
+
+static inline void blend_color_x4_over_argb8888(uint32_t *dst, uint32_t src_color, uint32_t opa4)
+{
+	for (int k = 4; k > 0; k--, dst++, opa4 >>= 8)
+		*dst = blend_argb8888_over_argb8888(*dst, src_color | (opa4 << 24));
+}
+
+/* scale the 4 opacities by opa, the same as (opa4[i] * opa) >> 8 */
+static inline uint32_t opa4_scale(uint32_t opa4, uint8_t opa)
+{
+	uint32_t lo = ((opa4 & 0x00ff00ff) * opa >> 8) & 0x00ff00ff;
+	uint32_t hi = (((opa4 >> 8) & 0x00ff00ff) * opa >> 8) & 0x00ff00ff;
+
+	return lo | (hi << 8);
+}
+
+/* the 4 opacities of 2 bytes of A4 mask, MSB pixel first */
+static inline uint32_t opa4_from_a4(const uint8_t *src, const uint8_t *opa_table)
+{
+	return opa_table[src[0] >> 4] | ((uint32_t)opa_table[src[0] & 0xf] << 8) |
+		((uint32_t)opa_table[src[1] >> 4] << 16) | ((uint32_t)opa_table[src[1] & 0xf] << 24);
+}
+
 void sw_blend_color_over_rgb565(void *dst, uint32_t src_color,
 		uint16_t dst_pitch, uint16_t w, uint16_t h)
 {
@@ -99,42 +159,52 @@ void sw_blend_a8_over_rgb565(void *dst, const void *src, uint32_t src_color,
 
 	const uint8_t *src8 = src;
 	uint8_t *dst8 = dst;
+	uint16_t cover_color = blend_argb8888_over_rgb565(0, src_color | 0xFF000000);
 
 	src_color &= ~0xFF000000;
 
-	if (src_opa == 255) {
-		for (int j = h; j > 0; j--) {
-			const uint8_t *tmp_src = src8;
-			uint16_t *tmp_dst = (uint16_t *)dst8;
-
-			for (int i = w; i > 0; i--) {
-				uint32_t color32 = src_color | ((uint32_t)*tmp_src << 24);
+	for (int j = h; j > 0; j--) {
+		const uint8_t *tmp_src = src8;
+		uint16_t *tmp_dst = (uint16_t *)dst8;
+		int i = w;
 
-				*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, color32);
-				tmp_dst++;
-				tmp_src++;
-			}
+		for (; i > 0 && ((uintptr_t)tmp_src & 0x3); i--) {
+			uint8_t opa = (src_opa == 255) ? *tmp_src : ((*tmp_src * src_opa) >> 8);
 
-			dst8 += dst_pitch;
-			src8 += src_pitch;
+			*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, src_color | ((uint32_t)opa << 24));
+			tmp_dst++;
+			tmp_src++;
 		}
-	} else {
-		for (int j = h; j > 0; j--) {
-			const uint8_t *tmp_src = src8;
-			uint16_t *tmp_dst = (uint16_t *)dst8;
 
-			for (int i = w; i > 0; i--) {
-				uint8_t opa = (*tmp_src * src_opa) >> 8;
-				uint32_t color32 = src_color | ((uint32_t)opa << 24);
+		for (; i >= 4; i -= 4) {
+			uint32_t opa4 = *(const uint32_t *)tmp_src;
 
-				*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, color32);
-				tmp_dst++;
-				tmp_src++;
+			if (opa4 == OPA4_COVER && src_opa == 255) {
+				tmp_dst[0] = cover_color;
+				tmp_dst[1] = cover_color;
+				tmp_dst[2] = cover_color;
+				tmp_dst[3] = cover_color;
+			} else if (opa4 != OPA4_TRANSP) {
+				if (src_opa < 255)
+					opa4 = opa4_scale(opa4, src_opa);
+
+				blend_color_x4_over_rgb565(tmp_dst, src_color, opa4);
 			}
 
-			dst8 += dst_pitch;
-			src8 += src_pitch;
+			tmp_dst += 4;
+			tmp_src += 4;
+		}
+
+		for (; i > 0; i--) {
+			uint8_t opa = (src_opa == 255) ? *tmp_src : ((*tmp_src * src_opa) >> 8);
+
+			*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, src_color | ((uint32_t)opa << 24));
+			tmp_dst++;
+			tmp_src++;
 		}
+
+		dst8 += dst_pitch;
+		src8 += src_pitch;
 	}
 }
 
@@ -216,42 +286,52 @@ void sw_blend_a8_over_argb8888(void *dst, const void *src, uint32_t src_color,
 
 	const uint8_t *src8 = src;
 	uint8_t *dst8 = dst;
+	uint32_t cover_color = src_color | 0xFF000000;
 
 	src_color &= ~0xFF000000;
 
-	if (src_opa == 255) {
-		for (int j = h; j > 0; j--) {
-			const uint8_t *tmp_src = src8;
-			uint32_t *tmp_dst = (uint32_t *)dst8;
-
-			for (int i = w; i > 0; i--) {
-				uint32_t color32 = src_color | ((uint32_t)*tmp_src << 24);
+	for (int j = h; j > 0; j--) {
+		const uint8_t *tmp_src = src8;
+		uint32_t *tmp_dst = (uint32_t *)dst8;
+		int i = w;
 
-				*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, color32);
-				tmp_dst++;
-				tmp_src++;
-			}
+		for (; i > 0 && ((uintptr_t)tmp_src & 0x3); i--) {
+			uint8_t opa = (src_opa == 255) ? *tmp_src : ((*tmp_src * src_opa) >> 8);
 
-			dst8 += dst_pitch;
-			src8 += src_pitch;
+			*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, src_color | ((uint32_t)opa << 24));
+			tmp_dst++;
+			tmp_src++;
 		}
-	} else {
-		for (int j = h; j > 0; j--) {
-			const uint8_t *tmp_src = src8;
-			uint32_t *tmp_dst = (uint32_t *)dst8;
 
-			for (int i = w; i > 0; i--) {
-				uint8_t opa = (*tmp_src * src_opa) >> 8;
-				uint32_t color32 = src_color | ((uint32_t)opa << 24);
+		for (; i >= 4; i -= 4) {
+			uint32_t opa4 = *(const uint32_t *)tmp_src;
 
-				*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, color32);
-				tmp_dst++;
-				tmp_src++;
+			if (opa4 == OPA4_COVER && src_opa == 255) {
+				tmp_dst[0] = cover_color;
+				tmp_dst[1] = cover_color;
+				tmp_dst[2] = cover_color;
+				tmp_dst[3] = cover_color;
+			} else if (opa4 != OPA4_TRANSP) {
+				if (src_opa < 255)
+					opa4 = opa4_scale(opa4, src_opa);
+
+				blend_color_x4_over_argb8888(tmp_dst, src_color, opa4);
 			}
 
-			dst8 += dst_pitch;
-			src8 += src_pitch;
+			tmp_dst += 4;
+			tmp_src += 4;
+		}
+
+		for (; i > 0; i--) {
+			uint8_t opa = (src_opa == 255) ? *tmp_src : ((*tmp_src * src_opa) >> 8);
+
+			*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, src_color | ((uint32_t)opa << 24));
+			tmp_dst++;
+			tmp_src++;
 		}
+
+		dst8 += dst_pitch;
+		src8 += src_pitch;
 	}
 }
 
@@ -271,30 +351,53 @@ void sw_blend_a4_over_rgb565(void *dst, const void *src, uint32_t src_color,
 	}
 
 	const uint8_t *src8 = src;
-	const uint8_t src_bpp = 4;
-	const uint8_t src_bmask = (1 << src_bpp) - 1;
-	const uint8_t src_bofs_max = 8 - src_bpp;
 	uint8_t *dst8 = dst;
+	uint16_t cover_color = blend_argb8888_over_rgb565(0, src_color | 0xFF000000);
 
 	src_color &= ~0xFF000000;
 
 	for (int j = h; j > 0; j--) {
 		const uint8_t *tmp_src = src8;
 		uint16_t *tmp_dst = (uint16_t *)dst8;
-		uint8_t bpos = src_bofs_max - src_bofs;
+		int i = w;
 
-		for (int i = w; i > 0; i--) {
-			uint8_t opa = opa_table[(*tmp_src >> bpos) & src_bmask];
-			uint32_t color32 = src_color | ((uint32_t)opa << 24);
+		/* start from the low 4 bits */
+		if (src_bofs > 0 && i > 0) {
+			uint8_t opa = opa_table[*tmp_src & 0xf];
 
-			*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, color32);
+			*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, src_color | ((uint32_t)opa << 24));
+			tmp_dst++;
+			tmp_src++;
+			i--;
+		}
+
+		for (; i >= 4; i -= 4) {
+			uint16_t opa4_a4 = tmp_src[0] | ((uint16_t)tmp_src[1] << 8);
+
+			if (opa4_a4 == 0xffff && src_opa == 255) {
+				tmp_dst[0] = cover_color;
+				tmp_dst[1] = cover_color;
+				tmp_dst[2] = cover_color;
+				tmp_dst[3] = cover_color;
+			} else if (opa4_a4 != 0) {
+				blend_color_x4_over_rgb565(tmp_dst, src_color, opa4_from_a4(tmp_src, opa_table));
+			}
+
+			tmp_dst += 4;
+			tmp_src += 2;
+		}
+
+		for (uint8_t bpos = 4; i > 0; i--) {
+			uint8_t opa = opa_table[(*tmp_src >> bpos) & 0xf];
+
+			*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, src_color | ((uint32_t)opa << 24));
 			tmp_dst++;
 
 			if (bpos == 0) {
-				bpos = src_bofs_max;
+				bpos = 4;
 				tmp_src++;
 			} else {
-				bpos -= src_bpp;
+				bpos = 0;
 			}
 		}
 
@@ -375,30 +478,53 @@ void sw_blend_a4_over_argb8888(void *dst, const void *src, uint32_t src_color,
 	}
 
 	const uint8_t *src8 = src;
-	const uint8_t src_bpp = 4;
-	const uint8_t src_bmask = (1 << src_bpp) - 1;
-	const uint8_t src_bofs_max = 8 - src_bpp;
 	uint8_t *dst8 = dst;
+	uint32_t cover_color = src_color | 0xFF000000;
 
 	src_color &= ~0xFF000000;
 
 	for (int j = h; j > 0; j--) {
 		const uint8_t *tmp_src = src8;
 		uint32_t *tmp_dst = (uint32_t *)dst8;
-		uint8_t bpos = src_bofs_max - src_bofs;
+		int i = w;
 
-		for (int i = w; i > 0; i--) {
-			uint8_t opa = opa_table[(*tmp_src >> bpos) & src_bmask];
-			uint32_t color32 = src_color | ((uint32_t)opa << 24);
+		/* start from the low 4 bits */
+		if (src_bofs > 0 && i > 0) {
+			uint8_t opa = opa_table[*tmp_src & 0xf];
 
-			*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, color32);
+			*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, src_color | ((uint32_t)opa << 24));
+			tmp_dst++;
+			tmp_src++;
+			i--;
+		}
+
+		for (; i >= 4; i -= 4) {
+			uint16_t opa4_a4 = tmp_src[0] | ((uint16_t)tmp_src[1] << 8);
+
+			if (opa4_a4 == 0xffff && src_opa == 255) {
+				tmp_dst[0] = cover_color;
+				tmp_dst[1] = cover_color;
+				tmp_dst[2] = cover_color;
+				tmp_dst[3] = cover_color;
+			} else if (opa4_a4 != 0) {
+				blend_color_x4_over_argb8888(tmp_dst, src_color, opa4_from_a4(tmp_src, opa_table));
+			}
+
+			tmp_dst += 4;
+			tmp_src += 2;
+		}
+
+		for (uint8_t bpos = 4; i > 0; i--) {
+			uint8_t opa = opa_table[(*tmp_src >> bpos) & 0xf];
+
+			*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, src_color | ((uint32_t)opa << 24));
 			tmp_dst++;
 
 			if (bpos == 0) {
-				bpos = src_bofs_max;
+				bpos = 4;
 				tmp_src++;
 			} else {
-				bpos -= src_bpp;
+				bpos = 0;
 			}
 		}
 
@@ -1291,13 +1417,35 @@ void sw_blend_argb8888_over_rgb565(void *dst, const void *src,
 	for (int j = h; j > 0; j--) {
 		const uint32_t *tmp_src = (uint32_t *)src8;
 		uint16_t *tmp_dst = (uint16_t *)dst8;
+		int i = w;
 
-		for (int i = w; i > 0; i--) {
+		if (((uintptr_t)tmp_dst & 0x3) && i > 0) {
 			*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, *tmp_src);
 			tmp_dst++;
 			tmp_src++;
+			i--;
 		}
 
+		/* 2 pixels a time, skip the transparent pairs */
+		for (; i >= 2; i -= 2) {
+			uint32_t c0 = tmp_src[0];
+			uint32_t c1 = tmp_src[1];
+
+			if ((c0 | c1) >= 0x01000000) {
+				uint32_t c2 = *(uint32_t *)tmp_dst;
+
+				c2 = blend_argb8888_over_rgb565(c2 & 0xffff, c0) |
+					((uint32_t)blend_argb8888_over_rgb565(c2 >> 16, c1) << 16);
+				*(uint32_t *)tmp_dst = c2;
+			}
+
+			tmp_dst += 2;
+			tmp_src += 2;
+		}
+
+		if (i > 0)
+			*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, *tmp_src);
+
 		src8 += src_pitch;
 		dst8 += dst_pitch;
 	}
@@ -4,37 +4,512 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <errno.h>
+#include <stdbool.h>
 #include <string.h>
 #include <display/sw_draw.h>
 #include <display/display_hal.h>
 
-static inline void cvt_buf_argb8888_to_bgr888(void * dest, const void * src, uint32_t len)
+#ifndef ARRAY_SIZE
+#  define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+#endif
+
+/* pixels converted at a time through the argb8888 intermediate buffer */
+#define CVT_CHUNK_SIZE 64
+
+#define IS_ALIGNED2(p) ((((uintptr_t)(p)) & 0x1) == 0)
+#define IS_ALIGNED4(p) ((((uintptr_t)(p)) & 0x3) == 0)
+
+/*
+ * Every format is converted from and to argb8888, which is stored in native
+ * 32-bit words. The unpack (to argb8888) and pack (from argb8888) kernels
+ * move whole words when the non-argb8888 side is suitably aligned, and fall
+ * back to bytes otherwise.
+ */
+typedef void (*cvt_unpack_fn)(uint32_t *dest, const uint8_t *src, uint32_t len);
+typedef void (*cvt_pack_fn)(uint8_t *dest, const uint32_t *src, uint32_t len);
+
+typedef struct {
+	uint32_t cf;
+	cvt_unpack_fn unpack;
+	cvt_pack_fn pack;
+} cvt_format_t;
+
+/*******************************************************************************
+ *      single pixel helpers
+ ******************************************************************************/
+static inline uint32_t rgb565_to_argb8888(uint32_t c)
+{
+	uint32_t rb = ((c & 0xf800) << 8) | ((c & 0x001f) << 3);
+	uint32_t g = (c & 0x07e0) << 5;
+
+	/* replicate the high bits into the low bits, 2 channels at a time */
+	rb |= (rb >> 5) & 0x070007;
+	g |= (g >> 6) & 0x000300;
+
+	return 0xff000000 | rb | g;
+}
+
+static inline uint32_t argb8888_to_rgb565(uint32_t c)
+{
+	return ((c >> 8) & 0xf800) | ((c >> 5) & 0x07e0) | ((c >> 3) & 0x001f);
+}
+
+static inline uint32_t swap_rb(uint32_t c)
+{
+	return (c & 0xff00ff00) | ((c >> 16) & 0xff) | ((c & 0xff) << 16);
+}
+
+static inline uint32_t expand6(uint32_t x)
+{
+	return (x << 2) | (x >> 4);
+}
+
+static inline uint32_t expand5(uint32_t x)
+{
+	return (x << 3) | (x >> 2);
+}
+
+static inline uint32_t load24(const uint8_t *src)
+{
+	return src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16);
+}
+
+static inline void store24(uint8_t *dest, uint32_t c)
+{
+	dest[0] = c;
+	dest[1] = c >> 8;
+	dest[2] = c >> 16;
+}
+
+/*******************************************************************************
+ *      unpack kernels
+ ******************************************************************************/
+static void unpack_argb8888(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	memcpy(dest, src, len * 4);
+}
+
+static void unpack_xrgb8888(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	if (IS_ALIGNED4(src)) {
+		const uint32_t *src32 = (const uint32_t *)src;
+
+		for (; len > 0; len--)
+			*dest++ = *src32++ | 0xff000000;
+	} else {
+		for (; len > 0; len--, src += 4)
+			*dest++ = load24(src) | 0xff000000;
+	}
+}
+
+static void unpack_rgb565(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	if (IS_ALIGNED2(src)) {
+		const uint16_t *src16 = (const uint16_t *)src;
+
+		if (!IS_ALIGNED4(src16) && len > 0) {
+			*dest++ = rgb565_to_argb8888(*src16++);
+			len--;
+		}
+
+		/* 2 pixels per load */
+		for (; len >= 2; len -= 2) {
+			uint32_t c = *(const uint32_t *)src16;
+
+			dest[0] = rgb565_to_argb8888(c);
+			dest[1] = rgb565_to_argb8888(c >> 16);
+			dest += 2;
+			src16 += 2;
+		}
+
+		if (len > 0)
+			*dest = rgb565_to_argb8888(*src16);
+	} else {
+		for (; len > 0; len--, src += 2)
+			*dest++ = rgb565_to_argb8888(src[0] | ((uint32_t)src[1] << 8));
+	}
+}
+
+static void unpack_rgb565_be(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	for (; len > 0; len--, src += 2)
+		*dest++ = rgb565_to_argb8888(src[1] | ((uint32_t)src[0] << 8));
+}
+
+/* RGB_888 is B, G, R in memory, so 4 pixels are exactly 3 words of argb8888 without alpha */
+static void unpack_rgb888(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	if (IS_ALIGNED4(src)) {
+		const uint32_t *src32 = (const uint32_t *)src;
+
+		for (; len >= 4; len -= 4) {
+			uint32_t w0 = src32[0], w1 = src32[1], w2 = src32[2];
+
+			dest[0] = w0 | 0xff000000;
+			dest[1] = (w0 >> 24) | (w1 << 8) | 0xff000000;
+			dest[2] = (w1 >> 16) | (w2 << 16) | 0xff000000;
+			dest[3] = (w2 >> 8) | 0xff000000;
+			dest += 4;
+			src32 += 3;
+		}
+
+		src = (const uint8_t *)src32;
+	}
+
+	for (; len > 0; len--, src += 3)
+		*dest++ = load24(src) | 0xff000000;
+}
+
+static void unpack_bgr888(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	uint32_t *dest_end = dest + len;
+
+	unpack_rgb888(dest, src, len);
+
+	for (; dest < dest_end; dest++)
+		*dest = swap_rb(*dest);
+}
+
+static void unpack_argb8565(uint32_t *dest, const uint8_t *src, uint32_t len)
 {
-	uint8_t *dest8 = dest;
-	const uint8_t *src8 = src;
+	for (; len > 0; len--, src += 3) {
+		uint32_t c = rgb565_to_argb8888(src[0] | ((uint32_t)src[1] << 8));
 
-	for (; len > 0; len--) {
-		*dest8++ = src8[2];
-		*dest8++ = src8[1];
-		*dest8++ = src8[0];
-		src8 += 4;
+		*dest++ = (c & 0x00ffffff) | ((uint32_t)src[2] << 24);
 	}
 }
 
+static void unpack_argb6666(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	for (; len > 0; len--, src += 3) {
+		uint32_t c = load24(src);
+
+		*dest++ = (expand6(c >> 18) << 24) | (expand6((c >> 12) & 0x3f) << 16) |
+				(expand6((c >> 6) & 0x3f) << 8) | expand6(c & 0x3f);
+	}
+}
+
+static void unpack_abgr6666(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	uint32_t *dest_end = dest + len;
+
+	unpack_argb6666(dest, src, len);
+
+	for (; dest < dest_end; dest++)
+		*dest = swap_rb(*dest);
+}
+
+static void unpack_argb1555(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	for (; len > 0; len--, src += 2) {
+		uint32_t c = src[0] | ((uint32_t)src[1] << 8);
+
+		*dest++ = ((c & 0x8000) ? 0xff000000 : 0) | (expand5((c >> 10) & 0x1f) << 16) |
+				(expand5((c >> 5) & 0x1f) << 8) | expand5(c & 0x1f);
+	}
+}
+
+/* A8 is taken as a white alpha mask */
+static void unpack_a8(uint32_t *dest, const uint8_t *src, uint32_t len)
+{
+	for (; len > 0; len--)
+		*dest++ = ((uint32_t)*src++ << 24) | 0x00ffffff;
+}
+
+/*******************************************************************************
+ *      pack kernels
+ ******************************************************************************/
+static void pack_argb8888(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	memcpy(dest, src, len * 4);
+}
+
+static void pack_rgb565(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	if (IS_ALIGNED2(dest)) {
+		uint16_t *dest16 = (uint16_t *)dest;
+
+		if (!IS_ALIGNED4(dest16) && len > 0) {
+			*dest16++ = argb8888_to_rgb565(*src++);
+			len--;
+		}
+
+		/* 2 pixels per store */
+		for (; len >= 2; len -= 2) {
+			*(uint32_t *)dest16 = argb8888_to_rgb565(src[0]) |
+					(argb8888_to_rgb565(src[1]) << 16);
+			dest16 += 2;
+			src += 2;
+		}
+
+		if (len > 0)
+			*dest16 = argb8888_to_rgb565(*src);
+	} else {
+		for (; len > 0; len--, dest += 2) {
+			uint32_t c = argb8888_to_rgb565(*src++);
+
+			dest[0] = c;
+			dest[1] = c >> 8;
+		}
+	}
+}
+
+static void pack_rgb565_be(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	for (; len > 0; len--, dest += 2) {
+		uint32_t c = argb8888_to_rgb565(*src++);
+
+		dest[0] = c >> 8;
+		dest[1] = c;
+	}
+}
+
+static void pack_rgb888(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	if (IS_ALIGNED4(dest)) {
+		uint32_t *dest32 = (uint32_t *)dest;
+
+		/* 4 pixels per 3 stores */
+		for (; len >= 4; len -= 4) {
+			uint32_t c0 = src[0] & 0xffffff, c1 = src[1] & 0xffffff;
+			uint32_t c2 = src[2] & 0xffffff, c3 = src[3] & 0xffffff;
+
+			dest32[0] = c0 | (c1 << 24);
+			dest32[1] = (c1 >> 8) | (c2 << 16);
+			dest32[2] = (c2 >> 16) | (c3 << 8);
+			dest32 += 3;
+			src += 4;
+		}
+
+		dest = (uint8_t *)dest32;
+	}
+
+	for (; len > 0; len--, dest += 3)
+		store24(dest, *src++);
+}
+
+static void pack_bgr888(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	if (IS_ALIGNED4(dest)) {
+		uint32_t *dest32 = (uint32_t *)dest;
+
+		for (; len >= 4; len -= 4) {
+			uint32_t c0 = swap_rb(src[0]) & 0xffffff, c1 = swap_rb(src[1]) & 0xffffff;
+			uint32_t c2 = swap_rb(src[2]) & 0xffffff, c3 = swap_rb(src[3]) & 0xffffff;
+
+			dest32[0] = c0 | (c1 << 24);
+			dest32[1] = (c1 >> 8) | (c2 << 16);
+			dest32[2] = (c2 >> 16) | (c3 << 8);
+			dest32 += 3;
+			src += 4;
+		}
+
+		dest = (uint8_t *)dest32;
+	}
+
+	for (; len > 0; len--, dest += 3)
+		store24(dest, swap_rb(*src++));
+}
+
+static void pack_argb8565(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	for (; len > 0; len--, dest += 3) {
+		uint32_t c = *src++;
+
+		store24(dest, argb8888_to_rgb565(c) | ((c >> 8) & 0xff0000));
+	}
+}
+
+static void pack_argb6666(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	for (; len > 0; len--, dest += 3) {
+		uint32_t c = *src++;
+
+		store24(dest, ((c >> 8) & 0xfc0000) | ((c >> 6) & 0x03f000) |
+				((c >> 4) & 0x000fc0) | ((c >> 2) & 0x00003f));
+	}
+}
+
+static void pack_abgr6666(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	for (; len > 0; len--, dest += 3) {
+		uint32_t c = swap_rb(*src++);
+
+		store24(dest, ((c >> 8) & 0xfc0000) | ((c >> 6) & 0x03f000) |
+				((c >> 4) & 0x000fc0) | ((c >> 2) & 0x00003f));
+	}
+}
+
+static void pack_argb1555(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	for (; len > 0; len--, dest += 2) {
+		uint32_t c = *src++;
+		uint32_t v = ((c >> 16) & 0x8000) | ((c >> 9) & 0x7c00) |
+				((c >> 6) & 0x03e0) | ((c >> 3) & 0x001f);
+
+		dest[0] = v;
+		dest[1] = v >> 8;
+	}
+}
+
+static void pack_a8(uint8_t *dest, const uint32_t *src, uint32_t len)
+{
+	for (; len > 0; len--)
+		*dest++ = *src++ >> 24;
+}
+
+static void cvt_buf_swap16(uint8_t *dest, const uint8_t *src, uint32_t len)
+{
+	if (IS_ALIGNED4(dest) && IS_ALIGNED4(src)) {
+		uint32_t *dest32 = (uint32_t *)dest;
+		const uint32_t *src32 = (const uint32_t *)src;
+
+		for (; len >= 2; len -= 2) {
+			uint32_t c = *src32++;
+
+			*dest32++ = ((c >> 8) & 0x00ff00ff) | ((c << 8) & 0xff00ff00);
+		}
+
+		dest = (uint8_t *)dest32;
+		src = (const uint8_t *)src32;
+	}
+
+	for (; len > 0; len--, src += 2, dest += 2) {
+		uint8_t c = src[0];
+
+		dest[0] = src[1];
+		dest[1] = c;
+	}
+}
+
+static const cvt_format_t cvt_formats[] = {
+	{ HAL_PIXEL_FORMAT_ARGB_8888, unpack_argb8888, pack_argb8888 },
+	{ HAL_PIXEL_FORMAT_XRGB_8888, unpack_xrgb8888, pack_argb8888 },
+	{ HAL_PIXEL_FORMAT_RGB_565, unpack_rgb565, pack_rgb565 },
+	{ HAL_PIXEL_FORMAT_RGB_565_BE, unpack_rgb565_be, pack_rgb565_be },
+	{ HAL_PIXEL_FORMAT_RGB_888, unpack_rgb888, pack_rgb888 },
+	{ HAL_PIXEL_FORMAT_BGR_888, unpack_bgr888, pack_bgr888 },
+	{ HAL_PIXEL_FORMAT_ARGB_8565, unpack_argb8565, pack_argb8565 },
+	{ HAL_PIXEL_FORMAT_ARGB_6666, unpack_argb6666, pack_argb6666 },
+	{ HAL_PIXEL_FORMAT_ABGR_6666, unpack_abgr6666, pack_abgr6666 },
+	{ HAL_PIXEL_FORMAT_ARGB_1555, unpack_argb1555, pack_argb1555 },
+	{ HAL_PIXEL_FORMAT_A8, unpack_a8, pack_a8 },
+};
+
+static const cvt_format_t *cvt_find_format(uint32_t cf)
+{
+	for (int i = 0; i < ARRAY_SIZE(cvt_formats); i++) {
+		if (cvt_formats[i].cf == cf)
+			return &cvt_formats[i];
+	}
+
+	return NULL;
+}
+
+static bool cvt_is_argb8888(uint32_t cf)
+{
+	return cf == HAL_PIXEL_FORMAT_ARGB_8888;
+}
+
 int sw_convert_color_buffer(void * dest_buf, uint32_t dest_cf, const void * src_buf, uint32_t src_cf, uint32_t len)
 {
-	if (dest_cf == src_cf) {
-		uint8_t px_size = hal_pixel_format_get_bits_per_pixel(dest_cf);
-		memcpy(dest_buf, src_buf, px_size * len);
+	const cvt_format_t *src_fmt;
+	const cvt_format_t *dest_fmt;
+	uint32_t chunk[CVT_CHUNK_SIZE];
+	uint8_t *dest8 = dest_buf;
+	const uint8_t *src8 = src_buf;
+	uint8_t dest_bpp = hal_pixel_format_get_bits_per_pixel(dest_cf);
+	uint8_t src_bpp = hal_pixel_format_get_bits_per_pixel(src_cf);
+
+	if (dest_cf == src_cf || (dest_cf == HAL_PIXEL_FORMAT_XRGB_8888 &&
+			src_cf == HAL_PIXEL_FORMAT_ARGB_8888)) {
+		memcpy(dest_buf, src_buf, (dest_bpp * len + 7) / 8);
 		return 0;
 	}
 
-	if (dest_cf == HAL_PIXEL_FORMAT_BGR_888) {
-		if (src_cf == HAL_PIXEL_FORMAT_ARGB_8888 || src_cf == HAL_PIXEL_FORMAT_XRGB_8888) {
-			cvt_buf_argb8888_to_bgr888(dest_buf, src_buf, len);
-			return 0;
+	if ((dest_cf == HAL_PIXEL_FORMAT_RGB_565 && src_cf == HAL_PIXEL_FORMAT_RGB_565_BE) ||
+		(dest_cf == HAL_PIXEL_FORMAT_RGB_565_BE && src_cf == HAL_PIXEL_FORMAT_RGB_565)) {
+		cvt_buf_swap16(dest_buf, src_buf, len);
+		return 0;
+	}
+
+	src_fmt = cvt_find_format(src_cf);
+	dest_fmt = cvt_find_format(dest_cf);
+	if (src_fmt == NULL || dest_fmt == NULL)
+		return -ENOSYS;
+
+	/* one pass when either side is argb8888 in aligned memory */
+	if (cvt_is_argb8888(dest_cf) && IS_ALIGNED4(dest_buf)) {
+		src_fmt->unpack(dest_buf, src_buf, len);
+		return 0;
+	}
+
+	if (cvt_is_argb8888(src_cf) && IS_ALIGNED4(src_buf)) {
+		dest_fmt->pack(dest_buf, src_buf, len);
+		return 0;
+	}
+
+	while (len > 0) {
+		uint32_t n = (len > CVT_CHUNK_SIZE) ? CVT_CHUNK_SIZE : len;
+
+		src_fmt->unpack(chunk, src8, n);
+		dest_fmt->pack(dest8, chunk, n);
+
+		src8 += n * src_bpp / 8;
+		dest8 += n * dest_bpp / 8;
+		len -= n;
+	}
+
+	return 0;
+}
+
+int sw_convert_index_buffer(void * dest_buf, uint32_t dest_cf, const void * src_buf,
+		uint32_t src_cf, const uint32_t * clut, uint32_t len)
+{
+	const cvt_format_t *dest_fmt;
+	uint32_t chunk[CVT_CHUNK_SIZE];
+	uint8_t *dest8 = dest_buf;
+	const uint8_t *src8 = src_buf;
+	uint8_t dest_bpp = hal_pixel_format_get_bits_per_pixel(dest_cf);
+	uint8_t bpp = hal_pixel_format_get_bits_per_pixel(src_cf);
+	uint8_t mask = (1 << bpp) - 1;
+	uint8_t shift = 8;
+
+	if (clut == NULL || (src_cf != HAL_PIXEL_FORMAT_I8 && src_cf != HAL_PIXEL_FORMAT_I4 &&
+			src_cf != HAL_PIXEL_FORMAT_I2 && src_cf != HAL_PIXEL_FORMAT_I1))
+		return -EINVAL;
+
+	dest_fmt = cvt_find_format(dest_cf);
+	if (dest_fmt == NULL)
+		return -ENOSYS;
+
+	while (len > 0) {
+		uint32_t n = (len > CVT_CHUNK_SIZE) ? CVT_CHUNK_SIZE : len;
+		uint32_t *out = (cvt_is_argb8888(dest_cf) && IS_ALIGNED4(dest8)) ?
+				(uint32_t *)dest8 : chunk;
+
+		if (bpp == 8) {
+			for (uint32_t i = 0; i < n; i++)
+				out[i] = clut[*src8++];
+		} else {
+			/* the first index sits in the most significant bits */
+			for (uint32_t i = 0; i < n; i++) {
+				shift -= bpp;
+				out[i] = clut[(*src8 >> shift) & mask];
+				if (shift == 0) {
+					shift = 8;
+					src8++;
+				}
+			}
 		}
+
+		if (out == chunk)
+			dest_fmt->pack(dest8, chunk, n);
+
+		dest8 += n * dest_bpp / 8;
+		len -= n;
 	}
 
-	return -ENOSYS;
+	return 0;
 }
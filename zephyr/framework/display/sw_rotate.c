@@ -7,6 +7,8 @@
 #include <display/sw_draw.h>
 #include <display/sw_rotate.h>
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
 #ifdef CONFIG_GUI_API_BROM
 #  include <brom_interface.h>
 #endif
@@ -178,6 +180,537 @@ void sw_transform_config_with_mode(uint16_t img_w, uint16_t img_h,
 	}
 }
 
+/*
+ * Tile size in pixels of the 90/270 degree rotation. The src pixels of one
+ * dst tile span SW_ROTATE_TILE_SIZE src lines, which stay in the cache while
+ * the dst tile is written row by row.
+ */
+#ifndef SW_ROTATE_TILE_SIZE
+#define SW_ROTATE_TILE_SIZE 16
+#endif
+
+/*
+ * copy a dst block whose pixel (i, j) is at src + i * step_x + j * step_y
+ */
+static void sw_rotate_block_16bit(uint8_t *dst, int32_t dst_pitch,
+		const uint8_t *src, int32_t step_x, int32_t step_y, int w, int h,
+		uint8_t px_bytes)
+{
+	for (int j = 0; j < h; j++) {
+		uint16_t *dst16 = (uint16_t *)dst;
+		const uint8_t *src8 = src;
+
+		for (int i = 0; i < w; i++) {
+			dst16[i] = *(const uint16_t *)src8;
+			src8 += step_x;
+		}
+
+		dst += dst_pitch;
+		src += step_y;
+	}
+}
+
+static void sw_rotate_block_24bit(uint8_t *dst, int32_t dst_pitch,
+		const uint8_t *src, int32_t step_x, int32_t step_y, int w, int h,
+		uint8_t px_bytes)
+{
+	for (int j = 0; j < h; j++) {
+		uint8_t *dst8 = dst;
+		const uint8_t *src8 = src;
+
+		for (int i = 0; i < w; i++) {
+			dst8[0] = src8[0];
+			dst8[1] = src8[1];
+			dst8[2] = src8[2];
+			dst8 += 3;
+			src8 += step_x;
+		}
+
+		dst += dst_pitch;
+		src += step_y;
+	}
+}
+
+static void sw_rotate_block_32bit(uint8_t *dst, int32_t dst_pitch,
+		const uint8_t *src, int32_t step_x, int32_t step_y, int w, int h,
+		uint8_t px_bytes)
+{
+	for (int j = 0; j < h; j++) {
+		uint32_t *dst32 = (uint32_t *)dst;
+		const uint8_t *src8 = src;
+
+		for (int i = 0; i < w; i++) {
+			dst32[i] = *(const uint32_t *)src8;
+			src8 += step_x;
+		}
+
+		dst += dst_pitch;
+		src += step_y;
+	}
+}
+
+/* any pixel size and alignment */
+static void sw_rotate_block_bytes(uint8_t *dst, int32_t dst_pitch,
+		const uint8_t *src, int32_t step_x, int32_t step_y, int w, int h,
+		uint8_t px_bytes)
+{
+	for (int j = 0; j < h; j++) {
+		uint8_t *dst8 = dst;
+		const uint8_t *src8 = src;
+
+		for (int i = 0; i < w; i++) {
+			for (int k = 0; k < px_bytes; k++)
+				*dst8++ = src8[k];
+
+			src8 += step_x;
+		}
+
+		dst += dst_pitch;
+		src += step_y;
+	}
+}
+
+int sw_rotate_copy(void *dst, const void *src, uint16_t dst_pitch, uint16_t src_pitch,
+		uint16_t src_w, uint16_t src_h, uint8_t px_bytes, uint8_t mode)
+{
+	void (*copy_block)(uint8_t *, int32_t, const uint8_t *, int32_t, int32_t,
+			int, int, uint8_t);
+	const uint8_t *src8 = src;
+	uint8_t *dst8 = dst;
+	int32_t step_x, step_y;
+	uint16_t dst_w, dst_h;
+	uintptr_t align_bits = (uintptr_t)dst | (uintptr_t)src | dst_pitch | src_pitch;
+
+	switch (px_bytes) {
+	case 1:
+		copy_block = sw_rotate_block_bytes;
+		break;
+	case 2:
+		copy_block = (align_bits & 0x1) ? sw_rotate_block_bytes : sw_rotate_block_16bit;
+		break;
+	case 3:
+		copy_block = sw_rotate_block_24bit;
+		break;
+	case 4:
+		copy_block = (align_bits & 0x3) ? sw_rotate_block_bytes : sw_rotate_block_32bit;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* the dst pixel (x, y) is at src8 + x * step_x + y * step_y */
+	switch (mode) {
+	case SW_ROT_90:
+		src8 += (src_h - 1) * src_pitch;
+		step_x = -src_pitch;
+		step_y = px_bytes;
+		dst_w = src_h;
+		dst_h = src_w;
+		break;
+	case SW_ROT_180:
+		src8 += (src_h - 1) * src_pitch + (src_w - 1) * px_bytes;
+		step_x = -px_bytes;
+		step_y = -src_pitch;
+		dst_w = src_w;
+		dst_h = src_h;
+		break;
+	case SW_ROT_270:
+		src8 += (src_w - 1) * px_bytes;
+		step_x = src_pitch;
+		step_y = -px_bytes;
+		dst_w = src_h;
+		dst_h = src_w;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (src_w == 0 || src_h == 0)
+		return 0;
+
+	/* both sides are walked sequentially, no need to tile */
+	if (mode == SW_ROT_180) {
+		copy_block(dst8, dst_pitch, src8, step_x, step_y, dst_w, dst_h, px_bytes);
+		return 0;
+	}
+
+	for (int y = 0; y < dst_h; y += SW_ROTATE_TILE_SIZE) {
+		int h = MIN(dst_h - y, SW_ROTATE_TILE_SIZE);
+
+		for (int x = 0; x < dst_w; x += SW_ROTATE_TILE_SIZE) {
+			int w = MIN(dst_w - x, SW_ROTATE_TILE_SIZE);
+
+			copy_block(dst8 + y * dst_pitch + x * px_bytes, dst_pitch,
+					src8 + x * step_x + y * step_y, step_x, step_y, w, h, px_bytes);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Pixels sampled at a time into the span buffer of sw_transform_*().
+ *
+ * The samples of a span are computed by the cheapest kernel giving the same
+ * result as the general bilinear filtering:
+ * 1) COPY: all samples on integer source pixels of one source line, in order;
+ * 2) NEAREST: all samples on integer source pixels, such as 90 degree
+ *    rotation, flipping and integral down scaling;
+ * 3) AXIS: samples on one source line pair, such as scaling without rotation,
+ *    where the filter y tap is computed once and the source pixels loaded
+ *    are reused until the sample moves to the next source column;
+ * 4) AFFINE: the general bilinear filtering.
+ */
+#define SW_TRANSFORM_SPAN_LEN 64
+
+enum {
+	SW_SPAN_COPY = 0,
+	SW_SPAN_NEAREST,
+	SW_SPAN_AXIS,
+	SW_SPAN_AFFINE,
+};
+
+/*
+ * classify a span
+ *
+ * @param p_x X coord of start point in fixedpoint-16
+ * @param p_y Y coord of start point in fixedpoint-16
+ * @param dx_x X coord of point delta in x direction in fixedpoint-16
+ * @param dx_y Y coord of point delta in x direction in fixedpoint-16
+ * @param tap_bits bits of filter tap coefficient
+ *
+ * @return span kind
+ */
+static inline uint8_t sw_transform_span_kind(int32_t p_x, int32_t p_y,
+		int32_t dx_x, int32_t dx_y, uint8_t tap_bits)
+{
+	/* fraction bits dropped by the filter tap */
+	const int32_t frac_mask = FIXEDPOINT16(1) - (1 << (16 - tap_bits));
+
+	if (((dx_x | dx_y) & (FIXEDPOINT16(1) - 1)) == 0 && ((p_x | p_y) & frac_mask) == 0) {
+		return (dx_x == FIXEDPOINT16(1) && dx_y == 0) ? SW_SPAN_COPY : SW_SPAN_NEAREST;
+	}
+
+	return (dx_y == 0) ? SW_SPAN_AXIS : SW_SPAN_AFFINE;
+}
+
+static void sw_transform_sample_rgb565(uint16_t *out, const uint8_t *src,
+		uint16_t src_pitch, int32_t p_x, int32_t p_y, int32_t dx_x, int32_t dx_y, int n)
+{
+	const uint8_t *src1 = src + FLOOR_FIXEDPOINT16(p_y) * src_pitch + FLOOR_FIXEDPOINT16(p_x) * 2;
+
+	switch (sw_transform_span_kind(p_x, p_y, dx_x, dx_y, 6)) {
+	case SW_SPAN_COPY:
+		memcpy(out, src1, n * 2);
+		break;
+
+	case SW_SPAN_NEAREST: {
+		int32_t step = (dx_x >> 16) * 2 + (dx_y >> 16) * src_pitch;
+
+		for (; n > 0; n--) {
+			*out++ = *(const uint16_t *)src1;
+			src1 += step;
+		}
+		break;
+	}
+
+	case SW_SPAN_AXIS: {
+		const uint8_t *row = src1 - FLOOR_FIXEDPOINT16(p_x) * 2;
+		int y_tap = (p_y - FIXEDPOINT16(FLOOR_FIXEDPOINT16(p_y))) >> 10;
+		int last_x = INT32_MIN;
+		uint16_t c00 = 0, c10 = 0, c01 = 0, c11 = 0;
+
+		for (; n > 0; n--) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int x_frac = p_x - FIXEDPOINT16(x);
+
+			if (x != last_x) {
+				const uint16_t *row0 = (const uint16_t *)(row + x * 2);
+				const uint16_t *row1 = (const uint16_t *)(row + src_pitch + x * 2);
+
+				c00 = row0[0];
+				c10 = row0[1];
+				c01 = row1[0];
+				c11 = row1[1];
+				last_x = x;
+			}
+
+			*out++ = bilinear_rgb565_fast_m6(c00, c10, c01, c11, x_frac >> 10, y_tap, 6);
+			p_x += dx_x;
+		}
+		break;
+	}
+
+	default:
+		for (; n > 0; n--) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int y = FLOOR_FIXEDPOINT16(p_y);
+			int x_frac = p_x - FIXEDPOINT16(x);
+			int y_frac = p_y - FIXEDPOINT16(y);
+			const uint8_t *src1 = src + y * src_pitch + x * 2;
+			const uint8_t *src3 = src1 + src_pitch;
+
+			*out++ = bilinear_rgb565_fast_m6(*(const uint16_t *)src1,
+					*(const uint16_t *)(src1 + 2), *(const uint16_t *)src3,
+					*(const uint16_t *)(src3 + 2), x_frac >> 10, y_frac >> 10, 6);
+
+			p_x += dx_x;
+			p_y += dx_y;
+		}
+		break;
+	}
+}
+
+static ALWAYS_INLINE void sw_transform_sample_px24(uint8_t (*out)[3], const uint8_t *src,
+		uint16_t src_pitch, int32_t p_x, int32_t p_y, int32_t dx_x, int32_t dx_y, int n,
+		void (*filter)(uint8_t *, const uint8_t *, const uint8_t *,
+				const uint8_t *, const uint8_t *, int16_t, int16_t, int16_t))
+{
+	const uint8_t *src1 = src + FLOOR_FIXEDPOINT16(p_y) * src_pitch + FLOOR_FIXEDPOINT16(p_x) * 3;
+
+	switch (sw_transform_span_kind(p_x, p_y, dx_x, dx_y, 6)) {
+	case SW_SPAN_COPY:
+		memcpy(out, src1, n * 3);
+		break;
+
+	case SW_SPAN_NEAREST: {
+		int32_t step = (dx_x >> 16) * 3 + (dx_y >> 16) * src_pitch;
+
+		for (; n > 0; n--, out++) {
+			(*out)[0] = src1[0];
+			(*out)[1] = src1[1];
+			(*out)[2] = src1[2];
+			src1 += step;
+		}
+		break;
+	}
+
+	case SW_SPAN_AXIS: {
+		const uint8_t *row = src1 - FLOOR_FIXEDPOINT16(p_x) * 3;
+		int y_tap = (p_y - FIXEDPOINT16(FLOOR_FIXEDPOINT16(p_y))) >> 10;
+
+		for (; n > 0; n--, out++) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int x_frac = p_x - FIXEDPOINT16(x);
+			const uint8_t *row0 = row + x * 3;
+			const uint8_t *row1 = row0 + src_pitch;
+
+			filter(*out, row0, row0 + 3, row1, row1 + 3, x_frac >> 10, y_tap, 6);
+			p_x += dx_x;
+		}
+		break;
+	}
+
+	default:
+		for (; n > 0; n--, out++) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int y = FLOOR_FIXEDPOINT16(p_y);
+			int x_frac = p_x - FIXEDPOINT16(x);
+			int y_frac = p_y - FIXEDPOINT16(y);
+			const uint8_t *src1 = src + y * src_pitch + x * 3;
+			const uint8_t *src3 = src1 + src_pitch;
+
+			filter(*out, src1, src1 + 3, src3, src3 + 3, x_frac >> 10, y_frac >> 10, 6);
+
+			p_x += dx_x;
+			p_y += dx_y;
+		}
+		break;
+	}
+}
+
+static void sw_transform_sample_argb8565(uint8_t (*out)[3], const uint8_t *src,
+		uint16_t src_pitch, int32_t p_x, int32_t p_y, int32_t dx_x, int32_t dx_y, int n)
+{
+	sw_transform_sample_px24(out, src, src_pitch, p_x, p_y, dx_x, dx_y, n,
+			bilinear_argb8565_fast_m6);
+}
+
+static void sw_transform_sample_argb6666(uint8_t (*out)[3], const uint8_t *src,
+		uint16_t src_pitch, int32_t p_x, int32_t p_y, int32_t dx_x, int32_t dx_y, int n)
+{
+	sw_transform_sample_px24(out, src, src_pitch, p_x, p_y, dx_x, dx_y, n,
+			bilinear_argb6666_fast_m6);
+}
+
+static void sw_transform_sample_argb8888(uint32_t *out, const uint8_t *src,
+		uint16_t src_pitch, int32_t p_x, int32_t p_y, int32_t dx_x, int32_t dx_y, int n)
+{
+	const uint8_t *src1 = src + FLOOR_FIXEDPOINT16(p_y) * src_pitch + FLOOR_FIXEDPOINT16(p_x) * 4;
+
+	switch (sw_transform_span_kind(p_x, p_y, dx_x, dx_y, 8)) {
+	case SW_SPAN_COPY:
+		memcpy(out, src1, n * 4);
+		break;
+
+	case SW_SPAN_NEAREST: {
+		int32_t step = (dx_x >> 16) * 4 + (dx_y >> 16) * src_pitch;
+
+		for (; n > 0; n--) {
+			*out++ = *(const uint32_t *)src1;
+			src1 += step;
+		}
+		break;
+	}
+
+	case SW_SPAN_AXIS: {
+		const uint8_t *row = src1 - FLOOR_FIXEDPOINT16(p_x) * 4;
+		int y_tap = (p_y - FIXEDPOINT16(FLOOR_FIXEDPOINT16(p_y))) >> 8;
+		int last_x = INT32_MIN;
+		uint32_t c00 = 0, c10 = 0, c01 = 0, c11 = 0;
+
+		for (; n > 0; n--) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int x_frac = p_x - FIXEDPOINT16(x);
+
+			if (x != last_x) {
+				const uint32_t *row0 = (const uint32_t *)(row + x * 4);
+				const uint32_t *row1 = (const uint32_t *)(row + src_pitch + x * 4);
+
+				c00 = row0[0];
+				c10 = row0[1];
+				c01 = row1[0];
+				c11 = row1[1];
+				last_x = x;
+			}
+
+			*out++ = bilinear_argb8888_fast_m8(c00, c10, c01, c11, x_frac >> 8, y_tap, 8);
+			p_x += dx_x;
+		}
+		break;
+	}
+
+	default:
+		for (; n > 0; n--) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int y = FLOOR_FIXEDPOINT16(p_y);
+			int x_frac = p_x - FIXEDPOINT16(x);
+			int y_frac = p_y - FIXEDPOINT16(y);
+			const uint8_t *src1 = src + y * src_pitch + x * 4;
+			const uint8_t *src3 = src1 + src_pitch;
+
+			*out++ = bilinear_argb8888_fast_m8(*(const uint32_t *)src1,
+					*(const uint32_t *)(src1 + 4), *(const uint32_t *)src3,
+					*(const uint32_t *)(src3 + 4), x_frac >> 8, y_frac >> 8, 8);
+
+			p_x += dx_x;
+			p_y += dx_y;
+		}
+		break;
+	}
+}
+
+static void sw_transform_sample_rgb888(uint32_t *out, const uint8_t *src,
+		uint16_t src_pitch, int32_t p_x, int32_t p_y, int32_t dx_x, int32_t dx_y, int n)
+{
+	const uint8_t *src1 = src + FLOOR_FIXEDPOINT16(p_y) * src_pitch + FLOOR_FIXEDPOINT16(p_x) * 3;
+	uint8_t kind = sw_transform_span_kind(p_x, p_y, dx_x, dx_y, 8);
+
+	switch (kind) {
+	case SW_SPAN_COPY:
+	case SW_SPAN_NEAREST: {
+		int32_t step = (kind == SW_SPAN_COPY) ? 3 :
+				((dx_x >> 16) * 3 + (dx_y >> 16) * src_pitch);
+
+		for (; n > 0; n--) {
+			*out++ = src1[0] | ((uint32_t)src1[1] << 8) | ((uint32_t)src1[2] << 16);
+			src1 += step;
+		}
+		break;
+	}
+
+	case SW_SPAN_AXIS: {
+		const uint8_t *row = src1 - FLOOR_FIXEDPOINT16(p_x) * 3;
+		int y_tap = (p_y - FIXEDPOINT16(FLOOR_FIXEDPOINT16(p_y))) >> 8;
+
+		for (; n > 0; n--) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int x_frac = p_x - FIXEDPOINT16(x);
+			const uint8_t *row0 = row + x * 3;
+			const uint8_t *row1 = row0 + src_pitch;
+
+			*out++ = bilinear_rgb888_fast_m8(row0, row0 + 3, row1, row1 + 3,
+					x_frac >> 8, y_tap, 8);
+			p_x += dx_x;
+		}
+		break;
+	}
+
+	default:
+		for (; n > 0; n--) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int y = FLOOR_FIXEDPOINT16(p_y);
+			int x_frac = p_x - FIXEDPOINT16(x);
+			int y_frac = p_y - FIXEDPOINT16(y);
+			const uint8_t *src1 = src + y * src_pitch + x * 3;
+			const uint8_t *src3 = src1 + src_pitch;
+
+			*out++ = bilinear_rgb888_fast_m8(src1, src1 + 3, src3, src3 + 3,
+					x_frac >> 8, y_frac >> 8, 8);
+
+			p_x += dx_x;
+			p_y += dx_y;
+		}
+		break;
+	}
+}
+
+static void sw_transform_sample_a8(uint8_t *out, const uint8_t *src,
+		uint16_t src_pitch, int32_t p_x, int32_t p_y, int32_t dx_x, int32_t dx_y, int n)
+{
+	const uint8_t *src1 = src + FLOOR_FIXEDPOINT16(p_y) * src_pitch + FLOOR_FIXEDPOINT16(p_x);
+
+	switch (sw_transform_span_kind(p_x, p_y, dx_x, dx_y, 8)) {
+	case SW_SPAN_COPY:
+		memcpy(out, src1, n);
+		break;
+
+	case SW_SPAN_NEAREST: {
+		int32_t step = (dx_x >> 16) + (dx_y >> 16) * src_pitch;
+
+		for (; n > 0; n--) {
+			*out++ = *src1;
+			src1 += step;
+		}
+		break;
+	}
+
+	case SW_SPAN_AXIS: {
+		const uint8_t *row = src1 - FLOOR_FIXEDPOINT16(p_x);
+		int y_tap = (p_y - FIXEDPOINT16(FLOOR_FIXEDPOINT16(p_y))) >> 8;
+
+		for (; n > 0; n--) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int x_frac = p_x - FIXEDPOINT16(x);
+			const uint8_t *row0 = row + x;
+			const uint8_t *row1 = row0 + src_pitch;
+
+			*out++ = bilinear_a8_fast_m8(row0[0], row0[1], row1[0], row1[1],
+					x_frac >> 8, y_tap, 8);
+			p_x += dx_x;
+		}
+		break;
+	}
+
+	default:
+		for (; n > 0; n--) {
+			int x = FLOOR_FIXEDPOINT16(p_x);
+			int y = FLOOR_FIXEDPOINT16(p_y);
+			int x_frac = p_x - FIXEDPOINT16(x);
+			int y_frac = p_y - FIXEDPOINT16(y);
+			const uint8_t *src1 = src + y * src_pitch + x;
+			const uint8_t *src3 = src1 + src_pitch;
+
+			*out++ = bilinear_a8_fast_m8(src1[0], src1[1], src3[0], src3[1],
+					x_frac >> 8, y_frac >> 8, 8);
+
+			p_x += dx_x;
+			p_y += dx_y;
+		}
+		break;
+	}
+}
+
 void sw_transform_rgb565_over_rgb565(void *dst, const void *src,
 		uint16_t dst_pitch, uint16_t src_pitch, uint16_t src_w, uint16_t src_h,
 		int16_t x, int16_t y, uint16_t w, uint16_t h,
@@ -196,7 +729,6 @@ void sw_transform_rgb565_over_rgb565(void *dst, const void *src,
 			dst, src, dst_pitch, src_pitch, src_w, src_h, x, y, w, h, matrix);
 #else
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 2;
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -219,24 +751,9 @@ void sw_transform_rgb565_over_rgb565(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-
-			*tmp_dst = bilinear_rgb565_fast_m6(*(uint16_t*)src1,
-					*(uint16_t*)src2, *(uint16_t*)src3, *(uint16_t*)src4,
-					x_frac >> 10, y_frac >> 10, 6);
-
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
-		}
+		/* no blending, so sample into dst directly */
+		sw_transform_sample_rgb565(tmp_dst, src, src_pitch,
+				p_x, p_y, matrix->sx, matrix->shy, x2 - x1 + 1);
 
 next_line:
 		src_coord_x += matrix->shx;
@@ -253,7 +770,7 @@ void sw_transform_rgb565_over_rgb888(void *dst, const void *src,
 {
 	uint8_t * dst8 = dst;
 	uint16_t dst_bytes_per_pixel = 3;
-	uint16_t src_bytes_per_pixel = 2;
+	uint16_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -276,27 +793,21 @@ void sw_transform_rgb565_over_rgb888(void *dst, const void *src,
 			tmp_dst += x1 * dst_bytes_per_pixel;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			uint16_t c16;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			c16 = bilinear_rgb565_fast_m6(*(uint16_t*)src1,
-					*(uint16_t*)src2, *(uint16_t*)src3, *(uint16_t*)src4,
-					x_frac >> 10, y_frac >> 10, 6);
+			sw_transform_sample_rgb565(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst++ = ((c16 & 0x1f) << 3) | (c16 & 0x07);
-			*tmp_dst++ = ((c16 & 0x07e0) >> 3) | ((c16 & 0x60) >> 5);
-			*tmp_dst++ = ((c16 & 0xf800) >> 8) | ((c16 & 0x3800) >> 11);
+			for (int k = 0; k < n; k++) {
+				uint16_t c16 = span[k];
 
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst++ = ((c16 & 0x1f) << 3) | (c16 & 0x07);
+				*tmp_dst++ = ((c16 & 0x07e0) >> 3) | ((c16 & 0x60) >> 5);
+				*tmp_dst++ = ((c16 & 0xf800) >> 8) | ((c16 & 0x3800) >> 11);
+			}
 		}
 
 next_line:
@@ -316,7 +827,7 @@ void sw_transform_rgb565_over_argb8888(void *dst, const void *src,
 //			dst, src, dst_pitch, src_pitch, src_w, src_h, x, y, w, h, matrix);
 //#else
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 2;
+	uint16_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -339,28 +850,23 @@ void sw_transform_rgb565_over_argb8888(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			uint16_t c16;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			c16 = bilinear_rgb565_fast_m6(*(uint16_t*)src1,
-					*(uint16_t*)src2, *(uint16_t*)src3, *(uint16_t*)src4,
-					x_frac >> 10, y_frac >> 10, 6);
+			sw_transform_sample_rgb565(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = ((c16 & 0x1f) << 3) | (c16 & 0x07) |
-					((c16 & 0x07e0) << 5) | ((c16 & 0x60) << 3) |
-					((c16 & 0xf800) << 8) | ((c16 & 0x3800) << 5) | 0xFF000000;
+			for (int k = 0; k < n; k++) {
+				uint16_t c16 = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = ((c16 & 0x1f) << 3) | (c16 & 0x07) |
+						((c16 & 0x07e0) << 5) | ((c16 & 0x60) << 3) |
+						((c16 & 0xf800) << 8) | ((c16 & 0x3800) << 5) | 0xFF000000;
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -582,7 +1088,7 @@ void sw_transform_argb8565_over_rgb565(void *dst, const void *src,
 			dst, src, dst_pitch, src_pitch, src_w, src_h, x, y, w, h, matrix);
 #else
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 3;
+	uint8_t span[SW_TRANSFORM_SPAN_LEN][3];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -605,25 +1111,21 @@ void sw_transform_argb8565_over_rgb565(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			uint8_t result[3];
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			bilinear_argb8565_fast_m6(result, src1, src2, src3, src4,
-					x_frac >> 10, y_frac >> 10, 6);
+			sw_transform_sample_argb8565(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = blend_argb8565_over_rgb565(*tmp_dst, result);
+			for (int k = 0; k < n; k++) {
+				const uint8_t *result = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = blend_argb8565_over_rgb565(*tmp_dst, result);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -641,7 +1143,7 @@ void sw_transform_argb8565_over_rgb888(void *dst, const void *src,
 {
 	uint8_t * dst8 = dst;
 	uint16_t dst_bytes_per_pixel = 3;
-	uint16_t src_bytes_per_pixel = 3;
+	uint8_t span[SW_TRANSFORM_SPAN_LEN][3];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -664,33 +1166,28 @@ void sw_transform_argb8565_over_rgb888(void *dst, const void *src,
 			tmp_dst += x1 * dst_bytes_per_pixel;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			uint8_t result[3];
-			sw_color32_t col32 = {
-				.a = 255,
-				.r = tmp_dst[2],
-				.g = tmp_dst[1],
-				.b = tmp_dst[0],
-			};
-
-			bilinear_argb8565_fast_m6(result, src1, src2, src3, src4,
-					x_frac >> 10, y_frac >> 10, 6);
-
-			col32.full = blend_argb8565_over_argb8888(col32.full, result);
-			*tmp_dst++ = col32.b;
-			*tmp_dst++ = col32.g;
-			*tmp_dst++ = col32.r;
-
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
+
+			sw_transform_sample_argb8565(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
+
+			for (int k = 0; k < n; k++) {
+				const uint8_t *result = span[k];
+				sw_color32_t col32 = {
+					.a = 255,
+					.r = tmp_dst[2],
+					.g = tmp_dst[1],
+					.b = tmp_dst[0],
+				};
+
+				col32.full = blend_argb8565_over_argb8888(col32.full, result);
+				*tmp_dst++ = col32.b;
+				*tmp_dst++ = col32.g;
+				*tmp_dst++ = col32.r;
+			}
 		}
 
 next_line:
@@ -710,7 +1207,7 @@ void sw_transform_argb8565_over_argb8888(void *dst, const void *src,
 			dst, src, dst_pitch, src_pitch, src_w, src_h, x, y, w, h, matrix);
 #else
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 3;
+	uint8_t span[SW_TRANSFORM_SPAN_LEN][3];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -733,25 +1230,21 @@ void sw_transform_argb8565_over_argb8888(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			uint8_t result[3];
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			bilinear_argb8565_fast_m6(result, src1, src2, src3, src4,
-					x_frac >> 10, y_frac >> 10, 6);
+			sw_transform_sample_argb8565(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = blend_argb8565_over_argb8888(*tmp_dst, result);
+			for (int k = 0; k < n; k++) {
+				const uint8_t *result = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = blend_argb8565_over_argb8888(*tmp_dst, result);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -772,7 +1265,7 @@ void sw_transform_argb6666_over_rgb565(void *dst, const void *src,
 			dst, src, dst_pitch, src_pitch, src_w, src_h, x, y, w, h, matrix);
 #else
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 3;
+	uint8_t span[SW_TRANSFORM_SPAN_LEN][3];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -795,25 +1288,21 @@ void sw_transform_argb6666_over_rgb565(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			uint8_t result[3];
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			bilinear_argb6666_fast_m6(result, src1, src2, src3, src4,
-					x_frac >> 10, y_frac >> 10, 6);
+			sw_transform_sample_argb6666(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = blend_argb6666_over_rgb565(*tmp_dst, result);
+			for (int k = 0; k < n; k++) {
+				const uint8_t *result = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = blend_argb6666_over_rgb565(*tmp_dst, result);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -831,7 +1320,7 @@ void sw_transform_argb6666_over_rgb888(void *dst, const void *src,
 {
 	uint8_t * dst8 = dst;
 	uint16_t dst_bytes_per_pixel = 3;
-	uint16_t src_bytes_per_pixel = 3;
+	uint8_t span[SW_TRANSFORM_SPAN_LEN][3];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -854,33 +1343,28 @@ void sw_transform_argb6666_over_rgb888(void *dst, const void *src,
 			tmp_dst += x1 * dst_bytes_per_pixel;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			uint8_t result[3];
-			sw_color32_t col32 = {
-				.a = 255,
-				.r = tmp_dst[2],
-				.g = tmp_dst[1],
-				.b = tmp_dst[0],
-			};
-
-			bilinear_argb6666_fast_m6(result, src1, src2, src3, src4,
-					x_frac >> 10, y_frac >> 10, 6);
-
-			col32.full = blend_argb6666_over_argb8888(col32.full, result);
-			*tmp_dst++ = col32.b;
-			*tmp_dst++ = col32.g;
-			*tmp_dst++ = col32.r;
-
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
+
+			sw_transform_sample_argb6666(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
+
+			for (int k = 0; k < n; k++) {
+				const uint8_t *result = span[k];
+				sw_color32_t col32 = {
+					.a = 255,
+					.r = tmp_dst[2],
+					.g = tmp_dst[1],
+					.b = tmp_dst[0],
+				};
+
+				col32.full = blend_argb6666_over_argb8888(col32.full, result);
+				*tmp_dst++ = col32.b;
+				*tmp_dst++ = col32.g;
+				*tmp_dst++ = col32.r;
+			}
 		}
 
 next_line:
@@ -900,7 +1384,7 @@ void sw_transform_argb6666_over_argb8888(void *dst, const void *src,
 			dst, src, dst_pitch, src_pitch, src_w, src_h, x, y, w, h, matrix);
 #else
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 3;
+	uint8_t span[SW_TRANSFORM_SPAN_LEN][3];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -923,25 +1407,21 @@ void sw_transform_argb6666_over_argb8888(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			uint8_t result[3];
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			bilinear_argb6666_fast_m6(result, src1, src2, src3, src4,
-					x_frac >> 10, y_frac >> 10, 6);
+			sw_transform_sample_argb6666(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = blend_argb6666_over_argb8888(*tmp_dst, result);
+			for (int k = 0; k < n; k++) {
+				const uint8_t *result = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = blend_argb6666_over_argb8888(*tmp_dst, result);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -970,7 +1450,7 @@ void sw_transform_argb8888_over_rgb565(void *dst, const void *src,
 			dst, src, dst_pitch, src_pitch, src_w, src_h, x, y, w, h, matrix);
 #else
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 4;
+	uint32_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -993,25 +1473,21 @@ void sw_transform_argb8888_over_rgb565(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			uint32_t color = bilinear_argb8888_fast_m8(*(uint32_t*)src1,
-					*(uint32_t*)src2, *(uint32_t*)src3, *(uint32_t*)src4,
-					x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_argb8888(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, color);
+			for (int k = 0; k < n; k++) {
+				uint32_t color = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, color);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -1029,7 +1505,7 @@ void sw_transform_argb8888_over_rgb888(void *dst, const void *src,
 {
 	uint8_t * dst8 = dst;
 	uint16_t dst_bytes_per_pixel = 3;
-	uint16_t src_bytes_per_pixel = 4;
+	uint32_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1051,33 +1527,29 @@ void sw_transform_argb8888_over_rgb888(void *dst, const void *src,
 			tmp_dst += x1 * dst_bytes_per_pixel;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			sw_color32_t col32 = {
-				.a = 255,
-				.r = tmp_dst[2],
-				.g = tmp_dst[1],
-				.b = tmp_dst[0],
-			};
-
-			uint32_t color = bilinear_argb8888_fast_m8(*(uint32_t*)src1,
-					*(uint32_t*)src2, *(uint32_t*)src3, *(uint32_t*)src4,
-					x_frac >> 8, y_frac >> 8, 8);
-
-			col32.full = blend_argb8888_over_argb8888(col32.full, color);
-			*tmp_dst++ = col32.b;
-			*tmp_dst++ = col32.g;
-			*tmp_dst++ = col32.r;
-
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
+
+			sw_transform_sample_argb8888(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
+
+			for (int k = 0; k < n; k++) {
+				sw_color32_t col32 = {
+					.a = 255,
+					.r = tmp_dst[2],
+					.g = tmp_dst[1],
+					.b = tmp_dst[0],
+				};
+
+				uint32_t color = span[k];
+
+				col32.full = blend_argb8888_over_argb8888(col32.full, color);
+				*tmp_dst++ = col32.b;
+				*tmp_dst++ = col32.g;
+				*tmp_dst++ = col32.r;
+			}
 		}
 
 next_line:
@@ -1105,7 +1577,7 @@ void sw_transform_argb8888_over_argb8888(void *dst, const void *src,
 			dst, src, dst_pitch, src_pitch, src_w, src_h, x, y, w, h, matrix);
 #else
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 4;
+	uint32_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1127,25 +1599,21 @@ void sw_transform_argb8888_over_argb8888(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			uint32_t color = bilinear_argb8888_fast_m8(*(uint32_t*)src1,
-					*(uint32_t*)src2, *(uint32_t*)src3, *(uint32_t*)src4,
-					x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_argb8888(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, color);
+			for (int k = 0; k < n; k++) {
+				uint32_t color = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, color);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -1162,7 +1630,7 @@ void sw_transform_xrgb8888_over_rgb565(void *dst, const void *src,
 		const sw_matrix_t *matrix)
 {
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 4;
+	uint32_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1185,26 +1653,22 @@ void sw_transform_xrgb8888_over_rgb565(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			uint32_t color = bilinear_argb8888_fast_m8(*(uint32_t*)src1,
-					*(uint32_t*)src2, *(uint32_t*)src3, *(uint32_t*)src4,
-					x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_argb8888(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = ((color & 0xf80000) >> 8) | ((color & 0x00fc00) >> 5) |
-					((color & 0x0000f8) >> 3);
+			for (int k = 0; k < n; k++) {
+				uint32_t color = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = ((color & 0xf80000) >> 8) | ((color & 0x00fc00) >> 5) |
+						((color & 0x0000f8) >> 3);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -1221,7 +1685,7 @@ void sw_transform_xrgb8888_over_rgb888(void *dst, const void *src,
 {
 	uint8_t * dst8 = dst;
 	uint16_t dst_bytes_per_pixel = 3;
-	uint16_t src_bytes_per_pixel = 4;
+	uint32_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1243,27 +1707,21 @@ void sw_transform_xrgb8888_over_rgb888(void *dst, const void *src,
 			tmp_dst += x1 * dst_bytes_per_pixel;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			sw_color32_t col32;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			col32.full = bilinear_argb8888_fast_m8(*(uint32_t*)src1,
-					*(uint32_t*)src2, *(uint32_t*)src3, *(uint32_t*)src4,
-					x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_argb8888(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst++ = col32.b;
-			*tmp_dst++ = col32.g;
-			*tmp_dst++ = col32.r;
+			for (int k = 0; k < n; k++) {
+				sw_color32_t col32 = { .full = span[k], };
 
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst++ = col32.b;
+				*tmp_dst++ = col32.g;
+				*tmp_dst++ = col32.r;
+			}
 		}
 
 next_line:
@@ -1279,7 +1737,7 @@ void sw_transform_xrgb8888_over_argb8888(void *dst, const void *src,
 		const sw_matrix_t *matrix)
 {
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 4;
+	uint32_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1301,25 +1759,21 @@ void sw_transform_xrgb8888_over_argb8888(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			uint32_t color = bilinear_argb8888_fast_m8(*(uint32_t*)src1,
-					*(uint32_t*)src2, *(uint32_t*)src3, *(uint32_t*)src4,
-					x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_argb8888(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = color | 0xff000000;
+			for (int k = 0; k < n; k++) {
+				uint32_t color = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = color | 0xff000000;
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -1335,7 +1789,7 @@ void sw_transform_rgb888_over_rgb565(void *dst, const void *src,
 		const sw_matrix_t *matrix)
 {
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 3;
+	uint32_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1358,25 +1812,22 @@ void sw_transform_rgb888_over_rgb565(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			uint32_t color = bilinear_rgb888_fast_m8(src1,
-					src2, src3, src4, x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_rgb888(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = ((color & 0xf80000) >> 8) | ((color & 0x00fc00) >> 5) |
-					((color & 0x0000f8) >> 3);
+			for (int k = 0; k < n; k++) {
+				uint32_t color = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = ((color & 0xf80000) >> 8) | ((color & 0x00fc00) >> 5) |
+						((color & 0x0000f8) >> 3);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -1393,7 +1844,7 @@ void sw_transform_rgb888_over_rgb888(void *dst, const void *src,
 {
 	uint8_t * dst8 = dst;
 	uint16_t dst_bytes_per_pixel = 3;
-	uint16_t src_bytes_per_pixel = 3;
+	uint32_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1415,25 +1866,20 @@ void sw_transform_rgb888_over_rgb888(void *dst, const void *src,
 			tmp_dst += x1 * dst_bytes_per_pixel;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			sw_color32_t col32;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			col32.full = bilinear_rgb888_fast_m8(src1,
-					src2, src3, src4, x_frac >> 8, y_frac >> 8, 8);
-			*tmp_dst++ = col32.b;
-			*tmp_dst++ = col32.g;
-			*tmp_dst++ = col32.r;
+			sw_transform_sample_rgb888(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+			for (int k = 0; k < n; k++) {
+				sw_color32_t col32 = { .full = span[k], };
+				*tmp_dst++ = col32.b;
+				*tmp_dst++ = col32.g;
+				*tmp_dst++ = col32.r;
+			}
 		}
 
 next_line:
@@ -1449,7 +1895,7 @@ void sw_transform_rgb888_over_argb8888(void *dst, const void *src,
 		const sw_matrix_t *matrix)
 {
 	uint8_t * dst8 = dst;
-	uint16_t src_bytes_per_pixel = 3;
+	uint32_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1471,24 +1917,21 @@ void sw_transform_rgb888_over_argb8888(void *dst, const void *src,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			uint32_t color = bilinear_rgb888_fast_m8(src1,
-					src2, src3, src4, x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_rgb888(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			*tmp_dst = color | 0xff000000;
+			for (int k = 0; k < n; k++) {
+				uint32_t color = span[k];
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = color | 0xff000000;
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -1505,7 +1948,7 @@ void sw_transform_a8_over_rgb565(void *dst, const void *src, uint32_t src_color,
 {
 	uint8_t * dst8 = dst;
 	uint8_t src_opa = src_color >> 24;
-	uint16_t src_bytes_per_pixel = 1;
+	uint8_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1528,29 +1971,26 @@ void sw_transform_a8_over_rgb565(void *dst, const void *src, uint32_t src_color,
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-			uint32_t opa = bilinear_a8_fast_m8(*src1,
-					*src2, *src3, *src4, x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_a8(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			if (src_opa < 255)
-				opa = (opa * src_opa) >> 8;
+			for (int k = 0; k < n; k++) {
+				uint32_t opa = span[k];
 
-			src_color = (src_color & 0xffffff) | (opa << 24);
+				if (src_opa < 255)
+					opa = (opa * src_opa) >> 8;
 
-			*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, src_color);
+				src_color = (src_color & 0xffffff) | (opa << 24);
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = blend_argb8888_over_rgb565(*tmp_dst, src_color);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
@@ -1568,7 +2008,7 @@ void sw_transform_a8_over_rgb888(void *dst, const void *src, uint32_t src_color,
 	uint8_t * dst8 = dst;
 	uint16_t dst_bytes_per_pixel = 3;
 	uint8_t src_opa = src_color >> 24;
-	uint16_t src_bytes_per_pixel = 1;
+	uint8_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1590,37 +2030,34 @@ void sw_transform_a8_over_rgb888(void *dst, const void *src, uint32_t src_color,
 			tmp_dst += x1 * dst_bytes_per_pixel;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
-			sw_color32_t col32 = {
-				.a = 255,
-				.r = tmp_dst[2],
-				.g = tmp_dst[1],
-				.b = tmp_dst[0],
-			};
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-            uint32_t opa = bilinear_a8_fast_m8(*src1,
-                *src2, *src3, *src4, x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_a8(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			if (src_opa < 255)
-				opa = (opa * src_opa) >> 8;
+			for (int k = 0; k < n; k++) {
+				sw_color32_t col32 = {
+					.a = 255,
+					.r = tmp_dst[2],
+					.g = tmp_dst[1],
+					.b = tmp_dst[0],
+				};
 
-			src_color = (src_color & 0xffffff) | (opa << 24);
+	            uint32_t opa = span[k];
 
-			col32.full = blend_argb8888_over_argb8888(col32.full, src_color);
-			*tmp_dst++ = col32.b;
-			*tmp_dst++ = col32.g;
-			*tmp_dst++ = col32.r;
+				if (src_opa < 255)
+					opa = (opa * src_opa) >> 8;
 
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				src_color = (src_color & 0xffffff) | (opa << 24);
+
+				col32.full = blend_argb8888_over_argb8888(col32.full, src_color);
+				*tmp_dst++ = col32.b;
+				*tmp_dst++ = col32.g;
+				*tmp_dst++ = col32.r;
+			}
 		}
 
 next_line:
@@ -1637,7 +2074,7 @@ void sw_transform_a8_over_argb8888(void *dst, const void *src, uint32_t src_colo
 {
 	uint8_t * dst8 = dst;
 	uint8_t src_opa = src_color >> 24;
-	uint16_t src_bytes_per_pixel = 1;
+	uint8_t span[SW_TRANSFORM_SPAN_LEN];
 	int32_t src_coord_x = matrix->tx +
 			y * matrix->shx + x * matrix->sx;
 	int32_t src_coord_y = matrix->ty +
@@ -1659,29 +2096,26 @@ void sw_transform_a8_over_argb8888(void *dst, const void *src, uint32_t src_colo
 			tmp_dst += x1;
 		}
 
-		for (int i = x2 - x1; i >= 0; i--) {
-			int x = FLOOR_FIXEDPOINT16(p_x);
-			int y = FLOOR_FIXEDPOINT16(p_y);
-			int x_frac = p_x - FIXEDPOINT16(x);
-			int y_frac = p_y - FIXEDPOINT16(y);
-			uint8_t *src1 = (uint8_t *)src + y * src_pitch + x * src_bytes_per_pixel;
-			uint8_t *src2 = src1 + src_bytes_per_pixel;
-			uint8_t *src3 = src1 + src_pitch;
-			uint8_t *src4 = src2 + src_pitch;
+		for (int i = x2 - x1 + 1; i > 0; i -= SW_TRANSFORM_SPAN_LEN) {
+			int n = MIN(i, SW_TRANSFORM_SPAN_LEN);
 
-            uint32_t opa = bilinear_a8_fast_m8(*src1,
-                *src2, *src3, *src4, x_frac >> 8, y_frac >> 8, 8);
+			sw_transform_sample_a8(span, src, src_pitch,
+					p_x, p_y, matrix->sx, matrix->shy, n);
+			p_x += matrix->sx * n;
+			p_y += matrix->shy * n;
 
-			if (src_opa < 255)
-				opa = (opa * src_opa) >> 8;
+			for (int k = 0; k < n; k++) {
+	            uint32_t opa = span[k];
 
-			src_color = (src_color & 0xffffff) | (opa << 24);
+				if (src_opa < 255)
+					opa = (opa * src_opa) >> 8;
 
-			*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, src_color);
+				src_color = (src_color & 0xffffff) | (opa << 24);
 
-			tmp_dst += 1;
-			p_x += matrix->sx;
-			p_y += matrix->shy;
+				*tmp_dst = blend_argb8888_over_argb8888(*tmp_dst, src_color);
+
+				tmp_dst += 1;
+			}
 		}
 
 next_line:
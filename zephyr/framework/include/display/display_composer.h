@@ -55,6 +55,8 @@ enum display_composer_flags {
 	FIRST_POST_IN_FRAME = BIT(0),
 	/* last post in one frame */
 	LAST_POST_IN_FRAME  = BIT(1),
+	/* frame of the primary surface, recorded in the frame timeline */
+	POST_FRAME_TIMELINE = BIT(2),
 	/* post using DE path.
 	 * posting by DE has much higher efficiency than DMA, but may be affected
 	 * by drawing, since DMA2D HAL is accelerated by DE.
@@ -100,6 +102,22 @@ typedef struct ui_layer {
 	void *cleanup_data;
 } ui_layer_t;
 
+/**
+ * @struct display_composer_stats
+ * @brief Structure holding the display composer post statistics
+ *
+ */
+typedef struct display_composer_stats {
+	/* number of frames posted */
+	uint32_t frame_cnt;
+	/* bytes transferred to the panel in the last frame */
+	uint32_t last_frame_bytes;
+	/* maximum bytes transferred to the panel in one frame */
+	uint32_t max_frame_bytes;
+	/* total bytes transferred to the panel */
+	uint64_t total_bytes;
+} display_composer_stats_t;
+
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
@@ -206,6 +224,37 @@ void display_composer_round(ui_region_t *region);
  */
 int display_composer_post(const ui_layer_t *layers, int num_layers, uint32_t post_flags);
 
+/**
+ * @brief Post the dirty regions of one layer to display
+ *
+ * Each dirty region is rounded by display_composer_round(), clipped to the
+ * layer frame and posted as one part of the frame, so only the changed areas
+ * are transferred to the panel. The bounding box of the regions is posted
+ * instead if the panel has no GRAM or not enough post entries are available.
+ *
+ * The layer cleanup callback is called once after the whole frame.
+ *
+ * This routine may be blocked in thread context.
+ *
+ * @param layer layer to post, its crop and frame cover all the regions
+ * @param regions dirty regions in display coordinates
+ * @param num_regions number of dirty regions
+ * @param post_flags post flags, see enum display_composer_flags
+ *
+ * @return 0 on success else negative errno code.
+ */
+int display_composer_post_regions(const ui_layer_t *layer, const ui_region_t *regions,
+		int num_regions, uint32_t post_flags);
+
+/**
+ * @brief Get the post statistics
+ *
+ * @param stats address to store the statistics
+ *
+ * @return N/A
+ */
+void display_composer_get_stats(display_composer_stats_t *stats);
+
 /**
  * @brief Flush to display
  *
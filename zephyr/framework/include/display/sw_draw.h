@@ -201,16 +201,40 @@ static ALWAYS_INLINE void cvt_argb8888_to_argb1555(uint8_t dest_color[2], const
 /*
  * @brief convert buffer pixel format
  *
+ * Any pair of ARGB_8888, XRGB_8888, RGB_565, RGB_565_BE, RGB_888, BGR_888,
+ * ARGB_8565, ARGB_6666, ABGR_6666, ARGB_1555 and A8 is supported. A8 source
+ * is converted as white with that alpha.
+ *
  * @param dest_buf dest buffer address
  * @param dest_cf dest buffer pixel format
  * @param src_buf source buffer address
  * @param src_cf source buffer pixel format
  * @param len number of pixels to convert
  *
- * @retval argb8888 color value
+ * @retval 0 on success
+ * @retval -ENOSYS if the format pair is not supported
  */
 int sw_convert_color_buffer(void * dest_buf, uint32_t dest_cf, const void * src_buf, uint32_t src_cf, uint32_t len);
 
+/*
+ * @brief convert indexed buffer to pixel format
+ *
+ * Indices are packed from the most significant bits of each byte.
+ *
+ * @param dest_buf dest buffer address
+ * @param dest_cf dest buffer pixel format, any supported by sw_convert_color_buffer()
+ * @param src_buf source buffer address
+ * @param src_cf source buffer pixel format, I8, I4, I2 or I1
+ * @param clut argb8888 color lookup table
+ * @param len number of pixels to convert
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if src_cf is not indexed or clut is NULL
+ * @retval -ENOSYS if dest_cf is not supported
+ */
+int sw_convert_index_buffer(void * dest_buf, uint32_t dest_cf, const void * src_buf,
+		uint32_t src_cf, const uint32_t * clut, uint32_t len);
+
 /*******************************************************************************
  *      pixel blending
  ******************************************************************************/
@@ -106,6 +106,27 @@ void sw_transform_config(int16_t img_x, int16_t img_y,
 void sw_transform_config_with_mode(uint16_t img_w, uint16_t img_h,
 		uint8_t mode, sw_matrix_t *matrix);
 
+/*
+ * @brief rotate and copy an image by 90, 180 or 270 degrees (CW)
+ *
+ * The dst image is src_h x src_w for 90 and 270 degrees, and src_w x src_h
+ * for 180 degrees. Both images have the same pixel format.
+ *
+ * @param dst address of dst image
+ * @param src address of src image
+ * @param dst_pitch stride in bytes of dst image
+ * @param src_pitch stride in bytes of src image
+ * @param src_w width in pixels of src image
+ * @param src_h height in pixels of src image
+ * @param px_bytes bytes per pixel, 1 ~ 4
+ * @param mode SW_ROT_90, SW_ROT_180 or SW_ROT_270
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if px_bytes or mode is not supported
+ */
+int sw_rotate_copy(void *dst, const void *src, uint16_t dst_pitch, uint16_t src_pitch,
+		uint16_t src_w, uint16_t src_h, uint8_t px_bytes, uint8_t mode);
+
 /*
  * @brief rotate an rgb565 image over rgb565 image
  *
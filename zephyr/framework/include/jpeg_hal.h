@@ -169,6 +169,94 @@ int jpg_decode(void* jpeg_src, int jpeg_size,
     void* bmp_buffer, int output_format, int output_stride,
     int win_x, int win_y, int win_w, int win_h);
 
+/**
+ * @brief decode jpeg like jpg_decode, but by software if the hardware is busy
+ *
+ * Only for callers which prefer the slower software decode to waiting for
+ * the hardware, such as UI image decoders. Same as jpg_decode() without
+ * CONFIG_JPEG_SW_DECODER.
+ *
+ * @retval decoded bytes on success else negative errno code.
+ */
+int jpg_decode_sw_fallback(void* jpeg_src, int jpeg_size,
+    void* bmp_buffer, int output_format, int output_stride,
+    int win_x, int win_y, int win_w, int win_h);
+
+#ifdef CONFIG_JPEG_SW_DECODER
+
+/**
+ * @typedef jpeg_sw_strip_cb_t
+ * @brief Callback to consume one decoded strip
+ *
+ * @param user_data user data passed to jpeg_sw_decode_strips()
+ * @param strip_buffer buffer of the strip, the first row is picture row y
+ * @param y picture row of the strip in scaled pixels
+ * @param h number of rows in the strip
+ *
+ * @retval 0 to continue decoding else stop decoding and return the value.
+ */
+typedef int (*jpeg_sw_strip_cb_t)(void *user_data, const void *strip_buffer, int y, int h);
+
+/**
+ * @brief get the picture information for software decoding
+ *
+ * @param jpeg_src pointer to jpeg picture
+ * @param jpeg_size size of picture
+ * @param scale_shift scale down the picture by (1 << scale_shift), range [0, 3]
+ * @param width return the scaled picture width
+ * @param height return the scaled picture height
+ * @param strip_height return the rows of one strip (MCU row) in scaled pixels
+ *
+ * @retval 0 on success else negative errno code.
+ */
+int jpeg_sw_get_info(const void *jpeg_src, int jpeg_size, int scale_shift,
+		uint16_t *width, uint16_t *height, uint16_t *strip_height);
+
+/**
+ * @brief decode a window of the jpeg picture by software
+ *
+ * Only the baseline pictures with the sampling factors of 1 or 2 are supported.
+ * The window is in the scaled picture coordinates.
+ *
+ * @param jpeg_src pointer to jpeg picture
+ * @param jpeg_size size of picture
+ * @param bmp_buffer output buffer of the window
+ * @param output_format output format, HAL_JPEG_OUT_RGB888 or HAL_JPEG_OUT_RGB565
+ * @param output_stride output stride in pixels
+ * @param win_x window x
+ * @param win_y window y
+ * @param win_w window width
+ * @param win_h window height
+ * @param scale_shift scale down the picture by (1 << scale_shift), range [0, 3]
+ *
+ * @retval 0 on success else negative errno code.
+ */
+int jpeg_sw_decode(const void *jpeg_src, int jpeg_size,
+		void *bmp_buffer, int output_format, int output_stride,
+		int win_x, int win_y, int win_w, int win_h, int scale_shift);
+
+/**
+ * @brief decode the jpeg picture by software, one strip (MCU row) at a time
+ *
+ * The strip buffer must hold strip_height rows returned by jpeg_sw_get_info().
+ *
+ * @param jpeg_src pointer to jpeg picture
+ * @param jpeg_size size of picture
+ * @param strip_buffer output buffer of one strip
+ * @param output_format output format, HAL_JPEG_OUT_RGB888 or HAL_JPEG_OUT_RGB565
+ * @param output_stride output stride in pixels
+ * @param scale_shift scale down the picture by (1 << scale_shift), range [0, 3]
+ * @param strip_cb callback called once a strip decoded
+ * @param user_data user data passed to strip_cb
+ *
+ * @retval 0 on success else negative errno code.
+ */
+int jpeg_sw_decode_strips(const void *jpeg_src, int jpeg_size,
+		void *strip_buffer, int output_format, int output_stride,
+		int scale_shift, jpeg_sw_strip_cb_t strip_cb, void *user_data);
+
+#endif /* CONFIG_JPEG_SW_DECODER */
+
 #ifdef __cplusplus
 }
 #endif
@@ -278,16 +278,40 @@ int hal_jpeg_deinit(hal_jpeg_handle_t *hjpeg)
 	return 0;
 }
 
-int jpg_decode(void* jpeg_src, int jpeg_size,
+static int _jpg_decode(void* jpeg_src, int jpeg_size,
     void* bmp_buffer, int output_format, int output_stride,
-    int win_x, int win_y, int win_w, int win_h)
+    int win_x, int win_y, int win_w, int win_h, bool sw_fallback)
 {
     static hal_jpeg_handle_t jpg_decoder;
     static bool jpg_inited = false;
     int res;
 	int bytes_per_pixel = output_format ? 2 : 3;
 
+#ifdef CONFIG_JPEG_SW_DECODER
+	if (!sw_fallback) {
+		res = os_mutex_lock(&g_decode_mutex, OS_FOREVER);
+	} else if (os_mutex_lock(&g_decode_mutex, OS_NO_WAIT)) {
+		/* hardware decoder busy, decode by software instead of waiting */
+		res = jpeg_sw_decode(jpeg_src, jpeg_size, bmp_buffer, output_format,
+				output_stride, win_x, win_y, win_w, win_h, 0);
+		if (res == 0) {
+#ifndef CONFIG_SOC_NO_PSRAM
+			if (buf_is_psram(bmp_buffer)) {
+				mem_dcache_clean(bmp_buffer, win_h * output_stride * bytes_per_pixel);
+				mem_dcache_sync();
+			}
+#endif
+			return win_w * win_h * bytes_per_pixel;
+		}
+
+		/* not supported by software, wait for the hardware */
+		res = os_mutex_lock(&g_decode_mutex, OS_FOREVER);
+	} else {
+		res = 0;
+	}
+#else
 	res = os_mutex_lock(&g_decode_mutex, OS_FOREVER);
+#endif
 	if (res) {
 		return res;
 	}
@@ -318,3 +342,19 @@ int jpg_decode(void* jpeg_src, int jpeg_size,
     return res ? res : (win_w * win_h * bytes_per_pixel);
 }
 
+int jpg_decode(void* jpeg_src, int jpeg_size,
+    void* bmp_buffer, int output_format, int output_stride,
+    int win_x, int win_y, int win_w, int win_h)
+{
+	return _jpg_decode(jpeg_src, jpeg_size, bmp_buffer, output_format,
+			output_stride, win_x, win_y, win_w, win_h, false);
+}
+
+int jpg_decode_sw_fallback(void* jpeg_src, int jpeg_size,
+    void* bmp_buffer, int output_format, int output_stride,
+    int win_x, int win_y, int win_w, int win_h)
+{
+	return _jpg_decode(jpeg_src, jpeg_size, bmp_buffer, output_format,
+			output_stride, win_x, win_y, win_w, win_h, true);
+}
+
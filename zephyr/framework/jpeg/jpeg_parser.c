@@ -48,6 +48,23 @@ int JFREAD(jpeg_parser_info_t *parser_info, void *buf, int len)
 #define JFTELL(parser_info)  parser_info->jpeg_current_offset 
 #define JFOFFSET(parser_info)  parser_info->jpeg_current_offset
 
+/**********************************************************
+* get the table address in hardware ram or parser tables
+***********************************************************
+**/
+static inline uint8_t *_jpeg_parser_table(struct jpeg_parser_info *parser_info, uint32_t addr)
+{
+	if (parser_info->tables == NULL) {
+		return (uint8_t *)addr;
+	}
+
+	if (addr >= JPEG_VLCTABLE_RAM) {
+		return &parser_info->tables->vlc_table[addr - JPEG_VLCTABLE_RAM];
+	}
+
+	return &parser_info->tables->iq_table[addr - JPEG_IQTABLE_RAM];
+}
+
 /**********************************************************
 * get one bytes from jpeg
 ***********************************************************
@@ -187,6 +204,14 @@ static int _jpeg_parser_sof0(struct jpeg_parser_info *parser_info)
 		V[i] = HV & 0xf;
 		_jpeg_parser_getbyte(parser_info);
 		sof_len -= 3;
+
+		if (parser_info->tables) {
+			parser_info->tables->comp_hv[i] = HV;
+		}
+	}
+
+	if (parser_info->tables) {
+		parser_info->tables->num_comps = Nnum;
 	}
 
 	jpeg_info->yuv_mode = YUV_OTHER;
@@ -390,18 +415,18 @@ static int _jpeg_parser_dht(struct jpeg_parser_info *parser_info)
 		if (tcth & 0xf0) {
 			if (tcth & 0x0f) {
 				curtable    = &jpeg_info->AC_TAB1[0];
-				curvaltable = (uint8_t*)ACHuf_1;
+				curvaltable = _jpeg_parser_table(parser_info, ACHuf_1);
 			} else {
 				curtable = &jpeg_info->AC_TAB0[0];
-				curvaltable = (uint8_t*)ACHuf_0;
+				curvaltable = _jpeg_parser_table(parser_info, ACHuf_0);
 			}
 		} else {
 			if (tcth & 0x0f) {
 				curtable = &jpeg_info->DC_TAB1[0];
-				curvaltable = (uint8_t*)DCHuf_1;
+				curvaltable = _jpeg_parser_table(parser_info, DCHuf_1);
 			} else {
 				curtable = &jpeg_info->DC_TAB0[0];
-				curvaltable = (uint8_t*)DCHuf_0;
+				curvaltable = _jpeg_parser_table(parser_info, DCHuf_0);
 			}
 		}
 
@@ -411,6 +436,10 @@ static int _jpeg_parser_dht(struct jpeg_parser_info *parser_info)
 		for(i = 0;i < 16;i++) {
 			len += curtable[i];
 		}
+
+		if (len > ((tcth & 0xf0) ? 162 : 12)) {
+			return EN_NOSUPPORT;
+		}
 		//val i
 		_jpeg_parser_get_data(parser_info, curvaltable, len);
 
@@ -474,11 +503,11 @@ static int _jpeg_parser_dqt(struct jpeg_parser_info *parser_info)
 		tq = _jpeg_parser_getbyte(parser_info);
 
 		if (tq == 0x0) {
-			curtable = (uint8_t*)QT_0;
+			curtable = _jpeg_parser_table(parser_info, QT_0);
 		} else if (tq == 0x1) {
-			curtable = (uint8_t*)QT_1;
+			curtable = _jpeg_parser_table(parser_info, QT_1);
 		} else {
-			curtable = (uint8_t*)QT_2;
+			curtable = _jpeg_parser_table(parser_info, QT_2);
 		}
 		//len = 0;
 	    for (i = 0; i < 64; i++) {
@@ -490,7 +519,7 @@ static int _jpeg_parser_dqt(struct jpeg_parser_info *parser_info)
 		jpeg_info->getQTablenum++;
 
 		if (tq == 0x1) {
-			memcpy((char*)QT_2, (const char*)QT_1, 64);
+			memcpy(_jpeg_parser_table(parser_info, QT_2), _jpeg_parser_table(parser_info, QT_1), 64);
 		}
 	}
 
@@ -569,8 +598,8 @@ static int _jpeg_parser_sos(struct jpeg_parser_info *parser_info)
 	_jpeg_parser_skipbytes(parser_info, 3);
 
 	if ((jpeg_info->amountOfQTables == 3)&&(jpeg_info->getQTablenum == 1)) {
-		memcpy((char*)QT_1, (const char*)QT_0, 64);
-		memcpy((char*)QT_2, (const char*)QT_1, 64);
+		memcpy(_jpeg_parser_table(parser_info, QT_1), _jpeg_parser_table(parser_info, QT_0), 64);
+		memcpy(_jpeg_parser_table(parser_info, QT_2), _jpeg_parser_table(parser_info, QT_1), 64);
 	}
 
 	jpeg_info->stream_addr = &parser_info->jpeg_base[parser_info->jpeg_current_offset];
@@ -579,6 +608,20 @@ static int _jpeg_parser_sos(struct jpeg_parser_info *parser_info)
 	return EN_NORMAL;
 }
 
+/**********************************************************
+*	jpeg deal for 0xdd mark
+***********************************************************
+**/
+static int _jpeg_parser_dri(struct jpeg_parser_info *parser_info)
+{
+	//len
+	_jpeg_parser_get2bytes(parser_info);
+
+	parser_info->restart_interval = _jpeg_parser_get2bytes(parser_info);
+
+	return EN_NORMAL;
+}
+
 /**********************************************************
 * get mark from jpeg
 ***********************************************************
@@ -618,6 +661,7 @@ const jpeg_marker_handle_t jpeg_rout[]=
 	{M_DHT,  _jpeg_parser_dht},//0xc4
 	{M_DQT,  _jpeg_parser_dqt},//0xdb
 	{M_SOS,  _jpeg_parser_sos},//0xda
+	{M_DRI,  _jpeg_parser_dri},//0xdd
 };
 
 
@@ -656,7 +700,7 @@ int jpeg_parser_process(struct jpeg_parser_info *parser_info, int mode)
 
 		mark_handle = NULL;
 
-		for (i = 0; i < 5; i++) {
+		for (i = 0; i < ARRAY_SIZE(jpeg_rout); i++) {
 			if (tag == jpeg_rout[i].marker) {
 				mark_handle = (jpeg_marker_handle_t *)&jpeg_rout[i];
 			}
@@ -25,12 +25,24 @@ typedef enum{
 	EN_NORMAL,
 }rt_status_t;
 
+/* tables parsed into memory instead of the hardware table ram, used by software decoding */
+typedef struct jpeg_parser_tables {
+	uint8_t vlc_table[JPEG_VLCTABLE_SIZE * 4];
+	uint8_t iq_table[JPEG_IQTABLE_SIZE * 4];
+	/* number of frame components and their sampling factors (H << 4 | V) */
+	uint8_t num_comps;
+	uint8_t comp_hv[3];
+} jpeg_parser_tables_t;
+
 typedef struct jpeg_parser_info {
 	uint8_t *jpeg_base;
 	uint32_t jpeg_size;
 	uint32_t jpeg_current_offset;
 	uint32_t thumbnailoffset;
 	struct jpeg_info_t jpeg_info;
+	/* NULL to parse the tables into the hardware table ram */
+	jpeg_parser_tables_t *tables;
+	uint16_t restart_interval;
 	uint32_t  nodata:1;
 } jpeg_parser_info_t;
 
@@ -121,6 +133,9 @@ typedef struct{
 
 #define SHIFTVAL 10
 
+/* zigzag order to natural order */
+extern const uint8_t zigzag[64];
+
 int jpeg_parser_process(struct jpeg_parser_info *parser_info, int mode);
 
 #endif
@@ -0,0 +1,982 @@
+/*
+ * Copyright (c) 2020, Actions Semi Co., Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ ******************************************************************************
+ * @file    jpeg_sw_decoder.c
+ * @brief   JPEG software decoder.
+ *          Baseline JPEG decoder running on the CPU, using the tables parsed
+ *          by jpeg_parser. The picture is decoded MCU row by MCU row so that
+ *          only a window of the picture or one strip at a time is output, and
+ *          can be scaled down by 1/2, 1/4 or 1/8 while decoding by running
+ *          the reduced size IDCT on the low frequency coefficients.
+ *
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <string.h>
+#include <errno.h>
+#include <os_common_api.h>
+#include <jpeg_hal.h>
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(jpeg_sw, LOG_LEVEL_INF);
+
+/* MCU is at most 2x2 blocks of 8x8 pixels */
+#define MCU_MAX_SIZE    16
+
+#define HUFF_LOOKAHEAD  8
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+typedef struct jpeg_sw_huff {
+	/* (code length << 8) | symbol for the codes not longer than HUFF_LOOKAHEAD bits */
+	uint16_t lookup[1 << HUFF_LOOKAHEAD];
+	/* largest code of length k (-1 if none), maxcode[17] is the sentinel */
+	int32_t maxcode[18];
+	/* symbol index offset of the codes of length k */
+	int32_t valoffset[17];
+	const uint8_t *vals;
+} jpeg_sw_huff_t;
+
+typedef struct jpeg_sw_comp {
+	uint8_t h;
+	uint8_t v;
+	/* box upsampling shift to the MCU size */
+	uint8_t hshift;
+	uint8_t vshift;
+	/* rows of the plane skipped per output row, for the 2x1 subsampled component */
+	uint8_t vskip;
+	/* IDCT scale and the scaled block size of the component */
+	uint8_t idct_shift;
+	uint8_t block_size;
+	uint8_t dc_tbl;
+	uint8_t ac_tbl;
+	int16_t dc_pred;
+	const uint8_t *qtable;
+	/* samples of the component in one MCU */
+	uint8_t plane[MCU_MAX_SIZE * MCU_MAX_SIZE];
+} jpeg_sw_comp_t;
+
+typedef struct jpeg_sw_decoder {
+	jpeg_parser_info_t parser_info;
+	jpeg_parser_tables_t tables;
+
+	jpeg_sw_huff_t dc_huff[2];
+	jpeg_sw_huff_t ac_huff[2];
+	jpeg_sw_comp_t comps[3];
+	uint8_t num_comps;
+
+	/* bit reader */
+	const uint8_t *ptr;
+	const uint8_t *end;
+	uint32_t bitbuf;
+	int8_t bits;
+	uint8_t marker : 1;
+
+	/* MCU size in scaled pixels */
+	uint8_t mcu_w;
+	uint8_t mcu_h;
+	uint16_t mcu_cols;
+	uint16_t mcu_rows;
+	/* scaled picture size */
+	uint16_t width;
+	uint16_t height;
+
+	int32_t coef[64];
+} jpeg_sw_decoder_t;
+
+typedef struct jpeg_sw_output {
+	uint8_t *buffer;
+	uint8_t format;
+	uint8_t bytes_per_pixel;
+	uint16_t stride;
+	/* picture row stored in the first row of buffer */
+	int16_t buf_y;
+	/* window to output in scaled pixels */
+	int16_t x1, y1, x2, y2;
+} jpeg_sw_output_t;
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static OS_MUTEX_DEFINE(g_sw_decode_mutex);
+
+static jpeg_sw_decoder_t g_sw_decoder;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static inline uint8_t _clamp_sample(int32_t val)
+{
+	return (val < 0) ? 0 : ((val > 255) ? 255 : val);
+}
+
+static int _jpeg_sw_build_huff(jpeg_sw_huff_t *huff, const uint8_t *bits, const uint8_t *vals)
+{
+	int32_t code = 0;
+	int p = 0;
+	int l, i;
+
+	for (l = 1; l <= 16; l++) {
+		huff->valoffset[l] = p - code;
+		if (bits[l - 1]) {
+			code += bits[l - 1];
+			p += bits[l - 1];
+			huff->maxcode[l] = code - 1;
+		} else {
+			huff->maxcode[l] = -1;
+		}
+
+		/* more codes than the code length can represent */
+		if (code > (1 << l)) {
+			return -EINVAL;
+		}
+
+		code <<= 1;
+	}
+
+	huff->maxcode[17] = INT32_MAX;
+	huff->vals = vals;
+
+	memset(huff->lookup, 0, sizeof(huff->lookup));
+
+	code = 0;
+	p = 0;
+	for (l = 1; l <= HUFF_LOOKAHEAD; l++) {
+		for (i = 0; i < bits[l - 1]; i++, p++, code++) {
+			int look = code << (HUFF_LOOKAHEAD - l);
+			int n = 1 << (HUFF_LOOKAHEAD - l);
+
+			while (n-- > 0) {
+				huff->lookup[look++] = (l << 8) | vals[p];
+			}
+		}
+
+		code <<= 1;
+	}
+
+	return 0;
+}
+
+static void _jpeg_sw_fill_bits(jpeg_sw_decoder_t *dec)
+{
+	while (dec->bits <= 24) {
+		uint32_t c = 0;
+
+		if (!dec->marker && dec->ptr < dec->end) {
+			c = *dec->ptr++;
+			if (c == 0xFF) {
+				if (dec->ptr < dec->end && *dec->ptr == 0) {
+					/* stuffed zero byte */
+					dec->ptr++;
+				} else {
+					/* reach a marker, stay on it and feed zeros */
+					dec->ptr--;
+					dec->marker = 1;
+					c = 0;
+				}
+			}
+		}
+
+		dec->bitbuf |= c << (24 - dec->bits);
+		dec->bits += 8;
+	}
+}
+
+static inline int _jpeg_sw_get_bits(jpeg_sw_decoder_t *dec, int n)
+{
+	int val;
+
+	_jpeg_sw_fill_bits(dec);
+
+	val = dec->bitbuf >> (32 - n);
+	dec->bitbuf <<= n;
+	dec->bits -= n;
+	return val;
+}
+
+static inline int _jpeg_sw_extend(jpeg_sw_decoder_t *dec, int s)
+{
+	int val = _jpeg_sw_get_bits(dec, s);
+
+	return (val < (1 << (s - 1))) ? (val - (1 << s) + 1) : val;
+}
+
+static int _jpeg_sw_decode_huff(jpeg_sw_decoder_t *dec, const jpeg_sw_huff_t *huff)
+{
+	int32_t code;
+	int l;
+
+	_jpeg_sw_fill_bits(dec);
+
+	l = huff->lookup[dec->bitbuf >> (32 - HUFF_LOOKAHEAD)];
+	if (l >> 8) {
+		dec->bitbuf <<= (l >> 8);
+		dec->bits -= (l >> 8);
+		return l & 0xFF;
+	}
+
+	for (l = HUFF_LOOKAHEAD + 1; ; l++) {
+		code = dec->bitbuf >> (32 - l);
+		if (code <= huff->maxcode[l]) {
+			break;
+		}
+	}
+
+	if (l > 16) {
+		return -EIO;
+	}
+
+	dec->bitbuf <<= l;
+	dec->bits -= l;
+	return huff->vals[code + huff->valoffset[l]];
+}
+
+static int _jpeg_sw_decode_block(jpeg_sw_decoder_t *dec, jpeg_sw_comp_t *comp)
+{
+	int32_t *coef = dec->coef;
+	int k, s, r;
+
+	memset(coef, 0, sizeof(dec->coef));
+
+	s = _jpeg_sw_decode_huff(dec, &dec->dc_huff[comp->dc_tbl]);
+	if (s < 0 || s > 11) {
+		return -EIO;
+	}
+
+	if (s) {
+		comp->dc_pred += _jpeg_sw_extend(dec, s);
+	}
+
+	coef[0] = comp->dc_pred * comp->qtable[0];
+
+	for (k = 1; k < 64; k++) {
+		s = _jpeg_sw_decode_huff(dec, &dec->ac_huff[comp->ac_tbl]);
+		if (s < 0) {
+			return -EIO;
+		}
+
+		r = s >> 4;
+		s &= 0x0F;
+
+		if (s) {
+			k += r;
+			if (k > 63 || s > 10) {
+				return -EIO;
+			}
+
+			coef[zigzag[k]] = _jpeg_sw_extend(dec, s) * comp->qtable[zigzag[k]];
+		} else if (r == 15) {
+			k += 15;
+		} else {
+			break;
+		}
+	}
+
+	return 0;
+}
+
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+#define FIX_0_298631336  2446
+#define FIX_0_390180644  3196
+#define FIX_0_541196100  4433
+#define FIX_0_765366865  6270
+#define FIX_0_899976223  7373
+#define FIX_1_175875602  9633
+#define FIX_1_501321110  12299
+#define FIX_1_847759065  15137
+#define FIX_1_961570560  16069
+#define FIX_2_053119869  16819
+#define FIX_2_562915447  20995
+#define FIX_3_072711026  25172
+
+#define FIX_0_211164243  1730
+#define FIX_0_509795579  4176
+#define FIX_0_601344887  4926
+#define FIX_0_720959822  5906
+#define FIX_0_850430095  6967
+#define FIX_1_061594337  8697
+#define FIX_1_272758580  10426
+#define FIX_1_451774981  11893
+#define FIX_2_172734803  17799
+#define FIX_3_624509785  29692
+
+#define DESCALE(x, n)  (((x) + (1 << ((n) - 1))) >> (n))
+
+/* accurate integer IDCT (the "islow" algorithm of the IJG library) */
+static void _jpeg_sw_idct_8x8(const int32_t *coef, uint8_t *out, int stride)
+{
+	int32_t ws[64];
+	int32_t tmp0, tmp1, tmp2, tmp3, tmp10, tmp11, tmp12, tmp13;
+	int32_t z1, z2, z3, z4, z5;
+	const int32_t *in;
+	int32_t *w;
+	int i;
+
+	/* pass 1: columns from the coefficients into the work space */
+	for (i = 0, in = coef, w = ws; i < 8; i++, in++, w++) {
+		if ((in[8] | in[16] | in[24] | in[32] | in[40] | in[48] | in[56]) == 0) {
+			int32_t dcval = in[0] << PASS1_BITS;
+
+			w[0] = w[8] = w[16] = w[24] = w[32] = w[40] = w[48] = w[56] = dcval;
+			continue;
+		}
+
+		z2 = in[16];
+		z3 = in[48];
+		z1 = (z2 + z3) * FIX_0_541196100;
+		tmp2 = z1 - z3 * FIX_1_847759065;
+		tmp3 = z1 + z2 * FIX_0_765366865;
+
+		tmp0 = (in[0] + in[32]) << CONST_BITS;
+		tmp1 = (in[0] - in[32]) << CONST_BITS;
+
+		tmp10 = tmp0 + tmp3;
+		tmp13 = tmp0 - tmp3;
+		tmp11 = tmp1 + tmp2;
+		tmp12 = tmp1 - tmp2;
+
+		tmp0 = in[56];
+		tmp1 = in[40];
+		tmp2 = in[24];
+		tmp3 = in[8];
+
+		z1 = tmp0 + tmp3;
+		z2 = tmp1 + tmp2;
+		z3 = tmp0 + tmp2;
+		z4 = tmp1 + tmp3;
+		z5 = (z3 + z4) * FIX_1_175875602;
+
+		tmp0 *= FIX_0_298631336;
+		tmp1 *= FIX_2_053119869;
+		tmp2 *= FIX_3_072711026;
+		tmp3 *= FIX_1_501321110;
+		z1 *= -FIX_0_899976223;
+		z2 *= -FIX_2_562915447;
+		z3 = z3 * -FIX_1_961570560 + z5;
+		z4 = z4 * -FIX_0_390180644 + z5;
+
+		tmp0 += z1 + z3;
+		tmp1 += z2 + z4;
+		tmp2 += z2 + z3;
+		tmp3 += z1 + z4;
+
+		w[0]  = DESCALE(tmp10 + tmp3, CONST_BITS - PASS1_BITS);
+		w[56] = DESCALE(tmp10 - tmp3, CONST_BITS - PASS1_BITS);
+		w[8]  = DESCALE(tmp11 + tmp2, CONST_BITS - PASS1_BITS);
+		w[48] = DESCALE(tmp11 - tmp2, CONST_BITS - PASS1_BITS);
+		w[16] = DESCALE(tmp12 + tmp1, CONST_BITS - PASS1_BITS);
+		w[40] = DESCALE(tmp12 - tmp1, CONST_BITS - PASS1_BITS);
+		w[24] = DESCALE(tmp13 + tmp0, CONST_BITS - PASS1_BITS);
+		w[32] = DESCALE(tmp13 - tmp0, CONST_BITS - PASS1_BITS);
+	}
+
+	/* pass 2: rows from the work space into the samples */
+	for (i = 0, w = ws; i < 8; i++, w += 8, out += stride) {
+		if ((w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) == 0) {
+			uint8_t outval = _clamp_sample(DESCALE(w[0], PASS1_BITS + 3) + 128);
+
+			memset(out, outval, 8);
+			continue;
+		}
+
+		z2 = w[2];
+		z3 = w[6];
+		z1 = (z2 + z3) * FIX_0_541196100;
+		tmp2 = z1 - z3 * FIX_1_847759065;
+		tmp3 = z1 + z2 * FIX_0_765366865;
+
+		tmp0 = (w[0] + w[4]) << CONST_BITS;
+		tmp1 = (w[0] - w[4]) << CONST_BITS;
+
+		tmp10 = tmp0 + tmp3;
+		tmp13 = tmp0 - tmp3;
+		tmp11 = tmp1 + tmp2;
+		tmp12 = tmp1 - tmp2;
+
+		tmp0 = w[7];
+		tmp1 = w[5];
+		tmp2 = w[3];
+		tmp3 = w[1];
+
+		z1 = tmp0 + tmp3;
+		z2 = tmp1 + tmp2;
+		z3 = tmp0 + tmp2;
+		z4 = tmp1 + tmp3;
+		z5 = (z3 + z4) * FIX_1_175875602;
+
+		tmp0 *= FIX_0_298631336;
+		tmp1 *= FIX_2_053119869;
+		tmp2 *= FIX_3_072711026;
+		tmp3 *= FIX_1_501321110;
+		z1 *= -FIX_0_899976223;
+		z2 *= -FIX_2_562915447;
+		z3 = z3 * -FIX_1_961570560 + z5;
+		z4 = z4 * -FIX_0_390180644 + z5;
+
+		tmp0 += z1 + z3;
+		tmp1 += z2 + z4;
+		tmp2 += z2 + z3;
+		tmp3 += z1 + z4;
+
+		out[0] = _clamp_sample(DESCALE(tmp10 + tmp3, CONST_BITS + PASS1_BITS + 3) + 128);
+		out[7] = _clamp_sample(DESCALE(tmp10 - tmp3, CONST_BITS + PASS1_BITS + 3) + 128);
+		out[1] = _clamp_sample(DESCALE(tmp11 + tmp2, CONST_BITS + PASS1_BITS + 3) + 128);
+		out[6] = _clamp_sample(DESCALE(tmp11 - tmp2, CONST_BITS + PASS1_BITS + 3) + 128);
+		out[2] = _clamp_sample(DESCALE(tmp12 + tmp1, CONST_BITS + PASS1_BITS + 3) + 128);
+		out[5] = _clamp_sample(DESCALE(tmp12 - tmp1, CONST_BITS + PASS1_BITS + 3) + 128);
+		out[3] = _clamp_sample(DESCALE(tmp13 + tmp0, CONST_BITS + PASS1_BITS + 3) + 128);
+		out[4] = _clamp_sample(DESCALE(tmp13 - tmp0, CONST_BITS + PASS1_BITS + 3) + 128);
+	}
+}
+
+/*
+ * reduced size IDCT producing the averages of 2x2 output samples of the 8x8 IDCT,
+ * the coefficient row/column 4 does not contribute to the averages
+ */
+static void _jpeg_sw_idct_4x4(const int32_t *coef, uint8_t *out, int stride)
+{
+	int32_t ws[8 * 4];
+	int32_t tmp0, tmp2, tmp10, tmp12;
+	const int32_t *in;
+	int32_t *w;
+	int i;
+
+	/* pass 1: columns from the coefficients into the work space */
+	for (i = 0, in = coef, w = ws; i < 8; i++, in++, w++) {
+		if (i == 4) {
+			continue;
+		}
+
+		if ((in[8] | in[16] | in[24] | in[40] | in[48] | in[56]) == 0) {
+			int32_t dcval = in[0] << PASS1_BITS;
+
+			w[0] = w[8] = w[16] = w[24] = dcval;
+			continue;
+		}
+
+		tmp0 = in[0] << (CONST_BITS + 1);
+		tmp2 = in[16] * FIX_1_847759065 - in[48] * FIX_0_765366865;
+
+		tmp10 = tmp0 + tmp2;
+		tmp12 = tmp0 - tmp2;
+
+		tmp0 = in[56] * -FIX_0_211164243 + in[40] * FIX_1_451774981 +
+			in[24] * -FIX_2_172734803 + in[8] * FIX_1_061594337;
+		tmp2 = in[56] * -FIX_0_509795579 + in[40] * -FIX_0_601344887 +
+			in[24] * FIX_0_899976223 + in[8] * FIX_2_562915447;
+
+		w[0]  = DESCALE(tmp10 + tmp2, CONST_BITS - PASS1_BITS + 1);
+		w[24] = DESCALE(tmp10 - tmp2, CONST_BITS - PASS1_BITS + 1);
+		w[8]  = DESCALE(tmp12 + tmp0, CONST_BITS - PASS1_BITS + 1);
+		w[16] = DESCALE(tmp12 - tmp0, CONST_BITS - PASS1_BITS + 1);
+	}
+
+	/* pass 2: 4 rows from the work space into the samples */
+	for (i = 0, w = ws; i < 4; i++, w += 8, out += stride) {
+		if ((w[1] | w[2] | w[3] | w[5] | w[6] | w[7]) == 0) {
+			uint8_t outval = _clamp_sample(DESCALE(w[0], PASS1_BITS + 3) + 128);
+
+			memset(out, outval, 4);
+			continue;
+		}
+
+		tmp0 = w[0] << (CONST_BITS + 1);
+		tmp2 = w[2] * FIX_1_847759065 - w[6] * FIX_0_765366865;
+
+		tmp10 = tmp0 + tmp2;
+		tmp12 = tmp0 - tmp2;
+
+		tmp0 = w[7] * -FIX_0_211164243 + w[5] * FIX_1_451774981 +
+			w[3] * -FIX_2_172734803 + w[1] * FIX_1_061594337;
+		tmp2 = w[7] * -FIX_0_509795579 + w[5] * -FIX_0_601344887 +
+			w[3] * FIX_0_899976223 + w[1] * FIX_2_562915447;
+
+		out[0] = _clamp_sample(DESCALE(tmp10 + tmp2, CONST_BITS + PASS1_BITS + 3 + 1) + 128);
+		out[3] = _clamp_sample(DESCALE(tmp10 - tmp2, CONST_BITS + PASS1_BITS + 3 + 1) + 128);
+		out[1] = _clamp_sample(DESCALE(tmp12 + tmp0, CONST_BITS + PASS1_BITS + 3 + 1) + 128);
+		out[2] = _clamp_sample(DESCALE(tmp12 - tmp0, CONST_BITS + PASS1_BITS + 3 + 1) + 128);
+	}
+}
+
+/* reduced size IDCT producing the averages of 4x4 output samples, only the odd coefficients contribute */
+static void _jpeg_sw_idct_2x2(const int32_t *coef, uint8_t *out, int stride)
+{
+	int32_t ws[8 * 2];
+	int32_t tmp0, tmp10;
+	const int32_t *in;
+	int32_t *w;
+	int i;
+
+	/* pass 1: columns from the coefficients into the work space */
+	for (i = 0, in = coef, w = ws; i < 8; i++, in++, w++) {
+		if (i == 2 || i == 4 || i == 6) {
+			continue;
+		}
+
+		if ((in[8] | in[24] | in[40] | in[56]) == 0) {
+			int32_t dcval = in[0] << PASS1_BITS;
+
+			w[0] = w[8] = dcval;
+			continue;
+		}
+
+		tmp10 = in[0] << (CONST_BITS + 2);
+		tmp0 = in[56] * -FIX_0_720959822 + in[40] * FIX_0_850430095 +
+			in[24] * -FIX_1_272758580 + in[8] * FIX_3_624509785;
+
+		w[0] = DESCALE(tmp10 + tmp0, CONST_BITS - PASS1_BITS + 2);
+		w[8] = DESCALE(tmp10 - tmp0, CONST_BITS - PASS1_BITS + 2);
+	}
+
+	/* pass 2: 2 rows from the work space into the samples */
+	for (i = 0, w = ws; i < 2; i++, w += 8, out += stride) {
+		if ((w[1] | w[3] | w[5] | w[7]) == 0) {
+			out[0] = out[1] = _clamp_sample(DESCALE(w[0], PASS1_BITS + 3) + 128);
+			continue;
+		}
+
+		tmp10 = w[0] << (CONST_BITS + 2);
+		tmp0 = w[7] * -FIX_0_720959822 + w[5] * FIX_0_850430095 +
+			w[3] * -FIX_1_272758580 + w[1] * FIX_3_624509785;
+
+		out[0] = _clamp_sample(DESCALE(tmp10 + tmp0, CONST_BITS + PASS1_BITS + 3 + 2) + 128);
+		out[1] = _clamp_sample(DESCALE(tmp10 - tmp0, CONST_BITS + PASS1_BITS + 3 + 2) + 128);
+	}
+}
+
+static void _jpeg_sw_idct(jpeg_sw_decoder_t *dec, int idct_shift, uint8_t *out, int stride)
+{
+	switch (idct_shift) {
+	case 0:
+		_jpeg_sw_idct_8x8(dec->coef, out, stride);
+		break;
+	case 1:
+		_jpeg_sw_idct_4x4(dec->coef, out, stride);
+		break;
+	case 2:
+		_jpeg_sw_idct_2x2(dec->coef, out, stride);
+		break;
+	default:
+		out[0] = _clamp_sample(DESCALE(dec->coef[0], 3) + 128);
+		break;
+	}
+}
+
+static void _jpeg_sw_restart(jpeg_sw_decoder_t *dec)
+{
+	int i;
+
+	/* discard the padding bits and skip the RSTn marker */
+	while (dec->ptr + 1 < dec->end) {
+		if (dec->ptr[0] == 0xFF && dec->ptr[1] >= M_RST0 && dec->ptr[1] <= M_RST7) {
+			dec->ptr += 2;
+			break;
+		}
+
+		dec->ptr++;
+	}
+
+	dec->bitbuf = 0;
+	dec->bits = 0;
+	dec->marker = 0;
+
+	for (i = 0; i < dec->num_comps; i++) {
+		dec->comps[i].dc_pred = 0;
+	}
+}
+
+static inline const uint8_t *_jpeg_sw_plane_row(const jpeg_sw_comp_t *comp, int py)
+{
+	return &comp->plane[((py << comp->vskip) >> comp->vshift) * comp->h * comp->block_size];
+}
+
+static void _jpeg_sw_color_convert(jpeg_sw_decoder_t *dec, jpeg_sw_output_t *output,
+				int mcu_x, int mcu_y)
+{
+	jpeg_sw_comp_t *comps = dec->comps;
+	int x1 = MAX(mcu_x, output->x1);
+	int y1 = MAX(mcu_y, output->y1);
+	int x2 = MIN(mcu_x + dec->mcu_w - 1, output->x2);
+	int y2 = MIN(mcu_y + dec->mcu_h - 1, output->y2);
+	int x, y;
+
+	for (y = y1; y <= y2; y++) {
+		uint8_t *dst = output->buffer + ((y - output->buf_y) * output->stride
+				+ (x1 - output->x1)) * output->bytes_per_pixel;
+		int py = y - mcu_y;
+		const uint8_t *y_row = _jpeg_sw_plane_row(&comps[0], py);
+		const uint8_t *cb_row = NULL;
+		const uint8_t *cr_row = NULL;
+
+		if (dec->num_comps == 3) {
+			cb_row = _jpeg_sw_plane_row(&comps[1], py);
+			cr_row = _jpeg_sw_plane_row(&comps[2], py);
+		}
+
+		for (x = x1; x <= x2; x++) {
+			int px = x - mcu_x;
+			int luma = y_row[px >> comps[0].hshift];
+			uint8_t r, g, b;
+
+			if (cb_row) {
+				int cb = cb_row[px >> comps[1].hshift] - 128;
+				int cr = cr_row[px >> comps[2].hshift] - 128;
+
+				r = _clamp_sample(luma + ((91881 * cr + 32768) >> 16));
+				g = _clamp_sample(luma + ((-22554 * cb - 46802 * cr + 32768) >> 16));
+				b = _clamp_sample(luma + ((116130 * cb + 32768) >> 16));
+			} else {
+				r = g = b = luma;
+			}
+
+			if (output->format == HAL_JPEG_OUT_RGB565) {
+				*(uint16_t *)dst = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+				dst += 2;
+			} else {
+				dst[0] = b;
+				dst[1] = g;
+				dst[2] = r;
+				dst += 3;
+			}
+		}
+	}
+}
+
+static int _jpeg_sw_decode_mcu(jpeg_sw_decoder_t *dec, bool output)
+{
+	int i, bx, by, ret;
+
+	for (i = 0; i < dec->num_comps; i++) {
+		jpeg_sw_comp_t *comp = &dec->comps[i];
+		int bs = comp->block_size;
+		int plane_stride = comp->h * bs;
+
+		for (by = 0; by < comp->v; by++) {
+			for (bx = 0; bx < comp->h; bx++) {
+				ret = _jpeg_sw_decode_block(dec, comp);
+				if (ret) {
+					return ret;
+				}
+
+				if (output) {
+					_jpeg_sw_idct(dec, comp->idct_shift,
+							&comp->plane[by * bs * plane_stride + bx * bs], plane_stride);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int _jpeg_sw_prepare(jpeg_sw_decoder_t *dec, const void *jpeg_src, int jpeg_size,
+				int scale_shift)
+{
+	const struct jpeg_head_info *head_info = jpeg_src;
+	jpeg_parser_info_t *parser_info = &dec->parser_info;
+	struct jpeg_info_t *jpeg_info = &parser_info->jpeg_info;
+	uint8_t hmax = 1, vmax = 1;
+	int i;
+
+	if (jpeg_src == NULL || scale_shift < 0 || scale_shift > 3) {
+		return -EINVAL;
+	}
+
+	if (head_info->flag == JPEG_FLAG) {
+		/* the tiled pictures are left to the hardware decoder */
+		if (head_info->split_num > 1) {
+			return -ENOTSUP;
+		}
+
+		jpeg_src = (const uint8_t *)jpeg_src + sizeof(*head_info);
+		jpeg_size -= sizeof(*head_info);
+	}
+
+	memset(parser_info, 0, sizeof(*parser_info));
+	memset(&dec->tables, 0, sizeof(dec->tables));
+	parser_info->jpeg_base = (uint8_t *)jpeg_src;
+	parser_info->jpeg_size = jpeg_size;
+	parser_info->tables = &dec->tables;
+
+	do {
+		/* skip the exif thumbnail and go on with the primary picture */
+		parser_info->thumbnailoffset = 0;
+
+		if (jpeg_parser_process(parser_info, 1)) {
+			return -EINVAL;
+		}
+	} while (jpeg_info->stream_addr == NULL && parser_info->thumbnailoffset != 0);
+
+	if (jpeg_info->stream_addr == NULL || jpeg_info->image_w == 0 || jpeg_info->image_h == 0) {
+		return -EINVAL;
+	}
+
+	if (dec->tables.num_comps == 1 && jpeg_info->scan.Ns == 1) {
+		dec->num_comps = 1;
+		dec->comps[0].h = 1;
+		dec->comps[0].v = 1;
+		dec->comps[0].dc_tbl = jpeg_info->scan.Td[0];
+		dec->comps[0].ac_tbl = jpeg_info->scan.Ta[0];
+	} else if (dec->tables.num_comps == 3 && jpeg_info->scan.Ns == 3) {
+		dec->num_comps = 3;
+		for (i = 0; i < 3; i++) {
+			dec->comps[i].h = dec->tables.comp_hv[i] >> 4;
+			dec->comps[i].v = dec->tables.comp_hv[i] & 0x0F;
+			dec->comps[i].dc_tbl = jpeg_info->scan.Td[i];
+			dec->comps[i].ac_tbl = jpeg_info->scan.Ta[i];
+
+			if (dec->comps[i].h < 1 || dec->comps[i].h > 2 ||
+				dec->comps[i].v < 1 || dec->comps[i].v > 2) {
+				return -ENOTSUP;
+			}
+
+			hmax = MAX(hmax, dec->comps[i].h);
+			vmax = MAX(vmax, dec->comps[i].v);
+		}
+	} else {
+		return -ENOTSUP;
+	}
+
+	for (i = 0; i < dec->num_comps; i++) {
+		jpeg_sw_comp_t *comp = &dec->comps[i];
+
+		if (comp->dc_tbl > 1 || comp->ac_tbl > 1) {
+			return -ENOTSUP;
+		}
+
+		comp->hshift = (comp->h < hmax) ? 1 : 0;
+		comp->vshift = (comp->v < vmax) ? 1 : 0;
+		comp->vskip = 0;
+		comp->idct_shift = scale_shift;
+
+		/* scale the 2x2 subsampled component by a larger IDCT instead of upsampling */
+		if (scale_shift > 0 && comp->hshift && comp->vshift) {
+			comp->idct_shift--;
+			comp->hshift = 0;
+			comp->vshift = 0;
+		}
+
+		/*
+		 * the 2x1 subsampled component too, the larger IDCT is square,
+		 * so take every other row of it
+		 */
+		if (scale_shift > 0 && comp->hshift && !comp->vshift) {
+			comp->idct_shift--;
+			comp->hshift = 0;
+			comp->vskip = 1;
+		}
+
+		comp->block_size = 8 >> comp->idct_shift;
+		comp->dc_pred = 0;
+		/* the parser arranges the component i to use the quantization table i */
+		comp->qtable = &dec->tables.iq_table[QT_0 - JPEG_IQTABLE_RAM + i * 64];
+	}
+
+	if (_jpeg_sw_build_huff(&dec->dc_huff[0], jpeg_info->DC_TAB0,
+			&dec->tables.vlc_table[DCHuf_0 - JPEG_VLCTABLE_RAM]) ||
+		_jpeg_sw_build_huff(&dec->dc_huff[1], jpeg_info->DC_TAB1,
+			&dec->tables.vlc_table[DCHuf_1 - JPEG_VLCTABLE_RAM]) ||
+		_jpeg_sw_build_huff(&dec->ac_huff[0], jpeg_info->AC_TAB0,
+			&dec->tables.vlc_table[ACHuf_0 - JPEG_VLCTABLE_RAM]) ||
+		_jpeg_sw_build_huff(&dec->ac_huff[1], jpeg_info->AC_TAB1,
+			&dec->tables.vlc_table[ACHuf_1 - JPEG_VLCTABLE_RAM])) {
+		return -EINVAL;
+	}
+
+	dec->mcu_w = (hmax * 8) >> scale_shift;
+	dec->mcu_h = (vmax * 8) >> scale_shift;
+	dec->mcu_cols = (jpeg_info->image_w + hmax * 8 - 1) / (hmax * 8);
+	dec->mcu_rows = (jpeg_info->image_h + vmax * 8 - 1) / (vmax * 8);
+	dec->width = (jpeg_info->image_w + (1 << scale_shift) - 1) >> scale_shift;
+	dec->height = (jpeg_info->image_h + (1 << scale_shift) - 1) >> scale_shift;
+
+	dec->ptr = jpeg_info->stream_addr;
+	dec->end = jpeg_info->stream_addr + jpeg_info->stream_size;
+	dec->bitbuf = 0;
+	dec->bits = 0;
+	dec->marker = 0;
+
+	return 0;
+}
+
+/*
+ * Decode the MCU rows from the top of the picture until the bottom of the output
+ * window. If strip_cb is not NULL, the buffer holds one MCU row, which is passed
+ * to strip_cb once completed.
+ */
+static int _jpeg_sw_decode_rows(jpeg_sw_decoder_t *dec, jpeg_sw_output_t *output,
+				jpeg_sw_strip_cb_t strip_cb, void *user_data)
+{
+	uint16_t restart_interval = dec->parser_info.restart_interval;
+	uint16_t restarts_to_go = restart_interval;
+	int mcu_col, mcu_row, mcu_x, mcu_y;
+	int ret;
+
+	for (mcu_row = 0, mcu_y = 0; mcu_row < dec->mcu_rows; mcu_row++, mcu_y += dec->mcu_h) {
+		bool row_visible = (mcu_y <= output->y2 && mcu_y + dec->mcu_h > output->y1);
+
+		if (mcu_y > output->y2) {
+			break;
+		}
+
+		if (strip_cb) {
+			output->buf_y = mcu_y;
+		}
+
+		for (mcu_col = 0, mcu_x = 0; mcu_col < dec->mcu_cols; mcu_col++, mcu_x += dec->mcu_w) {
+			bool visible = row_visible && (mcu_x <= output->x2 && mcu_x + dec->mcu_w > output->x1);
+
+			if (restart_interval) {
+				if (restarts_to_go == 0) {
+					_jpeg_sw_restart(dec);
+					restarts_to_go = restart_interval;
+				}
+
+				restarts_to_go--;
+			}
+
+			ret = _jpeg_sw_decode_mcu(dec, visible);
+			if (ret) {
+				LOG_ERR("corrupt data at mcu (%d, %d)", mcu_col, mcu_row);
+				return ret;
+			}
+
+			if (visible) {
+				_jpeg_sw_color_convert(dec, output, mcu_x, mcu_y);
+			}
+		}
+
+		if (strip_cb && row_visible) {
+			ret = strip_cb(user_data, output->buffer, mcu_y,
+					MIN(dec->mcu_h, dec->height - mcu_y));
+			if (ret) {
+				return ret;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int jpeg_sw_get_info(const void *jpeg_src, int jpeg_size, int scale_shift,
+				uint16_t *width, uint16_t *height, uint16_t *strip_height)
+{
+	jpeg_sw_decoder_t *dec = &g_sw_decoder;
+	int ret;
+
+	os_mutex_lock(&g_sw_decode_mutex, OS_FOREVER);
+
+	ret = _jpeg_sw_prepare(dec, jpeg_src, jpeg_size, scale_shift);
+	if (ret == 0) {
+		if (width)
+			*width = dec->width;
+		if (height)
+			*height = dec->height;
+		if (strip_height)
+			*strip_height = dec->mcu_h;
+	}
+
+	os_mutex_unlock(&g_sw_decode_mutex);
+	return ret;
+}
+
+int jpeg_sw_decode(const void *jpeg_src, int jpeg_size,
+				void *bmp_buffer, int output_format, int output_stride,
+				int win_x, int win_y, int win_w, int win_h, int scale_shift)
+{
+	jpeg_sw_decoder_t *dec = &g_sw_decoder;
+	jpeg_sw_output_t output;
+	int ret;
+
+	if (bmp_buffer == NULL || win_x < 0 || win_y < 0 || win_w <= 0 || win_h <= 0 ||
+		output_stride < win_w) {
+		return -EINVAL;
+	}
+
+	os_mutex_lock(&g_sw_decode_mutex, OS_FOREVER);
+
+	ret = _jpeg_sw_prepare(dec, jpeg_src, jpeg_size, scale_shift);
+	if (ret) {
+		goto err_exit;
+	}
+
+	if (win_x + win_w > dec->width || win_y + win_h > dec->height) {
+		ret = -EINVAL;
+		goto err_exit;
+	}
+
+	output.buffer = bmp_buffer;
+	output.format = output_format;
+	output.bytes_per_pixel = (output_format == HAL_JPEG_OUT_RGB565) ? 2 : 3;
+	output.stride = output_stride;
+	output.buf_y = win_y;
+	output.x1 = win_x;
+	output.y1 = win_y;
+	output.x2 = win_x + win_w - 1;
+	output.y2 = win_y + win_h - 1;
+
+	ret = _jpeg_sw_decode_rows(dec, &output, NULL, NULL);
+
+err_exit:
+	os_mutex_unlock(&g_sw_decode_mutex);
+	return ret;
+}
+
+int jpeg_sw_decode_strips(const void *jpeg_src, int jpeg_size,
+				void *strip_buffer, int output_format, int output_stride,
+				int scale_shift, jpeg_sw_strip_cb_t strip_cb, void *user_data)
+{
+	jpeg_sw_decoder_t *dec = &g_sw_decoder;
+	jpeg_sw_output_t output;
+	int ret;
+
+	if (strip_buffer == NULL || strip_cb == NULL) {
+		return -EINVAL;
+	}
+
+	os_mutex_lock(&g_sw_decode_mutex, OS_FOREVER);
+
+	ret = _jpeg_sw_prepare(dec, jpeg_src, jpeg_size, scale_shift);
+	if (ret) {
+		goto err_exit;
+	}
+
+	if (output_stride < dec->width) {
+		ret = -EINVAL;
+		goto err_exit;
+	}
+
+	output.buffer = strip_buffer;
+	output.format = output_format;
+	output.bytes_per_pixel = (output_format == HAL_JPEG_OUT_RGB565) ? 2 : 3;
+	output.stride = output_stride;
+	output.buf_y = 0;
+	output.x1 = 0;
+	output.y1 = 0;
+	output.x2 = dec->width - 1;
+	output.y2 = dec->height - 1;
+
+	ret = _jpeg_sw_decode_rows(dec, &output, strip_cb, user_data);
+
+err_exit:
+	os_mutex_unlock(&g_sw_decode_mutex);
+	return ret;
+}